@@ -20,16 +20,22 @@ package etchash
 
 /*
 #include "src/libetchash/internal.h"
+#include "src/libetchash/boundary.h"
 
-int etchashGoCallback_cgo(unsigned);
+int etchashGoProgress_cgo(etchash_progress_t const*, void*);
+
+// handles are plain integers, Go pointers must not be passed to C
+static inline void* etchashGoHandle(uintptr_t id) { return (void*)id; }
 */
 import "C"
 
 import (
+	"encoding/binary"
 	"errors"
 	"fmt"
 	"io/ioutil"
 	"math/big"
+	"math/bits"
 	"math/rand"
 	"os"
 	"os/user"
@@ -72,18 +78,52 @@ func defaultDir() string {
 	return filepath.Join(home, ".etchash")
 }
 
+// refCount counts the holders of a native handle. Whoever drops the count to
+// zero frees the handle right away; finalizers only catch handles that are
+// never released.
+type refCount struct {
+	refs int32
+}
+
+// acquire adds a holder, it fails once the handle has been released for good.
+func (r *refCount) acquire() bool {
+	for {
+		n := atomic.LoadInt32(&r.refs)
+		if n <= 0 {
+			return false
+		}
+		if atomic.CompareAndSwapInt32(&r.refs, n, n+1) {
+			return true
+		}
+	}
+}
+
+// drop removes a holder and reports whether it was the last one.
+func (r *refCount) drop() bool {
+	n := atomic.AddInt32(&r.refs, -1)
+	if n < 0 {
+		panic("etchash: native handle released more often than acquired")
+	}
+	return n == 0
+}
+
 // cache wraps an etchash_light_t with some metadata
-// and automatic memory management.
+// and reference counted memory management.
 type cache struct {
 	epoch       uint64
 	epochLength uint64
 	used        time.Time
 	test        bool
+	refCount    // the owning Light holds one reference, every Verify another
 
 	gen sync.Once // ensures cache is only generated once.
 	ptr *C.struct_etchash_light
 }
 
+func newCache(epoch, epochLength uint64, test bool) *cache {
+	return &cache{epoch: epoch, epochLength: epochLength, test: test, refCount: refCount{refs: 1}}
+}
+
 // generate creates the actual cache. it can be called from multiple
 // goroutines. the first call will generate the cache, subsequent
 // calls wait until it is generated.
@@ -103,8 +143,21 @@ func (cache *cache) generate() {
 }
 
 func freeCache(cache *cache) {
-	C.etchash_light_delete(cache.ptr)
-	cache.ptr = nil
+	if cache.ptr != nil {
+		C.etchash_light_delete(cache.ptr)
+		cache.ptr = nil
+	}
+}
+
+// release drops a reference, freeing the cache with the last one. A generation
+// in progress is waited for, one that has not started yet never will.
+func (cache *cache) release() {
+	if !cache.drop() {
+		return
+	}
+	cache.gen.Do(func() {})
+	runtime.SetFinalizer(cache, nil)
+	freeCache(cache)
 }
 
 func (cache *cache) compute(dagSize uint64, hash common.Hash, nonce uint64) (ok bool, mixDigest, result common.Hash) {
@@ -128,6 +181,26 @@ type Light struct {
 	NumCaches int // Maximum number of caches to keep before eviction (only init, don't modify)
 }
 
+// Close releases the caches of the Light. Caches in use by a Verify are freed
+// as soon as it returns. The Light remains usable and creates caches again as
+// needed. The Light of NewShared is shared by all its instances.
+func (l *Light) Close() {
+	l.mu.Lock()
+	released := make([]*cache, 0, len(l.caches)+1)
+	for epoch, c := range l.caches {
+		released = append(released, c)
+		delete(l.caches, epoch)
+	}
+	if l.future != nil {
+		released = append(released, l.future)
+		l.future = nil
+	}
+	l.mu.Unlock()
+	for _, c := range released {
+		c.release()
+	}
+}
+
 // Verify checks whether the block's nonce is valid.
 func (l *Light) Verify(block Block) bool {
 	// TODO: do etchash_quick_verify before getCache in order
@@ -150,24 +223,48 @@ func (l *Light) Verify(block Block) bool {
 	}
 
 	cache := l.getCache(blockNum)
-	dagSize := C.etchash_get_datasize(C.uint64_t(blockNum))
-	if l.test {
-		dagSize = dagSizeForTesting
+	defer cache.release()
+	// Recompute the hash using the cache. The mix digest has to match too, to
+	// avoid malleability as it's not included in a block's "hashNononce".
+	ok := C.etchash_light_verify_internal(cache.ptr, C.uint64_t(l.dagSize(blockNum)), hashToH256(block.HashNoNonce()),
+		C.uint64_t(block.Nonce()), hashToH256(block.MixDigest()), difficultyToBoundary(difficulty))
+	// Make sure cache is live until after the C call, see cache.compute.
+	_ = cache
+	return bool(ok)
+}
+
+// difficultyToBoundary returns 2^256 / difficulty, big endian, as results are
+// compared against it. Difficulties of up to 128 bits, all real ones, are
+// divided in C without allocating.
+func difficultyToBoundary(difficulty *big.Int) C.etchash_h256_t {
+	if difficulty.BitLen() > 128 {
+		var boundary common.Hash
+		new(big.Int).Div(maxUint256, difficulty).FillBytes(boundary[:])
+		return hashToH256(boundary)
 	}
-	// Recompute the hash using the cache.
-	ok, mixDigest, result := cache.compute(uint64(dagSize), block.HashNoNonce(), block.Nonce())
-	if !ok {
-		return false
+	var high, low uint64
+	for i, word := range difficulty.Bits() {
+		if shift := uint(i) * bits.UintSize; shift < 64 {
+			low |= uint64(word) << shift
+		} else {
+			high |= uint64(word) << (shift - 64)
+		}
 	}
+	return C.etchash_difficulty128_to_boundary(C.uint64_t(high), C.uint64_t(low))
+}
 
-	// avoid mixdigest malleability as it's not included in a block's "hashNononce"
-	if block.MixDigest() != mixDigest {
-		return false
+// withinBoundary reports whether a result is at most the boundary, comparing
+// big endian words. It runs in Go since passing the two to C would move them
+// to the heap.
+func withinBoundary(result, boundary *C.etchash_h256_t) bool {
+	r := (*[32]byte)(unsafe.Pointer(&result.b))
+	b := (*[32]byte)(unsafe.Pointer(&boundary.b))
+	for i := 0; i < 32; i += 8 {
+		if rw, bw := binary.BigEndian.Uint64(r[i:]), binary.BigEndian.Uint64(b[i:]); rw != bw {
+			return rw < bw
+		}
 	}
-
-	// The actual check.
-	target := new(big.Int).Div(maxUint256, difficulty)
-	return result.Big().Cmp(target) <= 0
+	return true
 }
 
 func h256ToHash(in C.etchash_h256_t) common.Hash {
@@ -178,8 +275,21 @@ func hashToH256(in common.Hash) C.etchash_h256_t {
 	return C.etchash_h256_t{b: *(*[32]C.uint8_t)(unsafe.Pointer(&in[0]))}
 }
 
+// dagSize returns the size of the DAG the cache of a block stands in for.
+func (l *Light) dagSize(blockNum uint64) uint64 {
+	if l.test {
+		return uint64(dagSizeForTesting)
+	}
+	return uint64(C.etchash_get_datasize(C.uint64_t(blockNum)))
+}
+
+// getCache returns the cache of a block's epoch with a reference the caller
+// has to release.
 func (l *Light) getCache(blockNum uint64) *cache {
-	var c *cache
+	var (
+		c        *cache
+		released []*cache
+	)
 	epoch := blockNum / epochLengthDefault
 	epochLength := epochLengthDefault
 	if blockNum >= ecip1099FBlock {
@@ -207,6 +317,7 @@ func (l *Light) getCache(blockNum uint64) *cache {
 			}
 			log.Debug(fmt.Sprintf("Evicting DAG for epoch %d in favour of epoch %d", evict.epoch, epoch))
 			delete(l.caches, evict.epoch)
+			released = append(released, evict)
 		}
 		// If we have the new DAG pre-generated, use that, otherwise create a new one
 		if l.future != nil && l.future.epoch == epoch {
@@ -214,7 +325,7 @@ func (l *Light) getCache(blockNum uint64) *cache {
 			c, l.future = l.future, nil
 		} else {
 			log.Debug(fmt.Sprintf("No pre-generated DAG available, creating new for epoch %d", epoch))
-			c = &cache{epoch: epoch, epochLength: epochLength, test: l.test}
+			c = newCache(epoch, epochLength, l.test)
 		}
 		l.caches[epoch] = c
 
@@ -228,26 +339,37 @@ func (l *Light) getCache(blockNum uint64) *cache {
 
 		// If we just used up the future cache, or need a refresh, regenerate
 		if l.future == nil || l.future.epoch <= epoch {
+			if l.future != nil {
+				released = append(released, l.future)
+			}
 			log.Debug(fmt.Sprintf("Pre-generating DAG for epoch %d", nextEpoch))
-			l.future = &cache{epoch: nextEpoch, epochLength: nextEpochLength, test: l.test}
+			l.future = newCache(nextEpoch, nextEpochLength, l.test)
 			go l.future.generate()
 		}
 	}
 	c.used = time.Now()
+	// cannot fail, the map holds a reference
+	c.acquire()
 	l.mu.Unlock()
 
+	// evicted caches are freed once no Verify uses them anymore
+	for _, evicted := range released {
+		evicted.release()
+	}
+
 	// Wait for generation finish and return the cache
 	c.generate()
 	return c
 }
 
 // dag wraps an etchash_full_t with some metadata
-// and automatic memory management.
+// and reference counted memory management.
 type dag struct {
 	epoch       uint64
 	epochLength uint64
 	test        bool
 	dir         string
+	refCount    // the owning Full holds one reference, every Search another
 
 	gen sync.Once // ensures DAG is only generated once.
 	ptr *C.struct_etchash_full
@@ -277,13 +399,17 @@ func (d *dag) generate() {
 		// TODO: this could share the cache with Light
 		cache := C.etchash_light_new_internal(cacheSize, (*C.etchash_h256_t)(unsafe.Pointer(&seedHash[0])))
 		defer C.etchash_light_delete(cache)
-		// Generate the actual DAG.
-		d.ptr = C.etchash_full_new_internal(
+		// Generate the actual DAG, reporting progress against this dag only.
+		handle := registerProgress(d)
+		defer unregisterProgress(handle)
+		d.ptr = C.etchash_full_new_internal_ex(
 			C.CString(d.dir),
 			hashToH256(seedHash),
 			dagSize,
 			cache,
-			(C.etchash_callback_t)(unsafe.Pointer(C.etchashGoCallback_cgo)),
+			(C.etchash_progress_callback_t)(unsafe.Pointer(C.etchashGoProgress_cgo)),
+			C.etchashGoHandle(C.uintptr_t(handle)),
+			nil,
 		)
 		if d.ptr == nil {
 			panic("etchash_full_new IO or memory error")
@@ -294,17 +420,68 @@ func (d *dag) generate() {
 }
 
 func freeDAG(d *dag) {
-	C.etchash_full_delete(d.ptr)
-	d.ptr = nil
+	if d.ptr != nil {
+		C.etchash_full_delete(d.ptr)
+		d.ptr = nil
+	}
+}
+
+// release drops a reference, unmapping the DAG with the last one, see
+// cache.release.
+func (d *dag) release() {
+	if !d.drop() {
+		return
+	}
+	d.gen.Do(func() {})
+	runtime.SetFinalizer(d, nil)
+	freeDAG(d)
+}
+
+func (d *dag) compute(hash common.Hash, nonce uint64) (ok bool, mixDigest, result common.Hash) {
+	ret := C.etchash_full_compute(d.ptr, hashToH256(hash), C.uint64_t(nonce))
+	// Keep the DAG alive until after the C call, see cache.compute.
+	_ = d
+	return bool(ret.success), h256ToHash(ret.mix_hash), h256ToHash(ret.result)
 }
 
 func (d *dag) Ptr() unsafe.Pointer {
 	return unsafe.Pointer(d.ptr.data)
 }
 
-//export etchashGoCallback
-func etchashGoCallback(percent C.unsigned) C.int {
-	log.Info(fmt.Sprintf("Generating DAG: %d%%", percent))
+var (
+	progressMu   sync.Mutex
+	progressNext uintptr
+	progressDAGs = make(map[uintptr]*dag)
+)
+
+// registerProgress returns the handle under which progress reports
+// of a DAG generation are routed back to d.
+func registerProgress(d *dag) uintptr {
+	progressMu.Lock()
+	defer progressMu.Unlock()
+	progressNext++
+	progressDAGs[progressNext] = d
+	return progressNext
+}
+
+func unregisterProgress(handle uintptr) {
+	progressMu.Lock()
+	delete(progressDAGs, handle)
+	progressMu.Unlock()
+}
+
+//export etchashGoProgress
+func etchashGoProgress(progress *C.etchash_progress_t, handle C.uintptr_t) C.int {
+	progressMu.Lock()
+	d := progressDAGs[uintptr(handle)]
+	progressMu.Unlock()
+	if d == nil {
+		return 0
+	}
+	percent := uint64(progress.nodes_done) * 100 / uint64(progress.total_nodes)
+	log.Info(fmt.Sprintf("Generating DAG for epoch %d: %d%% (%d/%d nodes, %v elapsed)",
+		d.epoch, percent, progress.nodes_done, progress.total_nodes,
+		time.Duration(progress.elapsed_ms)*time.Millisecond))
 	return 0
 }
 
@@ -312,10 +489,12 @@ func etchashGoCallback(percent C.unsigned) C.int {
 // given directory. If dir is the empty string, the default directory
 // is used.
 func MakeDAG(blockNum uint64, dir string) error {
-	d := &dag{epoch: blockNum / epochLengthDefault, dir: dir}
+	d := &dag{epoch: blockNum / epochLengthDefault, dir: dir, refCount: refCount{refs: 1}}
 	if blockNum >= epochLengthDefault*2048 {
 		return fmt.Errorf("block number too high, limit is %d", epochLengthDefault*2048)
 	}
+	// the file stays, the mapping is not needed anymore
+	defer d.release()
 	d.generate()
 	if d.ptr == nil {
 		return errors.New("failed")
@@ -335,7 +514,22 @@ type Full struct {
 	current *dag       // current full DAG
 }
 
+// Close releases the DAG of the Full. A DAG in use by a Search is unmapped as
+// soon as it returns. The Full remains usable and maps a DAG again as needed.
+func (pow *Full) Close() {
+	pow.mu.Lock()
+	d := pow.current
+	pow.current = nil
+	pow.mu.Unlock()
+	if d != nil {
+		d.release()
+	}
+}
+
+// getDAG returns the DAG of a block's epoch with a reference the caller has
+// to release.
 func (pow *Full) getDAG(blockNum uint64) (d *dag) {
+	var previous *dag
 	epoch := blockNum / epochLengthDefault
 	epochLength := epochLengthDefault
 	if blockNum >= ecip1099FBlock {
@@ -346,10 +540,17 @@ func (pow *Full) getDAG(blockNum uint64) (d *dag) {
 	if pow.current != nil && pow.current.epoch == epoch {
 		d = pow.current
 	} else {
-		d = &dag{epoch: epoch, epochLength: epochLength, test: pow.test, dir: pow.Dir}
+		previous = pow.current
+		d = &dag{epoch: epoch, epochLength: epochLength, test: pow.test, dir: pow.Dir, refCount: refCount{refs: 1}}
 		pow.current = d
 	}
+	// cannot fail, pow.current holds a reference
+	d.acquire()
 	pow.mu.Unlock()
+	// the previous epoch's DAG is unmapped once no Search uses it anymore
+	if previous != nil {
+		previous.release()
+	}
 	// wait for it to finish generating.
 	d.generate()
 	return d
@@ -357,6 +558,7 @@ func (pow *Full) getDAG(blockNum uint64) (d *dag) {
 
 func (pow *Full) Search(block Block, stop <-chan struct{}, index int) (nonce uint64, mixDigest []byte) {
 	dag := pow.getDAG(block.NumberU64())
+	defer dag.release()
 
 	r := rand.New(rand.NewSource(time.Now().UnixNano()))
 	diff := block.Difficulty()
@@ -368,7 +570,7 @@ func (pow *Full) Search(block Block, stop <-chan struct{}, index int) (nonce uin
 
 	nonce = uint64(r.Int63())
 	hash := hashToH256(block.HashNoNonce())
-	target := new(big.Int).Div(maxUint256, diff)
+	boundary := difficultyToBoundary(diff)
 	for {
 		select {
 		case <-stop:
@@ -388,10 +590,9 @@ func (pow *Full) Search(block Block, stop <-chan struct{}, index int) (nonce uin
 			}
 
 			ret := C.etchash_full_compute(dag.ptr, hash, C.uint64_t(nonce))
-			result := h256ToHash(ret.result).Big()
 
 			// TODO: disagrees with the spec https://github.com/ethereum/wiki/wiki/Etchash#mining
-			if ret.success && result.Cmp(target) <= 0 {
+			if bool(ret.success) && withinBoundary(&ret.result, &boundary) {
 				mixDigest = C.GoBytes(unsafe.Pointer(&ret.mix_hash), C.int(32))
 				atomic.AddInt32(&pow.hashRate, -previousHashrate)
 				return nonce, mixDigest
@@ -421,6 +622,15 @@ type Etchash struct {
 	*Full
 }
 
+// Close releases the caches and the DAG, see Light.Close and Full.Close. The
+// Light of NewShared is left alone.
+func (eth *Etchash) Close() {
+	if eth.Light != sharedLight {
+		eth.Light.Close()
+	}
+	eth.Full.Close()
+}
+
 // New creates an instance of the proof of work.
 func New() *Etchash {
 	return &Etchash{new(Light), &Full{turbo: true}}
@@ -21,11 +21,13 @@ import (
 	"bytes"
 	"crypto/rand"
 	"encoding/hex"
+	"io/ioutil"
 	"log"
 	"math/big"
 	"os"
 	"sync"
 	"testing"
+	"time"
 
 	"github.com/ethereum/go-ethereum/common"
 	"github.com/ethereum/go-ethereum/crypto"
@@ -193,6 +195,61 @@ func TestEtchashSearchAcrossEpoch(t *testing.T) {
 	}
 }
 
+func TestEtchashClose(t *testing.T) {
+	eth, err := NewForTesting()
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer os.RemoveAll(eth.Full.Dir)
+
+	// a cache in use outlives Close until its last release
+	c := eth.Light.getCache(0)
+	eth.Light.Close()
+	if c.ptr == nil {
+		t.Fatal("cache freed while in use")
+	}
+	c.release()
+	if c.ptr != nil {
+		t.Fatal("cache not freed by the last release")
+	}
+
+	d := eth.Full.getDAG(0)
+	eth.Full.Close()
+	if d.ptr == nil {
+		t.Fatal("DAG unmapped while in use")
+	}
+	d.release()
+	if d.ptr != nil {
+		t.Fatal("DAG not unmapped by the last release")
+	}
+
+	// both remain usable after Close
+	block := &testBlock{number: 0, difficulty: big.NewInt(90)}
+	rand.Read(block.hashNoNonce[:])
+	nonce, md := eth.Search(block, nil, 0)
+	block.nonce = nonce
+	block.mixDigest = common.BytesToHash(md)
+	if !eth.Verify(block) {
+		t.Fatal("block could not be verified after Close")
+	}
+
+	// the DAG of the previous epoch goes with the last Search using it
+	previous := eth.Full.getDAG(0)
+	next := eth.Full.getDAG(epochLengthDefault)
+	if previous.ptr == nil {
+		t.Fatal("DAG unmapped while in use")
+	}
+	previous.release()
+	if previous.ptr != nil {
+		t.Fatal("DAG of the previous epoch not unmapped")
+	}
+	next.release()
+	eth.Close()
+	if next.ptr != nil {
+		t.Fatal("DAG not unmapped by Close")
+	}
+}
+
 func TestGetSeedHash(t *testing.T) {
 	seed0, err := GetSeedHash(0)
 	if err != nil {
@@ -219,3 +276,123 @@ func TestGetSeedHash(t *testing.T) {
 	}
 
 }
+
+func hexToBig(s string) *big.Int {
+	n, _ := new(big.Int).SetString(s, 16)
+	return n
+}
+
+func TestDifficultyToBoundary(t *testing.T) {
+	difficulties := []*big.Int{
+		big.NewInt(1),
+		big.NewInt(2),
+		big.NewInt(132416),
+		new(big.Int).Lsh(big.NewInt(1), 64),
+		hexToBig("deadbeefcafebabe0123456789abcdef"),
+		hexToBig("0100000000000000000000000000000000000000000000000003"),
+	}
+	for _, difficulty := range difficulties {
+		want := new(big.Int).Div(maxUint256, difficulty)
+		if want.BitLen() > 256 {
+			// no result exceeds 2^256 - 1 either
+			want.Sub(want, big.NewInt(1))
+		}
+		boundary := difficultyToBoundary(difficulty)
+		if got := h256ToHash(boundary).Big(); got.Cmp(want) != 0 {
+			t.Errorf("boundary of %v: got %x, want %x", difficulty, got, want)
+		}
+		for _, delta := range []int64{-1, 0, 1} {
+			if want.Sign() == 0 || (delta > 0 && want.BitLen() == 256) {
+				continue
+			}
+			var hash common.Hash
+			new(big.Int).Add(want, big.NewInt(delta)).FillBytes(hash[:])
+			result := hashToH256(hash)
+			if withinBoundary(&result, &boundary) != (delta <= 0) {
+				t.Errorf("result %v from the boundary of %v: got %v", delta, difficulty, !(delta <= 0))
+			}
+		}
+	}
+
+	difficulty := big.NewInt(1532671)
+	if allocs := testing.AllocsPerRun(100, func() { difficultyToBoundary(difficulty) }); allocs != 0 {
+		t.Errorf("difficultyToBoundary allocates %v times", allocs)
+	}
+}
+
+// The benchmarks below feed test/bench.sh, which compares them with the raw C
+// numbers of src/benchmark/binding_bench.cpp. Single benchmarks go through the
+// public API once per hash, batch benchmarks measure the per-hash cost against
+// prepared state.
+
+func BenchmarkLightVerifySingle(b *testing.B) {
+	eth := New()
+	block := validBlocks[0]
+	// generate the cache outside of the timed loop
+	if !eth.Verify(block) {
+		b.Fatal("block did not validate")
+	}
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		eth.Verify(block)
+	}
+}
+
+func BenchmarkLightVerifyBatch(b *testing.B) {
+	l := new(Light)
+	block := validBlocks[0]
+	cache := l.getCache(block.number)
+	defer cache.release()
+	dagSize := l.dagSize(block.number)
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		cache.compute(dagSize, block.hashNoNonce, uint64(i))
+	}
+}
+
+func newBenchmarkFull(b *testing.B) (*Full, *dag) {
+	dir, err := ioutil.TempDir("", "etchash-bench")
+	if err != nil {
+		b.Fatal(err)
+	}
+	pow := &Full{Dir: dir, test: true, turbo: true}
+	return pow, pow.getDAG(0)
+}
+
+func BenchmarkFullComputeSingle(b *testing.B) {
+	pow, d := newBenchmarkFull(b)
+	defer os.RemoveAll(pow.Dir)
+	defer d.release()
+	hash := crypto.Keccak256Hash([]byte("bench"))
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		d.compute(hash, uint64(i))
+	}
+}
+
+// Search with difficulty 1 returns after the first nonce, so this measures
+// the setup cost of a search on top of one hash.
+func BenchmarkSearchSingle(b *testing.B) {
+	pow, _ := newBenchmarkFull(b)
+	defer os.RemoveAll(pow.Dir)
+	block := &testBlock{difficulty: big.NewInt(1)}
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		pow.Search(block, nil, 0)
+	}
+}
+
+// Search with difficulty 4096 needs 4096 hashes per solution on average, so
+// the per-nonce loop dominates.
+func BenchmarkSearchBatch(b *testing.B) {
+	pow, _ := newBenchmarkFull(b)
+	defer os.RemoveAll(pow.Dir)
+	block := &testBlock{difficulty: big.NewInt(4096)}
+	rand.Read(block.hashNoNonce[:])
+	b.ResetTimer()
+	start := time.Now()
+	for i := 0; i < b.N; i++ {
+		pow.Search(block, nil, 0)
+	}
+	b.ReportMetric(float64(time.Since(start).Nanoseconds())/float64(b.N)/4096, "ns/hash")
+}
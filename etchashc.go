@@ -31,21 +31,42 @@ package etchash
 #cgo CFLAGS: -std=gnu99 -Wall
 #cgo windows CFLAGS: -mno-stack-arg-probe
 #cgo LDFLAGS: -lm
+#cgo !windows LDFLAGS: -lpthread
 
 #include "src/libetchash/internal.c"
 #include "src/libetchash/sha3.c"
 #include "src/libetchash/io.c"
+#include "src/libetchash/merkle.c"
+#include "src/libetchash/trace.c"
+#include "src/libetchash/auto.c"
+#include "src/libetchash/background.c"
+#include "src/libetchash/peer.c"
+#include "src/libetchash/search.c"
+#include "src/libetchash/budget.c"
+#include "src/libetchash/lanes.c"
+#include "src/libetchash/watchdog.c"
+#include "src/libetchash/pool.c"
+#include "src/libetchash/verify.c"
+#include "src/libetchash/topology.c"
+#include "src/libetchash/shard.c"
+#include "src/libetchash/boundary.c"
+#include "src/libetchash/epoch.c"
 
 #ifdef _WIN32
 #	include "src/libetchash/io_win32.c"
 #	include "src/libetchash/mmap_win32.c"
+#	include "src/libetchash/thread_win32.c"
 #else
 #	include "src/libetchash/io_posix.c"
+#	include "src/libetchash/thread_posix.c"
 #endif
 
 // 'gateway function' for calling back into go.
-extern int etchashGoCallback(unsigned);
-int etchashGoCallback_cgo(unsigned percent) { return etchashGoCallback(percent); }
+extern int etchashGoProgress(etchash_progress_t*, uintptr_t);
+int etchashGoProgress_cgo(etchash_progress_t const* progress, void* user)
+{
+	return etchashGoProgress((etchash_progress_t*)progress, (uintptr_t)user);
+}
 
 */
 import "C"
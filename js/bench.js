@@ -0,0 +1,104 @@
+// bench.js
+// JS numbers for the cross-binding benchmark report, see test/bench.sh.
+// Prints one tab separated line per measurement:
+//
+//     binding  operation  granularity  hashes  ns/hash
+//
+// The JS port reimplements etchash instead of binding the C library, so its
+// "overhead" is that of the whole implementation.
+
+/*jslint node: true, shadow:true */
+"use strict";
+
+var etchash = require('./etchash');
+var util = require('./util');
+
+var scale = process.argv.length > 2 ? parseInt(process.argv[2], 10) : 1;
+
+function now()
+{
+	var t = process.hrtime();
+	return t[0] * 1e9 + t[1];
+}
+
+function report(op, granularity, hashes, ns)
+{
+	console.log(["js", op, granularity, hashes, (ns / hashes).toFixed(1)].join("\t"));
+}
+
+// the epoch 0 sizes used by the C benchmark
+var params = etchash.defaultParams();
+params.cacheSize = 16776896;
+params.dagSize = 1073739904;
+var seed = new Uint8Array(32);
+
+var start = now();
+var hasher = new etchash.Etchash(params, seed);
+report("cache_generate", "single", 1, now() - start);
+
+var header = util.hexStringToBytes("7e7e7e587e7e7e7e7e7e7e7e7e7e7e7e7e7e7e7e7e7e7e7e7e7e7e7e7e7e7e7e");
+var calls = 20 * scale;
+start = now();
+for (var i = 0; i < calls; ++i)
+{
+	var nonce = new Uint8Array(8);
+	nonce[0] = i & 0xff;
+	nonce[1] = i >> 8;
+	hasher.hash(header, nonce);
+}
+report("light_verify", "single", calls, now() - start);
+
+// reuse the nonce buffer
+var nonce = new Uint8Array(8);
+start = now();
+for (var i = 0; i < calls; ++i)
+{
+	nonce[0] = i & 0xff;
+	nonce[1] = i >> 8;
+	hasher.hash(header, nonce);
+}
+report("light_verify", "batch", calls, now() - start);
+
+// the WebAssembly build of the C library, if built (see src/wasm)
+var etchashWasm = require('./etchash_wasm');
+try
+{
+	require.resolve('./etchash_wasm_module');
+}
+catch (e)
+{
+	etchashWasm = null;
+}
+if (etchashWasm !== null)
+{
+	etchashWasm.ready().then(function(wasm)
+	{
+		function wasmReport(op, granularity, hashes, ns)
+		{
+			console.log(["wasm", op, granularity, hashes, (ns / hashes).toFixed(1)].join("\t"));
+		}
+		var start = now();
+		var hasher = new wasm.Etchash(params, seed);
+		wasmReport("cache_generate", "single", 1, now() - start);
+
+		var wasmCalls = 200 * scale;
+		var nonces = [];
+		for (var i = 0; i < wasmCalls; ++i)
+		{
+			var nonce = new Uint8Array(8);
+			nonce[0] = i & 0xff;
+			nonce[1] = i >> 8;
+			nonces.push(nonce);
+		}
+		start = now();
+		for (var i = 0; i < wasmCalls; ++i)
+		{
+			hasher.hash(header, nonces[i]);
+		}
+		wasmReport("light_verify", "single", wasmCalls, now() - start);
+		start = now();
+		hasher.hashBatch(header, nonces);
+		wasmReport("light_verify", "batch", wasmCalls, now() - start);
+		hasher.destroy();
+	});
+}
@@ -0,0 +1,175 @@
+// etchash_wasm.js
+// The Etchash interface of etchash.js backed by libetchash compiled to
+// WebAssembly with SIMD128, see src/wasm. The cache lives in the linear
+// memory of the module, call destroy() to release it.
+//
+//     require('./etchash_wasm').ready().then(function(etchash) {
+//         var hasher = new etchash.Etchash(etchash.defaultParams(), seed);
+//         hasher.hash(header, nonce);
+//         hasher.hashBatch(header, [nonce, ...]);
+//     });
+//
+// Where the module compiles synchronously (Node.js) Etchash can be used
+// right after require().
+
+/*jslint node: true, shadow:true */
+"use strict";
+
+var util = require('./util');
+var etchash = require('./etchash');
+
+var instance = null;
+var pending = null;
+
+function load()
+{
+	if (instance === null && pending === null)
+	{
+		var created = require('./etchash_wasm_module')();
+		if (created && typeof created.then === "function")
+		{
+			pending = created.then(function(module) { instance = module; return module; });
+		}
+		else
+		{
+			instance = created;
+		}
+	}
+	return instance;
+}
+
+// the parameters the C library has compiled in
+function checkParams(params)
+{
+	var defaults = etchash.defaultParams();
+	var fixed = ["cacheRounds", "dagParents", "mixSize", "mixParents"];
+	for (var i = 0; i != fixed.length; ++i)
+	{
+		if (params[fixed[i]] !== defaults[fixed[i]])
+			throw Error("The WebAssembly module only supports " + fixed[i] + " " + defaults[fixed[i]]);
+	}
+	if (params.cacheSize % 64 !== 0 || params.dagSize % params.mixSize !== 0)
+		throw Error("Invalid cache or DAG size");
+}
+
+// a growable buffer in linear memory
+function Scratch(module)
+{
+	var ptr = 0;
+	var size = 0;
+	this.get = function(bytes)
+	{
+		if (bytes > size)
+		{
+			module._free(ptr);
+			ptr = module._malloc(bytes);
+			size = bytes;
+			if (!ptr)
+			{
+				size = 0;
+				throw Error("Out of WebAssembly memory");
+			}
+		}
+		return ptr;
+	};
+	this.free = function()
+	{
+		module._free(ptr);
+		ptr = 0;
+		size = 0;
+	};
+}
+
+exports.defaultParams = etchash.defaultParams;
+
+// resolves to this module once the WebAssembly module is instantiated
+exports.ready = function()
+{
+	load();
+	return pending === null ? Promise.resolve(exports) : pending.then(function() { return exports; });
+};
+
+exports.Etchash = function(params, seed)
+{
+	var module = load();
+	if (module === null)
+		throw Error("The WebAssembly module is still loading, wait for ready()");
+	checkParams(params);
+	var seedWords = util.toWords(seed);
+	if (seedWords === null || seedWords.length < 8)
+		throw Error("Invalid seed '" + seed + "'");
+
+	var input = new Scratch(module);
+	var output = new Scratch(module);
+	var seedPtr = input.get(32);
+	module.HEAPU8.set(new Uint8Array(seedWords.buffer, seedWords.byteOffset, 32), seedPtr);
+	var light = module._etchash_wasm_light_new(params.cacheSize, seedPtr);
+	if (!light)
+		throw Error("Could not allocate the cache");
+	var sizeLow = params.dagSize % 0x100000000;
+	var sizeHigh = Math.floor(params.dagSize / 0x100000000);
+
+	function run(header, nonces, count, mixHashes)
+	{
+		if (light === 0)
+			throw Error("Etchash was destroyed");
+		if (header.length !== 32)
+			throw Error("The header hash must be 32 bytes");
+		var headerPtr = input.get(32 + 8 * count);
+		var noncePtr = headerPtr + 32;
+		// every view is taken after the allocations, growing the memory detaches older ones
+		var resultPtr = output.get((mixHashes ? 64 : 32) * count);
+		var mixPtr = mixHashes ? resultPtr + 32 * count : 0;
+		module.HEAPU8.set(header, headerPtr);
+		for (var i = 0; i != count; ++i)
+		{
+			if (nonces[i].length !== 8)
+				throw Error("Nonces must be 8 bytes");
+			module.HEAPU8.set(nonces[i], noncePtr + 8 * i);
+		}
+		if (!module._etchash_wasm_hash(light, sizeLow, sizeHigh, headerPtr, noncePtr, count, mixPtr, resultPtr))
+			throw Error("Invalid DAG size");
+		return resultPtr;
+	}
+
+	this.hash = function(header, nonce)
+	{
+		var resultPtr = run(header, [nonce], 1, false);
+		return module.HEAPU8.slice(resultPtr, resultPtr + 32);
+	};
+
+	// hashes many nonces in one call into the module, returns {mixHash, result} per nonce
+	this.hashBatch = function(header, nonces)
+	{
+		var count = nonces.length;
+		var resultPtr = run(header, nonces, count, true);
+		var mixPtr = resultPtr + 32 * count;
+		var ret = new Array(count);
+		for (var i = 0; i != count; ++i)
+		{
+			ret[i] = {
+				mixHash: module.HEAPU8.slice(mixPtr + 32 * i, mixPtr + 32 * i + 32),
+				result: module.HEAPU8.slice(resultPtr + 32 * i, resultPtr + 32 * i + 32)
+			};
+		}
+		return ret;
+	};
+
+	this.cacheDigest = function()
+	{
+		var digestPtr = output.get(32);
+		module._etchash_wasm_cache_digest(light, digestPtr);
+		return module.HEAPU8.slice(digestPtr, digestPtr + 32);
+	};
+
+	this.destroy = function()
+	{
+		if (light !== 0)
+		{
+			module._etchash_wasm_light_delete(light);
+			light = 0;
+		}
+		input.free();
+		output.free();
+	};
+};
@@ -0,0 +1,78 @@
+// test_wasm.js
+// Checks the WebAssembly build against the JS implementation. Build the
+// module first, see src/wasm. Skipped without the module unless
+// ETCHASH_WASM_REQUIRED is set.
+
+/*jslint node: true, shadow:true */
+"use strict";
+
+var etchash = require('./etchash');
+var util = require('./util');
+
+var etchashWasm;
+try
+{
+	etchashWasm = require('./etchash_wasm');
+	require.resolve('./etchash_wasm_module');
+}
+catch (e)
+{
+	if (process.env.ETCHASH_WASM_REQUIRED)
+	{
+		console.error("WebAssembly module not built");
+		process.exit(1);
+	}
+	console.log("WebAssembly module not built, skipping");
+	process.exit(0);
+}
+
+etchashWasm.ready().then(function(wasm)
+{
+	// small sizes, the JS cache takes long otherwise
+	var params = etchash.defaultParams();
+	params.cacheSize = 1024 * 64;
+	params.dagSize = 1024 * 1024 * 32;
+
+	var seed = util.hexStringToBytes("9410b944535a83d9adf6bbdcc80e051f30676173c16ca0d32d6f1263fc246466");
+	var header = util.hexStringToBytes("c5d2460186f7233c927e7db2dcc703c0e500b653ca82273b7bfad8045d85a470");
+	var js = new etchash.Etchash(params, seed);
+	var hasher = new wasm.Etchash(params, seed);
+
+	if (util.bytesToHexString(hasher.cacheDigest()) != util.bytesToHexString(js.cacheDigest()))
+		throw Error("WebAssembly cache differs");
+
+	var nonces = [];
+	for (var i = 0; i != 16; ++i)
+	{
+		var nonce = new Uint8Array(8);
+		nonce[0] = i * 37 & 0xff;
+		nonce[7] = i;
+		nonces.push(nonce);
+	}
+	var batch = hasher.hashBatch(header, nonces);
+	for (var i = 0; i != nonces.length; ++i)
+	{
+		var expected = util.bytesToHexString(js.hash(header, nonces[i]));
+		if (util.bytesToHexString(hasher.hash(header, nonces[i])) != expected)
+			throw Error("WebAssembly hash differs for nonce " + i);
+		if (util.bytesToHexString(batch[i].result) != expected)
+			throw Error("WebAssembly batch hash differs for nonce " + i);
+	}
+	hasher.destroy();
+
+	// the default sizes, where the JS port takes seconds
+	params = etchash.defaultParams();
+	var startTime = new Date().getTime();
+	hasher = new wasm.Etchash(params, seed);
+	console.log('WebAssembly startup took: ' + (new Date().getTime() - startTime) + "ms");
+	startTime = new Date().getTime();
+	var trials = 100;
+	batch = hasher.hashBatch(header, new Array(trials).fill(new Uint8Array(8)));
+	console.log("WebAssembly light client hashes averaged: " + (new Date().getTime() - startTime) / trials + "ms");
+	console.log("Hash = " + util.bytesToHexString(batch[0].result));
+	hasher.destroy();
+}).catch(function(e)
+{
+	console.error(e);
+	process.exit(1);
+});
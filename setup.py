@@ -5,16 +5,33 @@ sources = [
     'src/python/core.c',
     'src/libetchash/io.c',
     'src/libetchash/internal.c',
+    'src/libetchash/merkle.c',
+    'src/libetchash/trace.c',
+    'src/libetchash/auto.c',
+    'src/libetchash/background.c',
+    'src/libetchash/peer.c',
+    'src/libetchash/search.c',
+    'src/libetchash/budget.c',
+    'src/libetchash/lanes.c',
+    'src/libetchash/watchdog.c',
+    'src/libetchash/pool.c',
+    'src/libetchash/verify.c',
+    'src/libetchash/topology.c',
+    'src/libetchash/shard.c',
+    'src/libetchash/boundary.c',
+    'src/libetchash/epoch.c',
     'src/libetchash/sha3.c']
 if os.name == 'nt':
     sources += [
         'src/libetchash/util_win32.c',
         'src/libetchash/io_win32.c',
         'src/libetchash/mmap_win32.c',
+        'src/libetchash/thread_win32.c',
     ]
 else:
     sources += [
-        'src/libetchash/io_posix.c'
+        'src/libetchash/io_posix.c',
+        'src/libetchash/thread_posix.c',
     ]
 depends = [
     'src/libetchash/etchash.h',
@@ -25,7 +42,24 @@ depends = [
     'src/libetchash/io.h',
     'src/libetchash/fnv.h',
     'src/libetchash/internal.h',
+    'src/libetchash/merkle.h',
     'src/libetchash/sha3.h',
+    'src/libetchash/thread.h',
+    'src/libetchash/trace.h',
+    'src/libetchash/auto.h',
+    'src/libetchash/background.h',
+    'src/libetchash/peer.h',
+    'src/libetchash/search.h',
+    'src/libetchash/budget.h',
+    'src/libetchash/lanes.h',
+    'src/libetchash/provider.h',
+    'src/libetchash/watchdog.h',
+    'src/libetchash/pool.h',
+    'src/libetchash/verify.h',
+    'src/libetchash/topology.h',
+    'src/libetchash/shard.h',
+    'src/libetchash/boundary.h',
+    'src/libetchash/epoch.h',
     'src/libetchash/util.h',
 ]
 pyetchash = Extension('pyetchash',
@@ -0,0 +1,133 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file binding_bench.cpp
+ * @date 2026
+ *
+ * Raw C numbers for the cross-binding benchmark report, see test/bench.sh.
+ * Prints one tab separated line per measurement:
+ *
+ *     binding  operation  granularity  hashes  ns/hash
+ *
+ * The bindings add their own single and batch rows, the C numbers are the
+ * baseline for both. light_verify uses the epoch 0 cache like the Go, Python
+ * and JS benchmarks. full_compute and search use the small test DAG of the Go
+ * binding so that no DAG file has to be generated. full_lanes is full_compute
+ * ETCHASH_LANES nonces at a time, a C only row. search stops at the first
+ * hash under a 2^256/4096 boundary and is reported per hash.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <chrono>
+#include <libetchash/etchash.h>
+#include <libetchash/internal.h>
+#include <libetchash/io.h>
+#include <libetchash/lanes.h>
+
+using std::chrono::high_resolution_clock;
+
+static double elapsed_ns(high_resolution_clock::time_point start)
+{
+	return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - start).count();
+}
+
+static void report(char const* op, uint64_t hashes, double ns)
+{
+	printf("c\t%s\tany\t%llu\t%.1f\n", op, (unsigned long long)hashes, ns / hashes);
+	fflush(stdout);
+}
+
+int main(int argc, char** argv)
+{
+	unsigned scale = argc > 1 ? (unsigned)strtoul(argv[1], NULL, 10) : 1;
+	if (!scale) {
+		scale = 1;
+	}
+	etchash_h256_t header;
+	memcpy(&header, "~~~X~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+
+	// the cache of epoch 0
+	auto start = high_resolution_clock::now();
+	etchash_light_t light = etchash_light_new(0);
+	if (!light) {
+		fprintf(stderr, "could not allocate the epoch 0 cache\n");
+		return 1;
+	}
+	report("cache_generate", 1, elapsed_ns(start));
+
+	uint64_t const light_calls = 50 * scale;
+	start = high_resolution_clock::now();
+	for (uint64_t nonce = 0; nonce < light_calls; ++nonce) {
+		etchash_light_compute(light, header, nonce);
+	}
+	report("light_verify", light_calls, elapsed_ns(start));
+	etchash_light_delete(light);
+
+	// the test sized DAG of the Go binding
+	etchash_h256_t seed;
+	memset(&seed, 0, sizeof(seed));
+	etchash_light_t test_light = etchash_light_new_internal(1024, &seed);
+	etchash_full_t full = etchash_full_new_internal("./binding_bench_dag/", seed, 1024 * 32, test_light, NULL);
+	if (!full) {
+		fprintf(stderr, "could not create the test DAG\n");
+		return 1;
+	}
+
+	uint64_t const full_calls = 200000 * scale;
+	etchash_return_value_t ret;
+	start = high_resolution_clock::now();
+	for (uint64_t nonce = 0; nonce < full_calls; ++nonce) {
+		ret = etchash_full_compute(full, header, nonce);
+	}
+	report("full_compute", full_calls, elapsed_ns(start));
+
+	etchash_return_value_t lanes[ETCHASH_LANES];
+	uint64_t nonces[ETCHASH_LANES];
+	start = high_resolution_clock::now();
+	for (uint64_t nonce = 0; nonce < full_calls; nonce += ETCHASH_LANES) {
+		for (unsigned l = 0; l != ETCHASH_LANES; ++l) {
+			nonces[l] = nonce + l;
+		}
+		etchash_full_compute_lanes(full, header, nonces, lanes);
+	}
+	report("full_lanes", full_calls, elapsed_ns(start));
+
+	etchash_h256_t boundary;
+	memset(&boundary, 0, sizeof(boundary));
+	boundary.b[1] = 0x10;  // 2^256 / 4096
+	uint64_t hashes = 0;
+	uint64_t nonce = 0;
+	start = high_resolution_clock::now();
+	for (unsigned found = 0; found < 20 * scale; ++found) {
+		do {
+			ret = etchash_full_compute(full, header, nonce++);
+			hashes++;
+		} while (!etchash_check_difficulty(&ret.result, &boundary));
+	}
+	report("search", hashes, elapsed_ns(start));
+
+	etchash_full_delete(full);
+	etchash_light_delete(test_light);
+	char dagname[DAG_MUTABLE_NAME_MAX_SIZE];
+	etchash_io_mutable_name(ETCHASH_REVISION, &seed, dagname);
+	std::string path = std::string("./binding_bench_dag/") + dagname;
+	remove(path.c_str());
+	remove("./binding_bench_dag");
+	return 0;
+}
@@ -0,0 +1,88 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file dag_peer.cpp
+ * @date 2026
+ *
+ * Serves the DAG files of a directory to peers, or creates the DAG of a block
+ * by fetching it from peers first. Run one of each to transfer a DAG between
+ * two processes or hosts.
+ *
+ * usage: Dag_Peer serve <address> <dag directory>
+ *        Dag_Peer fetch <dag directory> <block number> <address>...
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <libetchash/etchash.h>
+#include <libetchash/peer.h>
+#include <libetchash/util.h>
+
+static int usage(char const* name)
+{
+	debugf("usage: %s serve <address> <dag directory>\n", name);
+	debugf("       %s fetch <dag directory> <block number> <address>...\n", name);
+	debugf("addresses are unix:<socket path> or tcp:<host>:<port>\n");
+	return 1;
+}
+
+static int progress(etchash_progress_t const* progress, void* user)
+{
+	(void)user;
+	debugf("\r%llu/%llu nodes, %llu ms", (unsigned long long)progress->nodes_done,
+		(unsigned long long)progress->total_nodes, (unsigned long long)progress->elapsed_ms);
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc >= 4 && strcmp(argv[1], "serve") == 0) {
+		etchash_peer_server_t server = etchash_peer_server_new(argv[2], argv[3]);
+		if (!server) {
+			return 1;
+		}
+		debugf("serving the DAGs of %s on %s\n", argv[3], argv[2]);
+		for (;;) {
+			std::this_thread::sleep_for(std::chrono::seconds(60));
+		}
+	}
+	if (argc >= 5 && strcmp(argv[1], "fetch") == 0) {
+		uint64_t block_number = strtoull(argv[3], NULL, 10);
+		etchash_light_t light = etchash_light_new(block_number);
+		if (!light) {
+			return 1;
+		}
+		etchash_full_options_t options = {};
+		options.dirname = argv[2];
+		options.peers = argv + 4;
+		options.num_peers = (uint32_t)(argc - 4);
+		auto start = std::chrono::steady_clock::now();
+		etchash_full_t full = etchash_full_new_ex(light, progress, NULL, &options);
+		auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+		if (!full) {
+			etchash_light_delete(light);
+			return 1;
+		}
+		debugf("\nDAG of block %llu ready in %lld ms\n", (unsigned long long)block_number, (long long)ms);
+		etchash_full_delete(full);
+		etchash_light_delete(light);
+		return 0;
+	}
+	return usage(argv[0]);
+}
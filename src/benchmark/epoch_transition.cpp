@@ -0,0 +1,403 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file epoch_transition.cpp
+ * @date 2026
+ *
+ * Simulates a chain crossing an epoch boundary under load, once per way of
+ * getting the new epoch's cache and DAG ready, and prints CSV:
+ *
+ *     mode,cache_bytes,dag_bytes,first_hash_ms,verifications,steady_p99_us,
+ *     transition_p50_us,transition_p99_us,transition_max_us,peak_rss_mb
+ *
+ * Verifier threads check shares of the epoch the simulated head is in with
+ * etchash_verify_internal() and a search scheduler hashes the head's epoch.
+ * first_hash_ms is the time from the boundary block to the first hash on the
+ * new epoch's DAG. Latencies are split in the blocks before the boundary and
+ * the blocks from it on. peak_rss_mb is sampled from /proc/self/statm during
+ * each mode, 0 outside Linux.
+ *
+ * Modes:
+ *   blocking    the new cache and DAG are generated when the boundary is hit
+ *   parallel    likewise, with the DAG generated on the library pool
+ *   background  etchash_background_t starts generating them -p blocks early
+ *
+ * Sizes are synthetic by default so that a run takes seconds; -r takes the
+ * real sizes of a block's epoch and the next. DAG files go to a scratch
+ * directory and are removed after each mode.
+ *
+ * usage: Epoch_Transition [-m mode,...] [-c cache bytes] [-f dag bytes]
+ *                         [-r block] [-b block ms] [-p blocks before]
+ *                         [-a blocks after] [-v verifiers] [-t search tasks]
+ *                         [-d dir]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <libetchash/etchash.h>
+#include <libetchash/internal.h>
+#include <libetchash/io.h>
+#include <libetchash/background.h>
+#include <libetchash/search.h>
+#include <libetchash/verify.h>
+#include <libetchash/util.h>
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+using std::chrono::high_resolution_clock;
+
+#define SHARES 16
+
+struct epoch {
+	etchash_h256_t seed;
+	uint64_t cache_size;
+	uint64_t full_size;
+	etchash_h256_t headers[SHARES];
+	etchash_h256_t mixes[SHARES];
+};
+
+struct latency {
+	bool transition;
+	double us;
+};
+
+struct run {
+	epoch const* epochs[2];
+	std::atomic<int> current;
+	std::atomic<bool> stop;
+	std::atomic<uint64_t> peak_rss;
+	std::atomic<int64_t> first_hash_us;
+	high_resolution_clock::time_point boundary_time;
+	std::vector<std::vector<latency>> latencies;
+};
+
+static uint64_t rss_bytes()
+{
+#ifdef __linux__
+	unsigned long long size = 0;
+	unsigned long long resident = 0;
+	FILE* f = fopen("/proc/self/statm", "r");
+	if (!f) {
+		return 0;
+	}
+	if (fscanf(f, "%llu %llu", &size, &resident) != 2) {
+		resident = 0;
+	}
+	fclose(f);
+	return resident * (uint64_t)sysconf(_SC_PAGESIZE);
+#else
+	return 0;
+#endif
+}
+
+// valid shares of an epoch, computed up front with a cache that is gone before the run
+static bool make_epoch(epoch* e)
+{
+	etchash_light_t light = etchash_light_new_internal(e->cache_size, &e->seed);
+	if (!light) {
+		return false;
+	}
+	for (unsigned i = 0; i != SHARES; ++i) {
+		memset(&e->headers[i], 0, sizeof(e->headers[i]));
+		e->headers[i].b[0] = (uint8_t)i;
+		e->mixes[i] = etchash_light_compute_internal(light, e->full_size, e->headers[i], i).mix_hash;
+	}
+	etchash_light_delete(light);
+	return true;
+}
+
+static void remove_dag(char const* dirname, etchash_h256_t const* seed)
+{
+	char name[DAG_MUTABLE_NAME_MAX_SIZE];
+	if (!etchash_io_mutable_name(ETCHASH_REVISION, seed, name)) {
+		return;
+	}
+	char* path = etchash_io_create_filename(dirname, name, strlen(name));
+	if (path) {
+		remove(path);
+		free(path);
+	}
+}
+
+static void verifier(run* r, unsigned id)
+{
+	etchash_h256_t boundary;
+	memset(&boundary, 0xff, sizeof(boundary));
+	std::vector<latency>& out = r->latencies[id];
+	for (unsigned i = id; !r->stop; ++i) {
+		int const current = r->current;
+		epoch const* e = r->epochs[current];
+		unsigned const share = i % SHARES;
+		auto start = high_resolution_clock::now();
+		if (!etchash_verify_internal(&e->seed, e->cache_size, e->full_size, &e->headers[share], share,
+			&e->mixes[share], &boundary)) {
+			debugf("share %u of epoch %d did not verify\n", share, current);
+		}
+		latency l;
+		l.transition = current == 1;
+		l.us = std::chrono::duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - start).count() / 1e3;
+		out.push_back(l);
+		// a steady share stream rather than a saturating one
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+static void sampler(run* r)
+{
+	while (!r->stop) {
+		uint64_t rss = rss_bytes();
+		if (rss > r->peak_rss) {
+			r->peak_rss = rss;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+}
+
+static void found(etchash_search_solution_t const* solution, void* user)
+{
+	run* r = (run*)user;
+	// every hash meets the boundary, the first of job 1 is the first on the new DAG
+	if (solution->job_id == 1 && r->first_hash_us < 0) {
+		int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(
+			high_resolution_clock::now() - r->boundary_time).count();
+		int64_t expected = -1;
+		r->first_hash_us.compare_exchange_strong(expected, us);
+	}
+}
+
+static double percentile(std::vector<double>& v, double p)
+{
+	if (v.empty()) {
+		return 0;
+	}
+	std::sort(v.begin(), v.end());
+	return v[std::min(v.size() - 1, (size_t)(p * v.size()))];
+}
+
+static int usage(char const* name)
+{
+	debugf("usage: %s [-m blocking,parallel,background] [-c cache bytes] [-f dag bytes] [-r block] [-b block ms]"
+		" [-p blocks] [-a blocks] [-v verifiers] [-t search tasks] [-d dir]\n", name);
+	return 1;
+}
+
+int main(int argc, char** argv)
+{
+	char const* modes = "blocking,parallel,background";
+	uint64_t cache_size = 1024 * 1024;
+	uint64_t full_size = 64 * 1024 * 1024;
+	uint64_t real_block = 0;
+	bool real = false;
+	unsigned block_ms = 100;
+	unsigned before = 30;
+	unsigned after = 20;
+	unsigned verifiers = 2;
+	unsigned search_tasks = 1;
+	std::string dirname = "./epoch_transition_dags/";
+	for (int i = 1; i < argc; ++i) {
+		bool has_value = i + 1 < argc;
+		if (strcmp(argv[i], "-m") == 0 && has_value) {
+			modes = argv[++i];
+		} else if (strcmp(argv[i], "-c") == 0 && has_value) {
+			cache_size = strtoull(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "-f") == 0 && has_value) {
+			full_size = strtoull(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "-r") == 0 && has_value) {
+			real_block = strtoull(argv[++i], NULL, 10);
+			real = true;
+		} else if (strcmp(argv[i], "-b") == 0 && has_value) {
+			block_ms = (unsigned)strtoul(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "-p") == 0 && has_value) {
+			before = (unsigned)strtoul(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "-a") == 0 && has_value) {
+			after = (unsigned)strtoul(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "-v") == 0 && has_value) {
+			verifiers = (unsigned)strtoul(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "-t") == 0 && has_value) {
+			search_tasks = (unsigned)strtoul(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "-d") == 0 && has_value) {
+			dirname = argv[++i];
+		} else {
+			return usage(argv[0]);
+		}
+	}
+	// the sizes the hashing requires, see etchash_compute_cache_nodes() and etchash_compute_full_data()
+	cache_size = std::max<uint64_t>(cache_size / 64 * 64, 64);
+	full_size = std::max<uint64_t>(full_size / 128 * 128, 128);
+	if (dirname.empty() || dirname.back() != '/') {
+		dirname += '/';
+	}
+
+	// epoch 0 is the one the chain leaves, epoch 1 the one it enters
+	epoch epochs[2];
+	uint64_t const epoch_length = real_block >= ETCHASH_ACTIVATION_BLOCK ? ETCHASH_NEW_EPOCH_LENGTH : ETCHASH_EPOCH_LENGTH;
+	uint64_t boundary_block = real ? (real_block / epoch_length + 1) * epoch_length : 1000000;
+	for (unsigned e = 0; e != 2; ++e) {
+		// the last block of the old epoch and the first of the new one
+		uint64_t block = boundary_block - 1 + e;
+		if (real) {
+			epochs[e].seed = etchash_get_seedhash(block);
+			epochs[e].cache_size = etchash_get_cachesize(block);
+			epochs[e].full_size = etchash_get_datasize(block);
+		} else {
+			// seeds of this run only, so that no DAG file of an earlier run is picked up
+			memset(&epochs[e].seed, 0, sizeof(epochs[e].seed));
+			uint64_t salt = etchash_time_ms() * 2 + e;
+			memcpy(&epochs[e].seed, &salt, sizeof(salt));
+			epochs[e].cache_size = cache_size;
+			epochs[e].full_size = full_size;
+		}
+		if (!make_epoch(&epochs[e])) {
+			debugf("could not create the cache of epoch %u\n", e);
+			return 1;
+		}
+	}
+
+	printf("mode,cache_bytes,dag_bytes,first_hash_ms,verifications,steady_p99_us,"
+		"transition_p50_us,transition_p99_us,transition_max_us,peak_rss_mb\n");
+	std::string list = modes;
+	size_t pos = 0;
+	while (pos <= list.size()) {
+		size_t comma = list.find(',', pos);
+		std::string mode = list.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+		pos = comma == std::string::npos ? list.size() + 1 : comma + 1;
+		if (mode != "blocking" && mode != "parallel" && mode != "background") {
+			return usage(argv[0]);
+		}
+		for (epoch const& e: epochs) {
+			remove_dag(dirname.c_str(), &e.seed);
+		}
+
+		// the old epoch is resident before the run starts
+		etchash_light_t lights[2] = { etchash_light_new_internal(epochs[0].cache_size, &epochs[0].seed), NULL };
+		etchash_full_t fulls[2] = { NULL, NULL };
+		if (lights[0]) {
+			fulls[0] = etchash_full_new_internal(dirname.c_str(), epochs[0].seed, epochs[0].full_size, lights[0], NULL);
+		}
+		if (!fulls[0]) {
+			debugf("could not create the DAG of the old epoch\n");
+			return 1;
+		}
+
+		run r;
+		r.epochs[0] = &epochs[0];
+		r.epochs[1] = &epochs[1];
+		r.current = 0;
+		r.stop = false;
+		r.peak_rss = rss_bytes();
+		r.first_hash_us = -1;
+		r.latencies.resize(verifiers);
+		etchash_search_t search = etchash_search_new(search_tasks, dirname.c_str(), found, &r);
+		etchash_search_work_t work;
+		memset(&work, 0, sizeof(work));
+		memset(&work.boundary, 0xff, sizeof(work.boundary));
+		work.full = fulls[0];
+		etchash_search_set_work(search, 0, &work);
+
+		std::vector<std::thread> threads;
+		threads.emplace_back(sampler, &r);
+		for (unsigned v = 0; v != verifiers; ++v) {
+			threads.emplace_back(verifier, &r, v);
+		}
+
+		etchash_background_t bg = NULL;
+		if (mode == "background") {
+			etchash_background_options_t options;
+			memset(&options, 0, sizeof(options));
+			options.dirname = dirname.c_str();
+			options.deadline_block = boundary_block;
+			options.block_time_ms = block_ms;
+			bg = etchash_background_new_internal(epochs[1].cache_size, &epochs[1].seed, epochs[1].full_size, &options);
+		}
+		for (uint64_t head = boundary_block - before; head != boundary_block + after; ++head) {
+			auto block_start = high_resolution_clock::now();
+			if (bg) {
+				etchash_background_set_head(bg, head);
+			}
+			if (head == boundary_block) {
+				r.boundary_time = block_start;
+				r.current = 1;
+				if (bg) {
+					etchash_background_wait(bg, UINT32_MAX);
+					etchash_background_take(bg, &lights[1], &fulls[1]);
+				} else {
+					etchash_full_options_t options;
+					memset(&options, 0, sizeof(options));
+					options.parallel = mode == "parallel";
+					lights[1] = etchash_light_new_internal(epochs[1].cache_size, &epochs[1].seed);
+					if (lights[1]) {
+						fulls[1] = etchash_full_new_internal_ex(dirname.c_str(), epochs[1].seed, epochs[1].full_size,
+							lights[1], NULL, NULL, &options);
+					}
+				}
+				if (!fulls[1]) {
+					debugf("could not create the DAG of the new epoch\n");
+					return 1;
+				}
+				work.full = fulls[1];
+				etchash_search_set_work(search, 1, &work);
+				etchash_search_remove(search, 0);
+				etchash_full_delete(fulls[0]);
+				etchash_light_delete(lights[0]);
+				fulls[0] = NULL;
+				lights[0] = NULL;
+			}
+			std::this_thread::sleep_until(block_start + std::chrono::milliseconds(block_ms));
+		}
+
+		r.stop = true;
+		for (std::thread& t: threads) {
+			t.join();
+		}
+		etchash_search_delete(search);
+		if (bg) {
+			etchash_background_delete(bg);
+		}
+		etchash_full_delete(fulls[1]);
+		etchash_light_delete(lights[1]);
+		etchash_verify_release();
+		for (epoch const& e: epochs) {
+			remove_dag(dirname.c_str(), &e.seed);
+		}
+
+		std::vector<double> steady;
+		std::vector<double> transition;
+		for (std::vector<latency> const& thread: r.latencies) {
+			for (latency const& l: thread) {
+				(l.transition ? transition : steady).push_back(l.us);
+			}
+		}
+		size_t const count = steady.size() + transition.size();
+		double const steady_p99 = percentile(steady, 0.99);
+		double const transition_p50 = percentile(transition, 0.5);
+		double const transition_p99 = percentile(transition, 0.99);
+		double const transition_max = transition.empty() ? 0 : transition.back();
+		printf("%s,%llu,%llu,%.1f,%llu,%.0f,%.0f,%.0f,%.0f,%.1f\n", mode.c_str(),
+			(unsigned long long)epochs[1].cache_size, (unsigned long long)epochs[1].full_size,
+			r.first_hash_us < 0 ? -1.0 : r.first_hash_us / 1e3, (unsigned long long)count,
+			steady_p99, transition_p50, transition_p99, transition_max, r.peak_rss / (1024.0 * 1024.0));
+		fflush(stdout);
+	}
+	return 0;
+}
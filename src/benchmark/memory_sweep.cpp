@@ -0,0 +1,319 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file memory_sweep.cpp
+ * @date 2026
+ *
+ * Sweeps full mode hashing over synthetic DAG sizes, from cache resident to
+ * many GB, for each page backing and thread count, to show where a host falls
+ * off its cache and TLB cliffs. Prints CSV:
+ *
+ *     backing,threads,size_bytes,hashes,elapsed_ms,hashes_per_s,ns_per_access
+ *
+ * ns_per_access is the time a thread spends per DAG page access, there are
+ * ETCHASH_ACCESSES of them per hash. By default the DAG is filled with
+ * pseudo random words instead of real DAG items: the accesses of a hash only
+ * depend on the data being random, and generating a real DAG of many GB takes
+ * minutes. Pass -r for the real data. Sizes that do not fit the memory the
+ * process may still use are skipped.
+ *
+ * Backings are 4k (transparent hugepages disabled for the range), thp
+ * (madvise'd transparent hugepages, which the kernel may not honour) and
+ * hugetlb (preallocated 2 MB hugepages, see /proc/sys/vm/nr_hugepages).
+ * Only 4k is available outside Linux.
+ *
+ * usage: Memory_Sweep [-s min size] [-m max size] [-b backing,...]
+ *                     [-t threads,...] [-d ms per point] [-l] [-r] [-p]
+ *   -l  hash with etchash_full_compute_lanes()
+ *   -p  plot ns per access of every series after the CSV
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <libetchash/etchash.h>
+#include <libetchash/internal.h>
+#include <libetchash/auto.h>
+#include <libetchash/lanes.h>
+#include <libetchash/util.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+using std::chrono::high_resolution_clock;
+
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024ULL)
+
+enum backing { BACKING_4K, BACKING_THP, BACKING_HUGETLB };
+static char const* const g_backing_names[] = {"4k", "thp", "hugetlb"};
+
+struct point {
+	backing kind;
+	unsigned threads;
+	uint64_t size;
+	double ns_per_access;
+};
+
+static void* map_backing(backing kind, uint64_t size, uint64_t* mapped)
+{
+	*mapped = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+#ifdef __linux__
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+	if (kind == BACKING_HUGETLB) {
+		flags |= MAP_HUGETLB;
+	}
+	void* mem = mmap(NULL, *mapped, PROT_READ | PROT_WRITE, flags, -1, 0);
+	if (mem == MAP_FAILED) {
+		return NULL;
+	}
+	if (kind != BACKING_HUGETLB) {
+		madvise(mem, *mapped, kind == BACKING_THP ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+	}
+	return mem;
+#else
+	return kind == BACKING_4K ? malloc((size_t)*mapped) : NULL;
+#endif
+}
+
+static void unmap_backing(void* mem, uint64_t mapped)
+{
+#ifdef __linux__
+	munmap(mem, mapped);
+#else
+	(void)mapped;
+	free(mem);
+#endif
+}
+
+static void fill_random(void* mem, uint64_t size)
+{
+	uint64_t* words = (uint64_t*)mem;
+	uint64_t x = 0x9E3779B97F4A7C15ULL;
+	for (uint64_t i = 0; i != size / sizeof(uint64_t); ++i) {
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+		words[i] = x;
+	}
+}
+
+static void hash_until(etchash_full_t full, unsigned id, bool lanes, std::atomic<bool> const* stop, uint64_t* hashes)
+{
+	etchash_h256_t header;
+	memset(&header, 0, sizeof(header));
+	header.b[0] = (uint8_t)id;
+	uint64_t nonce = (uint64_t)id << 40;
+	uint64_t count = 0;
+	etchash_return_value_t ret[ETCHASH_LANES];
+	uint64_t nonces[ETCHASH_LANES];
+	while (!stop->load(std::memory_order_relaxed)) {
+		if (lanes) {
+			for (unsigned l = 0; l != ETCHASH_LANES; ++l) {
+				nonces[l] = nonce++;
+			}
+			etchash_full_compute_lanes(full, header, nonces, ret);
+			count += ETCHASH_LANES;
+		} else {
+			ret[0] = etchash_full_compute(full, header, nonce++);
+			count++;
+		}
+	}
+	*hashes = count;
+}
+
+static std::vector<std::string> split(char const* list)
+{
+	std::vector<std::string> ret;
+	std::string item;
+	for (char const* c = list; ; ++c) {
+		if (*c == ',' || !*c) {
+			if (!item.empty()) {
+				ret.push_back(item);
+			}
+			item.clear();
+			if (!*c) {
+				return ret;
+			}
+		} else {
+			item += *c;
+		}
+	}
+}
+
+static void plot(std::vector<point> const& points)
+{
+	size_t begin = 0;
+	while (begin != points.size()) {
+		size_t end = begin;
+		double max = 0;
+		while (end != points.size() && points[end].kind == points[begin].kind &&
+			points[end].threads == points[begin].threads) {
+			max = points[end].ns_per_access > max ? points[end].ns_per_access : max;
+			end++;
+		}
+		printf("\n%s, %u threads: ns per access\n", g_backing_names[points[begin].kind], points[begin].threads);
+		for (size_t i = begin; i != end; ++i) {
+			int width = max > 0 ? (int)(points[i].ns_per_access / max * 60 + 0.5) : 0;
+			printf("%10.1f MB %8.2f %s\n", points[i].size / (1024.0 * 1024.0), points[i].ns_per_access,
+				std::string(width, '#').c_str());
+		}
+		begin = end;
+	}
+}
+
+static int usage(char const* name)
+{
+	debugf("usage: %s [-s min size] [-m max size] [-b 4k,thp,hugetlb] [-t threads,...] [-d ms] [-l] [-r] [-p]\n", name);
+	return 1;
+}
+
+int main(int argc, char** argv)
+{
+	uint64_t min_size = 256 * 1024;
+	uint64_t max_size = 4ULL * 1024 * 1024 * 1024;
+	char const* backings = "4k,thp,hugetlb";
+	unsigned const cpus = std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1;
+	std::string threads_list = cpus > 1 ? "1," + std::to_string(cpus) : "1";
+	unsigned duration_ms = 500;
+	bool lanes = false;
+	bool real = false;
+	bool plotted = false;
+	for (int i = 1; i < argc; ++i) {
+		bool has_value = i + 1 < argc;
+		if (strcmp(argv[i], "-s") == 0 && has_value) {
+			min_size = strtoull(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "-m") == 0 && has_value) {
+			max_size = strtoull(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "-b") == 0 && has_value) {
+			backings = argv[++i];
+		} else if (strcmp(argv[i], "-t") == 0 && has_value) {
+			threads_list = argv[++i];
+		} else if (strcmp(argv[i], "-d") == 0 && has_value) {
+			duration_ms = (unsigned)strtoul(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "-l") == 0) {
+			lanes = true;
+		} else if (strcmp(argv[i], "-r") == 0) {
+			real = true;
+		} else if (strcmp(argv[i], "-p") == 0) {
+			plotted = true;
+		} else {
+			return usage(argv[0]);
+		}
+	}
+	// the DAG is hashed in 128 byte pages
+	min_size = min_size < 1024 ? 1024 : min_size / 128 * 128;
+
+	std::vector<unsigned> thread_counts;
+	for (std::string const& t: split(threads_list.c_str())) {
+		thread_counts.push_back((unsigned)std::max(1, atoi(t.c_str())));
+	}
+	etchash_host_info_t host;
+	etchash_host_probe(NULL, NULL, &host);
+
+	etchash_h256_t seed;
+	memset(&seed, 0, sizeof(seed));
+	etchash_light_t light = real ? etchash_light_new_internal(1024, &seed) : NULL;
+
+	std::vector<point> points;
+	printf("backing,threads,size_bytes,hashes,elapsed_ms,hashes_per_s,ns_per_access\n");
+	for (std::string const& name: split(backings)) {
+		int kind = -1;
+		for (int k = 0; k != 3; ++k) {
+			if (name == g_backing_names[k]) {
+				kind = k;
+			}
+		}
+		if (kind < 0) {
+			return usage(argv[0]);
+		}
+		// each size and one and a half of it, to place the cliffs more closely
+		for (uint64_t base = min_size; base <= max_size; base *= 2) {
+			for (uint64_t size: {base, base / 256 * 3 * 128}) {
+				if (size > max_size) {
+					continue;
+				}
+				if (host.memory_available != ETCHASH_UNKNOWN_SIZE && size > host.memory_available / 10 * 8) {
+					debugf("skipping %llu bytes, more than the memory available\n", (unsigned long long)size);
+					continue;
+				}
+				uint64_t mapped;
+				void* mem = map_backing((backing)kind, size, &mapped);
+				if (!mem) {
+					debugf("no %s backing for %llu bytes\n", name.c_str(), (unsigned long long)size);
+					continue;
+				}
+				if (real) {
+					etchash_compute_full_data(mem, size, light, NULL);
+				} else {
+					fill_random(mem, size);
+				}
+				// a stand-in full handler over the memory, never passed to etchash_full_delete()
+				struct etchash_full full;
+				memset(&full, 0, sizeof(full));
+				full.file_size = size;
+				full.data = (node*)mem;
+
+				for (unsigned threads: thread_counts) {
+					std::atomic<bool> stop(false);
+					std::vector<uint64_t> hashes(threads);
+					std::vector<std::thread> workers;
+					auto start = high_resolution_clock::now();
+					for (unsigned t = 0; t != threads; ++t) {
+						workers.emplace_back(hash_until, &full, t, lanes, &stop, &hashes[t]);
+					}
+					std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+					stop = true;
+					for (std::thread& worker: workers) {
+						worker.join();
+					}
+					double elapsed_ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+						high_resolution_clock::now() - start).count();
+					uint64_t total = 0;
+					for (uint64_t h: hashes) {
+						total += h;
+					}
+					point p;
+					p.kind = (backing)kind;
+					p.threads = threads;
+					p.size = size;
+					p.ns_per_access = total ? elapsed_ns * threads / ((double)total * ETCHASH_ACCESSES) : 0;
+					points.push_back(p);
+					printf("%s,%u,%llu,%llu,%.0f,%.0f,%.2f\n", name.c_str(), threads, (unsigned long long)size,
+						(unsigned long long)total, elapsed_ns / 1e6, total / (elapsed_ns / 1e9), p.ns_per_access);
+					fflush(stdout);
+				}
+				unmap_backing(mem, mapped);
+			}
+		}
+	}
+	if (light) {
+		etchash_light_delete(light);
+	}
+	if (plotted) {
+		// one series per backing and thread count, in size order
+		std::stable_sort(points.begin(), points.end(), [](point const& a, point const& b) {
+			return a.kind != b.kind ? a.kind < b.kind : a.threads != b.threads ? a.threads < b.threads : a.size < b.size;
+		});
+		plot(points);
+	}
+	return 0;
+}
@@ -0,0 +1,225 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file smt_pairing.cpp
+ * @date 2026
+ *
+ * Measures what pairing a memory bound with a compute bound worker on the two
+ * hyperthreads of a core gains over placing two workers of the same kind on
+ * a core. Memory workers hash in full mode over a DAG far larger than the
+ * last level cache, compute workers hash in light mode over a cache resident
+ * cache, which is Keccak bound. Prints CSV:
+ *
+ *     placement,cores,memory_hashes_per_s,compute_hashes_per_s,combined
+ *
+ * Placements, with one memory and one compute worker per core in total:
+ *
+ *     solo     one worker of a kind per core, the other hyperthread idle,
+ *              run once per kind for the reference rates
+ *     naive    both hyperthreads of half the cores run memory workers, of
+ *              the other half compute workers
+ *     paired   every core runs a memory and a compute worker
+ *
+ * combined is the sum of the rates of both kinds, each normalised by its solo
+ * rate: 2 means each kind runs as fast as alone on a core. The DAG is filled
+ * with pseudo random words, as in Memory_Sweep. Needs SMT and an even number
+ * of cores, see etchash_topology_smt_pairs().
+ *
+ * usage: SMT_Pairing [-c cores] [-s DAG size] [-d ms per placement]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <libetchash/etchash.h>
+#include <libetchash/internal.h>
+#include <libetchash/thread.h>
+#include <libetchash/topology.h>
+#include <libetchash/util.h>
+
+using std::chrono::high_resolution_clock;
+
+#define MAX_CORES 1024
+
+enum kind { KIND_MEMORY, KIND_COMPUTE };
+
+struct worker {
+	kind what;
+	unsigned cpu;
+	uint64_t hashes;
+};
+
+struct rates {
+	double memory;
+	double compute;
+};
+
+static void fill_random(void* mem, uint64_t size)
+{
+	uint64_t* words = (uint64_t*)mem;
+	uint64_t x = 0x9E3779B97F4A7C15ULL;
+	for (uint64_t i = 0; i != size / sizeof(uint64_t); ++i) {
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+		words[i] = x;
+	}
+}
+
+static void hash_until(
+	etchash_full_t full,
+	etchash_light_t light,
+	unsigned id,
+	worker* w,
+	std::atomic<bool> const* stop
+)
+{
+	etchash_thread_set_affinity(&w->cpu, 1);
+	etchash_h256_t header;
+	memset(&header, 0, sizeof(header));
+	header.b[0] = (uint8_t)id;
+	uint64_t nonce = (uint64_t)id << 40;
+	uint64_t count = 0;
+	while (!stop->load(std::memory_order_relaxed)) {
+		if (w->what == KIND_MEMORY) {
+			etchash_full_compute(full, header, nonce++);
+		} else {
+			// the size of the real DAG only picks the pages, the cache stays resident
+			etchash_light_compute_internal(light, full->file_size, header, nonce++);
+		}
+		count++;
+	}
+	w->hashes = count;
+}
+
+static rates run(std::vector<worker>& workers, etchash_full_t full, etchash_light_t light, unsigned duration_ms)
+{
+	std::atomic<bool> stop(false);
+	std::vector<std::thread> threads;
+	auto start = high_resolution_clock::now();
+	for (size_t i = 0; i != workers.size(); ++i) {
+		threads.emplace_back(hash_until, full, light, (unsigned)i, &workers[i], &stop);
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+	stop = true;
+	for (std::thread& t: threads) {
+		t.join();
+	}
+	double elapsed_s = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		high_resolution_clock::now() - start).count() / 1e9;
+	rates r = {0, 0};
+	for (worker const& w: workers) {
+		(w.what == KIND_MEMORY ? r.memory : r.compute) += w.hashes / elapsed_s;
+	}
+	return r;
+}
+
+static int usage(char const* name)
+{
+	debugf("usage: %s [-c cores] [-s DAG size] [-d ms]\n", name);
+	return 1;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned cores = 0;
+	uint64_t dag_size = 1024ULL * 1024 * 1024;
+	unsigned duration_ms = 2000;
+	for (int i = 1; i < argc; ++i) {
+		bool has_value = i + 1 < argc;
+		if (strcmp(argv[i], "-c") == 0 && has_value) {
+			cores = (unsigned)strtoul(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "-s") == 0 && has_value) {
+			dag_size = strtoull(argv[++i], NULL, 10) / 128 * 128;
+		} else if (strcmp(argv[i], "-d") == 0 && has_value) {
+			duration_ms = (unsigned)strtoul(argv[++i], NULL, 10);
+		} else {
+			return usage(argv[0]);
+		}
+	}
+	static unsigned first[MAX_CORES];
+	static unsigned second[MAX_CORES];
+	unsigned available = etchash_topology_smt_pairs(first, second, MAX_CORES);
+	if (available < 2) {
+		printf("# no SMT on this host, nothing to pair\n");
+		return 0;
+	}
+	cores = cores && cores < available ? cores : available;
+	cores &= ~1u;
+	if (cores < 2 || dag_size < 1024) {
+		return usage(argv[0]);
+	}
+
+	void* mem = malloc((size_t)dag_size);
+	if (!mem) {
+		debugf("cannot allocate %llu bytes\n", (unsigned long long)dag_size);
+		return 1;
+	}
+	fill_random(mem, dag_size);
+	// a stand-in full handler over the memory, never passed to etchash_full_delete()
+	struct etchash_full full;
+	memset(&full, 0, sizeof(full));
+	full.file_size = dag_size;
+	full.data = (node*)mem;
+	etchash_h256_t seed;
+	memset(&seed, 0, sizeof(seed));
+	etchash_light_t light = etchash_light_new_internal(16 * 1024, &seed);
+	if (!light) {
+		free(mem);
+		return 1;
+	}
+
+	printf("placement,cores,memory_hashes_per_s,compute_hashes_per_s,combined\n");
+	rates solo = {0, 0};
+	for (kind what: {KIND_MEMORY, KIND_COMPUTE}) {
+		std::vector<worker> workers;
+		for (unsigned c = 0; c != cores; ++c) {
+			workers.push_back(worker{what, first[c], 0});
+		}
+		rates r = run(workers, &full, light, duration_ms);
+		if (what == KIND_MEMORY) {
+			solo.memory = r.memory;
+		} else {
+			solo.compute = r.compute;
+		}
+		printf("solo_%s,%u,%.0f,%.0f,1\n", what == KIND_MEMORY ? "memory" : "compute", cores, r.memory, r.compute);
+		fflush(stdout);
+	}
+	for (bool paired: {false, true}) {
+		std::vector<worker> workers;
+		for (unsigned c = 0; c != cores; ++c) {
+			if (paired) {
+				workers.push_back(worker{KIND_MEMORY, first[c], 0});
+				workers.push_back(worker{KIND_COMPUTE, second[c], 0});
+			} else {
+				kind what = c < cores / 2 ? KIND_MEMORY : KIND_COMPUTE;
+				workers.push_back(worker{what, first[c], 0});
+				workers.push_back(worker{what, second[c], 0});
+			}
+		}
+		rates r = run(workers, &full, light, duration_ms);
+		double combined = r.memory / solo.memory + r.compute / solo.compute;
+		printf("%s,%u,%.0f,%.0f,%.3f\n", paired ? "paired" : "naive", cores, r.memory, r.compute, combined);
+		fflush(stdout);
+	}
+	etchash_light_delete(light);
+	free(mem);
+	return 0;
+}
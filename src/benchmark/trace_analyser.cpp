@@ -0,0 +1,79 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file trace_analyser.cpp
+ * @date 2026
+ *
+ * Reports page reuse, NUMA distribution and hugepage coverage of a DAG access
+ * trace written with etchash_trace_open().
+ *
+ * usage: Trace_Analyser <trace file> [numa nodes] [interleave bytes]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <libetchash/trace.h>
+#include <libetchash/util.h>
+
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		debugf("usage: %s <trace file> [numa nodes] [interleave bytes]\n", argv[0]);
+		return 1;
+	}
+	etchash_trace_record_t* records;
+	uint64_t count;
+	etchash_trace_layout_t layout = {};
+	if (!etchash_trace_load(argv[1], &records, &count, &layout.full_size)) {
+		debugf("could not read trace file \"%s\"\n", argv[1]);
+		return 1;
+	}
+	layout.numa_nodes = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : 1;
+	layout.interleave_bytes = argc > 3 ? strtoull(argv[3], NULL, 10) : 4096;
+
+	etchash_trace_stats_t stats;
+	if (!etchash_trace_analyse(records, count, &layout, &stats)) {
+		debugf("could not analyse trace, check the NUMA layout\n");
+		free(records);
+		return 1;
+	}
+	free(records);
+
+	debugf("DAG size:            %llu bytes\n", (unsigned long long)layout.full_size);
+	debugf("hashes:              %llu\n", (unsigned long long)stats.hashes);
+	debugf("page accesses:       %llu\n", (unsigned long long)stats.accesses);
+	debugf("distinct pages:      %llu (%.2f%% of the DAG)\n",
+		(unsigned long long)stats.distinct_pages,
+		100.0 * stats.distinct_pages * ETCHASH_MIX_BYTES / layout.full_size);
+	debugf("distinct 4K pages:   %llu\n", (unsigned long long)stats.distinct_4k);
+	debugf("distinct 2M pages:   %llu (%.2f%% hugepage coverage)\n",
+		(unsigned long long)stats.distinct_2m, 100.0 * stats.hugepage_coverage);
+	debugf("cold accesses:       %llu\n", (unsigned long long)stats.cold_accesses);
+	debugf("mean reuse distance: %.1f accesses\n", stats.mean_reuse_distance);
+	debugf("reuse distance histogram:\n");
+	for (unsigned i = 0; i != 64; ++i) {
+		if (stats.reuse_histogram[i]) {
+			debugf("  [2^%-2u, 2^%-2u): %llu\n", i, i + 1, (unsigned long long)stats.reuse_histogram[i]);
+		}
+	}
+	debugf("NUMA distribution (%u nodes, %llu byte interleave):\n",
+		layout.numa_nodes ? layout.numa_nodes : 1, (unsigned long long)layout.interleave_bytes);
+	for (unsigned n = 0; n != (layout.numa_nodes ? layout.numa_nodes : 1); ++n) {
+		debugf("  node %u: %llu (%.2f%%)\n", n, (unsigned long long)stats.numa_accesses[n],
+			stats.accesses ? 100.0 * stats.numa_accesses[n] / stats.accesses : 0.0);
+	}
+	return 0;
+}
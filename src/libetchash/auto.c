@@ -0,0 +1,385 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file auto.c
+ * @date 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "auto.h"
+#include "internal.h"
+#include "thread.h"
+#include "io.h"
+
+#define MIB (1024 * 1024)
+
+static bool host_read(char const* root, char const* path, char* buf, size_t size)
+{
+	char name[512];
+	snprintf(name, sizeof(name), "%s%s", root ? root : "", path);
+	FILE* f = etchash_fopen(name, "r");
+	if (!f) {
+		return false;
+	}
+	size_t n = fread(buf, 1, size - 1, f);
+	fclose(f);
+	buf[n] = '\0';
+	return n > 0;
+}
+
+// parses a single number, "max" (cgroup v2) and negative values (cgroup v1) mean no limit
+static bool host_read_limit(char const* root, char const* path, uint64_t* value)
+{
+	char buf[64];
+	if (!host_read(root, path, buf, sizeof(buf)) || strncmp(buf, "max", 3) == 0 || buf[0] == '-') {
+		return false;
+	}
+	char* end;
+	*value = strtoull(buf, &end, 10);
+	return end != buf;
+}
+
+// counts the entries of a kernel cpu/node list such as "0-3,8,10-11"
+static unsigned host_read_list(char const* root, char const* path)
+{
+	char buf[1024];
+	if (!host_read(root, path, buf, sizeof(buf))) {
+		return 0;
+	}
+	unsigned count = 0;
+	char* p = buf;
+	while (*p >= '0' && *p <= '9') {
+		unsigned long first = strtoul(p, &p, 10);
+		unsigned long last = first;
+		if (*p == '-') {
+			last = strtoul(p + 1, &p, 10);
+		}
+		if (last >= first) {
+			count += (unsigned)(last - first + 1);
+		}
+		if (*p != ',') {
+			break;
+		}
+		p++;
+	}
+	return count;
+}
+
+static bool host_meminfo(char const* meminfo, char const* key, uint64_t* value)
+{
+	char const* p = strstr(meminfo, key);
+	if (!p) {
+		return false;
+	}
+	p += strlen(key);
+	char* end;
+	*value = strtoull(p, &end, 10);
+	if (end == p) {
+		return false;
+	}
+	while (*end == ' ') {
+		end++;
+	}
+	if (strncmp(end, "kB", 2) == 0) {
+		*value *= 1024;
+	}
+	return true;
+}
+
+void etchash_host_probe(char const* root, char const* dirname, etchash_host_info_t* info)
+{
+	char meminfo[4096];
+	uint64_t value;
+	uint64_t limit;
+	uint64_t period;
+
+	info->memory_limit = ETCHASH_UNKNOWN_SIZE;
+	info->memory_available = ETCHASH_UNKNOWN_SIZE;
+	info->cpu_quota = 0;
+	info->cpus = 0;
+	info->hugepages_free = 0;
+	info->numa_nodes = 0;
+	info->disk_free = ETCHASH_UNKNOWN_SIZE;
+
+	if (host_read(root, "/proc/meminfo", meminfo, sizeof(meminfo))) {
+		if (host_meminfo(meminfo, "MemTotal:", &value)) {
+			info->memory_limit = value;
+		}
+		if (host_meminfo(meminfo, "MemAvailable:", &value)) {
+			info->memory_available = value;
+		}
+		uint64_t pagesize;
+		if (host_meminfo(meminfo, "HugePages_Free:", &value) &&
+			host_meminfo(meminfo, "Hugepagesize:", &pagesize)) {
+			info->hugepages_free = value * pagesize;
+		}
+	}
+
+	// the cgroup v2 unified hierarchy first, then the v1 controllers
+	bool have_limit = host_read_limit(root, "/sys/fs/cgroup/memory.max", &limit);
+	bool v2 = have_limit;
+	if (!have_limit) {
+		have_limit = host_read_limit(root, "/sys/fs/cgroup/memory/memory.limit_in_bytes", &limit);
+	}
+	if (have_limit && limit < info->memory_limit) {
+		info->memory_limit = limit;
+		uint64_t used = 0;
+		if (v2) {
+			host_read_limit(root, "/sys/fs/cgroup/memory.current", &used);
+		} else {
+			host_read_limit(root, "/sys/fs/cgroup/memory/memory.usage_in_bytes", &used);
+		}
+		uint64_t left = used < limit ? limit - used : 0;
+		if (left < info->memory_available) {
+			info->memory_available = left;
+		}
+	}
+
+	char cpumax[64];
+	if (host_read(root, "/sys/fs/cgroup/cpu.max", cpumax, sizeof(cpumax))) {
+		if (strncmp(cpumax, "max", 3) != 0) {
+			char* end;
+			value = strtoull(cpumax, &end, 10);
+			period = strtoull(end, NULL, 10);
+			if (period) {
+				info->cpu_quota = (double)value / (double)period;
+			}
+		}
+	} else if (host_read_limit(root, "/sys/fs/cgroup/cpu/cpu.cfs_quota_us", &value) &&
+		host_read_limit(root, "/sys/fs/cgroup/cpu/cpu.cfs_period_us", &period) && period) {
+		info->cpu_quota = (double)value / (double)period;
+	}
+
+	info->cpus = host_read_list(root, "/sys/devices/system/cpu/online");
+	if (!info->cpus) {
+		info->cpus = etchash_cpu_count();
+	}
+	info->numa_nodes = host_read_list(root, "/sys/devices/system/node/online");
+	if (!info->numa_nodes) {
+		info->numa_nodes = 1;
+	}
+
+	if (dirname && etchash_disk_free(dirname, &value)) {
+		info->disk_free = value;
+	}
+}
+
+void etchash_auto_select(
+	etchash_host_info_t const* host,
+	etchash_auto_policy_t const* policy,
+	uint64_t full_size,
+	uint64_t cache_size,
+	bool dag_on_disk,
+	etchash_auto_choice_t* choice
+)
+{
+	etchash_auto_policy_t defaults;
+	if (!policy) {
+		memset(&defaults, 0, sizeof(defaults));
+		policy = &defaults;
+	}
+
+	unsigned threads = host->cpus ? host->cpus : 1;
+	if (host->cpu_quota > 0) {
+		unsigned quota = (unsigned)(host->cpu_quota + 0.999);
+		if (quota < threads) {
+			threads = quota;
+		}
+	}
+	if (policy->max_threads && policy->max_threads < threads) {
+		threads = policy->max_threads;
+	}
+	if (threads == 0) {
+		threads = 1;
+	}
+	choice->threads = threads;
+
+	uint64_t headroom = policy->memory_headroom;
+	if (!headroom && host->memory_limit != ETCHASH_UNKNOWN_SIZE) {
+		headroom = host->memory_limit / 8;
+	}
+	uint64_t needed = full_size + cache_size + headroom;
+	uint64_t disk_needed = dag_on_disk ? 0 : full_size + ETCHASH_DAG_HEADER_SIZE;
+
+	char why[160];
+	if (policy->light_only) {
+		choice->mode = ETCHASH_MODE_LIGHT;
+		snprintf(why, sizeof(why), "the policy asks for light mode");
+	} else if (host->memory_available != ETCHASH_UNKNOWN_SIZE && host->memory_available < needed) {
+		choice->mode = ETCHASH_MODE_LIGHT;
+		snprintf(
+			why, sizeof(why), "%llu MiB of memory available, the DAG needs %llu MiB with headroom",
+			(unsigned long long)(host->memory_available / MIB), (unsigned long long)(needed / MIB)
+		);
+	} else if (host->disk_free != ETCHASH_UNKNOWN_SIZE && host->disk_free < disk_needed) {
+		choice->mode = ETCHASH_MODE_LIGHT;
+		snprintf(
+			why, sizeof(why), "%llu MiB of disk free, the DAG file needs %llu MiB",
+			(unsigned long long)(host->disk_free / MIB), (unsigned long long)(disk_needed / MIB)
+		);
+	} else {
+		choice->mode = ETCHASH_MODE_FULL;
+		if (host->memory_available == ETCHASH_UNKNOWN_SIZE) {
+			snprintf(why, sizeof(why), "no memory limit found");
+		} else {
+			snprintf(
+				why, sizeof(why), "%llu MiB of memory available for the %llu MiB DAG%s",
+				(unsigned long long)(host->memory_available / MIB), (unsigned long long)(full_size / MIB),
+				dag_on_disk ? ", already on disk" : ""
+			);
+		}
+	}
+	snprintf(
+		choice->reason, sizeof(choice->reason), "%s mode: %s; %u threads (%u cpus, quota %.2f); %u numa nodes; %llu MiB hugepages free",
+		choice->mode == ETCHASH_MODE_FULL ? "full" : "light", why, threads, host->cpus, host->cpu_quota,
+		host->numa_nodes, (unsigned long long)(host->hugepages_free / MIB)
+	);
+}
+
+static bool auto_dag_on_disk(char const* dirname, etchash_h256_t const* seedhash, uint64_t full_size)
+{
+	char mutable_name[DAG_MUTABLE_NAME_MAX_SIZE];
+	etchash_io_mutable_name(ETCHASH_REVISION, seedhash, mutable_name);
+	char* name = etchash_io_create_filename(dirname, mutable_name, strlen(mutable_name));
+	if (!name) {
+		return false;
+	}
+	bool ret = false;
+	FILE* f = etchash_fopen(name, "rb");
+	if (f) {
+		size_t found_size;
+		ret = etchash_file_size(f, &found_size) && (
+			found_size == full_size + ETCHASH_DAG_HEADER_SIZE ||
+			found_size == full_size + ETCHASH_DAG_MAGIC_NUM_SIZE
+		);
+		fclose(f);
+	}
+	free(name);
+	return ret;
+}
+
+// the memory budget needs the room of the DAG, continue in light mode
+static void auto_evict(void* user)
+{
+	etchash_auto_t handler = (etchash_auto_t)user;
+	etchash_full_t full = etchash_atomic_exchange_ptr((void* volatile*)&handler->full, NULL);
+	if (!full) {
+		return;
+	}
+	etchash_spin_lock(&handler->choice_lock);
+	handler->choice.mode = ETCHASH_MODE_LIGHT;
+	snprintf(handler->choice.reason, sizeof(handler->choice.reason), "light mode: the DAG was evicted by the memory budget");
+	etchash_spin_unlock(&handler->choice_lock);
+	while (etchash_atomic_load(&handler->users)) {
+		etchash_sleep_ms(0);
+	}
+	etchash_full_delete(full);
+}
+
+etchash_auto_t etchash_auto_new(uint64_t block_number, etchash_auto_policy_t const* policy)
+{
+	char strbuf[256];
+	char const* dirname = policy ? policy->dirname : NULL;
+	if (!dirname) {
+		if (!etchash_get_default_dirname(strbuf, 256)) {
+			return NULL;
+		}
+		dirname = strbuf;
+	}
+	etchash_auto_t ret = calloc(sizeof(*ret), 1);
+	if (!ret) {
+		return NULL;
+	}
+	ret->light = etchash_light_new(block_number);
+	if (!ret->light) {
+		goto fail_free;
+	}
+	uint64_t full_size = etchash_get_datasize(block_number);
+	etchash_h256_t seedhash = etchash_get_seedhash(block_number);
+	bool light_only = policy && policy->light_only;
+	if (!light_only) {
+		etchash_mkdir(dirname);
+	}
+	etchash_host_probe(NULL, light_only ? NULL : dirname, &ret->host);
+	bool on_disk = !light_only && auto_dag_on_disk(dirname, &seedhash, full_size);
+	etchash_auto_select(&ret->host, policy, full_size, ret->light->cache_size, on_disk, &ret->choice);
+
+	if (ret->choice.mode == ETCHASH_MODE_FULL && !etchash_budget_fits(ETCHASH_BUDGET_DAG, full_size)) {
+		ret->choice.mode = ETCHASH_MODE_LIGHT;
+		snprintf(
+			ret->choice.reason, sizeof(ret->choice.reason),
+			"light mode: the DAG of %llu bytes does not fit the memory budget",
+			(unsigned long long)full_size
+		);
+	}
+	if (ret->choice.mode == ETCHASH_MODE_FULL) {
+		ret->full = etchash_full_new_internal(dirname, seedhash, full_size, ret->light, NULL);
+		if (ret->full) {
+			etchash_budget_set_evict(ret->full->budget, auto_evict, ret);
+		} else {
+			ret->choice.mode = ETCHASH_MODE_LIGHT;
+			snprintf(
+				ret->choice.reason, sizeof(ret->choice.reason),
+				"light mode: the DAG could not be created in %s", dirname
+			);
+		}
+	}
+	return ret;
+
+fail_free:
+	free(ret);
+	return NULL;
+}
+
+void etchash_auto_delete(etchash_auto_t handler)
+{
+	etchash_full_t full = etchash_atomic_exchange_ptr((void* volatile*)&handler->full, NULL);
+	// an eviction may still be using the handler
+	etchash_budget_forget(full ? full->budget : NULL);
+	if (full) {
+		etchash_full_delete(full);
+	}
+	etchash_light_delete(handler->light);
+	free(handler);
+}
+
+void etchash_auto_get_choice(etchash_auto_t handler, etchash_auto_choice_t* choice)
+{
+	etchash_spin_lock(&handler->choice_lock);
+	*choice = handler->choice;
+	etchash_spin_unlock(&handler->choice_lock);
+}
+
+etchash_return_value_t etchash_auto_compute(
+	etchash_auto_t handler,
+	etchash_h256_t const header_hash,
+	uint64_t nonce
+)
+{
+	etchash_return_value_t ret;
+	etchash_atomic_add(&handler->users, 1);
+	etchash_full_t full = etchash_atomic_load_ptr((void* volatile*)&handler->full);
+	if (full) {
+		etchash_budget_touch(full->budget);
+		ret = etchash_full_compute(full, header_hash, nonce);
+	} else {
+		ret = etchash_light_compute(handler->light, header_hash, nonce);
+	}
+	etchash_atomic_add(&handler->users, -1);
+	return ret;
+}
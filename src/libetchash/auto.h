@@ -0,0 +1,141 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file auto.h
+ * @date 2026
+ *
+ * Automatic choice between light and full mode based on the resources the
+ * process can actually use: cgroup (v2, or v1) memory and CPU limits, free
+ * hugepages, NUMA nodes and free disk space in the DAG directory.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "etchash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ETCHASH_UNKNOWN_SIZE UINT64_MAX
+#define ETCHASH_AUTO_REASON_SIZE 512
+
+typedef enum etchash_mode {
+	ETCHASH_MODE_LIGHT = 0,  ///< Verify with the cache, computing DAG items on the fly
+	ETCHASH_MODE_FULL,       ///< Hash with the full DAG
+} etchash_mode_t;
+
+/// What the host provides to the process. Fields are ETCHASH_UNKNOWN_SIZE or 0 if unknown
+typedef struct etchash_host_info {
+	uint64_t memory_limit;      ///< Lowest of the cgroup limit and physical memory
+	uint64_t memory_available;  ///< Memory that can still be allocated within the limit
+	double cpu_quota;           ///< CPUs the cgroup may use, 0 for no quota
+	unsigned cpus;              ///< Online CPUs
+	uint64_t hugepages_free;    ///< Bytes of free preallocated hugepages
+	unsigned numa_nodes;        ///< Online NUMA nodes
+	uint64_t disk_free;         ///< Free bytes in the DAG directory
+} etchash_host_info_t;
+
+/// Settings for @ref etchash_auto_new(). Zero initialize for the defaults.
+typedef struct etchash_auto_policy {
+	char const* dirname;       ///< DAG directory, NULL for the default directory
+	uint64_t memory_headroom;  ///< Memory to leave to the embedder, 0 for 1/8th of the limit
+	unsigned max_threads;      ///< Upper bound of the chosen thread count, 0 for none
+	bool light_only;           ///< Never choose full mode
+} etchash_auto_policy_t;
+
+/// The outcome of @ref etchash_auto_select()
+typedef struct etchash_auto_choice {
+	etchash_mode_t mode;
+	unsigned threads;                        ///< Suggested number of hashing threads
+	char reason[ETCHASH_AUTO_REASON_SIZE];   ///< Human readable explanation of the choice
+} etchash_auto_choice_t;
+
+struct etchash_auto {
+	etchash_light_t light;
+	etchash_full_t full;          ///< NULL unless full mode was chosen. Dropped when the memory budget evicts it.
+	etchash_host_info_t host;
+	etchash_auto_choice_t choice; ///< Read it with @ref etchash_auto_get_choice(), an eviction rewrites it
+	int32_t volatile choice_lock;
+	int32_t users;                ///< Threads in @ref etchash_auto_compute()
+};
+typedef struct etchash_auto* etchash_auto_t;
+
+/**
+ * Probe the resources available to the process
+ *
+ * @param root       Prefix of the /proc and /sys paths to read, NULL or "" for the
+ *                   real ones. Useful to test against a recorded file tree.
+ * @param dirname    The DAG directory whose free disk space to report
+ * @param[out] info  Receives the findings
+ */
+void etchash_host_probe(char const* root, char const* dirname, etchash_host_info_t* info);
+
+/**
+ * Choose the mode and thread count for an epoch
+ *
+ * @param host         The probed host, see @ref etchash_host_probe()
+ * @param policy       The embedder's policy, may be NULL for the defaults
+ * @param full_size    Size of the epoch's DAG
+ * @param cache_size   Size of the epoch's cache
+ * @param dag_on_disk  Whether the DAG file already exists and needs no disk space
+ * @param[out] choice  Receives the decision and its reason
+ */
+void etchash_auto_select(
+	etchash_host_info_t const* host,
+	etchash_auto_policy_t const* policy,
+	uint64_t full_size,
+	uint64_t cache_size,
+	bool dag_on_disk,
+	etchash_auto_choice_t* choice
+);
+
+/**
+ * Create the handlers for a block in the mode the host can afford
+ *
+ * If full mode is chosen but the DAG can not be created the handler falls back
+ * to light mode and says so in choice.reason.
+ *
+ * @param block_number   The block number for which to create the handlers
+ * @param policy         The embedder's policy, may be NULL for the defaults
+ * @return               The handlers or NULL for ERRNOMEM
+ */
+etchash_auto_t etchash_auto_new(uint64_t block_number, etchash_auto_policy_t const* policy);
+
+void etchash_auto_delete(etchash_auto_t handler);
+
+/**
+ * Copy the current choice of the handler. Safe while the memory budget
+ * evicts the DAG from another thread.
+ *
+ * @param handler      The handlers
+ * @param[out] choice  Receives the mode, thread count and reason
+ */
+void etchash_auto_get_choice(etchash_auto_t handler, etchash_auto_choice_t* choice);
+
+/**
+ * Hash with the full DAG if there is one, else with the cache. The DAG is
+ * dropped for the cache when the memory budget (see budget.h) needs its room.
+ */
+etchash_return_value_t etchash_auto_compute(
+	etchash_auto_t handler,
+	etchash_h256_t const header_hash,
+	uint64_t nonce
+);
+
+#ifdef __cplusplus
+}
+#endif
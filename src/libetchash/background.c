@@ -0,0 +1,333 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file background.c
+ * @date 2026
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "background.h"
+#include "internal.h"
+#include "thread.h"
+#include "pool.h"
+#include "io.h"
+
+#define BACKGROUND_DEFAULT_ESCALATE_BLOCKS 100
+#define BACKGROUND_DEFAULT_BLOCK_TIME_MS 13000
+// DAG nodes between checks for foreground work, a few milliseconds of work
+#define BACKGROUND_PROGRESS_INTERVAL 256
+
+static int32_t volatile g_foreground = 0;
+
+struct etchash_background {
+	etchash_thread_t thread;
+	etchash_mutex_t mutex;
+	etchash_cond_t finished;
+	char dirname[256];
+	uint64_t block_number;    // 0 for explicit sizes, as for etchash_light_new_internal()
+	uint64_t cache_size;
+	etchash_h256_t seed;
+	uint64_t full_size;
+	etchash_background_options_t options;
+	uint64_t head_block;
+	bool cancel;
+	bool taken;
+	etchash_background_status_t status;
+	uint64_t dag_paused_ms;   // time paused since the DAG generation started
+	uint64_t running_ms;      // time spent generating the DAG while not paused
+	etchash_light_t light;
+	etchash_full_t full;
+};
+
+void etchash_foreground_begin(void)
+{
+	etchash_atomic_add(&g_foreground, 1);
+}
+
+void etchash_foreground_end(void)
+{
+	etchash_atomic_add(&g_foreground, -1);
+}
+
+// whether the remaining work can still be done in the time left before the deadline
+static bool background_should_escalate(struct etchash_background* bg, etchash_progress_t const* progress)
+{
+	if (!bg->options.deadline_block) {
+		return false;
+	}
+	uint64_t blocks_left = bg->options.deadline_block > bg->head_block ?
+		bg->options.deadline_block - bg->head_block : 0;
+	if (blocks_left <= bg->options.escalate_blocks) {
+		return true;
+	}
+	if (bg->status.state != ETCHASH_BACKGROUND_DAG || !progress->nodes_done || !bg->running_ms) {
+		return false;
+	}
+	// keep a safety margin of half of the time left
+	uint64_t remaining_ms = bg->running_ms * (progress->total_nodes - progress->nodes_done) / progress->nodes_done;
+	return blocks_left * bg->options.block_time_ms < 2 * remaining_ms;
+}
+
+static int background_progress(etchash_progress_t const* progress, void* user)
+{
+	struct etchash_background* bg = (struct etchash_background*)user;
+	uint64_t now = etchash_time_ms();
+	etchash_mutex_lock(&bg->mutex);
+	if (bg->status.state == ETCHASH_BACKGROUND_DAG) {
+		bg->running_ms = progress->elapsed_ms > bg->dag_paused_ms ? progress->elapsed_ms - bg->dag_paused_ms : 0;
+	}
+	bg->status.nodes_done = progress->nodes_done;
+	bg->status.total_nodes = progress->total_nodes;
+	for (;;) {
+		if (bg->cancel) {
+			etchash_mutex_unlock(&bg->mutex);
+			return 1;
+		}
+		if (!bg->status.escalated && background_should_escalate(bg, progress)) {
+			bg->status.escalated = true;
+			etchash_thread_set_background(false);
+		}
+		if (bg->status.escalated ||
+			(uint32_t)etchash_atomic_load(&g_foreground) <= bg->options.foreground_limit) {
+			break;
+		}
+		bg->status.paused = true;
+		etchash_mutex_unlock(&bg->mutex);
+		etchash_sleep_ms(1);
+		etchash_mutex_lock(&bg->mutex);
+	}
+	if (bg->status.paused) {
+		bg->status.paused = false;
+		uint64_t paused_ms = etchash_time_ms() - now;
+		bg->status.paused_ms += paused_ms;
+		if (bg->status.state == ETCHASH_BACKGROUND_DAG) {
+			bg->dag_paused_ms += paused_ms;
+		}
+	}
+	etchash_mutex_unlock(&bg->mutex);
+	return 0;
+}
+
+static void background_finish(struct etchash_background* bg, etchash_background_state_t state)
+{
+	etchash_mutex_lock(&bg->mutex);
+	bg->status.state = bg->cancel ? ETCHASH_BACKGROUND_CANCELLED : state;
+	etchash_cond_broadcast(&bg->finished);
+	etchash_mutex_unlock(&bg->mutex);
+}
+
+static void background_run(void* arg)
+{
+	struct etchash_background* bg = (struct etchash_background*)arg;
+	etchash_thread_set_background(true);
+	// generation is keccak bound, next to the hashing threads on a paired pool
+	etchash_pool_pin_thread(ETCHASH_WORK_COMPUTE);
+
+	etchash_light_t light = etchash_light_new_internal_ex(bg->cache_size, &bg->seed, background_progress, bg);
+	if (!light) {
+		background_finish(bg, ETCHASH_BACKGROUND_FAILED);
+		return;
+	}
+	// the DAG is charged to the budget for the epoch of the light
+	light->block_number = bg->block_number;
+	etchash_budget_set_epoch(light->budget, get_epoch_number(bg->block_number));
+
+	etchash_mutex_lock(&bg->mutex);
+	bg->status.state = ETCHASH_BACKGROUND_DAG;
+	etchash_mutex_unlock(&bg->mutex);
+
+	etchash_full_options_t options;
+	memset(&options, 0, sizeof(options));
+	options.progress_interval = BACKGROUND_PROGRESS_INTERVAL;
+	etchash_full_t full = etchash_full_new_internal_ex(
+		bg->dirname,
+		bg->seed,
+		bg->full_size,
+		light,
+		background_progress,
+		bg,
+		&options
+	);
+	if (!full) {
+		etchash_light_delete(light);
+		background_finish(bg, ETCHASH_BACKGROUND_FAILED);
+		return;
+	}
+	bg->light = light;
+	bg->full = full;
+	background_finish(bg, ETCHASH_BACKGROUND_DONE);
+}
+
+static etchash_background_t background_start(
+	char const* dirname,
+	uint64_t block_number,
+	uint64_t cache_size,
+	etchash_h256_t const* seed,
+	uint64_t full_size,
+	etchash_background_options_t const* options
+)
+{
+	struct etchash_background* bg = calloc(sizeof(*bg), 1);
+	if (!bg) {
+		return NULL;
+	}
+	bg->dirname[0] = '\0';
+	if (!etchash_strncat(bg->dirname, sizeof(bg->dirname), dirname, strlen(dirname))) {
+		goto fail_free;
+	}
+	bg->block_number = block_number;
+	bg->cache_size = cache_size;
+	bg->seed = *seed;
+	bg->full_size = full_size;
+	if (options) {
+		bg->options = *options;
+	}
+	if (!bg->options.escalate_blocks) {
+		bg->options.escalate_blocks = BACKGROUND_DEFAULT_ESCALATE_BLOCKS;
+	}
+	if (!bg->options.block_time_ms) {
+		bg->options.block_time_ms = BACKGROUND_DEFAULT_BLOCK_TIME_MS;
+	}
+	bg->status.state = ETCHASH_BACKGROUND_CACHE;
+	etchash_mutex_init(&bg->mutex);
+	etchash_cond_init(&bg->finished);
+	if (!etchash_thread_create(&bg->thread, background_run, bg)) {
+		etchash_cond_destroy(&bg->finished);
+		etchash_mutex_destroy(&bg->mutex);
+		goto fail_free;
+	}
+	return bg;
+
+fail_free:
+	free(bg);
+	return NULL;
+}
+
+etchash_background_t etchash_background_new(
+	uint64_t block_number,
+	etchash_background_options_t const* options
+)
+{
+	char strbuf[256];
+	char const* dirname = options ? options->dirname : NULL;
+	if (!dirname) {
+		if (!etchash_get_default_dirname(strbuf, 256)) {
+			return NULL;
+		}
+		dirname = strbuf;
+	}
+	etchash_background_options_t settings;
+	memset(&settings, 0, sizeof(settings));
+	if (options) {
+		settings = *options;
+	}
+	if (!settings.deadline_block) {
+		uint64_t epoch_length = block_number >= ETCHASH_ACTIVATION_BLOCK ?
+			ETCHASH_NEW_EPOCH_LENGTH : ETCHASH_EPOCH_LENGTH;
+		settings.deadline_block = get_epoch_number(block_number) * epoch_length;
+	}
+	etchash_h256_t seed = etchash_get_seedhash(block_number);
+	return background_start(
+		dirname,
+		block_number,
+		etchash_get_cachesize(block_number),
+		&seed,
+		etchash_get_datasize(block_number),
+		&settings
+	);
+}
+
+etchash_background_t etchash_background_new_internal(
+	uint64_t cache_size,
+	etchash_h256_t const* seed,
+	uint64_t full_size,
+	etchash_background_options_t const* options
+)
+{
+	char strbuf[256];
+	char const* dirname = options ? options->dirname : NULL;
+	if (!dirname) {
+		if (!etchash_get_default_dirname(strbuf, 256)) {
+			return NULL;
+		}
+		dirname = strbuf;
+	}
+	return background_start(dirname, 0, cache_size, seed, full_size, options);
+}
+
+void etchash_background_set_head(etchash_background_t bg, uint64_t head_block)
+{
+	etchash_mutex_lock(&bg->mutex);
+	bg->head_block = head_block;
+	etchash_mutex_unlock(&bg->mutex);
+}
+
+void etchash_background_status(etchash_background_t bg, etchash_background_status_t* status)
+{
+	etchash_mutex_lock(&bg->mutex);
+	*status = bg->status;
+	etchash_mutex_unlock(&bg->mutex);
+}
+
+static bool background_ended(etchash_background_t bg)
+{
+	return bg->status.state != ETCHASH_BACKGROUND_CACHE && bg->status.state != ETCHASH_BACKGROUND_DAG;
+}
+
+bool etchash_background_wait(etchash_background_t bg, uint32_t timeout_ms)
+{
+	uint64_t end = etchash_time_ms() + timeout_ms;
+	etchash_mutex_lock(&bg->mutex);
+	while (!background_ended(bg)) {
+		uint64_t now = etchash_time_ms();
+		if (now >= end) {
+			break;
+		}
+		etchash_cond_timedwait(&bg->finished, &bg->mutex, (uint32_t)(end - now));
+	}
+	bool ended = background_ended(bg);
+	etchash_mutex_unlock(&bg->mutex);
+	return ended;
+}
+
+bool etchash_background_take(etchash_background_t bg, etchash_light_t* light, etchash_full_t* full)
+{
+	etchash_mutex_lock(&bg->mutex);
+	bool ret = bg->status.state == ETCHASH_BACKGROUND_DONE && !bg->taken;
+	if (ret) {
+		*light = bg->light;
+		*full = bg->full;
+		bg->taken = true;
+	}
+	etchash_mutex_unlock(&bg->mutex);
+	return ret;
+}
+
+void etchash_background_delete(etchash_background_t bg)
+{
+	etchash_mutex_lock(&bg->mutex);
+	bg->cancel = true;
+	etchash_mutex_unlock(&bg->mutex);
+	etchash_thread_join(bg->thread);
+	if (bg->full && !bg->taken) {
+		etchash_full_delete(bg->full);
+		etchash_light_delete(bg->light);
+	}
+	etchash_cond_destroy(&bg->finished);
+	etchash_mutex_destroy(&bg->mutex);
+	free(bg);
+}
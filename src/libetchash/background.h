@@ -0,0 +1,131 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file background.h
+ * @date 2026
+ *
+ * Generation of the next epoch's cache and DAG at idle priority. The
+ * generator pauses while latency sensitive verification is running and
+ * stops yielding when the epoch boundary gets close, so that the DAG is
+ * ready in time.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "etchash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum etchash_background_state {
+	ETCHASH_BACKGROUND_CACHE = 0,  ///< Generating the cache
+	ETCHASH_BACKGROUND_DAG,        ///< Generating the DAG
+	ETCHASH_BACKGROUND_DONE,
+	ETCHASH_BACKGROUND_FAILED,
+	ETCHASH_BACKGROUND_CANCELLED,
+} etchash_background_state_t;
+
+/// Settings for @ref etchash_background_new(). Zero initialize for the defaults.
+typedef struct etchash_background_options {
+	char const* dirname;         ///< DAG directory, NULL for the default directory
+	uint64_t deadline_block;     ///< Block by which the DAG must be ready, 0 for the first block of its epoch
+	uint32_t escalate_blocks;    ///< Stop yielding this many blocks before the deadline, 0 for 100
+	uint32_t block_time_ms;      ///< Expected block interval, 0 for 13 seconds
+	uint32_t foreground_limit;   ///< Foreground calls tolerated before pausing, 0 pauses for any
+} etchash_background_options_t;
+
+typedef struct etchash_background_status {
+	etchash_background_state_t state;
+	uint64_t nodes_done;   ///< Progress within the current state
+	uint64_t total_nodes;
+	bool paused;           ///< Waiting for foreground work to finish
+	bool escalated;        ///< No longer yielding because the deadline is close
+	uint64_t paused_ms;    ///< Total time spent paused
+} etchash_background_status_t;
+
+typedef struct etchash_background* etchash_background_t;
+
+/**
+ * Start generating the cache and DAG of a block's epoch in the background
+ *
+ * @param block_number  A block of the epoch to generate, usually the first of the next epoch
+ * @param options       Settings, may be NULL for the defaults
+ * @return              The generator or NULL if it could not be started
+ */
+etchash_background_t etchash_background_new(
+	uint64_t block_number,
+	etchash_background_options_t const* options
+);
+
+/**
+ * Start a generator for explicit sizes, mostly for tests with small data
+ *
+ * @param cache_size    The size of the cache in bytes
+ * @param seed          The cache's seed hash
+ * @param full_size     The size of the DAG in bytes
+ * @param options       Settings, may be NULL. A zero deadline_block means no deadline.
+ * @return              The generator or NULL if it could not be started
+ */
+etchash_background_t etchash_background_new_internal(
+	uint64_t cache_size,
+	etchash_h256_t const* seed,
+	uint64_t full_size,
+	etchash_background_options_t const* options
+);
+
+/**
+ * Tell the generator the block the chain is at, to measure the time left
+ */
+void etchash_background_set_head(etchash_background_t bg, uint64_t head_block);
+
+void etchash_background_status(etchash_background_t bg, etchash_background_status_t* status);
+
+/**
+ * Wait for the generation to end
+ *
+ * @param timeout_ms    Maximum time to wait
+ * @return              true if the generation ended, successfully or not
+ */
+bool etchash_background_wait(etchash_background_t bg, uint32_t timeout_ms);
+
+/**
+ * Take ownership of the generated handlers
+ *
+ * @param[out] light    The cache, free with @ref etchash_light_delete()
+ * @param[out] full     The DAG, free with @ref etchash_full_delete() before @a light
+ * @return              false if the generation did not succeed or they were already taken
+ */
+bool etchash_background_take(etchash_background_t bg, etchash_light_t* light, etchash_full_t* full);
+
+/**
+ * Stop the generation if still running and free the generator, along with
+ * any handlers that were not taken
+ */
+void etchash_background_delete(etchash_background_t bg);
+
+/**
+ * Mark the start and end of latency sensitive work such as verification.
+ *
+ * @ref etchash_light_compute() marks itself; call these around batches of
+ * other work that background generation should yield to.
+ */
+void etchash_foreground_begin(void);
+void etchash_foreground_end(void);
+
+#ifdef __cplusplus
+}
+#endif
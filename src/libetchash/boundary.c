@@ -0,0 +1,101 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file boundary.c
+ * @date 2026
+ */
+#include <string.h>
+#include "boundary.h"
+#include "endian.h"
+
+// Big endian word i of a hash, word 0 is the most significant
+static inline uint64_t boundary_word(etchash_h256_t const* hash, unsigned i)
+{
+	uint64_t word;
+	memcpy(&word, hash->b + 8 * i, sizeof(word));
+#if LITTLE_ENDIAN == BYTE_ORDER
+	word = etchash_swap_u64(word);
+#endif
+	return word;
+}
+
+etchash_h256_t etchash_difficulty128_to_boundary(uint64_t high, uint64_t low)
+{
+	etchash_h256_t boundary;
+	memset(&boundary, 0, sizeof(boundary));
+	if (!high && !low) {
+		return boundary;
+	}
+
+	// Long division of 2^256 - 1 by the difficulty, one bit at a time. The
+	// remainder stays below the difficulty but doubling it can carry out of
+	// 128 bits, in which case it exceeds the difficulty and the wrapping
+	// subtraction is exact.
+	uint64_t quotient[4] = { 0, 0, 0, 0 };
+	uint64_t rem_high = 0;
+	uint64_t rem_low = 0;
+	for (int bit = 255; bit >= 0; bit--) {
+		uint64_t const carry = rem_high >> 63;
+		rem_high = (rem_high << 1) | (rem_low >> 63);
+		rem_low = (rem_low << 1) | 1;
+		if (carry || rem_high > high || (rem_high == high && rem_low >= low)) {
+			uint64_t const borrow = rem_low < low;
+			rem_low -= low;
+			rem_high -= high;
+			rem_high -= borrow;
+			quotient[3 - bit / 64] |= (uint64_t)1 << (bit % 64);
+		}
+	}
+
+	// 2^256 / d exceeds (2^256 - 1) / d by one when d divides 2^256, that is
+	// when the remainder is d - 1. For d = 1 that would not fit, all ones is
+	// kept as no result exceeds it either.
+	uint64_t const last_high = high - (low == 0);
+	uint64_t const last_low = low - 1;
+	if ((high || low > 1) && rem_high == last_high && rem_low == last_low) {
+		for (int i = 3; i >= 0; i--) {
+			if (++quotient[i]) {
+				break;
+			}
+		}
+	}
+
+	for (unsigned i = 0; i < 4; i++) {
+		uint64_t word = quotient[i];
+#if LITTLE_ENDIAN == BYTE_ORDER
+		word = etchash_swap_u64(word);
+#endif
+		memcpy(boundary.b + 8 * i, &word, sizeof(word));
+	}
+	return boundary;
+}
+
+etchash_h256_t etchash_difficulty_to_boundary(uint64_t difficulty)
+{
+	return etchash_difficulty128_to_boundary(0, difficulty);
+}
+
+bool etchash_boundary_check(etchash_h256_t const* hash, etchash_h256_t const* boundary)
+{
+	for (unsigned i = 0; i < 4; i++) {
+		uint64_t const h = boundary_word(hash, i);
+		uint64_t const b = boundary_word(boundary, i);
+		if (h != b) {
+			return h < b;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,66 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file boundary.h
+ * @date 2026
+ *
+ * Conversions between a difficulty and its boundary, 2^256 / difficulty, and
+ * the comparison of results against a boundary, without big integers.
+ *
+ * Bindings convert a difficulty once per block or job and then only compare
+ * words, so neither a verification nor a search step allocates.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "etchash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The boundary of a 64 bit difficulty
+ *
+ * @param difficulty    The difficulty
+ * @return              2^256 / difficulty rounded down, big endian. 2^256 - 1
+ *                      for a difficulty of 1, which accepts every result as
+ *                      2^256 does, and 0 for a difficulty of 0
+ */
+etchash_h256_t etchash_difficulty_to_boundary(uint64_t difficulty);
+
+/**
+ * The boundary of a 128 bit difficulty
+ *
+ * @param high          Upper 64 bits of the difficulty
+ * @param low           Lower 64 bits of the difficulty
+ * @return              As @ref etchash_difficulty_to_boundary()
+ */
+etchash_h256_t etchash_difficulty128_to_boundary(uint64_t high, uint64_t low);
+
+/**
+ * Whether a result is within a boundary, comparing four 64 bit words instead
+ * of 32 bytes
+ *
+ * @param hash          The result of a hash
+ * @param boundary      2^256 / difficulty, big endian
+ * @return              true if hash <= boundary
+ */
+bool etchash_boundary_check(etchash_h256_t const* hash, etchash_h256_t const* boundary);
+
+#ifdef __cplusplus
+}
+#endif
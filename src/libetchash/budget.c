@@ -0,0 +1,232 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file budget.c
+ * @date 2026
+ */
+
+#include <stdlib.h>
+#include "budget.h"
+#include "internal.h"
+#include "thread.h"
+
+struct etchash_budget_entry {
+	etchash_budget_category_t category;
+	uint64_t size;
+	uint64_t epoch;
+	uint64_t volatile last_use;
+	etchash_budget_evict_t evict;
+	void* user;
+	struct etchash_budget_entry* next;
+};
+
+// allocations are rare, see etchash_spin_lock()
+static int32_t volatile g_lock;
+static uint64_t g_limit;
+static etchash_budget_policy_t g_policy;
+static uint64_t g_head_epoch;
+// advanced by every allocation, entries touched since then are more recent
+static uint64_t volatile g_tick;
+static etchash_budget_usage_t g_usage;
+static struct etchash_budget_entry* g_entries;
+// the entry being evicted, only one eviction runs at a time
+static struct etchash_budget_entry* g_evicting;
+
+static void budget_lock(void)
+{
+	etchash_spin_lock(&g_lock);
+}
+
+static void budget_unlock(void)
+{
+	etchash_spin_unlock(&g_lock);
+}
+
+// waits for a running eviction to finish. Called with the lock held
+static void budget_wait_eviction(void)
+{
+	while (g_evicting) {
+		budget_unlock();
+		etchash_sleep_ms(1);
+		budget_lock();
+	}
+}
+
+static bool budget_protected(struct etchash_budget_entry const* entry)
+{
+	return g_policy == ETCHASH_BUDGET_KEEP_CURRENT &&
+		(entry->epoch == g_head_epoch || entry->epoch == g_head_epoch + 1);
+}
+
+// the next entry to evict or NULL. Called with the lock held
+static struct etchash_budget_entry* budget_victim(void)
+{
+	struct etchash_budget_entry* victim = NULL;
+	for (struct etchash_budget_entry* entry = g_entries; entry; entry = entry->next) {
+		if (entry->evict && !budget_protected(entry) && (!victim || entry->last_use < victim->last_use)) {
+			victim = entry;
+		}
+	}
+	return victim;
+}
+
+static uint64_t budget_evictable(void)
+{
+	uint64_t size = 0;
+	for (struct etchash_budget_entry* entry = g_entries; entry; entry = entry->next) {
+		if (entry->evict && !budget_protected(entry)) {
+			size += entry->size;
+		}
+	}
+	return size;
+}
+
+void etchash_budget_set(uint64_t limit, etchash_budget_policy_t policy)
+{
+	budget_lock();
+	g_limit = limit;
+	g_policy = policy;
+	budget_unlock();
+}
+
+void etchash_budget_set_head(uint64_t block_number)
+{
+	budget_lock();
+	g_head_epoch = get_epoch_number(block_number);
+	budget_unlock();
+}
+
+void etchash_budget_usage(etchash_budget_usage_t* usage)
+{
+	budget_lock();
+	*usage = g_usage;
+	usage->limit = g_limit;
+	budget_unlock();
+}
+
+bool etchash_budget_fits(etchash_budget_category_t category, uint64_t size)
+{
+	(void)category;
+	budget_lock();
+	bool ret = !g_limit || g_usage.used - budget_evictable() + size <= g_limit;
+	budget_unlock();
+	return ret;
+}
+
+etchash_budget_entry_t etchash_budget_acquire(
+	etchash_budget_category_t category,
+	uint64_t size,
+	uint64_t epoch,
+	bool required
+)
+{
+	struct etchash_budget_entry* entry = calloc(sizeof(*entry), 1);
+	if (!entry) {
+		return NULL;
+	}
+	entry->category = category;
+	entry->size = size;
+	entry->epoch = epoch;
+	budget_lock();
+	budget_wait_eviction();
+	while (g_limit && g_usage.used + size > g_limit) {
+		struct etchash_budget_entry* victim = budget_victim();
+		if (!victim) {
+			break;
+		}
+		// the owner deletes its DAG, which releases the entry
+		etchash_budget_evict_t evict = victim->evict;
+		void* user = victim->user;
+		victim->evict = NULL;
+		g_evicting = victim;
+		g_usage.evictions++;
+		budget_unlock();
+		evict(user);
+		budget_lock();
+		g_evicting = NULL;
+		budget_wait_eviction();
+	}
+	if (g_limit && g_usage.used + size > g_limit && !required) {
+		g_usage.refusals++;
+		budget_unlock();
+		free(entry);
+		return NULL;
+	}
+	entry->last_use = etchash_atomic_add_u64(&g_tick, 1);
+	entry->next = g_entries;
+	g_entries = entry;
+	g_usage.used += size;
+	g_usage.category[category] += size;
+	g_usage.entries[category]++;
+	if (g_usage.used > g_usage.peak) {
+		g_usage.peak = g_usage.used;
+	}
+	budget_unlock();
+	return entry;
+}
+
+void etchash_budget_release(etchash_budget_entry_t entry)
+{
+	budget_lock();
+	struct etchash_budget_entry** p = &g_entries;
+	while (*p != entry) {
+		p = &(*p)->next;
+	}
+	*p = entry->next;
+	g_usage.used -= entry->size;
+	g_usage.category[entry->category] -= entry->size;
+	g_usage.entries[entry->category]--;
+	budget_unlock();
+	free(entry);
+}
+
+void etchash_budget_set_epoch(etchash_budget_entry_t entry, uint64_t epoch)
+{
+	budget_lock();
+	entry->epoch = epoch;
+	budget_unlock();
+}
+
+void etchash_budget_set_evict(etchash_budget_entry_t entry, etchash_budget_evict_t evict, void* user)
+{
+	budget_lock();
+	entry->evict = evict;
+	entry->user = user;
+	budget_unlock();
+}
+
+void etchash_budget_forget(etchash_budget_entry_t entry)
+{
+	budget_lock();
+	if (!entry) {
+		budget_wait_eviction();
+		budget_unlock();
+		return;
+	}
+	entry->evict = NULL;
+	while (g_evicting == entry) {
+		budget_unlock();
+		etchash_sleep_ms(1);
+		budget_lock();
+	}
+	budget_unlock();
+}
+
+void etchash_budget_touch(etchash_budget_entry_t entry)
+{
+	// a stamp of its own, entries touched between two allocations are ordered too
+	entry->last_use = etchash_atomic_add_u64(&g_tick, 1);
+}
@@ -0,0 +1,136 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file budget.h
+ * @date 2026
+ *
+ * Library wide accounting of the memory held by caches and DAGs.
+ *
+ * Every cache and DAG registers its size on creation and unregisters when
+ * deleted. With a limit set, a DAG that does not fit is refused after owners
+ * that can fall back to light mode, such as @ref etchash_auto_t, have been
+ * asked to drop their DAG by the eviction policy. Only DAGs with an eviction
+ * callback (see @ref etchash_budget_set_evict()) can be dropped, which the
+ * library sets for the DAGs of @ref etchash_auto_t alone: a plain
+ * @ref etchash_full_new() handler is never evicted, and is itself refused
+ * with NULL when it does not fit, even if other plain handlers sit idle.
+ * Caches are the minimum needed to verify at all and are always admitted,
+ * though they still make DAGs get evicted.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "etchash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum etchash_budget_category {
+	ETCHASH_BUDGET_CACHE = 0,
+	ETCHASH_BUDGET_DAG,
+	ETCHASH_BUDGET_CATEGORIES
+} etchash_budget_category_t;
+
+typedef enum etchash_budget_policy {
+	ETCHASH_BUDGET_LRU = 0,        ///< Evict the least recently used DAG first
+	ETCHASH_BUDGET_KEEP_CURRENT,   ///< Like LRU, but never evict the current or the next epoch
+} etchash_budget_policy_t;
+
+typedef struct etchash_budget_usage {
+	uint64_t limit;                                  ///< 0 for no limit
+	uint64_t used;
+	uint64_t peak;
+	uint64_t category[ETCHASH_BUDGET_CATEGORIES];    ///< Bytes per @ref etchash_budget_category_t
+	unsigned entries[ETCHASH_BUDGET_CATEGORIES];     ///< Allocations per category
+	uint64_t evictions;                              ///< DAGs dropped to make room
+	uint64_t refusals;                               ///< DAGs refused for lack of room
+} etchash_budget_usage_t;
+
+/**
+ * Set the memory limit of all caches and DAGs of the process
+ *
+ * Lowering the limit does not evict anything until the next allocation.
+ *
+ * @param limit     Bytes, 0 for no limit
+ * @param policy    Which DAGs to evict first
+ */
+void etchash_budget_set(uint64_t limit, etchash_budget_policy_t policy);
+
+/**
+ * Tell the @ref ETCHASH_BUDGET_KEEP_CURRENT policy the chain head
+ */
+void etchash_budget_set_head(uint64_t block_number);
+
+void etchash_budget_usage(etchash_budget_usage_t* usage);
+
+/**
+ * Whether an allocation of @a size could be admitted, evicting what can be evicted
+ */
+bool etchash_budget_fits(etchash_budget_category_t category, uint64_t size);
+
+// The rest is used by the owners of caches and DAGs
+
+typedef struct etchash_budget_entry* etchash_budget_entry_t;
+
+/**
+ * Called to make an owner drop its DAG, it must delete the DAG before returning
+ */
+typedef void (*etchash_budget_evict_t)(void* user);
+
+/**
+ * Register an allocation
+ *
+ * @param category  What is allocated
+ * @param size      Bytes allocated
+ * @param epoch     Epoch of the data, for the eviction policy
+ * @param required  Admit the allocation even if it exceeds the limit
+ * @return          The registration or NULL if the allocation does not fit
+ */
+etchash_budget_entry_t etchash_budget_acquire(
+	etchash_budget_category_t category,
+	uint64_t size,
+	uint64_t epoch,
+	bool required
+);
+
+void etchash_budget_release(etchash_budget_entry_t entry);
+
+void etchash_budget_set_epoch(etchash_budget_entry_t entry, uint64_t epoch);
+
+/**
+ * Make an allocation evictable
+ *
+ * @param evict     Called from whichever thread needs the room
+ */
+void etchash_budget_set_evict(etchash_budget_entry_t entry, etchash_budget_evict_t evict, void* user);
+
+/**
+ * Make an entry unevictable, waiting for an eviction of it in progress
+ *
+ * @param entry     The entry or NULL to wait for any eviction in progress,
+ *                  for owners whose DAG was taken by one
+ */
+void etchash_budget_forget(etchash_budget_entry_t entry);
+
+/**
+ * Mark an entry as used now, for the LRU order
+ */
+void etchash_budget_touch(etchash_budget_entry_t entry);
+
+#ifdef __cplusplus
+}
+#endif
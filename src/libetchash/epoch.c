@@ -0,0 +1,182 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file epoch.c
+ * @date 2026
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "epoch.h"
+#include "internal.h"
+#include "background.h"
+#include "lanes.h"
+#include "thread.h"
+#include "io.h"
+
+etchash_epoch_context_t const* etchash_epoch_context_new_internal(
+	uint64_t block_number,
+	etchash_h256_t const* seed,
+	uint64_t cache_size,
+	uint64_t full_size,
+	bool full,
+	etchash_progress_callback_t callback,
+	void* user,
+	etchash_full_options_t const* options
+)
+{
+	if (cache_size % sizeof(node) != 0 || full_size % ETCHASH_MIX_BYTES != 0) {
+		return NULL;
+	}
+	etchash_epoch_context_t* context = calloc(sizeof(*context), 1);
+	if (!context) {
+		return NULL;
+	}
+	context->epoch_number = get_epoch_number(block_number);
+	context->epoch_length = block_number >= ETCHASH_ACTIVATION_BLOCK ? ETCHASH_NEW_EPOCH_LENGTH : ETCHASH_EPOCH_LENGTH;
+	context->first_block = context->epoch_number * context->epoch_length;
+	context->seedhash = *seed;
+	context->cache_size = cache_size;
+	context->full_size = full_size;
+	context->full_nodes = full_size / sizeof(node);
+	context->cache_nodes = etchash_divisor_make((uint32_t)(cache_size / sizeof(node)));
+	context->full_pages = etchash_divisor_make((uint32_t)(full_size / ETCHASH_MIX_BYTES));
+	context->refs = 1;
+
+	context->light = etchash_light_new_internal(cache_size, seed);
+	if (!context->light) {
+		goto fail_free_context;
+	}
+	context->light->block_number = block_number;
+	etchash_budget_set_epoch(context->light->budget, context->epoch_number);
+	if (full) {
+		char strbuf[256];
+		char const* dirname = options ? options->dirname : NULL;
+		if (!dirname) {
+			if (!etchash_get_default_dirname(strbuf, 256)) {
+				goto fail_delete_light;
+			}
+			dirname = strbuf;
+		}
+		context->full = etchash_full_new_internal_ex(dirname, *seed, full_size, context->light, callback, user, options);
+		if (!context->full) {
+			goto fail_delete_light;
+		}
+	}
+	return context;
+
+fail_delete_light:
+	etchash_light_delete(context->light);
+fail_free_context:
+	free(context);
+	return NULL;
+}
+
+etchash_epoch_context_t const* etchash_epoch_context_new_full(
+	uint64_t block_number,
+	etchash_progress_callback_t callback,
+	void* user,
+	etchash_full_options_t const* options
+)
+{
+	etchash_h256_t const seed = etchash_get_seedhash(block_number);
+	return etchash_epoch_context_new_internal(
+		block_number,
+		&seed,
+		etchash_get_cachesize(block_number),
+		etchash_get_datasize(block_number),
+		true,
+		callback,
+		user,
+		options
+	);
+}
+
+etchash_epoch_context_t const* etchash_epoch_context_new(uint64_t block_number)
+{
+	etchash_h256_t const seed = etchash_get_seedhash(block_number);
+	return etchash_epoch_context_new_internal(
+		block_number,
+		&seed,
+		etchash_get_cachesize(block_number),
+		etchash_get_datasize(block_number),
+		false,
+		NULL,
+		NULL,
+		NULL
+	);
+}
+
+etchash_epoch_context_t const* etchash_epoch_context_acquire(etchash_epoch_context_t const* context)
+{
+	// the count is the only mutable member
+	etchash_atomic_add(&((etchash_epoch_context_t*)context)->refs, 1);
+	return context;
+}
+
+void etchash_epoch_context_release(etchash_epoch_context_t const* context)
+{
+	etchash_epoch_context_t* mutable_context = (etchash_epoch_context_t*)context;
+	if (!context || etchash_atomic_add(&mutable_context->refs, -1) != 0) {
+		return;
+	}
+	if (context->full) {
+		etchash_full_delete(context->full);
+	}
+	etchash_light_delete(context->light);
+	free(mutable_context);
+}
+
+void etchash_epoch_compute_batch(
+	etchash_epoch_context_t const* context,
+	etchash_h256_t const header_hash,
+	uint64_t const* nonces,
+	uint32_t count,
+	etchash_return_value_t* ret
+)
+{
+	uint32_t i = 0;
+	if (context->full) {
+		for (; count - i >= ETCHASH_LANES; i += ETCHASH_LANES) {
+			etchash_full_compute_lanes(context->full, header_hash, nonces + i, ret + i);
+		}
+	}
+	for (; i != count; ++i) {
+		ret[i] = etchash_epoch_compute(context, header_hash, nonces[i]);
+	}
+}
+
+static etchash_return_value_t epoch_verify_compute(void* user, etchash_h256_t const* header_hash, uint64_t nonce)
+{
+	etchash_foreground_begin();
+	etchash_return_value_t const ret = etchash_epoch_compute(
+		(etchash_epoch_context_t const*)user, *header_hash, nonce
+	);
+	etchash_foreground_end();
+	return ret;
+}
+
+bool etchash_epoch_verify(
+	etchash_epoch_context_t const* context,
+	etchash_h256_t const header_hash,
+	uint64_t nonce,
+	etchash_h256_t const claimed_mix,
+	etchash_h256_t const boundary
+)
+{
+	return etchash_verify_proof(
+		&header_hash, nonce, &claimed_mix, &boundary, epoch_verify_compute, (void*)context
+	);
+}
@@ -0,0 +1,185 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file epoch.h
+ * @date 2026
+ *
+ * Per epoch contexts holding everything the hash derives from the block
+ * number, computed once.
+ *
+ * The block number based entry points look up the sizes of the epoch on every
+ * call, @ref etchash_full_new() runs the Keccak chain of the seed hash again
+ * and every hash divides the DAG size into pages. A context does all of that
+ * when it is created and is immutable afterwards, so the compute, batch and
+ * verify functions taking one only dereference it. The modulus of the page
+ * accesses and of the DAG item parents is taken with a precomputed reciprocal
+ * instead of a division.
+ *
+ * Contexts are reference counted and can be shared by any number of threads.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "etchash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// A 32 bit divisor with the reciprocal for @ref etchash_fastmod()
+typedef struct etchash_divisor {
+	uint32_t divisor;
+	uint64_t reciprocal;  ///< 2^64 / divisor rounded up
+} etchash_divisor_t;
+
+static inline etchash_divisor_t etchash_divisor_make(uint32_t divisor)
+{
+	etchash_divisor_t ret;
+	ret.divisor = divisor;
+	ret.reciprocal = divisor ? UINT64_C(0xFFFFFFFFFFFFFFFF) / divisor + 1 : 0;
+	return ret;
+}
+
+/**
+ * x % divisor with two multiplications, exact for all 32 bit values (Lemire,
+ * Kaser and Kurz, "Faster Remainder by Direct Computation", 2019)
+ */
+static inline uint32_t etchash_fastmod(uint32_t x, etchash_divisor_t divisor)
+{
+	uint64_t const fraction = divisor.reciprocal * x;
+	// the upper 64 bits of fraction * divisor, without 128 bit arithmetic
+	uint64_t const low = ((fraction & 0xFFFFFFFF) * divisor.divisor) >> 32;
+	return (uint32_t)(((fraction >> 32) * divisor.divisor + low) >> 32);
+}
+
+/// The facts of an epoch, see @ref etchash_epoch_context_new()
+typedef struct etchash_epoch_context {
+	uint64_t epoch_number;        ///< Index of the epoch in the size tables
+	uint64_t epoch_length;        ///< Blocks per epoch, ETCHASH_NEW_EPOCH_LENGTH from ECIP-1099 on
+	uint64_t first_block;         ///< First block of the epoch
+	etchash_h256_t seedhash;
+	uint64_t cache_size;          ///< Bytes of the cache
+	uint64_t full_size;           ///< Bytes of the DAG
+	uint64_t full_nodes;          ///< DAG items of 64 bytes
+	etchash_divisor_t cache_nodes; ///< Cache nodes, the modulus of the parents of a DAG item
+	etchash_divisor_t full_pages; ///< DAG pages of ETCHASH_MIX_BYTES, the modulus of the page accesses
+	etchash_light_t light;        ///< The cache
+	etchash_full_t full;          ///< The DAG, NULL for a light context
+	int32_t volatile refs;        ///< Private, see @ref etchash_epoch_context_acquire()
+} etchash_epoch_context_t;
+
+/**
+ * Create the light context of a block's epoch, computing its cache
+ *
+ * @param block_number   Any block of the epoch
+ * @return               The context with one reference, NULL for ERRNOMEM
+ */
+etchash_epoch_context_t const* etchash_epoch_context_new(uint64_t block_number);
+
+/**
+ * Create the full context of a block's epoch, computing its cache and
+ * loading or generating its DAG as @ref etchash_full_new_ex() does
+ *
+ * @param block_number   Any block of the epoch
+ * @param callback       Progress callback of the DAG generation, may be NULL
+ * @param user           Context pointer handed to @a callback
+ * @param options        Optional settings of the DAG, may be NULL
+ * @return               The context with one reference, NULL for ERRNOMEM or
+ *                       if the DAG could not be created
+ */
+etchash_epoch_context_t const* etchash_epoch_context_new_full(
+	uint64_t block_number,
+	etchash_progress_callback_t callback,
+	void* user,
+	etchash_full_options_t const* options
+);
+
+/**
+ * Create a context with given sizes, mostly for tests
+ *
+ * @param block_number   Any block of the epoch, sets the epoch facts
+ * @param seed           The seed hash of the cache
+ * @param cache_size     Bytes of the cache
+ * @param full_size      Bytes of the DAG
+ * @param full           Generate or load the DAG
+ * @param options        Optional settings of the DAG, may be NULL
+ * @return               The context with one reference, or NULL
+ */
+etchash_epoch_context_t const* etchash_epoch_context_new_internal(
+	uint64_t block_number,
+	etchash_h256_t const* seed,
+	uint64_t cache_size,
+	uint64_t full_size,
+	bool full,
+	etchash_progress_callback_t callback,
+	void* user,
+	etchash_full_options_t const* options
+);
+
+/**
+ * Take another reference to a context
+ *
+ * @return               @a context
+ */
+etchash_epoch_context_t const* etchash_epoch_context_acquire(etchash_epoch_context_t const* context);
+
+/**
+ * Drop a reference to a context, the last one frees its cache and DAG
+ */
+void etchash_epoch_context_release(etchash_epoch_context_t const* context);
+
+/**
+ * Hash a nonce, with the DAG of a full context and the cache of a light one
+ */
+etchash_return_value_t etchash_epoch_compute(
+	etchash_epoch_context_t const* context,
+	etchash_h256_t const header_hash,
+	uint64_t nonce
+);
+
+/**
+ * Hash several nonces of a header. A full context hashes them ETCHASH_LANES at
+ * a time, see lanes.h.
+ *
+ * @param[out] ret       @a count results, in the order of @a nonces
+ */
+void etchash_epoch_compute_batch(
+	etchash_epoch_context_t const* context,
+	etchash_h256_t const header_hash,
+	uint64_t const* nonces,
+	uint32_t count,
+	etchash_return_value_t* ret
+);
+
+/**
+ * Verify a proof of work, rejecting most invalid ones before hashing as
+ * @ref etchash_light_verify() does. The background DAG generator yields
+ * while a proof is hashed.
+ *
+ * @param boundary       2^256 / difficulty, big endian, see boundary.h
+ * @return               true if the mix is right and the result is within the boundary
+ */
+bool etchash_epoch_verify(
+	etchash_epoch_context_t const* context,
+	etchash_h256_t const header_hash,
+	uint64_t nonce,
+	etchash_h256_t const claimed_mix,
+	etchash_h256_t const boundary
+);
+
+#ifdef __cplusplus
+}
+#endif
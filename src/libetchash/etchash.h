@@ -39,6 +39,12 @@
 #define ETCHASH_ACCESSES 64
 #define ETCHASH_DAG_MAGIC_NUM_SIZE 8
 #define ETCHASH_DAG_MAGIC_NUM 0xFEE1DEADBADDCAFE
+// v2 DAG files start with a page sized header so that the DAG data is page aligned
+#define ETCHASH_DAG_HEADER_SIZE 4096
+#define ETCHASH_DAG_FORMAT_VERSION 2
+// chunks handed to an etchash_chunk_hook_t start at multiples of 16 KB, default to 256 KB
+#define ETCHASH_CHUNK_ALIGN_NODES 256
+#define ETCHASH_CHUNK_DEFAULT_NODES 4096
 // ECIP-1099 (ETCHASH)
 #define ETCHASH_NEW_EPOCH_LENGTH 60000U
 #define ETCHASH_ACTIVATION_BLOCK 11700000 // classic mainnet
@@ -64,6 +70,59 @@ struct etchash_full;
 typedef struct etchash_full* etchash_full_t;
 typedef int(*etchash_callback_t)(unsigned);
 
+/// Progress of a cache or DAG computation, see @ref etchash_progress_callback_t
+typedef struct etchash_progress {
+	uint64_t nodes_done;   ///< Number of nodes computed so far
+	uint64_t total_nodes;  ///< Number of nodes the computation will produce
+	uint64_t elapsed_ms;   ///< Milliseconds since the computation started
+} etchash_progress_t;
+
+/**
+ * Progress callback carrying a user supplied context pointer. As with
+ * @ref etchash_callback_t the computation continues as long as it returns 0
+ * and stops if a non-zero value is returned.
+ */
+typedef int(*etchash_progress_callback_t)(etchash_progress_t const* progress, void* user);
+
+/// A contiguous range of DAG nodes that has just been written, see @ref etchash_chunk_hook_t
+typedef struct etchash_chunk {
+	void const* data;      ///< The first node of the chunk
+	uint64_t size;         ///< Bytes of the chunk
+	uint64_t first_node;   ///< Index of the first node
+	uint64_t end_node;     ///< Index one past the last node
+} etchash_chunk_t;
+
+/**
+ * Called with every chunk of a DAG once it is written, while it is still in
+ * the cache of the generating core, so that checksums, merkle trees, copies
+ * or transfers take no second pass over the DAG. The chunks cover the DAG
+ * exactly once but may come in any order. The generation continues as long
+ * as the hook returns 0 and stops if a non-zero value is returned.
+ */
+typedef int(*etchash_chunk_hook_t)(etchash_chunk_t const* chunk, void* user);
+
+/// Optional settings for @ref etchash_full_new_ex(). Zero initialize for the defaults.
+typedef struct etchash_full_options {
+	char const* dirname;         ///< DAG directory, NULL for the default directory
+	uint32_t progress_interval;  ///< Nodes between progress reports, 0 for every 1%
+	char const* const* peers;    ///< Peers to fetch a new DAG from before generating it, see peer.h
+	uint32_t num_peers;
+	uint32_t peer_samples;       ///< DAG items to check in a fetched DAG, 0 for the default
+	bool parallel;               ///< Generate the DAG on the library pool, see pool.h. The progress
+	                             ///< callback is then called from pool threads, one call at a time
+	char const* const* dag_dirs; ///< Stripe the DAG over one file in each of these directories instead
+	                             ///< of @a dirname, for devices whose bandwidth adds up. POSIX only.
+	uint32_t num_dag_dirs;       ///< Stripe when 2 or more. Striped DAGs are generated in parallel
+	uint64_t stripe_size;        ///< Bytes of a stripe chunk, a power of two multiple of the page size,
+	                             ///< 0 for 256 MB
+	etchash_chunk_hook_t chunk_hook; ///< Called with each chunk of a generated or fetched DAG, not
+	                             ///< for a DAG loaded from disk. From pool threads, concurrently,
+	                             ///< if the DAG is generated in parallel
+	void* chunk_user;            ///< Context pointer handed to @a chunk_hook
+	uint32_t chunk_nodes;        ///< Nodes of a chunk, rounded up to a multiple of
+	                             ///< ETCHASH_CHUNK_ALIGN_NODES, 0 for ETCHASH_CHUNK_DEFAULT_NODES
+} etchash_full_options_t;
+
 typedef struct etchash_return_value {
 	etchash_h256_t result;
 	etchash_h256_t mix_hash;
@@ -78,6 +137,20 @@ typedef struct etchash_return_value {
  *                       ERRNOMEM or invalid parameters used for @ref etchash_compute_cache_nodes()
  */
 etchash_light_t etchash_light_new(uint64_t block_number);
+/**
+ * Allocate and initialize a new etchash_light handler, reporting progress
+ *
+ * @param block_number   The block number for which to create the handler
+ * @param callback       Progress callback, may be NULL. A non-zero return cancels the computation
+ * @param user           Context pointer handed to every @a callback invocation
+ * @return               Newly allocated etchash_light handler or NULL in case of
+ *                       ERRNOMEM, cancellation or invalid parameters
+ */
+etchash_light_t etchash_light_new_ex(
+	uint64_t block_number,
+	etchash_progress_callback_t callback,
+	void* user
+);
 /**
  * Frees a previously allocated etchash_light handler
  * @param light        The light handler to free
@@ -96,6 +169,28 @@ etchash_return_value_t etchash_light_compute(
 	etchash_h256_t const header_hash,
 	uint64_t nonce
 );
+/**
+ * Verify a proof of work with the light client data
+ *
+ * The claimed mix is checked against the difficulty first, which costs two
+ * Keccak hashes, so most invalid proofs are rejected before the light hash.
+ *
+ * @param light          The light client handler
+ * @param header_hash    The header hash to pack into the mix
+ * @param nonce          The claimed nonce
+ * @param claimed_mix    The claimed mix digest
+ * @param difficulty     The difficulty the result has to meet
+ * @return               true if the mix is right and the result is within
+ *                       2^256 / difficulty, false otherwise and for a
+ *                       difficulty of 0
+ */
+bool etchash_light_verify(
+	etchash_light_t light,
+	etchash_h256_t const header_hash,
+	uint64_t nonce,
+	etchash_h256_t const claimed_mix,
+	uint64_t difficulty
+);
 
 /**
  * Allocate and initialize a new etchash_full handler
@@ -109,10 +204,35 @@ etchash_return_value_t etchash_light_compute(
  *                      almost complete and that this function will soon return succesfully.
  *                      It does not mean that the function has already had a succesfull return.
  * @return              Newly allocated etchash_full handler or NULL in case of
- *                      ERRNOMEM or invalid parameters used for @ref etchash_compute_full_data()
+ *                      ERRNOMEM or invalid parameters used for @ref etchash_compute_full_data(),
+ *                      or if the DAG does not fit the memory budget (see budget.h),
+ *                      which does not evict other full handlers to make room
  */
 etchash_full_t etchash_full_new(etchash_light_t light, etchash_callback_t callback);
 
+/**
+ * Allocate and initialize a new etchash_full handler, reporting progress
+ *
+ * Unlike @ref etchash_full_new() every progress report carries the @a user
+ * pointer, so several DAGs can be generated concurrently and each of them
+ * can be told apart and cancelled on its own.
+ *
+ * @param light         The light handler containing the cache.
+ * @param callback      Progress callback, may be NULL. A non-zero return cancels
+ *                      DAG generation and makes this function return NULL.
+ * @param user          Context pointer handed to every @a callback invocation
+ * @param options       Optional settings, may be NULL for the defaults
+ * @return              Newly allocated etchash_full handler or NULL in case of
+ *                      ERRNOMEM, cancellation, invalid parameters or if the DAG
+ *                      does not fit the memory budget, see @ref etchash_full_new()
+ */
+etchash_full_t etchash_full_new_ex(
+	etchash_light_t light,
+	etchash_progress_callback_t callback,
+	void* user,
+	etchash_full_options_t const* options
+);
+
 /**
  * Frees a previously allocated etchash_full handler
  * @param full    The light handler to free
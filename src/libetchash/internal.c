@@ -32,6 +32,19 @@
 #include "internal.h"
 #include "data_sizes.h"
 #include "io.h"
+#include "background.h"
+#include "peer.h"
+#include "provider.h"
+#include "pool.h"
+#include "verify.h"
+#include "thread.h"
+#include "boundary.h"
+#if defined(MAP_FIXED)
+#include <unistd.h>
+#define ETCHASH_STRIPES_SUPPORTED
+#endif
+
+#define ETCHASH_DEFAULT_STRIPE_SIZE (256 * 1024 * 1024ULL)
 
 #ifdef WITH_CRYPTOPP
 
@@ -70,22 +83,44 @@ uint64_t etchash_get_cachesize(uint64_t const block_number)
 bool static etchash_compute_cache_nodes(
 	node* const nodes,
 	uint64_t cache_size,
-	etchash_h256_t const* seed
+	etchash_h256_t const* seed,
+	etchash_progress_callback_t callback,
+	void* user
 )
 {
 	if (cache_size % sizeof(node) != 0) {
 		return false;
 	}
 	uint32_t const num_nodes = (uint32_t) (cache_size / sizeof(node));
+	// every node is hashed once initially and once per round
+	etchash_progress_t progress;
+	progress.nodes_done = 0;
+	progress.total_nodes = (uint64_t)num_nodes * (1 + ETCHASH_CACHE_ROUNDS);
+	uint32_t const interval = num_nodes / 100 ? num_nodes / 100 : 1;
+	uint64_t const start = callback ? etchash_time_ms() : 0;
 
 	SHA3_512(nodes[0].bytes, (uint8_t*)seed, 32);
 
 	for (uint32_t i = 1; i != num_nodes; ++i) {
+		if (callback && i % interval == 0) {
+			progress.nodes_done = i;
+			progress.elapsed_ms = etchash_time_ms() - start;
+			if (callback(&progress, user) != 0) {
+				return false;
+			}
+		}
 		SHA3_512(nodes[i].bytes, nodes[i - 1].bytes, 64);
 	}
 
 	for (uint32_t j = 0; j != ETCHASH_CACHE_ROUNDS; j++) {
 		for (uint32_t i = 0; i != num_nodes; i++) {
+			if (callback && i % interval == 0) {
+				progress.nodes_done = (uint64_t)(j + 1) * num_nodes + i;
+				progress.elapsed_ms = etchash_time_ms() - start;
+				if (callback(&progress, user) != 0) {
+					return false;
+				}
+			}
 			uint32_t const idx = nodes[i].words[0] % num_nodes;
 			node data;
 			data = nodes[(num_nodes - 1 + i) % num_nodes];
@@ -98,6 +133,13 @@ bool static etchash_compute_cache_nodes(
 
 	// now perform endian conversion
 	fix_endian_arr32(nodes->words, num_nodes * NODE_WORDS);
+	if (callback) {
+		progress.nodes_done = progress.total_nodes;
+		progress.elapsed_ms = etchash_time_ms() - start;
+		if (callback(&progress, user) != 0) {
+			return false;
+		}
+	}
 	return true;
 }
 
@@ -107,9 +149,18 @@ void etchash_calculate_dag_item(
 	etchash_light_t const light
 )
 {
-	uint32_t num_parent_nodes = (uint32_t) (light->cache_size / sizeof(node));
-	node const* cache_nodes = (node const *) light->cache;
-	node const* init = &cache_nodes[node_index % num_parent_nodes];
+	etchash_divisor_t const parents = etchash_divisor_make((uint32_t)(light->cache_size / sizeof(node)));
+	etchash_calculate_dag_item_ex(ret, node_index, (node const*)light->cache, parents);
+}
+
+void etchash_calculate_dag_item_ex(
+	node* const ret,
+	uint32_t node_index,
+	node const* cache_nodes,
+	etchash_divisor_t parents
+)
+{
+	node const* init = &cache_nodes[etchash_fastmod(node_index, parents)];
 	memcpy(ret, init, sizeof(node));
 	ret->words[0] ^= node_index;
 	SHA3_512(ret->bytes, ret->bytes, sizeof(node));
@@ -122,7 +173,7 @@ void etchash_calculate_dag_item(
 #endif
 
 	for (uint32_t i = 0; i != ETCHASH_DATASET_PARENTS; ++i) {
-		uint32_t parent_index = fnv_hash(node_index ^ i, ret->words[i % NODE_WORDS]) % num_parent_nodes;
+		uint32_t parent_index = etchash_fastmod(fnv_hash(node_index ^ i, ret->words[i % NODE_WORDS]), parents);
 		node const *parent = &cache_nodes[parent_index];
 
 #if defined(_M_X64) && ENABLE_SSE
@@ -142,6 +193,13 @@ void etchash_calculate_dag_item(
 			ret->xmm[2] = xmm2;
 			ret->xmm[3] = xmm3;
 		}
+#elif defined(ETCHASH_WASM_SIMD)
+		{
+			v128_t const fnv_prime = wasm_i32x4_splat(FNV_PRIME);
+			for (unsigned v = 0; v != NODE_WORDS / 4; ++v) {
+				ret->v128[v] = wasm_v128_xor(wasm_i32x4_mul(ret->v128[v], fnv_prime), parent->v128[v]);
+			}
+		}
 		#else
 		{
 			for (unsigned w = 0; w != NODE_WORDS; ++w) {
@@ -153,11 +211,39 @@ void etchash_calculate_dag_item(
 	SHA3_512(ret->bytes, ret->bytes, sizeof(node));
 }
 
-bool etchash_compute_full_data(
+// The chunk hook of a DAG computation, hook is NULL without one
+typedef struct full_data_hook {
+	etchash_chunk_hook_t hook;
+	void* user;
+	uint32_t chunk_nodes;
+} full_data_hook_t;
+
+static void etchash_full_data_hook_init(full_data_hook_t* hook, etchash_full_options_t const* options)
+{
+	hook->hook = options ? options->chunk_hook : NULL;
+	hook->user = options ? options->chunk_user : NULL;
+	uint32_t const nodes = options && options->chunk_nodes ? options->chunk_nodes : ETCHASH_CHUNK_DEFAULT_NODES;
+	hook->chunk_nodes = (nodes + ETCHASH_CHUNK_ALIGN_NODES - 1) / ETCHASH_CHUNK_ALIGN_NODES * ETCHASH_CHUNK_ALIGN_NODES;
+}
+
+static bool etchash_full_data_chunk(full_data_hook_t const* hook, node const* full_nodes, uint64_t begin, uint64_t end)
+{
+	etchash_chunk_t chunk;
+	chunk.data = &full_nodes[begin];
+	chunk.size = (end - begin) * sizeof(node);
+	chunk.first_node = begin;
+	chunk.end_node = end;
+	return hook->hook(&chunk, hook->user) == 0;
+}
+
+static bool etchash_compute_full_data_hooked(
 	void* mem,
 	uint64_t full_size,
 	etchash_light_t const light,
-	etchash_callback_t callback
+	etchash_progress_callback_t callback,
+	void* user,
+	uint32_t progress_interval,
+	full_data_hook_t const* hook
 )
 {
 	if (full_size % (sizeof(uint32_t) * MIX_WORDS) != 0 ||
@@ -166,35 +252,203 @@ bool etchash_compute_full_data(
 	}
 	uint32_t const max_n = (uint32_t)(full_size / sizeof(node));
 	node* full_nodes = mem;
-	double const progress_change = 1.0f / max_n;
-	double progress = 0.0f;
+	if (progress_interval == 0) {
+		progress_interval = max_n / 100 ? max_n / 100 : 1;
+	}
+	etchash_progress_t progress;
+	progress.total_nodes = max_n;
+	uint64_t const start = callback ? etchash_time_ms() : 0;
+	uint32_t chunk_begin = 0;
 	// now compute full nodes
 	for (uint32_t n = 0; n != max_n; ++n) {
-		if (callback &&
-			n % (max_n / 100) == 0 &&
-			callback((unsigned int)(ceil(progress * 100.0f))) != 0) {
-
-			return false;
+		if (callback && n % progress_interval == 0) {
+			progress.nodes_done = n;
+			progress.elapsed_ms = etchash_time_ms() - start;
+			if (callback(&progress, user) != 0) {
+				return false;
+			}
 		}
-		progress += progress_change;
 		etchash_calculate_dag_item(&(full_nodes[n]), n, light);
+		if (hook->hook && (n + 1 - chunk_begin == hook->chunk_nodes || n + 1 == max_n)) {
+			if (!etchash_full_data_chunk(hook, full_nodes, chunk_begin, n + 1)) {
+				return false;
+			}
+			chunk_begin = n + 1;
+		}
+	}
+	if (callback) {
+		progress.nodes_done = max_n;
+		progress.elapsed_ms = etchash_time_ms() - start;
+		if (callback(&progress, user) != 0) {
+			return false;
+		}
 	}
 	return true;
 }
 
-static bool etchash_hash(
-	etchash_return_value_t* ret,
-	node const* full_nodes,
+bool etchash_compute_full_data_ex(
+	void* mem,
+	uint64_t full_size,
 	etchash_light_t const light,
+	etchash_progress_callback_t callback,
+	void* user,
+	uint32_t progress_interval
+)
+{
+	full_data_hook_t hook;
+	etchash_full_data_hook_init(&hook, NULL);
+	return etchash_compute_full_data_hooked(mem, full_size, light, callback, user, progress_interval, &hook);
+}
+
+typedef struct full_data_job {
+	node* full_nodes;
+	etchash_light_t light;
+	etchash_progress_callback_t callback;
+	void* user;
+	full_data_hook_t const* hook;
+	etchash_mutex_t mutex;
+	etchash_progress_t progress;
+	uint64_t start;
+} full_data_job_t;
+
+static bool etchash_compute_full_data_range(void* arg, uint64_t begin, uint64_t end)
+{
+	full_data_job_t* job = (full_data_job_t*)arg;
+	// ranges start at chunk boundaries, so every chunk is hooked right after it is written
+	uint64_t const step = job->hook->hook ? job->hook->chunk_nodes : end - begin;
+	for (uint64_t chunk = begin; chunk != end;) {
+		uint64_t const chunk_end = end - chunk > step ? chunk + step : end;
+		for (uint64_t n = chunk; n != chunk_end; ++n) {
+			etchash_calculate_dag_item(&job->full_nodes[n], (uint32_t)n, job->light);
+		}
+		if (job->hook->hook && !etchash_full_data_chunk(job->hook, job->full_nodes, chunk, chunk_end)) {
+			return false;
+		}
+		chunk = chunk_end;
+	}
+	if (!job->callback) {
+		return true;
+	}
+	etchash_mutex_lock(&job->mutex);
+	job->progress.nodes_done += end - begin;
+	job->progress.elapsed_ms = etchash_time_ms() - job->start;
+	bool const ok = job->callback(&job->progress, job->user) == 0;
+	etchash_mutex_unlock(&job->mutex);
+	return ok;
+}
+
+// etchash_compute_full_data_ex() on the library pool, one chunk per progress report
+static bool etchash_compute_full_data_parallel(
+	void* mem,
 	uint64_t full_size,
-	etchash_h256_t const header_hash,
-	uint64_t const nonce
+	etchash_light_t const light,
+	etchash_progress_callback_t callback,
+	void* user,
+	uint32_t progress_interval,
+	full_data_hook_t const* hook
 )
+{
+	if (full_size % (sizeof(uint32_t) * MIX_WORDS) != 0 ||
+		(full_size % sizeof(node)) != 0) {
+		return false;
+	}
+	uint32_t const max_n = (uint32_t)(full_size / sizeof(node));
+	if (progress_interval == 0) {
+		progress_interval = max_n / 100 ? max_n / 100 : 1;
+	}
+	uint64_t grain = progress_interval;
+	if (hook->hook) {
+		grain = (grain + hook->chunk_nodes - 1) / hook->chunk_nodes * hook->chunk_nodes;
+	}
+	full_data_job_t job;
+	job.full_nodes = mem;
+	job.light = light;
+	job.callback = callback;
+	job.user = user;
+	job.hook = hook;
+	job.progress.total_nodes = max_n;
+	job.progress.nodes_done = 0;
+	job.progress.elapsed_ms = 0;
+	job.start = callback ? etchash_time_ms() : 0;
+	etchash_mutex_init(&job.mutex);
+	bool const ok = etchash_parallel_for_kind(
+		ETCHASH_WORK_COMPUTE,
+		max_n,
+		grain,
+		etchash_compute_full_data_range,
+		&job
+	);
+	etchash_mutex_destroy(&job.mutex);
+	return ok;
+}
+
+// hands a DAG that was not generated here, e.g. fetched from a peer, to the chunk hook
+static bool etchash_full_data_replay(void const* mem, uint64_t full_size, full_data_hook_t const* hook)
+{
+	node const* full_nodes = mem;
+	uint64_t const max_n = full_size / sizeof(node);
+	for (uint64_t chunk = 0; hook->hook && chunk != max_n;) {
+		uint64_t const chunk_end = max_n - chunk > hook->chunk_nodes ? chunk + hook->chunk_nodes : max_n;
+		if (!etchash_full_data_chunk(hook, full_nodes, chunk, chunk_end)) {
+			return false;
+		}
+		chunk = chunk_end;
+	}
+	return true;
+}
+
+// adapts the percentage based etchash_callback_t to etchash_progress_callback_t
+static int etchash_percent_progress(etchash_progress_t const* progress, void* user)
+{
+	etchash_callback_t const callback = *(etchash_callback_t const*)user;
+	return callback((unsigned int)(ceil(progress->nodes_done * 100.0 / progress->total_nodes)));
+}
+
+bool etchash_compute_full_data(
+	void* mem,
+	uint64_t full_size,
+	etchash_light_t const light,
+	etchash_callback_t callback
+)
+{
+	return etchash_compute_full_data_ex(
+		mem,
+		full_size,
+		light,
+		callback ? etchash_percent_progress : NULL,
+		&callback,
+		0
+	);
+}
+
+// the page count of a DAG, false for sizes the hash cannot use
+static bool etchash_full_pages(etchash_divisor_t* pages, uint64_t full_size)
 {
 	if (full_size % MIX_WORDS != 0) {
 		return false;
 	}
+	*pages = etchash_divisor_make((uint32_t)(full_size / (sizeof(uint32_t) * MIX_WORDS)));
+	return true;
+}
+
+// the cache node count of a light handler, the modulus of the DAG item parents
+static etchash_divisor_t etchash_cache_nodes(etchash_light_t const light)
+{
+	return etchash_divisor_make(light ? (uint32_t)(light->cache_size / sizeof(node)) : 0);
+}
 
+static bool etchash_hash(
+	etchash_return_value_t* ret,
+	node const* full_nodes,
+	etchash_light_t const light,
+	etchash_provider_t const* provider,
+	etchash_divisor_t const full_pages,
+	etchash_divisor_t const cache_nodes,
+	etchash_h256_t const header_hash,
+	uint64_t const nonce,
+	uint32_t* indices
+)
+{
 	// pack hash and nonce together into first 40 bytes of s_mix
 	assert(sizeof(node) * 8 == 512);
 	node s_mix[MIX_NODES + 1];
@@ -210,19 +464,33 @@ static bool etchash_hash(
 		mix->words[w] = s_mix[0].words[w % NODE_WORDS];
 	}
 
-	unsigned const page_size = sizeof(uint32_t) * MIX_WORDS;
-	unsigned const num_full_pages = (unsigned) (full_size / page_size);
-
 	for (unsigned i = 0; i != ETCHASH_ACCESSES; ++i) {
-		uint32_t const index = fnv_hash(s_mix->words[0] ^ i, mix->words[i % MIX_WORDS]) % num_full_pages;
+		uint32_t const index = etchash_fastmod(fnv_hash(s_mix->words[0] ^ i, mix->words[i % MIX_WORDS]), full_pages);
+		if (indices) {
+			indices[i] = index;
+		}
+
+		// the items of the page in one batch
+		node fetched[MIX_NODES];
+		if (!full_nodes && provider) {
+			uint32_t items[MIX_NODES];
+			for (unsigned n = 0; n != MIX_NODES; ++n) {
+				items[n] = index * MIX_NODES + n;
+			}
+			if (!provider->fetch(provider->user, items, MIX_NODES, fetched)) {
+				return false;
+			}
+		}
 
 		for (unsigned n = 0; n != MIX_NODES; ++n) {
 			node const* dag_node;
 			if (full_nodes) {
 				dag_node = &full_nodes[MIX_NODES * index + n];
+			} else if (provider) {
+				dag_node = &fetched[n];
 			} else {
 				node tmp_node;
-				etchash_calculate_dag_item(&tmp_node, index * MIX_NODES + n, light);
+				etchash_calculate_dag_item_ex(&tmp_node, index * MIX_NODES + n, (node const*)light->cache, cache_nodes);
 				dag_node = &tmp_node;
 			}
 
@@ -238,6 +506,13 @@ static bool etchash_hash(
 				mix[n].xmm[2] = _mm_xor_si128(xmm2, dag_node->xmm[2]);
 				mix[n].xmm[3] = _mm_xor_si128(xmm3, dag_node->xmm[3]);
 			}
+#elif defined(ETCHASH_WASM_SIMD)
+			{
+				v128_t const fnv_prime = wasm_i32x4_splat(FNV_PRIME);
+				for (unsigned v = 0; v != NODE_WORDS / 4; ++v) {
+					mix[n].v128[v] = wasm_v128_xor(wasm_i32x4_mul(mix[n].v128[v], fnv_prime), dag_node->v128[v]);
+				}
+			}
 			#else
 			{
 				for (unsigned w = 0; w != NODE_WORDS; ++w) {
@@ -312,7 +587,29 @@ bool etchash_quick_check_difficulty(
 	return etchash_check_difficulty(&return_hash, boundary);
 }
 
-etchash_light_t etchash_light_new_internal(uint64_t cache_size, etchash_h256_t const* seed)
+bool etchash_verify_proof(
+	etchash_h256_t const* header_hash,
+	uint64_t nonce,
+	etchash_h256_t const* claimed_mix,
+	etchash_h256_t const* boundary,
+	etchash_proof_compute_t compute,
+	void* user
+)
+{
+	if (!etchash_quick_check_difficulty(header_hash, nonce, claimed_mix, boundary)) {
+		return false;
+	}
+	// the result was checked with the claimed mix, it only remains to match it
+	etchash_return_value_t const ret = compute(user, header_hash, nonce);
+	return ret.success && memcmp(&ret.mix_hash, claimed_mix, sizeof(*claimed_mix)) == 0;
+}
+
+etchash_light_t etchash_light_new_internal_ex(
+	uint64_t cache_size,
+	etchash_h256_t const* seed,
+	etchash_progress_callback_t callback,
+	void* user
+)
 {
 	struct etchash_light *ret;
 	ret = calloc(sizeof(*ret), 1);
@@ -323,13 +620,20 @@ etchash_light_t etchash_light_new_internal(uint64_t cache_size, etchash_h256_t c
 	if (!ret->cache) {
 		goto fail_free_light;
 	}
-	node* nodes = (node*)ret->cache;
-	if (!etchash_compute_cache_nodes(nodes, cache_size, seed)) {
+	ret->budget = etchash_budget_acquire(ETCHASH_BUDGET_CACHE, cache_size, 0, true);
+	if (!ret->budget) {
 		goto fail_free_cache_mem;
 	}
+	node* nodes = (node*)ret->cache;
+	if (!etchash_compute_cache_nodes(nodes, cache_size, seed, callback, user)) {
+		goto fail_release_budget;
+	}
 	ret->cache_size = cache_size;
+	etchash_verify_add_light(ret, seed);
 	return ret;
 
+fail_release_budget:
+	etchash_budget_release(ret->budget);
 fail_free_cache_mem:
 	free(ret->cache);
 fail_free_light:
@@ -337,20 +641,40 @@ fail_free_light:
 	return NULL;
 }
 
-etchash_light_t etchash_light_new(uint64_t block_number)
+etchash_light_t etchash_light_new_internal(uint64_t cache_size, etchash_h256_t const* seed)
+{
+	return etchash_light_new_internal_ex(cache_size, seed, NULL, NULL);
+}
+
+etchash_light_t etchash_light_new_ex(
+	uint64_t block_number,
+	etchash_progress_callback_t callback,
+	void* user
+)
 {
 	etchash_h256_t seedhash = etchash_get_seedhash(block_number);
 	etchash_light_t ret;
-	ret = etchash_light_new_internal(etchash_get_cachesize(block_number), &seedhash);
+	ret = etchash_light_new_internal_ex(etchash_get_cachesize(block_number), &seedhash, callback, user);
+	if (!ret) {
+		return NULL;
+	}
 	ret->block_number = block_number;
+	etchash_budget_set_epoch(ret->budget, get_epoch_number(block_number));
 	return ret;
 }
 
+etchash_light_t etchash_light_new(uint64_t block_number)
+{
+	return etchash_light_new_ex(block_number, NULL, NULL);
+}
+
 void etchash_light_delete(etchash_light_t light)
 {
+	etchash_verify_remove(light);
 	if (light->cache) {
 		free(light->cache);
 	}
+	etchash_budget_release(light->budget);
 	free(light);
 }
 
@@ -362,9 +686,15 @@ etchash_return_value_t etchash_light_compute_internal(
 )
 {
   	etchash_return_value_t ret;
+	uint32_t pages[ETCHASH_ACCESSES];
+	uint32_t* const indices = light->trace ? pages : NULL;
+	etchash_divisor_t full_pages;
 	ret.success = true;
-	if (!etchash_hash(&ret, NULL, light, full_size, header_hash, nonce)) {
+	if (!etchash_full_pages(&full_pages, full_size) ||
+		!etchash_hash(&ret, NULL, light, NULL, full_pages, etchash_cache_nodes(light), header_hash, nonce, indices)) {
 		ret.success = false;
+	} else if (indices) {
+		etchash_trace_append(light->trace, nonce, ETCHASH_TRACE_LIGHT, pages);
 	}
 	return ret;
 }
@@ -376,7 +706,53 @@ etchash_return_value_t etchash_light_compute(
 )
 {
 	uint64_t full_size = etchash_get_datasize(light->block_number);
-	return etchash_light_compute_internal(light, full_size, header_hash, nonce);
+	etchash_foreground_begin();
+	etchash_return_value_t ret = etchash_light_compute_internal(light, full_size, header_hash, nonce);
+	etchash_foreground_end();
+	return ret;
+}
+
+typedef struct light_verify {
+	etchash_light_t light;
+	uint64_t full_size;
+} light_verify_t;
+
+static etchash_return_value_t light_verify_compute(void* user, etchash_h256_t const* header_hash, uint64_t nonce)
+{
+	light_verify_t const* verify = (light_verify_t const*)user;
+	return etchash_light_compute_internal(verify->light, verify->full_size, *header_hash, nonce);
+}
+
+bool etchash_light_verify_internal(
+	etchash_light_t light,
+	uint64_t full_size,
+	etchash_h256_t const header_hash,
+	uint64_t nonce,
+	etchash_h256_t const claimed_mix,
+	etchash_h256_t const boundary
+)
+{
+	light_verify_t verify = { light, full_size };
+	return etchash_verify_proof(&header_hash, nonce, &claimed_mix, &boundary, light_verify_compute, &verify);
+}
+
+bool etchash_light_verify(
+	etchash_light_t light,
+	etchash_h256_t const header_hash,
+	uint64_t nonce,
+	etchash_h256_t const claimed_mix,
+	uint64_t difficulty
+)
+{
+	if (!difficulty) {
+		return false;
+	}
+	etchash_h256_t const boundary = etchash_difficulty_to_boundary(difficulty);
+	uint64_t const full_size = etchash_get_datasize(light->block_number);
+	etchash_foreground_begin();
+	bool const ok = etchash_light_verify_internal(light, full_size, header_hash, nonce, claimed_mix, boundary);
+	etchash_foreground_end();
+	return ok;
 }
 
 static bool etchash_mmap(struct etchash_full* ret, FILE* f)
@@ -388,9 +764,13 @@ static bool etchash_mmap(struct etchash_full* ret, FILE* f)
 	if ((fd = etchash_fileno(ret->file)) == -1) {
 		return false;
 	}
+	// legacy DAG files are still mapped, albeit with their data off the page boundary
+	if (!etchash_io_header_size(f, ret->file_size, &ret->header_size)) {
+		return false;
+	}
 	mmapped_data= mmap(
 		NULL,
-		(size_t)ret->file_size + ETCHASH_DAG_MAGIC_NUM_SIZE,
+		(size_t)(ret->file_size + ret->header_size),
 		PROT_READ | PROT_WRITE,
 		MAP_SHARED,
 		fd,
@@ -399,16 +779,187 @@ static bool etchash_mmap(struct etchash_full* ret, FILE* f)
 	if (mmapped_data == MAP_FAILED) {
 		return false;
 	}
-	ret->data = (node*)(mmapped_data + ETCHASH_DAG_MAGIC_NUM_SIZE);
+	ret->data = (node*)(mmapped_data + ret->header_size);
 	return true;
 }
 
-etchash_full_t etchash_full_new_internal(
+static void etchash_munmap(struct etchash_full* full)
+{
+	// could check that munmap(..) == 0 but even if it did not can't really do anything here
+	munmap((char*)full->data - full->header_size, (size_t)(full->file_size + full->header_size));
+}
+
+static void etchash_stripe_close(struct etchash_full* full)
+{
+	for (uint32_t i = 0; i < full->num_stripes; ++i) {
+		if (full->stripes[i]) {
+			fclose(full->stripes[i]);
+		}
+	}
+	free(full->stripes);
+	full->stripes = NULL;
+	full->num_stripes = 0;
+}
+
+static uint64_t etchash_stripe_chunks(struct etchash_full const* full)
+{
+	uint64_t const chunk = (uint64_t)1 << full->stripe_log2;
+	return (full->file_size + chunk - 1) / chunk;
+}
+
+static uint64_t etchash_stripe_chunk_bytes(struct etchash_full const* full, uint64_t c)
+{
+	uint64_t const chunk = (uint64_t)1 << full->stripe_log2;
+	return full->file_size - c * chunk < chunk ? full->file_size - c * chunk : chunk;
+}
+
+static bool etchash_stripe_write_headers(struct etchash_full* full, etchash_h256_t const* seed_hash)
+{
+	etchash_io_stripe_t stripe;
+	stripe.count = full->num_stripes;
+	stripe.chunk_log2 = full->stripe_log2;
+	for (stripe.index = 0; stripe.index < full->num_stripes; ++stripe.index) {
+		etchash_dag_header_t header;
+		etchash_io_stripe_header_init(&header, seed_hash, full->file_size, &stripe);
+		if (!etchash_io_write_header_ex(full->stripes[stripe.index], &header)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+#if defined(ETCHASH_STRIPES_SUPPORTED)
+// reads a chunk of a striped DAG in, the chunks of different stripes come from different devices
+static bool etchash_stripe_prefault(void* arg, uint64_t begin, uint64_t end)
+{
+	struct etchash_full const* full = (struct etchash_full const*)arg;
+	uint64_t const chunk = (uint64_t)1 << full->stripe_log2;
+	for (uint64_t c = begin; c != end; ++c) {
+		uint8_t const volatile* p = (uint8_t const volatile*)full->data + c * chunk;
+		uint64_t const bytes = etchash_stripe_chunk_bytes(full, c);
+		madvise((void*)p, (size_t)bytes, MADV_WILLNEED);
+		uint8_t sink = 0;
+		for (uint64_t off = 0; off < bytes; off += ETCHASH_DAG_HEADER_SIZE) {
+			sink ^= p[off];
+		}
+		(void)sink;
+	}
+	return true;
+}
+
+/*
+ * Opens the stripe files of a DAG and maps their chunks into one contiguous
+ * range, chunk c coming from stripe c % count. Returns ETCHASH_IO_MEMO_MATCH
+ * only if every stripe file held its part of this DAG already.
+ */
+static enum etchash_io_rc etchash_stripe_mmap(
+	struct etchash_full* ret,
+	etchash_full_options_t const* options,
+	etchash_h256_t const* seed_hash,
+	uint64_t full_size
+)
+{
+	uint64_t const chunk = options->stripe_size ? options->stripe_size : ETCHASH_DEFAULT_STRIPE_SIZE;
+	long const page = sysconf(_SC_PAGESIZE);
+	if ((chunk & (chunk - 1)) != 0 || page <= 0 || chunk % (uint64_t)page != 0 ||
+		ETCHASH_DAG_HEADER_SIZE % page != 0) {
+		ETCHASH_CRITICAL("DAG stripe size %llu is not a power of two multiple of the page size.", (unsigned long long)chunk);
+		return ETCHASH_IO_FAIL;
+	}
+	ret->stripes = calloc(options->num_dag_dirs, sizeof(FILE*));
+	if (!ret->stripes) {
+		return ETCHASH_IO_FAIL;
+	}
+	ret->num_stripes = options->num_dag_dirs;
+	while (((uint64_t)1 << ret->stripe_log2) < chunk) {
+		ret->stripe_log2++;
+	}
+
+	enum etchash_io_rc rc = ETCHASH_IO_MEMO_MATCH;
+	uint64_t const chunks = etchash_stripe_chunks(ret);
+	etchash_io_stripe_t stripe;
+	stripe.count = ret->num_stripes;
+	stripe.chunk_log2 = ret->stripe_log2;
+	for (stripe.index = 0; stripe.index < ret->num_stripes; ++stripe.index) {
+		uint64_t bytes = 0;
+		for (uint64_t c = stripe.index; c < chunks; c += stripe.count) {
+			bytes += etchash_stripe_chunk_bytes(ret, c);
+		}
+		char const* dirname = options->dag_dirs[stripe.index];
+		FILE** f = &ret->stripes[stripe.index];
+		enum etchash_io_rc file_rc = etchash_io_prepare_stripe(dirname, *seed_hash, full_size, &stripe, f, bytes, false);
+		if (file_rc == ETCHASH_IO_MEMO_SIZE_MISMATCH) {
+			file_rc = etchash_io_prepare_stripe(dirname, *seed_hash, full_size, &stripe, f, bytes, true);
+		}
+		if (file_rc == ETCHASH_IO_FAIL || file_rc == ETCHASH_IO_MEMO_SIZE_MISMATCH) {
+			goto fail_close;
+		}
+		if (file_rc != ETCHASH_IO_MEMO_MATCH) {
+			rc = ETCHASH_IO_MEMO_MISMATCH;
+		}
+	}
+
+	// reserve the range first so that the chunks land next to each other
+	char* base = mmap(NULL, (size_t)full_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED) {
+		ETCHASH_CRITICAL("Could not reserve %llu bytes for a striped DAG.", (unsigned long long)full_size);
+		goto fail_close;
+	}
+	for (uint64_t c = 0; c < chunks; ++c) {
+		int fd = etchash_fileno(ret->stripes[c % ret->num_stripes]);
+		off_t offset = (off_t)(ETCHASH_DAG_HEADER_SIZE + (c / ret->num_stripes) * chunk);
+		if (fd == -1 || mmap(
+			base + c * chunk,
+			(size_t)etchash_stripe_chunk_bytes(ret, c),
+			PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_FIXED,
+			fd,
+			offset) == MAP_FAILED) {
+			ETCHASH_CRITICAL("Could not map chunk %llu of a striped DAG.", (unsigned long long)c);
+			munmap(base, (size_t)full_size);
+			goto fail_close;
+		}
+	}
+	ret->data = (node*)base;
+	ret->header_size = 0;
+	return rc;
+
+fail_close:
+	etchash_stripe_close(ret);
+	return ETCHASH_IO_FAIL;
+}
+#else
+static bool etchash_stripe_prefault(void* arg, uint64_t begin, uint64_t end)
+{
+	(void)arg;
+	(void)begin;
+	(void)end;
+	return true;
+}
+
+static enum etchash_io_rc etchash_stripe_mmap(
+	struct etchash_full* ret,
+	etchash_full_options_t const* options,
+	etchash_h256_t const* seed_hash,
+	uint64_t full_size
+)
+{
+	(void)ret;
+	(void)options;
+	(void)seed_hash;
+	(void)full_size;
+	return ETCHASH_IO_FAIL;
+}
+#endif
+
+etchash_full_t etchash_full_new_internal_ex(
 	char const* dirname,
 	etchash_h256_t const seed_hash,
 	uint64_t full_size,
 	etchash_light_t const light,
-	etchash_callback_t callback
+	etchash_progress_callback_t callback,
+	void* user,
+	etchash_full_options_t const* options
 )
 {
 	struct etchash_full* ret;
@@ -418,62 +969,146 @@ etchash_full_t etchash_full_new_internal(
 		return NULL;
 	}
 	ret->file_size = (size_t)full_size;
-	switch (etchash_io_prepare(dirname, seed_hash, &f, (size_t)full_size, false)) {
-	case ETCHASH_IO_FAIL:
-		// etchash_io_prepare will do all ETCHASH_CRITICAL() logging in fail case
+	ret->budget = etchash_budget_acquire(ETCHASH_BUDGET_DAG, full_size, get_epoch_number(light->block_number), false);
+	if (!ret->budget) {
+		ETCHASH_CRITICAL("DAG of %llu bytes does not fit the memory budget.", (unsigned long long)full_size);
 		goto fail_free_full;
-	case ETCHASH_IO_MEMO_MATCH:
-		if (!etchash_mmap(ret, f)) {
-			ETCHASH_CRITICAL("mmap failure()");
-			goto fail_close_file;
+	}
+	bool striped = options && options->num_dag_dirs > 1;
+#if !defined(ETCHASH_STRIPES_SUPPORTED)
+	if (striped) {
+		ETCHASH_CRITICAL("Striped DAGs need fixed address mappings, using a single file instead.");
+		striped = false;
+	}
+#endif
+	if (striped) {
+		enum etchash_io_rc const rc = etchash_stripe_mmap(ret, options, &seed_hash, full_size);
+		if (rc == ETCHASH_IO_FAIL) {
+			goto fail_release_budget;
 		}
-		return ret;
-	case ETCHASH_IO_MEMO_SIZE_MISMATCH:
-		// if a DAG of same filename but unexpected size is found, silently force new file creation
-		if (etchash_io_prepare(dirname, seed_hash, &f, (size_t)full_size, true) != ETCHASH_IO_MEMO_MISMATCH) {
-			ETCHASH_CRITICAL("Could not recreate DAG file after finding existing DAG with unexpected size.");
-			goto fail_free_full;
+		if (rc == ETCHASH_IO_MEMO_MATCH) {
+			// read every stripe at once instead of faulting the pages in one by one
+			etchash_parallel_for(etchash_stripe_chunks(ret), 1, etchash_stripe_prefault, ret);
+			etchash_verify_add_full(ret, &seed_hash);
+			return ret;
 		}
-		// fallthrough to the mismatch case here, DO NOT go through match
-	case ETCHASH_IO_MEMO_MISMATCH:
-		if (!etchash_mmap(ret, f)) {
-			ETCHASH_CRITICAL("mmap failure()");
-			goto fail_close_file;
+	} else {
+		switch (etchash_io_prepare(dirname, seed_hash, &f, (size_t)full_size, false)) {
+		case ETCHASH_IO_FAIL:
+			// etchash_io_prepare will do all ETCHASH_CRITICAL() logging in fail case
+			goto fail_release_budget;
+		case ETCHASH_IO_MEMO_MATCH:
+			if (!etchash_mmap(ret, f)) {
+				ETCHASH_CRITICAL("mmap failure()");
+				goto fail_close_file;
+			}
+			etchash_verify_add_full(ret, &seed_hash);
+			return ret;
+		case ETCHASH_IO_MEMO_SIZE_MISMATCH:
+			// if a DAG of same filename but unexpected size is found, silently force new file creation
+			if (etchash_io_prepare(dirname, seed_hash, &f, (size_t)full_size, true) != ETCHASH_IO_MEMO_MISMATCH) {
+				ETCHASH_CRITICAL("Could not recreate DAG file after finding existing DAG with unexpected size.");
+				goto fail_release_budget;
+			}
+			// fallthrough to the mismatch case here, DO NOT go through match
+		case ETCHASH_IO_MEMO_MISMATCH:
+			if (!etchash_mmap(ret, f)) {
+				ETCHASH_CRITICAL("mmap failure()");
+				goto fail_close_file;
+			}
+			break;
 		}
-		break;
 	}
 
-	if (!etchash_compute_full_data(ret->data, full_size, light, callback)) {
-		ETCHASH_CRITICAL("Failure at computing DAG data.");
-		goto fail_free_full_data;
+	// a peer that already has the DAG can send it much faster than it can be computed
+	bool fetched = false;
+	for (uint32_t i = 0; options && i < options->num_peers && !fetched; ++i) {
+		uint64_t start = etchash_time_ms();
+		fetched = etchash_peer_fetch(options->peers[i], &seed_hash, full_size, light, ret->data, options->peer_samples);
+		if (fetched && callback) {
+			etchash_progress_t progress;
+			progress.total_nodes = full_size / sizeof(node);
+			progress.nodes_done = progress.total_nodes;
+			progress.elapsed_ms = etchash_time_ms() - start;
+			callback(&progress, user);
+		}
 	}
-
-	// after the DAG has been filled then we finalize it by writting the magic number at the beginning
-	if (fseek(f, 0, SEEK_SET) != 0) {
-		ETCHASH_CRITICAL("Could not seek to DAG file start to write magic number.");
+	uint32_t const progress_interval = options ? options->progress_interval : 0;
+	full_data_hook_t hook;
+	etchash_full_data_hook_init(&hook, options);
+	if (fetched && !etchash_full_data_replay(ret->data, full_size, &hook)) {
+		ETCHASH_CRITICAL("Chunk hook cancelled the fetched DAG.");
 		goto fail_free_full_data;
 	}
-	uint64_t const magic_num = ETCHASH_DAG_MAGIC_NUM;
-	if (fwrite(&magic_num, ETCHASH_DAG_MAGIC_NUM_SIZE, 1, f) != 1) {
-		ETCHASH_CRITICAL("Could not write magic number to DAG's beginning.");
+	// a striped DAG is written to all of its devices at once
+	bool const parallel = options && (options->parallel || striped);
+	if (!fetched && !(parallel ?
+		etchash_compute_full_data_parallel(ret->data, full_size, light, callback, user, progress_interval, &hook) :
+		etchash_compute_full_data_hooked(ret->data, full_size, light, callback, user, progress_interval, &hook))) {
+		ETCHASH_CRITICAL("Failure at computing DAG data.");
 		goto fail_free_full_data;
 	}
-	if (fflush(f) != 0) {// make sure the magic number IS there
-		ETCHASH_CRITICAL("Could not flush memory mapped data to DAG file. Insufficient space?");
+
+	// after the DAG has been filled then we finalize it by writting the header at the beginning
+	if (striped ? !etchash_stripe_write_headers(ret, &seed_hash) : !etchash_io_write_header(f, &seed_hash, full_size)) {
 		goto fail_free_full_data;
 	}
+	etchash_verify_add_full(ret, &seed_hash);
 	return ret;
 
 fail_free_full_data:
-	// could check that munmap(..) == 0 but even if it did not can't really do anything here
-	munmap(ret->data, (size_t)full_size);
+	etchash_munmap(ret);
 fail_close_file:
-	fclose(ret->file);
+	if (ret->file) {
+		fclose(ret->file);
+	}
+	etchash_stripe_close(ret);
+fail_release_budget:
+	etchash_budget_release(ret->budget);
 fail_free_full:
 	free(ret);
 	return NULL;
 }
 
+etchash_full_t etchash_full_new_internal(
+	char const* dirname,
+	etchash_h256_t const seed_hash,
+	uint64_t full_size,
+	etchash_light_t const light,
+	etchash_callback_t callback
+)
+{
+	return etchash_full_new_internal_ex(
+		dirname,
+		seed_hash,
+		full_size,
+		light,
+		callback ? etchash_percent_progress : NULL,
+		&callback,
+		NULL
+	);
+}
+
+etchash_full_t etchash_full_new_ex(
+	etchash_light_t light,
+	etchash_progress_callback_t callback,
+	void* user,
+	etchash_full_options_t const* options
+)
+{
+	char strbuf[256];
+	char const* dirname = options ? options->dirname : NULL;
+	if (!dirname) {
+		if (!etchash_get_default_dirname(strbuf, 256)) {
+			return NULL;
+		}
+		dirname = strbuf;
+	}
+	uint64_t full_size = etchash_get_datasize(light->block_number);
+	etchash_h256_t seedhash = etchash_get_seedhash(light->block_number);
+	return etchash_full_new_internal_ex(dirname, seedhash, full_size, light, callback, user, options);
+}
+
 etchash_full_t etchash_full_new(etchash_light_t light, etchash_callback_t callback)
 {
 	char strbuf[256];
@@ -487,11 +1122,13 @@ etchash_full_t etchash_full_new(etchash_light_t light, etchash_callback_t callba
 
 void etchash_full_delete(etchash_full_t full)
 {
-	// could check that munmap(..) == 0 but even if it did not can't really do anything here
-	munmap(full->data, (size_t)full->file_size);
+	etchash_verify_remove(full);
+	etchash_munmap(full);
 	if (full->file) {
 		fclose(full->file);
 	}
+	etchash_stripe_close(full);
+	etchash_budget_release(full->budget);
 	free(full);
 }
 
@@ -502,19 +1139,127 @@ etchash_return_value_t etchash_full_compute(
 )
 {
 	etchash_return_value_t ret;
+	uint32_t pages[ETCHASH_ACCESSES];
+	uint32_t* const indices = full->trace ? pages : NULL;
+	etchash_divisor_t full_pages;
 	ret.success = true;
-	if (!etchash_hash(
+	if (!etchash_full_pages(&full_pages, full->file_size) || !etchash_hash(
 		&ret,
 		(node const*)full->data,
 		NULL,
-		full->file_size,
+		NULL,
+		full_pages,
+		etchash_cache_nodes(NULL),
+		header_hash,
+		nonce,
+		indices)) {
+		ret.success = false;
+	} else if (indices) {
+		etchash_trace_append(full->trace, nonce, 0, pages);
+	}
+	return ret;
+}
+
+etchash_return_value_t etchash_full_compute_indices(
+	etchash_full_t full,
+	etchash_h256_t const header_hash,
+	uint64_t nonce,
+	uint32_t indices[ETCHASH_ACCESSES]
+)
+{
+	etchash_return_value_t ret;
+	etchash_divisor_t full_pages;
+	ret.success = true;
+	if (!etchash_full_pages(&full_pages, full->file_size) || !etchash_hash(
+		&ret,
+		(node const*)full->data,
+		NULL,
+		NULL,
+		full_pages,
+		etchash_cache_nodes(NULL),
 		header_hash,
-		nonce)) {
+		nonce,
+		indices)) {
 		ret.success = false;
 	}
 	return ret;
 }
 
+etchash_return_value_t etchash_compute_with_provider(
+	etchash_provider_t const* provider,
+	etchash_h256_t const header_hash,
+	uint64_t nonce
+)
+{
+	etchash_return_value_t ret;
+	etchash_divisor_t full_pages;
+	ret.success = etchash_full_pages(&full_pages, provider->full_size) &&
+		etchash_hash(&ret, NULL, NULL, provider, full_pages, etchash_cache_nodes(NULL), header_hash, nonce, NULL);
+	return ret;
+}
+
+etchash_return_value_t etchash_epoch_compute(
+	etchash_epoch_context_t const* context,
+	etchash_h256_t const header_hash,
+	uint64_t nonce
+)
+{
+	etchash_return_value_t ret;
+	uint32_t pages[ETCHASH_ACCESSES];
+	etchash_full_t const full = context->full;
+	etchash_trace_t const trace = full ? full->trace : context->light->trace;
+	uint32_t* const indices = trace ? pages : NULL;
+	ret.success = etchash_hash(
+		&ret,
+		full ? (node const*)full->data : NULL,
+		context->light,
+		NULL,
+		context->full_pages,
+		context->cache_nodes,
+		header_hash,
+		nonce,
+		indices
+	);
+	if (ret.success && indices) {
+		etchash_trace_append(trace, nonce, full ? 0 : ETCHASH_TRACE_LIGHT, pages);
+	}
+	return ret;
+}
+
+static bool etchash_fetch_full(void* user, uint32_t const* items, unsigned count, void* out)
+{
+	struct etchash_full const* full = (struct etchash_full const*)user;
+	for (unsigned i = 0; i != count; ++i) {
+		if ((uint64_t)items[i] * sizeof(node) >= full->file_size) {
+			return false;
+		}
+		memcpy((node*)out + i, &full->data[items[i]], sizeof(node));
+	}
+	return true;
+}
+
+static bool etchash_fetch_light(void* user, uint32_t const* items, unsigned count, void* out)
+{
+	for (unsigned i = 0; i != count; ++i) {
+		etchash_calculate_dag_item((node*)out + i, items[i], (etchash_light_t)user);
+	}
+	return true;
+}
+
+void etchash_provider_from_full(etchash_provider_t* provider, etchash_full_t full)
+{
+	provider->fetch = etchash_fetch_full;
+	provider->user = full;
+	provider->full_size = full->file_size;
+}
+
+void etchash_provider_from_light(etchash_provider_t* provider, etchash_light_t light, uint64_t full_size)
+{
+	provider->fetch = etchash_fetch_light;
+	provider->user = light;
+	provider->full_size = full_size;
+}
+
 void const* etchash_full_dag(etchash_full_t full)
 {
 	return full->data;
@@ -2,6 +2,9 @@
 #include "compiler.h"
 #include "endian.h"
 #include "etchash.h"
+#include "trace.h"
+#include "budget.h"
+#include "epoch.h"
 #include <stdio.h>
 
 #define ENABLE_SSE 0
@@ -10,6 +13,12 @@
 #include <smmintrin.h>
 #endif
 
+// WebAssembly builds with -msimd128, see src/wasm
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define ETCHASH_WASM_SIMD 1
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -28,6 +37,9 @@ typedef union node {
 #if defined(_M_X64) && ENABLE_SSE
 	__m128i xmm[NODE_WORDS/4];
 #endif
+#if defined(ETCHASH_WASM_SIMD)
+	v128_t v128[NODE_WORDS/4];
+#endif
 
 } node;
 
@@ -78,10 +90,41 @@ bool etchash_quick_check_difficulty(
 	etchash_h256_t const* boundary
 );
 
+/// Hashes a proof for @ref etchash_verify_proof(), with whichever data the caller has
+typedef etchash_return_value_t (*etchash_proof_compute_t)(
+	void* user,
+	etchash_h256_t const* header_hash,
+	uint64_t nonce
+);
+
+/**
+ * Verify a proof of work, rejecting most invalid ones before hashing
+ *
+ * The claimed mix gives the result with two Keccak hashes, so a proof that
+ * misses the boundary is refused without touching the cache or the DAG. Only
+ * the others are hashed by @a compute, whose mix must then match the claim.
+ *
+ * @param claimed_mix    The claimed mix digest
+ * @param boundary       2^256 / difficulty, big endian, see boundary.h
+ * @param compute        Hashes the proof, called only past the quick check
+ * @param user           Passed to @a compute
+ * @return               true if the mix is right and the result is within the boundary
+ */
+bool etchash_verify_proof(
+	etchash_h256_t const* header_hash,
+	uint64_t nonce,
+	etchash_h256_t const* claimed_mix,
+	etchash_h256_t const* boundary,
+	etchash_proof_compute_t compute,
+	void* user
+);
+
 struct etchash_light {
 	void* cache;
 	uint64_t cache_size;
 	uint64_t block_number;
+	etchash_trace_t trace;
+	etchash_budget_entry_t budget;
 };
 
 /**
@@ -95,6 +138,24 @@ struct etchash_light {
  */
 etchash_light_t etchash_light_new_internal(uint64_t cache_size, etchash_h256_t const* seed);
 
+/**
+ * Allocate and initialize a new etchash_light handler, reporting progress. Internal version
+ *
+ * @param cache_size    The size of the cache in bytes
+ * @param seed          Block seedhash to be used during the computation of the
+ *                      cache nodes
+ * @param callback      Progress callback, may be NULL. Check @ref etchash_light_new_ex() for details.
+ * @param user          Context pointer handed to @a callback
+ * @return              Newly allocated etchash_light handler or NULL in case of
+ *                      ERRNOMEM, cancellation or invalid parameters
+ */
+etchash_light_t etchash_light_new_internal_ex(
+	uint64_t cache_size,
+	etchash_h256_t const* seed,
+	etchash_progress_callback_t callback,
+	void* user
+);
+
 /**
  * Calculate the light client data. Internal version.
  *
@@ -111,10 +172,36 @@ etchash_return_value_t etchash_light_compute_internal(
 	uint64_t nonce
 );
 
+/**
+ * Verify a proof of work with the light client data. Internal version
+ *
+ * @param light          The light client handler
+ * @param full_size      The size of the full data in bytes
+ * @param header_hash    The header hash to pack into the mix
+ * @param nonce          The claimed nonce
+ * @param claimed_mix    The claimed mix digest
+ * @param boundary       2^256 / difficulty, big endian, see boundary.h
+ * @return               true if the mix is right and the result is within the boundary
+ */
+bool etchash_light_verify_internal(
+	etchash_light_t light,
+	uint64_t full_size,
+	etchash_h256_t const header_hash,
+	uint64_t nonce,
+	etchash_h256_t const claimed_mix,
+	etchash_h256_t const boundary
+);
+
 struct etchash_full {
 	FILE* file;
 	uint64_t file_size;
+	uint64_t header_size; // bytes in front of data in the mapping, see @ref etchash_dag_header
 	node* data;
+	etchash_trace_t trace;
+	etchash_budget_entry_t budget;
+	FILE** stripes;       // the stripe files of a striped DAG, file is NULL then
+	uint32_t num_stripes;
+	uint32_t stripe_log2; // log2 of the bytes of a stripe chunk
 };
 
 /**
@@ -142,12 +229,65 @@ etchash_full_t etchash_full_new_internal(
 	etchash_callback_t callback
 );
 
+/**
+ * Allocate and initialize a new etchash_full handler, reporting progress. Internal version.
+ *
+ * @param dirname        The directory in which to put the DAG file.
+ * @param seedhash       The seed hash of the block. Used in the DAG file naming.
+ * @param full_size      The size of the full data in bytes.
+ * @param cache          A cache object to use that was allocated with @ref etchash_cache_new().
+ * @param callback       Progress callback, may be NULL. Check @ref etchash_full_new_ex() for details.
+ * @param user           Context pointer handed to @a callback
+ * @param options        Optional settings, may be NULL. The dirname member is ignored.
+ * @return               Newly allocated etchash_full handler or NULL in case of
+ *                       ERRNOMEM, cancellation or invalid parameters
+ */
+etchash_full_t etchash_full_new_internal_ex(
+	char const* dirname,
+	etchash_h256_t const seed_hash,
+	uint64_t full_size,
+	etchash_light_t const light,
+	etchash_progress_callback_t callback,
+	void* user,
+	etchash_full_options_t const* options
+);
+
+/**
+ * Calculate the full client data, recording the DAG pages the hash accessed
+ *
+ * @param full           The full client handler
+ * @param header_hash    The header hash to pack into the mix
+ * @param nonce          The nonce to pack into the mix
+ * @param indices        Receives the index of the ETCHASH_MIX_BYTES sized DAG page
+ *                       read by each of the ETCHASH_ACCESSES rounds, in order
+ * @return               An object of etchash_return_value to hold the return value
+ */
+etchash_return_value_t etchash_full_compute_indices(
+	etchash_full_t full,
+	etchash_h256_t const header_hash,
+	uint64_t nonce,
+	uint32_t indices[ETCHASH_ACCESSES]
+);
+
 void etchash_calculate_dag_item(
 	node* const ret,
 	uint32_t node_index,
 	etchash_light_t const cache
 );
 
+/**
+ * Calculate a DAG item with the reciprocal of the cache node count at hand
+ *
+ * @param cache_nodes    The nodes of the cache
+ * @param parents        The number of cache nodes, see etchash_divisor_make()
+ */
+void etchash_calculate_dag_item_ex(
+	node* const ret,
+	uint32_t node_index,
+	node const* cache_nodes,
+	etchash_divisor_t parents
+);
+
 void etchash_quick_hash(
 	etchash_h256_t* return_hash,
 	etchash_h256_t const* header_hash,
@@ -155,6 +295,7 @@ void etchash_quick_hash(
 	etchash_h256_t const* mix_hash
 );
 
+uint64_t get_epoch_number(uint64_t const block_number);
 uint64_t etchash_get_datasize(uint64_t const block_number);
 uint64_t etchash_get_cachesize(uint64_t const block_number);
 
@@ -174,6 +315,26 @@ bool etchash_compute_full_data(
 	etchash_callback_t callback
 );
 
+/**
+ * Compute the memory data for a full node's memory, reporting progress
+ *
+ * @param mem                A pointer to an etchash full's memory
+ * @param full_size          The size of the full data in bytes
+ * @param cache              A cache object to use in the calculation
+ * @param callback           Progress callback, may be NULL. Check @ref etchash_full_new_ex() for details.
+ * @param user               Context pointer handed to @a callback
+ * @param progress_interval  Nodes between progress reports, 0 for every 1%
+ * @return                   true if all went fine and false for invalid parameters or cancellation
+ */
+bool etchash_compute_full_data_ex(
+	void* mem,
+	uint64_t full_size,
+	etchash_light_t const light,
+	etchash_progress_callback_t callback,
+	void* user,
+	uint32_t progress_interval
+);
+
 #ifdef __cplusplus
 }
 #endif
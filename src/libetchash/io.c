@@ -23,97 +23,222 @@
 #include <stdio.h>
 #include <errno.h>
 
-enum etchash_io_rc etchash_io_prepare(
-	char const* dirname,
-	etchash_h256_t const seedhash,
+// opens or creates the DAG file at @a path, whose header must match @a expected
+static enum etchash_io_rc io_prepare_file(
+	char const* path,
+	etchash_dag_header_t const* expected,
 	FILE** output_file,
 	uint64_t file_size,
 	bool force_create
 )
 {
-	char mutable_name[DAG_MUTABLE_NAME_MAX_SIZE];
 	enum etchash_io_rc ret = ETCHASH_IO_FAIL;
-	// reset errno before io calls
-	errno = 0;
-
-	// assert directory exists
-	if (!etchash_mkdir(dirname)) {
-		ETCHASH_CRITICAL("Could not create the etchash directory");
-		goto end;
-	}
-
-	etchash_io_mutable_name(ETCHASH_REVISION, &seedhash, mutable_name);
-	char* tmpfile = etchash_io_create_filename(dirname, mutable_name, strlen(mutable_name));
-	if (!tmpfile) {
-		ETCHASH_CRITICAL("Could not create the full DAG pathname");
-		goto end;
-	}
-
 	FILE *f;
 	if (!force_create) {
 		// try to open the file
-		f = etchash_fopen(tmpfile, "rb+");
+		f = etchash_fopen(path, "rb+");
 		if (f) {
 			size_t found_size;
 			if (!etchash_file_size(f, &found_size)) {
 				fclose(f);
-				ETCHASH_CRITICAL("Could not query size of DAG file: \"%s\"", tmpfile);
-				goto free_memo;
+				ETCHASH_CRITICAL("Could not query size of DAG file: \"%s\"", path);
+				return ETCHASH_IO_FAIL;
+			}
+			if (found_size == file_size + ETCHASH_DAG_HEADER_SIZE) {
+				etchash_dag_header_t header;
+				if (fread(&header, sizeof(header), 1, f) != 1) {
+					// I/O error
+					fclose(f);
+					ETCHASH_CRITICAL("Could not read from DAG file: \"%s\"", path);
+					return ETCHASH_IO_MEMO_SIZE_MISMATCH;
+				}
+				if (memcmp(&header, expected, sizeof(header)) != 0) {
+					fclose(f);
+					return ETCHASH_IO_MEMO_SIZE_MISMATCH;
+				}
+				ret = ETCHASH_IO_MEMO_MATCH;
+				goto set_file;
 			}
-			if (file_size != found_size - ETCHASH_DAG_MAGIC_NUM_SIZE) {
+			// legacy DAG file with only the magic number in front of the data, never striped
+			if (expected->flags != 0 || found_size != file_size + ETCHASH_DAG_MAGIC_NUM_SIZE) {
 				fclose(f);
-				ret = ETCHASH_IO_MEMO_SIZE_MISMATCH;
-				goto free_memo;
+				return ETCHASH_IO_MEMO_SIZE_MISMATCH;
 			}
 			// compare the magic number, no need to care about endianess since it's local
 			uint64_t magic_num;
 			if (fread(&magic_num, ETCHASH_DAG_MAGIC_NUM_SIZE, 1, f) != 1) {
 				// I/O error
 				fclose(f);
-				ETCHASH_CRITICAL("Could not read from DAG file: \"%s\"", tmpfile);
-				ret = ETCHASH_IO_MEMO_SIZE_MISMATCH;
-				goto free_memo;
+				ETCHASH_CRITICAL("Could not read from DAG file: \"%s\"", path);
+				return ETCHASH_IO_MEMO_SIZE_MISMATCH;
 			}
 			if (magic_num != ETCHASH_DAG_MAGIC_NUM) {
 				fclose(f);
-				ret = ETCHASH_IO_MEMO_SIZE_MISMATCH;
-				goto free_memo;
+				return ETCHASH_IO_MEMO_SIZE_MISMATCH;
 			}
 			ret = ETCHASH_IO_MEMO_MATCH;
 			goto set_file;
 		}
 	}
-	
+
 	// file does not exist, will need to be created
-	f = etchash_fopen(tmpfile, "wb+");
+	f = etchash_fopen(path, "wb+");
 	if (!f) {
-		ETCHASH_CRITICAL("Could not create DAG file: \"%s\"", tmpfile);
-		goto free_memo;
+		ETCHASH_CRITICAL("Could not create DAG file: \"%s\"", path);
+		return ETCHASH_IO_FAIL;
 	}
 	// make sure it's of the proper size
-	if (fseek(f, (long int)(file_size + ETCHASH_DAG_MAGIC_NUM_SIZE - 1), SEEK_SET) != 0) {
+	if (fseek(f, (long int)(file_size + ETCHASH_DAG_HEADER_SIZE - 1), SEEK_SET) != 0) {
 		fclose(f);
-		ETCHASH_CRITICAL("Could not seek to the end of DAG file: \"%s\". Insufficient space?", tmpfile);
-		goto free_memo;
+		ETCHASH_CRITICAL("Could not seek to the end of DAG file: \"%s\". Insufficient space?", path);
+		return ETCHASH_IO_FAIL;
 	}
 	if (fputc('\n', f) == EOF) {
 		fclose(f);
-		ETCHASH_CRITICAL("Could not write in the end of DAG file: \"%s\". Insufficient space?", tmpfile);
-		goto free_memo;
+		ETCHASH_CRITICAL("Could not write in the end of DAG file: \"%s\". Insufficient space?", path);
+		return ETCHASH_IO_FAIL;
 	}
 	if (fflush(f) != 0) {
 		fclose(f);
-		ETCHASH_CRITICAL("Could not flush at end of DAG file: \"%s\". Insufficient space?", tmpfile);
-		goto free_memo;
+		ETCHASH_CRITICAL("Could not flush at end of DAG file: \"%s\". Insufficient space?", path);
+		return ETCHASH_IO_FAIL;
 	}
 	ret = ETCHASH_IO_MEMO_MISMATCH;
-	goto set_file;
-
-	ret = ETCHASH_IO_MEMO_MATCH;
 set_file:
 	*output_file = f;
-free_memo:
+	return ret;
+}
+
+enum etchash_io_rc etchash_io_prepare(
+	char const* dirname,
+	etchash_h256_t const seedhash,
+	FILE** output_file,
+	uint64_t file_size,
+	bool force_create
+)
+{
+	char mutable_name[DAG_MUTABLE_NAME_MAX_SIZE];
+	enum etchash_io_rc ret = ETCHASH_IO_FAIL;
+	// reset errno before io calls
+	errno = 0;
+
+	// assert directory exists
+	if (!etchash_mkdir(dirname)) {
+		ETCHASH_CRITICAL("Could not create the etchash directory");
+		return ret;
+	}
+
+	etchash_io_mutable_name(ETCHASH_REVISION, &seedhash, mutable_name);
+	char* tmpfile = etchash_io_create_filename(dirname, mutable_name, strlen(mutable_name));
+	if (!tmpfile) {
+		ETCHASH_CRITICAL("Could not create the full DAG pathname");
+		return ret;
+	}
+	etchash_dag_header_t expected;
+	etchash_io_header_init(&expected, &seedhash, file_size);
+	ret = io_prepare_file(tmpfile, &expected, output_file, file_size, force_create);
 	free(tmpfile);
-end:
 	return ret;
 }
+
+enum etchash_io_rc etchash_io_prepare_stripe(
+	char const* dirname,
+	etchash_h256_t const seedhash,
+	uint64_t full_size,
+	etchash_io_stripe_t const* stripe,
+	FILE** output_file,
+	uint64_t file_size,
+	bool force_create
+)
+{
+	char mutable_name[DAG_MUTABLE_NAME_MAX_SIZE];
+	char name[DAG_MUTABLE_NAME_MAX_SIZE + 24];
+	errno = 0;
+	if (!etchash_mkdir(dirname)) {
+		ETCHASH_CRITICAL("Could not create the DAG stripe directory \"%s\"", dirname);
+		return ETCHASH_IO_FAIL;
+	}
+	etchash_io_mutable_name(ETCHASH_REVISION, &seedhash, mutable_name);
+	snprintf(name, sizeof(name), "%s.%uof%u", mutable_name, stripe->index + 1, stripe->count);
+	char* path = etchash_io_create_filename(dirname, name, strlen(name));
+	if (!path) {
+		ETCHASH_CRITICAL("Could not create the DAG stripe pathname");
+		return ETCHASH_IO_FAIL;
+	}
+	etchash_dag_header_t expected;
+	etchash_io_stripe_header_init(&expected, &seedhash, full_size, stripe);
+	enum etchash_io_rc ret = io_prepare_file(path, &expected, output_file, file_size, force_create);
+	free(path);
+	return ret;
+}
+
+void etchash_io_header_init(
+	etchash_dag_header_t* header,
+	etchash_h256_t const* seedhash,
+	uint64_t file_size
+)
+{
+	// zero everything first so that padding compares equal with memcmp()
+	memset(header, 0, sizeof(*header));
+	header->magic = ETCHASH_DAG_MAGIC_NUM;
+	header->version = ETCHASH_DAG_FORMAT_VERSION;
+	header->revision = ETCHASH_REVISION;
+	header->seed_hash = *seedhash;
+	header->full_size = file_size;
+	header->flags = 0;
+}
+
+void etchash_io_stripe_header_init(
+	etchash_dag_header_t* header,
+	etchash_h256_t const* seedhash,
+	uint64_t full_size,
+	etchash_io_stripe_t const* stripe
+)
+{
+	etchash_io_header_init(header, seedhash, full_size);
+	header->flags = ETCHASH_DAG_FLAG_STRIPED |
+		(uint64_t)stripe->index << 8 |
+		(uint64_t)stripe->count << 24 |
+		(uint64_t)stripe->chunk_log2 << 40;
+}
+
+bool etchash_io_write_header(FILE* f, etchash_h256_t const* seedhash, uint64_t file_size)
+{
+	etchash_dag_header_t header;
+	etchash_io_header_init(&header, seedhash, file_size);
+	return etchash_io_write_header_ex(f, &header);
+}
+
+bool etchash_io_write_header_ex(FILE* f, etchash_dag_header_t const* header)
+{
+	if (fseek(f, 0, SEEK_SET) != 0) {
+		ETCHASH_CRITICAL("Could not seek to DAG file start to write the header.");
+		return false;
+	}
+	if (fwrite(header, sizeof(*header), 1, f) != 1) {
+		ETCHASH_CRITICAL("Could not write the header to DAG's beginning.");
+		return false;
+	}
+	if (fflush(f) != 0) {
+		ETCHASH_CRITICAL("Could not flush the DAG header. Insufficient space?");
+		return false;
+	}
+	return true;
+}
+
+bool etchash_io_header_size(FILE* f, uint64_t file_size, uint64_t* header_size)
+{
+	size_t found_size;
+	if (!etchash_file_size(f, &found_size)) {
+		return false;
+	}
+	if (found_size == file_size + ETCHASH_DAG_HEADER_SIZE) {
+		*header_size = ETCHASH_DAG_HEADER_SIZE;
+		return true;
+	}
+	if (found_size == file_size + ETCHASH_DAG_MAGIC_NUM_SIZE) {
+		*header_size = ETCHASH_DAG_MAGIC_NUM_SIZE;
+		return true;
+	}
+	return false;
+}
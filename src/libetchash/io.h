@@ -48,6 +48,38 @@ enum etchash_io_rc {
 	ETCHASH_IO_MEMO_MATCH,         ///< DAG file existed and revision/hash matched. No need to do anything
 };
 
+/**
+ * The header of a v2 DAG file. It is stored at the beginning of the file and
+ * padded to ETCHASH_DAG_HEADER_SIZE bytes so that the DAG data which follows it
+ * starts on a page (and therefore cache line) boundary.
+ *
+ * Legacy DAG files only carry the 8 byte ETCHASH_DAG_MAGIC_NUM in front of the
+ * data. They are still accepted for reading.
+ */
+typedef struct etchash_dag_header {
+	uint64_t magic;            ///< ETCHASH_DAG_MAGIC_NUM. Written last, marks a complete DAG
+	uint32_t version;          ///< ETCHASH_DAG_FORMAT_VERSION
+	uint32_t revision;         ///< ETCHASH_REVISION
+	etchash_h256_t seed_hash;  ///< The seedhash of the epoch the DAG belongs to
+	uint64_t full_size;        ///< Size of the DAG data in bytes, excluding the header
+	uint64_t flags;            ///< 0, or the ETCHASH_DAG_FLAG_STRIPED layout of a stripe file
+} etchash_dag_header_t;
+
+/**
+ * The file holds one stripe of a DAG striped over several files: chunks
+ * index, index + count, index + 2 * count... of 2^chunk_log2 bytes, back to
+ * back. Bits 8-23 of the flags hold the index, 24-39 the count and 40-47
+ * chunk_log2, and full_size is the size of the whole DAG.
+ */
+#define ETCHASH_DAG_FLAG_STRIPED 0x1
+
+/// Place of a stripe file in a striped DAG, see @ref ETCHASH_DAG_FLAG_STRIPED
+typedef struct etchash_io_stripe {
+	uint32_t index;
+	uint32_t count;
+	uint32_t chunk_log2;
+} etchash_io_stripe_t;
+
 // small hack for windows. I don't feel I should use va_args and forward just
 // to have this one function properly cross-platform abstracted
 #if defined(_WIN32) && !defined(__GNUC__)
@@ -99,6 +131,79 @@ enum etchash_io_rc etchash_io_prepare(
 	bool force_create
 );
 
+/**
+ * Prepares one stripe file of a striped DAG, like @ref etchash_io_prepare()
+ *
+ * The file is named after the DAG file with the stripe's place appended, and
+ * only matches if its header records the same layout.
+ *
+ * @param[in] full_size      The size of the whole DAG
+ * @param[in] stripe         The place of the stripe
+ * @param[in] file_size      The size of the stripe's data in this file
+ */
+enum etchash_io_rc etchash_io_prepare_stripe(
+	char const* dirname,
+	etchash_h256_t const seedhash,
+	uint64_t full_size,
+	etchash_io_stripe_t const* stripe,
+	FILE** output_file,
+	uint64_t file_size,
+	bool force_create
+);
+
+/**
+ * Fill in the v2 header of a DAG file
+ *
+ * @param[out] header     The header to initialize
+ * @param[in] seedhash    The seedhash of the DAG's epoch
+ * @param[in] file_size   The size of the DAG data, excluding the header
+ */
+void etchash_io_header_init(
+	etchash_dag_header_t* header,
+	etchash_h256_t const* seedhash,
+	uint64_t file_size
+);
+
+/**
+ * Write the v2 header at the beginning of a DAG file, marking it as complete.
+ *
+ * @param f              The open DAG file
+ * @param seedhash       The seedhash of the DAG's epoch
+ * @param file_size      The size of the DAG data, excluding the header
+ * @return               true if the header was written and flushed to the file
+ */
+bool etchash_io_write_header(FILE* f, etchash_h256_t const* seedhash, uint64_t file_size);
+
+/**
+ * Fill in the v2 header of a stripe file
+ *
+ * @param[in] full_size   The size of the whole DAG
+ * @param[in] stripe      The place of the stripe
+ */
+void etchash_io_stripe_header_init(
+	etchash_dag_header_t* header,
+	etchash_h256_t const* seedhash,
+	uint64_t full_size,
+	etchash_io_stripe_t const* stripe
+);
+
+/**
+ * Write a prepared header at the beginning of a DAG or stripe file, see
+ * @ref etchash_io_write_header()
+ */
+bool etchash_io_write_header_ex(FILE* f, etchash_dag_header_t const* header);
+
+/**
+ * Get the size of the header in front of the DAG data of an existing DAG file
+ *
+ * @param[in] f            The open DAG file
+ * @param[in] file_size    The size of the DAG data
+ * @param[out] header_size ETCHASH_DAG_HEADER_SIZE for v2 files or
+ *                         ETCHASH_DAG_MAGIC_NUM_SIZE for legacy files
+ * @return                 false if the file size matches neither layout
+ */
+bool etchash_io_header_size(FILE* f, uint64_t file_size, uint64_t* header_size);
+
 /**
  * An fopen wrapper for no-warnings crossplatform fopen.
  *
@@ -184,6 +289,22 @@ char* etchash_io_create_filename(
  */
 bool etchash_get_default_dirname(char* strbuf, size_t buffsize);
 
+/**
+ * Get a monotonic timestamp, used to report the duration of long computations
+ *
+ * @return             Milliseconds since an unspecified point in the past
+ */
+uint64_t etchash_time_ms(void);
+
+/**
+ * Get the free space of the filesystem holding a directory
+ *
+ * @param[in]  dirname       The directory to query
+ * @param[out] free_bytes    Bytes available to unprivileged users
+ * @return                   true for success and false otherwise
+ */
+bool etchash_disk_free(char const* dirname, uint64_t* free_bytes);
+
 static inline bool etchash_io_mutable_name(
 	uint32_t revision,
 	etchash_h256_t const* seed_hash,
@@ -22,12 +22,14 @@
 #include "io.h"
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/statvfs.h>
 #include <errno.h>
 #include <libgen.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <pwd.h>
+#include <time.h>
 
 FILE* etchash_fopen(char const* file_name, char const* mode)
 {
@@ -109,3 +111,22 @@ bool etchash_get_default_dirname(char* strbuf, size_t buffsize)
 	}
 	return etchash_strncat(strbuf, buffsize, dir_suffix, sizeof(dir_suffix));
 }
+
+uint64_t etchash_time_ms(void)
+{
+	struct timespec ts;
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+		return 0;
+	}
+	return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+bool etchash_disk_free(char const* dirname, uint64_t* free_bytes)
+{
+	struct statvfs st;
+	if (statvfs(dirname, &st) != 0) {
+		return false;
+	}
+	*free_bytes = (uint64_t)st.f_bavail * (uint64_t)st.f_frsize;
+	return true;
+}
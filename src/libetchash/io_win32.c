@@ -98,3 +98,18 @@ bool etchash_get_default_dirname(char* strbuf, size_t buffsize)
 
 	return etchash_strncat(strbuf, buffsize, dir_suffix, sizeof(dir_suffix));
 }
+
+uint64_t etchash_time_ms(void)
+{
+	return (uint64_t)GetTickCount64();
+}
+
+bool etchash_disk_free(char const* dirname, uint64_t* free_bytes)
+{
+	ULARGE_INTEGER available;
+	if (!GetDiskFreeSpaceExA(dirname, &available, NULL, NULL)) {
+		return false;
+	}
+	*free_bytes = (uint64_t)available.QuadPart;
+	return true;
+}
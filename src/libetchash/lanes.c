@@ -0,0 +1,185 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file lanes.c
+ * @date 2026
+ */
+
+#include <string.h>
+#include "lanes.h"
+#include "fnv.h"
+#include "endian.h"
+#include "internal.h"
+
+#ifdef WITH_CRYPTOPP
+#include "sha3_cryptopp.h"
+#else
+#include "sha3.h"
+#endif // WITH_CRYPTOPP
+
+// the AVX-512 code is compiled for its target only, the CPU is checked at runtime
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define ETCHASH_LANES_HAVE_AVX512 1
+#include <immintrin.h>
+#endif
+
+static void lanes_hash_scalar(
+	etchash_full_t full,
+	etchash_h256_t const header_hash,
+	uint64_t const* nonces,
+	etchash_return_value_t* ret
+)
+{
+	for (unsigned l = 0; l != ETCHASH_LANES; ++l) {
+		ret[l] = etchash_full_compute(full, header_hash, nonces[l]);
+	}
+}
+
+#ifdef ETCHASH_LANES_HAVE_AVX512
+
+// x % n in every lane. Exact: the quotient of integers below 2^53 is never
+// rounded across an integer in double precision
+__attribute__((target("avx512f")))
+static inline __m512i lanes_mod(__m512i x, uint32_t n)
+{
+	__m512d const divisor = _mm512_set1_pd((double)n);
+	__m512d lo = _mm512_cvtepu32_pd(_mm512_castsi512_si256(x));
+	__m512d hi = _mm512_cvtepu32_pd(_mm512_extracti64x4_epi64(x, 1));
+	lo = _mm512_roundscale_pd(_mm512_div_pd(lo, divisor), _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+	hi = _mm512_roundscale_pd(_mm512_div_pd(hi, divisor), _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+	__m512i const q = _mm512_inserti64x4(
+		_mm512_castsi256_si512(_mm512_cvttpd_epu32(lo)),
+		_mm512_cvttpd_epu32(hi),
+		1
+	);
+	return _mm512_sub_epi32(x, _mm512_mullo_epi32(q, _mm512_set1_epi32((int)n)));
+}
+
+// etchash_hash() of internal.c with the mix transposed: mix[w] holds word w of every lane
+__attribute__((target("avx512f")))
+static void lanes_hash_avx512(
+	etchash_full_t full,
+	etchash_h256_t const header_hash,
+	uint64_t const* nonces,
+	etchash_return_value_t* ret
+)
+{
+	// per lane seed, followed by the compressed mix for the final Keccak
+	node s_mix[ETCHASH_LANES][2];
+	uint32_t seed_words[NODE_WORDS][ETCHASH_LANES];
+	for (unsigned l = 0; l != ETCHASH_LANES; ++l) {
+		memcpy(s_mix[l][0].bytes, &header_hash, 32);
+		fix_endian64(s_mix[l][0].double_words[4], nonces[l]);
+		SHA3_512(s_mix[l][0].bytes, s_mix[l][0].bytes, 40);
+		fix_endian_arr32(s_mix[l][0].words, 16);
+		for (unsigned w = 0; w != NODE_WORDS; ++w) {
+			seed_words[w][l] = s_mix[l][0].words[w];
+		}
+	}
+
+	__m512i mix[MIX_WORDS];
+	for (unsigned w = 0; w != MIX_WORDS; ++w) {
+		mix[w] = _mm512_loadu_si512(seed_words[w % NODE_WORDS]);
+	}
+	__m512i const s0 = mix[0];
+	__m512i const fnv_prime = _mm512_set1_epi32(FNV_PRIME);
+	__m512i const mix_words = _mm512_set1_epi64(MIX_WORDS);
+	uint32_t const num_full_pages = (uint32_t)(full->file_size / (sizeof(uint32_t) * MIX_WORDS));
+	uint32_t const* const dag = (uint32_t const*)full->data;
+
+	for (unsigned i = 0; i != ETCHASH_ACCESSES; ++i) {
+		__m512i const x = _mm512_xor_si512(
+			_mm512_mullo_epi32(_mm512_xor_si512(s0, _mm512_set1_epi32((int)i)), fnv_prime),
+			mix[i % MIX_WORDS]
+		);
+		__m512i const index = lanes_mod(x, num_full_pages);
+		// first word of each lane's page, 64 bit as large DAGs have more than 2^31 words
+		__m512i const page_lo = _mm512_mul_epu32(_mm512_cvtepu32_epi64(_mm512_castsi512_si256(index)), mix_words);
+		__m512i const page_hi = _mm512_mul_epu32(_mm512_cvtepu32_epi64(_mm512_extracti64x4_epi64(index, 1)), mix_words);
+		for (unsigned w = 0; w != MIX_WORDS; ++w) {
+			__m512i const offset = _mm512_set1_epi64(w);
+			__m256i const lo = _mm512_i64gather_epi32(_mm512_add_epi64(page_lo, offset), dag, 4);
+			__m256i const hi = _mm512_i64gather_epi32(_mm512_add_epi64(page_hi, offset), dag, 4);
+			__m512i const dag_words = _mm512_inserti64x4(_mm512_castsi256_si512(lo), hi, 1);
+			mix[w] = _mm512_xor_si512(_mm512_mullo_epi32(mix[w], fnv_prime), dag_words);
+		}
+	}
+
+	// compress mix
+	uint32_t cmix[MIX_WORDS / 4][ETCHASH_LANES];
+	for (unsigned w = 0; w != MIX_WORDS; w += 4) {
+		__m512i reduction = mix[w + 0];
+		reduction = _mm512_xor_si512(_mm512_mullo_epi32(reduction, fnv_prime), mix[w + 1]);
+		reduction = _mm512_xor_si512(_mm512_mullo_epi32(reduction, fnv_prime), mix[w + 2]);
+		reduction = _mm512_xor_si512(_mm512_mullo_epi32(reduction, fnv_prime), mix[w + 3]);
+		_mm512_storeu_si512(cmix[w / 4], reduction);
+	}
+
+	for (unsigned l = 0; l != ETCHASH_LANES; ++l) {
+		node* const compressed = &s_mix[l][1];
+		for (unsigned w = 0; w != MIX_WORDS / 4; ++w) {
+			compressed->words[w] = cmix[w][l];
+		}
+		fix_endian_arr32(compressed->words, MIX_WORDS / 4);
+		memcpy(&ret[l].mix_hash, compressed->bytes, 32);
+		// final Keccak hash
+		SHA3_256(&ret[l].result, s_mix[l][0].bytes, 64 + 32);
+		ret[l].success = true;
+	}
+}
+
+#endif // ETCHASH_LANES_HAVE_AVX512
+
+etchash_lanes_impl_t etchash_lanes_impl(void)
+{
+#ifdef ETCHASH_LANES_HAVE_AVX512
+	if (__builtin_cpu_supports("avx512f")) {
+		return ETCHASH_LANES_AVX512;
+	}
+#endif
+	return ETCHASH_LANES_SCALAR;
+}
+
+void etchash_full_compute_lanes_ex(
+	etchash_full_t full,
+	etchash_h256_t const header_hash,
+	uint64_t const* nonces,
+	etchash_return_value_t* ret,
+	etchash_lanes_impl_t impl
+)
+{
+#ifdef ETCHASH_LANES_HAVE_AVX512
+	// traces are recorded by the scalar code only
+	if (impl == ETCHASH_LANES_AVX512 && etchash_lanes_impl() == ETCHASH_LANES_AVX512 &&
+		!full->trace && full->file_size % MIX_WORDS == 0) {
+		lanes_hash_avx512(full, header_hash, nonces, ret);
+		return;
+	}
+#else
+	(void)impl;
+#endif
+	lanes_hash_scalar(full, header_hash, nonces, ret);
+}
+
+void etchash_full_compute_lanes(
+	etchash_full_t full,
+	etchash_h256_t const header_hash,
+	uint64_t const* nonces,
+	etchash_return_value_t* ret
+)
+{
+	etchash_full_compute_lanes_ex(full, header_hash, nonces, ret, etchash_lanes_impl());
+}
@@ -0,0 +1,81 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file lanes.h
+ * @date 2026
+ *
+ * Full mode hashing of 16 nonces at once, one nonce per SIMD lane.
+ *
+ * With AVX-512 the 32 mix words of the 16 nonces are kept in vector registers,
+ * the page indices and FNV mixing are computed 16 wide and the DAG words of all
+ * lanes are fetched with gathers, so one core has 16 DAG reads in flight where
+ * the one nonce at a time loop has one. The Keccak steps stay scalar per lane.
+ * Without AVX-512 the same interface hashes the nonces one after another.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "etchash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ETCHASH_LANES 16
+
+typedef enum etchash_lanes_impl {
+	ETCHASH_LANES_SCALAR = 0,
+	ETCHASH_LANES_AVX512,
+} etchash_lanes_impl_t;
+
+/**
+ * The implementation @ref etchash_full_compute_lanes() uses on this CPU
+ */
+etchash_lanes_impl_t etchash_lanes_impl(void);
+
+/**
+ * Hash ETCHASH_LANES nonces with the full DAG, bit exact with
+ * @ref etchash_full_compute() for each of them
+ *
+ * DAGs that record an access trace are hashed with the scalar implementation.
+ *
+ * @param full           The full client handler
+ * @param header_hash    The header hash to pack into the mix
+ * @param nonces         ETCHASH_LANES nonces
+ * @param[out] ret       ETCHASH_LANES results, in the order of @a nonces
+ */
+void etchash_full_compute_lanes(
+	etchash_full_t full,
+	etchash_h256_t const header_hash,
+	uint64_t const* nonces,
+	etchash_return_value_t* ret
+);
+
+/**
+ * Like @ref etchash_full_compute_lanes() with a given implementation, which
+ * falls back to the scalar one if the CPU lacks it. Mostly for tests.
+ */
+void etchash_full_compute_lanes_ex(
+	etchash_full_t full,
+	etchash_h256_t const header_hash,
+	uint64_t const* nonces,
+	etchash_return_value_t* ret,
+	etchash_lanes_impl_t impl
+);
+
+#ifdef __cplusplus
+}
+#endif
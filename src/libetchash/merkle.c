@@ -0,0 +1,445 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file merkle.c
+ * @date 2026
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "merkle.h"
+#include "internal.h"
+#include "pool.h"
+#include "thread.h"
+#include "io.h"
+
+#ifdef WITH_CRYPTOPP
+
+#include "sha3_cryptopp.h"
+
+#else
+#include "sha3.h"
+#endif // WITH_CRYPTOPP
+
+#define MERKLE_FILE_VERSION 1
+
+struct etchash_merkle_tree {
+	uint64_t full_size;
+	uint64_t num_leaves;
+	uint32_t depth;       // number of levels above the leaves
+	uint32_t base_level;  // lowest level kept in memory
+	uint64_t num_nodes;
+	etchash_h256_t* nodes;  // the kept levels, base_level first
+	uint64_t offsets[ETCHASH_MERKLE_MAX_DEPTH + 1];  // start of each kept level in nodes
+	etchash_h256_t zeros[ETCHASH_MERKLE_MAX_DEPTH + 1];  // nodes that only cover padding
+	uint64_t volatile covered;  // bottom kept level nodes hashed by etchash_merkle_chunk_hook()
+};
+
+typedef struct merkle_file_header {
+	uint64_t magic;
+	uint32_t version;
+	uint32_t revision;
+	etchash_h256_t seed_hash;
+	uint64_t full_size;
+	uint32_t depth;
+	uint32_t base_level;
+	uint64_t num_nodes;
+} merkle_file_header_t;
+
+static void merkle_hash_pair(
+	etchash_h256_t* ret,
+	etchash_h256_t const* left,
+	etchash_h256_t const* right
+)
+{
+	uint8_t buf[64];
+	memcpy(buf, left, 32);
+	memcpy(buf + 32, right, 32);
+	SHA3_256(ret, buf, 64);
+}
+
+static uint64_t merkle_level_count(struct etchash_merkle_tree const* tree, uint32_t level)
+{
+	return (tree->num_leaves + ((uint64_t)1 << level) - 1) >> level;
+}
+
+static etchash_h256_t const* merkle_node(
+	struct etchash_merkle_tree const* tree,
+	uint32_t level,
+	uint64_t index
+)
+{
+	if (index >= merkle_level_count(tree, level)) {
+		return &tree->zeros[level];
+	}
+	return &tree->nodes[tree->offsets[level] + index];
+}
+
+// Computes node @a index of @a level (at most base_level) from the DAG pages below it.
+// If @a branch is given the siblings on the path of @a leaf are stored in it.
+static void merkle_subtree(
+	struct etchash_merkle_tree const* tree,
+	uint8_t const* data,
+	uint32_t level,
+	uint64_t index,
+	uint64_t leaf,
+	etchash_h256_t* branch,
+	etchash_h256_t* ret
+)
+{
+	etchash_h256_t hashes[1 << ETCHASH_MERKLE_SUBTREE_LEVELS];
+	uint64_t const first = index << level;
+	uint32_t width = 1U << level;
+	for (uint32_t i = 0; i != width; ++i) {
+		if (first + i < tree->num_leaves) {
+			SHA3_256(&hashes[i], data + (first + i) * ETCHASH_MIX_BYTES, ETCHASH_MIX_BYTES);
+		} else {
+			etchash_h256_reset(&hashes[i]);
+		}
+	}
+	uint32_t pos = (uint32_t)(leaf - first);
+	for (uint32_t l = 0; l != level; ++l) {
+		if (branch) {
+			branch[l] = hashes[pos ^ 1];
+			pos >>= 1;
+		}
+		width >>= 1;
+		for (uint32_t i = 0; i != width; ++i) {
+			merkle_hash_pair(&hashes[i], &hashes[2 * i], &hashes[2 * i + 1]);
+		}
+	}
+	*ret = hashes[0];
+}
+
+static struct etchash_merkle_tree* merkle_tree_alloc(uint64_t full_size)
+{
+	if (full_size == 0 || full_size % ETCHASH_MIX_BYTES != 0) {
+		return NULL;
+	}
+	struct etchash_merkle_tree* tree = calloc(sizeof(*tree), 1);
+	if (!tree) {
+		return NULL;
+	}
+	tree->full_size = full_size;
+	tree->num_leaves = full_size / ETCHASH_MIX_BYTES;
+	while (((uint64_t)1 << tree->depth) < tree->num_leaves) {
+		tree->depth++;
+	}
+	tree->base_level = tree->depth < ETCHASH_MERKLE_SUBTREE_LEVELS ? tree->depth : ETCHASH_MERKLE_SUBTREE_LEVELS;
+	for (uint32_t l = tree->base_level; l <= tree->depth; ++l) {
+		tree->offsets[l] = tree->num_nodes;
+		tree->num_nodes += merkle_level_count(tree, l);
+	}
+	etchash_h256_reset(&tree->zeros[0]);
+	for (uint32_t l = 1; l <= tree->depth; ++l) {
+		merkle_hash_pair(&tree->zeros[l], &tree->zeros[l - 1], &tree->zeros[l - 1]);
+	}
+	tree->nodes = malloc((size_t)(tree->num_nodes * sizeof(etchash_h256_t)));
+	if (!tree->nodes) {
+		free(tree);
+		return NULL;
+	}
+	return tree;
+}
+
+typedef struct merkle_build_job {
+	struct etchash_merkle_tree* tree;
+	uint8_t const* data;
+} merkle_build_job_t;
+
+static bool merkle_build_range(void* arg, uint64_t first, uint64_t last)
+{
+	merkle_build_job_t const* job = (merkle_build_job_t const*)arg;
+	struct etchash_merkle_tree* tree = job->tree;
+	etchash_h256_t* level = &tree->nodes[tree->offsets[tree->base_level]];
+	for (uint64_t i = first; i != last; ++i) {
+		merkle_subtree(tree, job->data, tree->base_level, i, 0, NULL, &level[i]);
+	}
+	return true;
+}
+
+// hashes the levels above the bottom kept level
+static void merkle_build_upper(struct etchash_merkle_tree* tree)
+{
+	for (uint32_t l = tree->base_level + 1; l <= tree->depth; ++l) {
+		uint64_t const n = merkle_level_count(tree, l);
+		for (uint64_t i = 0; i != n; ++i) {
+			merkle_hash_pair(
+				&tree->nodes[tree->offsets[l] + i],
+				merkle_node(tree, l - 1, 2 * i),
+				merkle_node(tree, l - 1, 2 * i + 1)
+			);
+		}
+	}
+}
+
+// hashes the bottom kept level from the whole DAG
+static void merkle_build_base(struct etchash_merkle_tree* tree, uint8_t const* dag, bool parallel)
+{
+	merkle_build_job_t job = { tree, dag };
+	uint64_t const count = merkle_level_count(tree, tree->base_level);
+
+	// the bottom kept level is where nearly all the hashing happens, spread it
+	// on the pool in a few chunks per thread so that stealing evens them out
+	if (!parallel) {
+		merkle_build_range(&job, 0, count);
+	} else {
+		uint64_t grain = count / (8 * (uint64_t)etchash_pool_concurrency());
+		etchash_parallel_for_kind(ETCHASH_WORK_COMPUTE, count, grain ? grain : 1, merkle_build_range, &job);
+	}
+}
+
+etchash_merkle_tree_t etchash_merkle_tree_build(etchash_full_t full, bool parallel)
+{
+	struct etchash_merkle_tree* tree = merkle_tree_alloc(etchash_full_dag_size(full));
+	if (!tree) {
+		return NULL;
+	}
+	merkle_build_base(tree, (uint8_t const*)etchash_full_dag(full), parallel);
+	merkle_build_upper(tree);
+	return tree;
+}
+
+etchash_merkle_tree_t etchash_merkle_tree_begin(uint64_t full_size)
+{
+	return merkle_tree_alloc(full_size);
+}
+
+int etchash_merkle_chunk_hook(etchash_chunk_t const* chunk, void* user)
+{
+	struct etchash_merkle_tree* tree = (struct etchash_merkle_tree*)user;
+	// DAG nodes under one node of the bottom kept level
+	uint64_t const span = ((uint64_t)ETCHASH_MIX_BYTES / ETCHASH_HASH_BYTES) << tree->base_level;
+	if (chunk->first_node % span != 0) {
+		ETCHASH_CRITICAL("DAG chunk at node %llu is not aligned to the merkle tree.", (unsigned long long)chunk->first_node);
+		return 1;
+	}
+	merkle_build_job_t job = {
+		tree,
+		(uint8_t const*)chunk->data - chunk->first_node * ETCHASH_HASH_BYTES
+	};
+	uint64_t const count = merkle_level_count(tree, tree->base_level);
+	uint64_t const last = (chunk->end_node + span - 1) / span;
+	uint64_t const first = chunk->first_node / span;
+	uint64_t const end = last < count ? last : count;
+	merkle_build_range(&job, first, end);
+	etchash_atomic_add_u64(&tree->covered, end - first);
+	return 0;
+}
+
+bool etchash_merkle_tree_finish(etchash_merkle_tree_t tree, etchash_full_t full)
+{
+	uint64_t const count = merkle_level_count(tree, tree->base_level);
+	uint64_t const covered = etchash_atomic_load_u64(&tree->covered);
+	if (covered != count) {
+		// not every chunk was hooked, as for a DAG loaded from disk
+		if (!full || etchash_full_dag_size(full) != tree->full_size) {
+			ETCHASH_CRITICAL(
+				"The hooked DAG chunks cover %llu of %llu merkle tree nodes.",
+				(unsigned long long)covered, (unsigned long long)count
+			);
+			return false;
+		}
+		merkle_build_base(tree, (uint8_t const*)etchash_full_dag(full), true);
+	}
+	merkle_build_upper(tree);
+	return true;
+}
+
+static char* merkle_file_name(char const* dirname, etchash_h256_t const* seed_hash)
+{
+	char mutable_name[DAG_MUTABLE_NAME_MAX_SIZE];
+	char name[DAG_MUTABLE_NAME_MAX_SIZE + 7];
+	if (!etchash_io_mutable_name(ETCHASH_REVISION, seed_hash, mutable_name)) {
+		return NULL;
+	}
+	snprintf(name, sizeof(name), "merkle-%s", mutable_name);
+	return etchash_io_create_filename(dirname, name, strlen(name));
+}
+
+bool etchash_merkle_tree_save(
+	etchash_merkle_tree_t tree,
+	char const* dirname,
+	etchash_h256_t const* seed_hash
+)
+{
+	bool ret = false;
+	if (!etchash_mkdir(dirname)) {
+		ETCHASH_CRITICAL("Could not create the etchash directory");
+		return false;
+	}
+	char* filename = merkle_file_name(dirname, seed_hash);
+	if (!filename) {
+		return false;
+	}
+	FILE* f = etchash_fopen(filename, "wb");
+	if (!f) {
+		ETCHASH_CRITICAL("Could not create merkle tree file: \"%s\"", filename);
+		goto free_name;
+	}
+	merkle_file_header_t header;
+	memset(&header, 0, sizeof(header));
+	header.version = MERKLE_FILE_VERSION;
+	header.revision = ETCHASH_REVISION;
+	header.seed_hash = *seed_hash;
+	header.full_size = tree->full_size;
+	header.depth = tree->depth;
+	header.base_level = tree->base_level;
+	header.num_nodes = tree->num_nodes;
+	// as with the DAG the magic number is written last to mark a complete file
+	if (fwrite(&header, sizeof(header), 1, f) != 1 ||
+		fwrite(tree->nodes, sizeof(etchash_h256_t), (size_t)tree->num_nodes, f) != tree->num_nodes) {
+		ETCHASH_CRITICAL("Could not write merkle tree file: \"%s\". Insufficient space?", filename);
+		goto close_file;
+	}
+	header.magic = ETCHASH_MERKLE_MAGIC_NUM;
+	if (fseek(f, 0, SEEK_SET) != 0 ||
+		fwrite(&header, sizeof(header), 1, f) != 1 ||
+		fflush(f) != 0) {
+		ETCHASH_CRITICAL("Could not finalize merkle tree file: \"%s\"", filename);
+		goto close_file;
+	}
+	ret = true;
+
+close_file:
+	fclose(f);
+free_name:
+	free(filename);
+	return ret;
+}
+
+etchash_merkle_tree_t etchash_merkle_tree_load(
+	char const* dirname,
+	etchash_h256_t const* seed_hash,
+	uint64_t full_size
+)
+{
+	char* filename = merkle_file_name(dirname, seed_hash);
+	if (!filename) {
+		return NULL;
+	}
+	FILE* f = etchash_fopen(filename, "rb");
+	free(filename);
+	if (!f) {
+		return NULL;
+	}
+	struct etchash_merkle_tree* tree = merkle_tree_alloc(full_size);
+	if (!tree) {
+		goto close_file;
+	}
+	merkle_file_header_t header;
+	if (fread(&header, sizeof(header), 1, f) != 1 ||
+		header.magic != ETCHASH_MERKLE_MAGIC_NUM ||
+		header.version != MERKLE_FILE_VERSION ||
+		header.revision != ETCHASH_REVISION ||
+		memcmp(&header.seed_hash, seed_hash, sizeof(*seed_hash)) != 0 ||
+		header.full_size != full_size ||
+		header.depth != tree->depth ||
+		header.base_level != tree->base_level ||
+		header.num_nodes != tree->num_nodes ||
+		fread(tree->nodes, sizeof(etchash_h256_t), (size_t)tree->num_nodes, f) != tree->num_nodes) {
+		etchash_merkle_tree_delete(tree);
+		tree = NULL;
+	}
+
+close_file:
+	fclose(f);
+	return tree;
+}
+
+etchash_merkle_tree_t etchash_merkle_tree_new(
+	etchash_full_t full,
+	char const* dirname,
+	etchash_h256_t const* seed_hash,
+	bool parallel
+)
+{
+	etchash_merkle_tree_t tree = etchash_merkle_tree_load(dirname, seed_hash, etchash_full_dag_size(full));
+	if (tree) {
+		return tree;
+	}
+	tree = etchash_merkle_tree_build(full, parallel);
+	if (tree && !etchash_merkle_tree_save(tree, dirname, seed_hash)) {
+		// not having the on-disk cache only costs a rebuild next time
+		ETCHASH_CRITICAL("Could not store the merkle tree of the DAG");
+	}
+	return tree;
+}
+
+void etchash_merkle_tree_delete(etchash_merkle_tree_t tree)
+{
+	free(tree->nodes);
+	free(tree);
+}
+
+etchash_h256_t etchash_merkle_tree_root(etchash_merkle_tree_t tree)
+{
+	return *merkle_node(tree, tree->depth, 0);
+}
+
+etchash_return_value_t etchash_full_compute_with_proof(
+	etchash_full_t full,
+	etchash_merkle_tree_t tree,
+	etchash_h256_t const header_hash,
+	uint64_t nonce,
+	etchash_access_proof_t* proof
+)
+{
+	etchash_return_value_t ret;
+	if (tree->full_size != etchash_full_dag_size(full)) {
+		memset(&ret, 0, sizeof(ret));
+		ret.success = false;
+		return ret;
+	}
+	ret = etchash_full_compute_indices(full, header_hash, nonce, proof->indices);
+	if (!ret.success) {
+		return ret;
+	}
+	uint8_t const* data = (uint8_t const*)etchash_full_dag(full);
+	proof->depth = tree->depth;
+	for (unsigned i = 0; i != ETCHASH_ACCESSES; ++i) {
+		uint64_t const page = proof->indices[i];
+		etchash_h256_t* branch = proof->branches[i];
+		etchash_h256_t subtree_root;
+		memcpy(proof->pages[i], data + page * ETCHASH_MIX_BYTES, ETCHASH_MIX_BYTES);
+		merkle_subtree(tree, data, tree->base_level, page >> tree->base_level, page, branch, &subtree_root);
+		for (uint32_t l = tree->base_level; l != tree->depth; ++l) {
+			branch[l] = *merkle_node(tree, l, (page >> l) ^ 1);
+		}
+	}
+	return ret;
+}
+
+bool etchash_merkle_verify(
+	etchash_h256_t const* root,
+	uint8_t const* page,
+	uint32_t index,
+	etchash_h256_t const* branch,
+	uint32_t depth
+)
+{
+	etchash_h256_t hash;
+	etchash_h256_reset(&hash);
+	SHA3_256(&hash, page, ETCHASH_MIX_BYTES);
+	for (uint32_t l = 0; l != depth; ++l) {
+		if ((index >> l) & 1) {
+			merkle_hash_pair(&hash, &branch[l], &hash);
+		} else {
+			merkle_hash_pair(&hash, &hash, &branch[l]);
+		}
+	}
+	return memcmp(&hash, root, sizeof(hash)) == 0;
+}
@@ -0,0 +1,191 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file merkle.h
+ * @date 2026
+ *
+ * Merkle tree over the pages of a full DAG and proofs of the pages a hash accessed.
+ *
+ * The leaves of the tree are the Keccak-256 hashes of the ETCHASH_MIX_BYTES sized
+ * DAG pages, in the byte order in which they are stored in memory. Each inner
+ * node is the Keccak-256 hash of the concatenation of its two children. The
+ * number of leaves is padded to the next power of two with leaves made of 32 zero
+ * bytes, so every branch has the same depth.
+ *
+ * Only the upper levels of the tree are kept. The lowest
+ * ETCHASH_MERKLE_SUBTREE_LEVELS levels are recomputed from the DAG when a proof
+ * is generated, which keeps the tree at 1/64th of the size of the DAG.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "etchash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ETCHASH_MERKLE_MAX_DEPTH 40
+#define ETCHASH_MERKLE_SUBTREE_LEVELS 6
+#define ETCHASH_MERKLE_MAGIC_NUM 0xFEE1DEADBADDC0DE
+
+struct etchash_merkle_tree;
+typedef struct etchash_merkle_tree* etchash_merkle_tree_t;
+
+/// The DAG pages accessed by a hash together with their merkle branches
+typedef struct etchash_access_proof {
+	uint32_t depth;                                    ///< Number of valid entries in each branch
+	uint32_t indices[ETCHASH_ACCESSES];                ///< Accessed page of each round, in order
+	uint8_t pages[ETCHASH_ACCESSES][ETCHASH_MIX_BYTES];///< The contents of those pages
+	/// Sibling hashes from the leaf level up to just below the root
+	etchash_h256_t branches[ETCHASH_ACCESSES][ETCHASH_MERKLE_MAX_DEPTH];
+} etchash_access_proof_t;
+
+/**
+ * Build the merkle tree of a full DAG
+ *
+ * @param full         The full client handler holding the DAG
+ * @param parallel     true to spread the hashing on the library pool (see
+ *                     pool.h), whose concurrency sets the thread count, false
+ *                     to hash the DAG on the calling thread
+ * @return             The newly allocated tree or NULL for ERRNOMEM
+ */
+etchash_merkle_tree_t etchash_merkle_tree_build(etchash_full_t full, bool parallel);
+
+/**
+ * Allocate a merkle tree to be built while its DAG is generated
+ *
+ * Pass @ref etchash_merkle_chunk_hook() and the tree as the chunk hook of
+ * @ref etchash_full_new_ex(), which hashes the DAG pages while they are still
+ * in cache, then call @ref etchash_merkle_tree_finish().
+ *
+ * @param full_size    The size of the DAG in bytes
+ * @return             The newly allocated tree or NULL for ERRNOMEM
+ */
+etchash_merkle_tree_t etchash_merkle_tree_begin(uint64_t full_size);
+
+/**
+ * Hash the pages of a freshly written DAG chunk into a tree from
+ * @ref etchash_merkle_tree_begin(). Chunks may be hooked concurrently.
+ *
+ * @param chunk        The chunk, starting at a multiple of ETCHASH_CHUNK_ALIGN_NODES
+ * @param user         The tree
+ * @return             0, or 1 to stop the generation if the chunk is not aligned
+ */
+int etchash_merkle_chunk_hook(etchash_chunk_t const* chunk, void* user);
+
+/**
+ * Complete a tree from @ref etchash_merkle_tree_begin() once its DAG is ready
+ *
+ * No chunk is hooked for a DAG loaded from disk, and a generation may stop
+ * part way. The tree then hashes the pages from @a full instead, if given.
+ *
+ * @param tree         The tree
+ * @param full         The DAG that was generated, or NULL
+ * @return             false if the hooked chunks do not cover the DAG and
+ *                     @a full is NULL or of another size. The tree is
+ *                     unusable then.
+ */
+bool etchash_merkle_tree_finish(etchash_merkle_tree_t tree, etchash_full_t full);
+
+/**
+ * Load the merkle tree of a DAG from the on-disk cache, building and storing it
+ * if it is not there yet
+ *
+ * @param full         The full client handler holding the DAG
+ * @param dirname      The directory of the tree cache, normally the DAG directory
+ * @param seed_hash    The seed hash of the DAG's epoch, used in the file naming
+ * @param parallel     false to build the tree on the calling thread, see
+ *                     etchash_merkle_tree_build()
+ * @return             The tree or NULL for ERRNOMEM
+ */
+etchash_merkle_tree_t etchash_merkle_tree_new(
+	etchash_full_t full,
+	char const* dirname,
+	etchash_h256_t const* seed_hash,
+	bool parallel
+);
+
+/**
+ * Store a merkle tree in the on-disk cache
+ *
+ * @return             true if the tree was written to disk
+ */
+bool etchash_merkle_tree_save(
+	etchash_merkle_tree_t tree,
+	char const* dirname,
+	etchash_h256_t const* seed_hash
+);
+
+/**
+ * Load a merkle tree from the on-disk cache
+ *
+ * @param full_size    The size of the DAG the tree must belong to
+ * @return             The tree or NULL if there is no valid cached tree
+ */
+etchash_merkle_tree_t etchash_merkle_tree_load(
+	char const* dirname,
+	etchash_h256_t const* seed_hash,
+	uint64_t full_size
+);
+
+void etchash_merkle_tree_delete(etchash_merkle_tree_t tree);
+
+/**
+ * Get the merkle root of the DAG
+ */
+etchash_h256_t etchash_merkle_tree_root(etchash_merkle_tree_t tree);
+
+/**
+ * Calculate the full client data and prove the DAG pages it accessed
+ *
+ * @param full           The full client handler the tree was built from
+ * @param tree           The merkle tree of @a full
+ * @param header_hash    The header hash to pack into the mix
+ * @param nonce          The nonce to pack into the mix
+ * @param[out] proof     Receives the accessed pages and their branches
+ * @return               The result of the hash. success is false if the tree
+ *                       does not belong to the DAG
+ */
+etchash_return_value_t etchash_full_compute_with_proof(
+	etchash_full_t full,
+	etchash_merkle_tree_t tree,
+	etchash_h256_t const header_hash,
+	uint64_t nonce,
+	etchash_access_proof_t* proof
+);
+
+/**
+ * Check the merkle branch of a single DAG page
+ *
+ * @param root       The merkle root of the DAG
+ * @param page       The ETCHASH_MIX_BYTES bytes of the page
+ * @param index      The index of the page in the DAG
+ * @param branch     The sibling hashes, leaf level first
+ * @param depth      The number of hashes in @a branch
+ * @return           true if the page is part of the DAG with the given root
+ */
+bool etchash_merkle_verify(
+	etchash_h256_t const* root,
+	uint8_t const* page,
+	uint32_t index,
+	etchash_h256_t const* branch,
+	uint32_t depth
+);
+
+#ifdef __cplusplus
+}
+#endif
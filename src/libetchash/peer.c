@@ -0,0 +1,545 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file peer.c
+ * @date 2026
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "peer.h"
+#include "internal.h"
+#include "io.h"
+
+bool etchash_peer_verify(
+	void const* data,
+	uint64_t full_size,
+	etchash_light_t const light,
+	uint32_t samples
+)
+{
+	uint64_t const num_items = full_size / sizeof(node);
+	if (!num_items) {
+		return false;
+	}
+	if (!samples) {
+		samples = ETCHASH_PEER_DEFAULT_SAMPLES;
+	}
+	node const* items = (node const*)data;
+	uint64_t state = etchash_time_ms() ^ (uint64_t)(uintptr_t)data ^ 0x9e3779b97f4a7c15ULL;
+	for (uint32_t i = 0; i < samples; ++i) {
+		uint64_t index;
+		if (i == 0) {
+			index = 0;
+		} else if (i == 1) {
+			index = num_items - 1;
+		} else {
+			// xorshift64
+			state ^= state << 13;
+			state ^= state >> 7;
+			state ^= state << 17;
+			index = state % num_items;
+		}
+		node expected;
+		etchash_calculate_dag_item(&expected, (uint32_t)index, light);
+		if (memcmp(&expected, &items[index], sizeof(node)) != 0) {
+			ETCHASH_CRITICAL("DAG item %llu received from a peer does not match the cache", (unsigned long long)index);
+			return false;
+		}
+	}
+	return true;
+}
+
+#if defined(_WIN32)
+
+etchash_peer_server_t etchash_peer_server_new(char const* address, char const* dirname)
+{
+	(void)address;
+	(void)dirname;
+	ETCHASH_CRITICAL("Peer DAG transfer is not supported on this platform");
+	return NULL;
+}
+
+void etchash_peer_server_delete(etchash_peer_server_t server)
+{
+	(void)server;
+}
+
+bool etchash_peer_fetch(
+	char const* address,
+	etchash_h256_t const* seed_hash,
+	uint64_t full_size,
+	etchash_light_t const light,
+	void* data,
+	uint32_t samples
+)
+{
+	(void)address;
+	(void)seed_hash;
+	(void)full_size;
+	(void)light;
+	(void)data;
+	(void)samples;
+	return false;
+}
+
+#else
+
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include "thread.h"
+
+#if defined(MSG_NOSIGNAL)
+#define PEER_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define PEER_SEND_FLAGS 0
+#endif
+
+#define PEER_CHUNK_SIZE (1024 * 1024)
+#define PEER_POLL_MS 100
+#define PEER_TIMEOUT_S 30
+#define PEER_MAX_CONNECTIONS 8
+
+enum peer_status {
+	PEER_STATUS_OK = 0,
+	PEER_STATUS_NOT_FOUND = 1,
+	PEER_STATUS_BAD_REQUEST = 2,
+};
+
+typedef struct peer_request {
+	uint64_t magic;
+	uint32_t version;
+	uint32_t revision;
+	etchash_h256_t seed_hash;
+	uint64_t full_size;
+} peer_request_t;
+
+typedef struct peer_response {
+	uint64_t magic;
+	uint32_t status;
+	uint32_t reserved;
+	uint64_t full_size;
+} peer_response_t;
+
+// a connection served on its own thread, so that a slow client does not hold up the others
+struct peer_connection {
+	struct etchash_peer_server* server;
+	etchash_thread_t thread;
+	int fd;
+	bool running;                 // has a thread that is not joined yet, owned by the accept thread
+	bool done;                    // the thread finished serving, guarded by the server mutex
+};
+
+struct etchash_peer_server {
+	int fd;
+	char unix_path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+	char* dirname;
+	etchash_thread_t thread;
+	etchash_mutex_t mutex;
+	etchash_cond_t connection_done;
+	struct peer_connection connections[PEER_MAX_CONNECTIONS];
+	bool stop;
+};
+
+// resolves an address into a socket address, false for unknown formats
+static bool peer_resolve(
+	char const* address,
+	struct sockaddr_storage* addr,
+	socklen_t* addr_len,
+	int* family
+)
+{
+	memset(addr, 0, sizeof(*addr));
+	if (strncmp(address, "unix:", 5) == 0) {
+		struct sockaddr_un* un = (struct sockaddr_un*)addr;
+		size_t len = strlen(address + 5);
+		if (len == 0 || len >= sizeof(un->sun_path)) {
+			return false;
+		}
+		un->sun_family = AF_UNIX;
+		memcpy(un->sun_path, address + 5, len + 1);
+		*addr_len = (socklen_t)sizeof(*un);
+		*family = AF_UNIX;
+		return true;
+	}
+	if (strncmp(address, "tcp:", 4) != 0) {
+		return false;
+	}
+	char host[256];
+	char const* port = strrchr(address + 4, ':');
+	size_t host_len = port ? (size_t)(port - (address + 4)) : 0;
+	if (!port || host_len == 0 || host_len >= sizeof(host)) {
+		return false;
+	}
+	memcpy(host, address + 4, host_len);
+	host[host_len] = '\0';
+	struct addrinfo hints;
+	struct addrinfo* res;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(host, port + 1, &hints, &res) != 0) {
+		return false;
+	}
+	memcpy(addr, res->ai_addr, res->ai_addrlen);
+	*addr_len = res->ai_addrlen;
+	*family = res->ai_family;
+	freeaddrinfo(res);
+	return true;
+}
+
+static bool peer_send_all(int fd, void const* buf, size_t len)
+{
+	char const* p = (char const*)buf;
+	while (len) {
+		ssize_t n = send(fd, p, len, PEER_SEND_FLAGS);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return false;
+		}
+		p += n;
+		len -= (size_t)n;
+	}
+	return true;
+}
+
+static bool peer_recv_all(int fd, void* buf, size_t len)
+{
+	char* p = (char*)buf;
+	while (len) {
+		ssize_t n = recv(fd, p, len, 0);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return false;
+		}
+		p += n;
+		len -= (size_t)n;
+	}
+	return true;
+}
+
+static void peer_set_timeout(int fd)
+{
+	struct timeval tv;
+	tv.tv_sec = PEER_TIMEOUT_S;
+	tv.tv_usec = 0;
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+static bool peer_server_stopping(struct etchash_peer_server* server)
+{
+	etchash_mutex_lock(&server->mutex);
+	bool stop = server->stop;
+	etchash_mutex_unlock(&server->mutex);
+	return stop;
+}
+
+// opens the DAG file for a request if it is complete and its header matches
+static FILE* peer_open_dag(char const* dirname, peer_request_t const* request)
+{
+	char mutable_name[DAG_MUTABLE_NAME_MAX_SIZE];
+	etchash_io_mutable_name(ETCHASH_REVISION, &request->seed_hash, mutable_name);
+	char* name = etchash_io_create_filename(dirname, mutable_name, strlen(mutable_name));
+	if (!name) {
+		return NULL;
+	}
+	FILE* f = etchash_fopen(name, "rb");
+	free(name);
+	if (!f) {
+		return NULL;
+	}
+	size_t found_size;
+	etchash_dag_header_t header;
+	etchash_dag_header_t expected;
+	etchash_io_header_init(&expected, &request->seed_hash, request->full_size);
+	if (!etchash_file_size(f, &found_size) ||
+		found_size != request->full_size + ETCHASH_DAG_HEADER_SIZE ||
+		fread(&header, sizeof(header), 1, f) != 1 ||
+		memcmp(&header, &expected, sizeof(header)) != 0 ||
+		fseek(f, ETCHASH_DAG_HEADER_SIZE, SEEK_SET) != 0) {
+		fclose(f);
+		return NULL;
+	}
+	return f;
+}
+
+static void peer_serve(struct etchash_peer_server* server, int fd, char* buf)
+{
+	peer_request_t request;
+	peer_response_t response;
+	memset(&response, 0, sizeof(response));
+	response.magic = ETCHASH_PEER_MAGIC;
+	if (!peer_recv_all(fd, &request, sizeof(request))) {
+		return;
+	}
+	if (request.magic != ETCHASH_PEER_MAGIC || request.version != ETCHASH_PEER_VERSION ||
+		request.revision != ETCHASH_REVISION) {
+		response.status = PEER_STATUS_BAD_REQUEST;
+		peer_send_all(fd, &response, sizeof(response));
+		return;
+	}
+	FILE* f = peer_open_dag(server->dirname, &request);
+	if (!f) {
+		response.status = PEER_STATUS_NOT_FOUND;
+		peer_send_all(fd, &response, sizeof(response));
+		return;
+	}
+	response.status = PEER_STATUS_OK;
+	response.full_size = request.full_size;
+	if (peer_send_all(fd, &response, sizeof(response))) {
+		uint64_t left = request.full_size;
+		while (left && !peer_server_stopping(server)) {
+			size_t chunk = left < PEER_CHUNK_SIZE ? (size_t)left : PEER_CHUNK_SIZE;
+			if (fread(buf, 1, chunk, f) != chunk || !peer_send_all(fd, buf, chunk)) {
+				break;
+			}
+			left -= chunk;
+		}
+	}
+	fclose(f);
+}
+
+static void peer_connection_run(void* arg)
+{
+	struct peer_connection* c = (struct peer_connection*)arg;
+	char* buf = malloc(PEER_CHUNK_SIZE);
+	if (buf) {
+		peer_serve(c->server, c->fd, buf);
+		free(buf);
+	} else {
+		ETCHASH_CRITICAL("Could not allocate the peer transfer buffer");
+	}
+	etchash_mutex_lock(&c->server->mutex);
+	c->done = true;
+	etchash_cond_signal(&c->server->connection_done);
+	etchash_mutex_unlock(&c->server->mutex);
+}
+
+static void peer_connection_join(struct peer_connection* c)
+{
+	etchash_thread_join(c->thread);
+	close(c->fd);
+	c->running = false;
+}
+
+// joins the finished connections, returns a free slot or NULL if all are busy
+static struct peer_connection* peer_server_reap(struct etchash_peer_server* server)
+{
+	struct peer_connection* free_slot = NULL;
+	for (unsigned i = 0; i != PEER_MAX_CONNECTIONS; ++i) {
+		struct peer_connection* c = &server->connections[i];
+		if (c->running) {
+			etchash_mutex_lock(&server->mutex);
+			bool const done = c->done;
+			etchash_mutex_unlock(&server->mutex);
+			if (!done) {
+				continue;
+			}
+			peer_connection_join(c);
+		}
+		if (!free_slot) {
+			free_slot = c;
+		}
+	}
+	return free_slot;
+}
+
+static void peer_server_run(void* arg)
+{
+	struct etchash_peer_server* server = (struct etchash_peer_server*)arg;
+	while (!peer_server_stopping(server)) {
+		struct peer_connection* c = peer_server_reap(server);
+		if (!c) {
+			// further clients wait in the listen backlog until a connection finishes
+			etchash_mutex_lock(&server->mutex);
+			if (!server->stop) {
+				etchash_cond_timedwait(&server->connection_done, &server->mutex, PEER_POLL_MS);
+			}
+			etchash_mutex_unlock(&server->mutex);
+			continue;
+		}
+		struct pollfd pfd;
+		pfd.fd = server->fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		if (poll(&pfd, 1, PEER_POLL_MS) <= 0) {
+			continue;
+		}
+		int fd = accept(server->fd, NULL, NULL);
+		if (fd < 0) {
+			continue;
+		}
+		peer_set_timeout(fd);
+		c->server = server;
+		c->fd = fd;
+		c->done = false;
+		if (!etchash_thread_create(&c->thread, peer_connection_run, c)) {
+			close(fd);
+			continue;
+		}
+		c->running = true;
+	}
+	// wake connections blocked on a silent client, their sockets are closed after the join
+	for (unsigned i = 0; i != PEER_MAX_CONNECTIONS; ++i) {
+		struct peer_connection* c = &server->connections[i];
+		if (c->running) {
+			shutdown(c->fd, SHUT_RDWR);
+			peer_connection_join(c);
+		}
+	}
+}
+
+etchash_peer_server_t etchash_peer_server_new(char const* address, char const* dirname)
+{
+	struct sockaddr_storage addr;
+	socklen_t addr_len;
+	int family;
+	if (!peer_resolve(address, &addr, &addr_len, &family)) {
+		ETCHASH_CRITICAL("Invalid peer address: \"%s\"", address);
+		return NULL;
+	}
+	struct etchash_peer_server* server = calloc(sizeof(*server), 1);
+	if (!server) {
+		return NULL;
+	}
+	server->dirname = malloc(strlen(dirname) + 1);
+	if (!server->dirname) {
+		goto fail_free;
+	}
+	memcpy(server->dirname, dirname, strlen(dirname) + 1);
+	server->fd = socket(family, SOCK_STREAM, 0);
+	if (server->fd < 0) {
+		goto fail_free_dirname;
+	}
+	if (family == AF_UNIX) {
+		// a socket file left behind by a previous server would make bind() fail
+		memcpy(server->unix_path, ((struct sockaddr_un*)&addr)->sun_path, sizeof(server->unix_path));
+		unlink(server->unix_path);
+	} else {
+		int on = 1;
+		setsockopt(server->fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	}
+	if (bind(server->fd, (struct sockaddr*)&addr, addr_len) != 0 || listen(server->fd, 16) != 0) {
+		ETCHASH_CRITICAL("Could not listen on peer address: \"%s\"", address);
+		goto fail_close;
+	}
+	etchash_mutex_init(&server->mutex);
+	etchash_cond_init(&server->connection_done);
+	if (!etchash_thread_create(&server->thread, peer_server_run, server)) {
+		etchash_cond_destroy(&server->connection_done);
+		etchash_mutex_destroy(&server->mutex);
+		goto fail_close;
+	}
+	return server;
+
+fail_close:
+	close(server->fd);
+	if (server->unix_path[0]) {
+		unlink(server->unix_path);
+	}
+fail_free_dirname:
+	free(server->dirname);
+fail_free:
+	free(server);
+	return NULL;
+}
+
+void etchash_peer_server_delete(etchash_peer_server_t server)
+{
+	etchash_mutex_lock(&server->mutex);
+	server->stop = true;
+	etchash_mutex_unlock(&server->mutex);
+	etchash_thread_join(server->thread);
+	close(server->fd);
+	if (server->unix_path[0]) {
+		unlink(server->unix_path);
+	}
+	etchash_cond_destroy(&server->connection_done);
+	etchash_mutex_destroy(&server->mutex);
+	free(server->dirname);
+	free(server);
+}
+
+bool etchash_peer_fetch(
+	char const* address,
+	etchash_h256_t const* seed_hash,
+	uint64_t full_size,
+	etchash_light_t const light,
+	void* data,
+	uint32_t samples
+)
+{
+	struct sockaddr_storage addr;
+	socklen_t addr_len;
+	int family;
+	if (!peer_resolve(address, &addr, &addr_len, &family)) {
+		ETCHASH_CRITICAL("Invalid peer address: \"%s\"", address);
+		return false;
+	}
+	int fd = socket(family, SOCK_STREAM, 0);
+	if (fd < 0) {
+		return false;
+	}
+	bool ret = false;
+	peer_set_timeout(fd);
+	if (connect(fd, (struct sockaddr*)&addr, addr_len) != 0) {
+		goto end;
+	}
+
+	peer_request_t request;
+	memset(&request, 0, sizeof(request));
+	request.magic = ETCHASH_PEER_MAGIC;
+	request.version = ETCHASH_PEER_VERSION;
+	request.revision = ETCHASH_REVISION;
+	request.seed_hash = *seed_hash;
+	request.full_size = full_size;
+	peer_response_t response;
+	if (!peer_send_all(fd, &request, sizeof(request)) ||
+		!peer_recv_all(fd, &response, sizeof(response)) ||
+		response.magic != ETCHASH_PEER_MAGIC ||
+		response.status != PEER_STATUS_OK ||
+		response.full_size != full_size) {
+		goto end;
+	}
+	char* p = (char*)data;
+	uint64_t left = full_size;
+	while (left) {
+		size_t chunk = left < PEER_CHUNK_SIZE ? (size_t)left : PEER_CHUNK_SIZE;
+		if (!peer_recv_all(fd, p, chunk)) {
+			ETCHASH_CRITICAL("DAG transfer from \"%s\" was interrupted", address);
+			goto end;
+		}
+		p += chunk;
+		left -= chunk;
+	}
+	ret = etchash_peer_verify(data, full_size, light, samples);
+
+end:
+	close(fd);
+	return ret;
+}
+
+#endif
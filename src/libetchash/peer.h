@@ -0,0 +1,96 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file peer.h
+ * @date 2026
+ *
+ * Transfer of complete DAG files between hosts, so that only one host per
+ * rack spends the CPU time to generate an epoch's DAG.
+ *
+ * Addresses are "unix:<socket path>" or "tcp:<host>:<port>". A client sends
+ * the seed hash and DAG size it wants; the server answers with a status and,
+ * if it has a complete DAG file with a matching header, streams the DAG data.
+ * The client checks a sample of the received items against the cache before
+ * accepting them. Both ends must share the byte order. A server handles up to
+ * eight connections at once, each on its own thread.
+ *
+ * Only available on POSIX systems.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "etchash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ETCHASH_PEER_MAGIC 0x5245455048435445ULL  // "ETCHPEER"
+#define ETCHASH_PEER_VERSION 1
+#define ETCHASH_PEER_DEFAULT_SAMPLES 256
+
+typedef struct etchash_peer_server* etchash_peer_server_t;
+
+/**
+ * Start serving the complete DAG files of a directory
+ *
+ * @param address       Where to listen, see the address format above
+ * @param dirname       The directory holding the DAG files
+ * @return              The server or NULL if the address could not be bound
+ */
+etchash_peer_server_t etchash_peer_server_new(char const* address, char const* dirname);
+
+/**
+ * Stop serving, waits for the transfers in progress to be interrupted
+ */
+void etchash_peer_server_delete(etchash_peer_server_t server);
+
+/**
+ * Fetch a DAG from a peer
+ *
+ * @param address       The peer to fetch from
+ * @param seed_hash     Seed hash of the wanted DAG
+ * @param full_size     Size of the wanted DAG in bytes
+ * @param light         The epoch's cache, used to check the received data
+ * @param[out] data     Receives @a full_size bytes of DAG data
+ * @param samples       Number of items to check, 0 for ETCHASH_PEER_DEFAULT_SAMPLES
+ * @return              true if the whole DAG was received and passed the checks
+ */
+bool etchash_peer_fetch(
+	char const* address,
+	etchash_h256_t const* seed_hash,
+	uint64_t full_size,
+	etchash_light_t const light,
+	void* data,
+	uint32_t samples
+);
+
+/**
+ * Check randomly chosen DAG items, always including the first and the last
+ * one, against items computed from the cache
+ *
+ * @return              true if all sampled items match
+ */
+bool etchash_peer_verify(
+	void const* data,
+	uint64_t full_size,
+	etchash_light_t const light,
+	uint32_t samples
+);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,537 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file pool.c
+ * @date 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "pool.h"
+#include "internal.h"
+#include "thread.h"
+#include "topology.h"
+#include "io.h"
+
+#if defined(_MSC_VER)
+#define POOL_THREAD_LOCAL __declspec(thread)
+#else
+#define POOL_THREAD_LOCAL __thread
+#endif
+
+#define POOL_MAX_CPUS 1024
+
+struct pool_task {
+	etchash_task_fn fn;
+	void* arg;
+	struct pool_task* next;
+	struct pool_task* prev;
+};
+
+struct pool;
+
+struct pool_worker {
+	struct pool* pool;
+	unsigned index;
+	etchash_work_kind_t kind;     // of the tasks it prefers, ETCHASH_WORK_ANY unless paired
+	etchash_thread_t thread;
+	// the owner runs from the head, thieves take from the tail
+	etchash_mutex_t mutex;
+	struct pool_task* head;
+	struct pool_task* tail;
+};
+
+struct pool {
+	unsigned num_workers;
+	struct pool_worker* workers;
+	// sleeping workers wait for pending to become non zero
+	etchash_mutex_t mutex;
+	etchash_cond_t wake;
+	int32_t volatile pending;
+	int32_t volatile next_worker;
+	int32_t volatile submitters;  // etchash_pool_submit_kind() calls still queueing a task
+	bool stop;
+	// worker i runs on cpus[i % num_cpus]. Paired, the even ones are the
+	// memory bound hyperthreads of their core and the odd ones their siblings
+	unsigned cpus[POOL_MAX_CPUS];
+	unsigned num_cpus;
+	bool paired;
+};
+
+// configuration changes are rare, see etchash_spin_lock()
+static int32_t volatile g_pool_lock;
+static struct pool* g_pool;
+static etchash_pool_options_t g_pool_options;
+static unsigned g_pool_cpus[POOL_MAX_CPUS];
+static etchash_executor_t g_pool_executor;
+static bool g_pool_has_executor;
+static POOL_THREAD_LOCAL struct pool_worker* t_worker;
+
+static void pool_lock(void)
+{
+	etchash_spin_lock(&g_pool_lock);
+}
+
+static void pool_unlock(void)
+{
+	etchash_spin_unlock(&g_pool_lock);
+}
+
+// the CPUs the workers of a pool with @a options run on, see struct pool
+static unsigned pool_placement(etchash_pool_options_t const* options, unsigned* cpus, bool* paired)
+{
+	unsigned count = 0;
+	*paired = false;
+	if (options->numa) {
+		count = etchash_topology_numa_cpus(options->numa_node, cpus, POOL_MAX_CPUS);
+		if (!count) {
+			ETCHASH_CRITICAL("Could not read the CPUs of NUMA node %u, workers are not pinned", options->numa_node);
+		}
+	} else if (options->cpus) {
+		for (unsigned i = 0; i < options->num_cpus && i < POOL_MAX_CPUS; ++i) {
+			cpus[count++] = options->cpus[i];
+		}
+	}
+	if (!options->smt_pairing) {
+		return count;
+	}
+	unsigned first[POOL_MAX_CPUS / 2];
+	unsigned second[POOL_MAX_CPUS / 2];
+	unsigned const cores = etchash_topology_smt_pairs(first, second, POOL_MAX_CPUS / 2);
+	unsigned pairs = 0;
+	unsigned paired_cpus[POOL_MAX_CPUS];
+	for (unsigned c = 0; c < cores; ++c) {
+		// only the cores the CPU list or NUMA node allows
+		bool has_first = count == 0;
+		bool has_second = count == 0;
+		for (unsigned i = 0; i < count; ++i) {
+			has_first = has_first || cpus[i] == first[c];
+			has_second = has_second || cpus[i] == second[c];
+		}
+		if (has_first && has_second) {
+			paired_cpus[2 * pairs] = first[c];
+			paired_cpus[2 * pairs + 1] = second[c];
+			pairs++;
+		}
+	}
+	if (!pairs) {
+		return count;
+	}
+	for (unsigned i = 0; i < 2 * pairs; ++i) {
+		cpus[i] = paired_cpus[i];
+	}
+	*paired = true;
+	return 2 * pairs;
+}
+
+static void pool_push(struct pool_worker* worker, struct pool_task* task)
+{
+	etchash_mutex_lock(&worker->mutex);
+	task->next = NULL;
+	task->prev = worker->tail;
+	if (worker->tail) {
+		worker->tail->next = task;
+	} else {
+		worker->head = task;
+	}
+	worker->tail = task;
+	etchash_mutex_unlock(&worker->mutex);
+}
+
+static struct pool_task* pool_pop(struct pool_worker* worker, bool steal)
+{
+	etchash_mutex_lock(&worker->mutex);
+	struct pool_task* task = steal ? worker->tail : worker->head;
+	if (task) {
+		if (task->prev) {
+			task->prev->next = task->next;
+		} else {
+			worker->head = task->next;
+		}
+		if (task->next) {
+			task->next->prev = task->prev;
+		} else {
+			worker->tail = task->prev;
+		}
+	}
+	etchash_mutex_unlock(&worker->mutex);
+	return task;
+}
+
+static struct pool_task* pool_find(struct pool_worker* worker)
+{
+	struct pool* pool = worker->pool;
+	struct pool_task* task = pool_pop(worker, false);
+	// tasks of its own kind first, the hyperthread is idle otherwise
+	for (unsigned pass = 0; !task && pass < (pool->paired ? 2u : 1u); ++pass) {
+		for (unsigned i = 1; !task && i < pool->num_workers; ++i) {
+			struct pool_worker* victim = &pool->workers[(worker->index + i) % pool->num_workers];
+			if (!pool->paired || pass == 1 || victim->kind == worker->kind) {
+				task = pool_pop(victim, true);
+			}
+		}
+	}
+	if (task) {
+		etchash_atomic_add(&pool->pending, -1);
+	}
+	return task;
+}
+
+static void pool_worker_main(void* arg)
+{
+	struct pool_worker* worker = (struct pool_worker*)arg;
+	struct pool* pool = worker->pool;
+	t_worker = worker;
+	if (pool->num_cpus) {
+		etchash_thread_set_affinity(&pool->cpus[worker->index % pool->num_cpus], 1);
+	}
+	while (true) {
+		struct pool_task* task = pool_find(worker);
+		if (task) {
+			task->fn(task->arg);
+			free(task);
+			continue;
+		}
+		etchash_mutex_lock(&pool->mutex);
+		while (etchash_atomic_load(&pool->pending) == 0 && !pool->stop) {
+			etchash_cond_wait(&pool->wake, &pool->mutex);
+		}
+		bool done = pool->stop && etchash_atomic_load(&pool->pending) == 0;
+		etchash_mutex_unlock(&pool->mutex);
+		if (done) {
+			break;
+		}
+	}
+	t_worker = NULL;
+}
+
+// stops a pool that is no longer g_pool, after the tasks already submitted to it
+static void pool_stop(struct pool* pool)
+{
+	// no new submitter can find the pool, wait for the ones that did to count their task
+	while (etchash_atomic_load(&pool->submitters)) {
+		etchash_sleep_ms(0);
+	}
+	etchash_mutex_lock(&pool->mutex);
+	pool->stop = true;
+	etchash_cond_broadcast(&pool->wake);
+	etchash_mutex_unlock(&pool->mutex);
+	for (unsigned i = 0; i < pool->num_workers; ++i) {
+		etchash_thread_join(pool->workers[i].thread);
+		etchash_mutex_destroy(&pool->workers[i].mutex);
+	}
+	etchash_cond_destroy(&pool->wake);
+	etchash_mutex_destroy(&pool->mutex);
+	free(pool->workers);
+	free(pool);
+}
+
+static struct pool* pool_start(etchash_pool_options_t const* options)
+{
+	struct pool* pool = (struct pool*)calloc(1, sizeof(*pool));
+	if (!pool) {
+		return NULL;
+	}
+	pool->num_cpus = pool_placement(options, pool->cpus, &pool->paired);
+	unsigned threads = options->threads;
+	if (!threads) {
+		threads = (options->numa || pool->paired) && pool->num_cpus ? pool->num_cpus : etchash_cpu_count();
+	}
+	pool->workers = (struct pool_worker*)calloc(threads, sizeof(struct pool_worker));
+	if (!pool->workers) {
+		free(pool);
+		return NULL;
+	}
+	etchash_mutex_init(&pool->mutex);
+	etchash_cond_init(&pool->wake);
+	for (unsigned i = 0; i < threads; ++i) {
+		struct pool_worker* worker = &pool->workers[i];
+		worker->pool = pool;
+		worker->index = i;
+		worker->kind = !pool->paired ? ETCHASH_WORK_ANY : i % 2 ? ETCHASH_WORK_COMPUTE : ETCHASH_WORK_MEMORY;
+		etchash_mutex_init(&worker->mutex);
+		if (!etchash_thread_create(&worker->thread, pool_worker_main, worker)) {
+			etchash_mutex_destroy(&worker->mutex);
+			ETCHASH_CRITICAL("Could only start %u of %u pool threads", i, threads);
+			break;
+		}
+		pool->num_workers = i + 1;
+	}
+	if (!pool->num_workers) {
+		pool_stop(pool);
+		return NULL;
+	}
+	return pool;
+}
+
+// the internal pool, started if needed. Called with the lock held
+static struct pool* pool_get(void)
+{
+	if (!g_pool) {
+		g_pool = pool_start(&g_pool_options);
+	}
+	return g_pool;
+}
+
+bool etchash_pool_configure(etchash_pool_options_t const* options)
+{
+	etchash_pool_options_t defaults = { 0 };
+	pool_lock();
+	struct pool* old = g_pool;
+	g_pool = NULL;
+	g_pool_options = options ? *options : defaults;
+	if (g_pool_options.cpus) {
+		if (g_pool_options.num_cpus > POOL_MAX_CPUS) {
+			g_pool_options.num_cpus = POOL_MAX_CPUS;
+		}
+		for (unsigned i = 0; i < g_pool_options.num_cpus; ++i) {
+			g_pool_cpus[i] = g_pool_options.cpus[i];
+		}
+		g_pool_options.cpus = g_pool_cpus;
+	}
+	pool_unlock();
+	if (old) {
+		pool_stop(old);
+	}
+	pool_lock();
+	bool ok = pool_get() != NULL;
+	pool_unlock();
+	return ok;
+}
+
+void etchash_pool_set_executor(etchash_executor_t const* executor)
+{
+	pool_lock();
+	g_pool_has_executor = executor && executor->submit;
+	if (g_pool_has_executor) {
+		g_pool_executor = *executor;
+	}
+	pool_unlock();
+}
+
+void etchash_pool_shutdown(void)
+{
+	pool_lock();
+	struct pool* old = g_pool;
+	g_pool = NULL;
+	pool_unlock();
+	if (old) {
+		pool_stop(old);
+	}
+}
+
+bool etchash_pool_submit(etchash_task_fn fn, void* arg)
+{
+	return etchash_pool_submit_kind(ETCHASH_WORK_ANY, fn, arg);
+}
+
+// the worker to queue a task of @a kind on
+static struct pool_worker* pool_pick(struct pool* pool, etchash_work_kind_t kind)
+{
+	// tasks submitted by a task stay on its worker, they are likely to share its data
+	if (t_worker && t_worker->pool == pool && (kind == ETCHASH_WORK_ANY || t_worker->kind == kind)) {
+		return t_worker;
+	}
+	uint32_t const next = (uint32_t)etchash_atomic_add(&pool->next_worker, 1);
+	unsigned const compute_workers = pool->num_workers / 2;
+	if (!pool->paired || kind == ETCHASH_WORK_ANY || !compute_workers) {
+		return &pool->workers[next % pool->num_workers];
+	}
+	if (kind == ETCHASH_WORK_COMPUTE) {
+		return &pool->workers[next % compute_workers * 2 + 1];
+	}
+	return &pool->workers[next % (pool->num_workers - compute_workers) * 2];
+}
+
+bool etchash_pool_submit_kind(etchash_work_kind_t kind, etchash_task_fn fn, void* arg)
+{
+	pool_lock();
+	if (g_pool_has_executor) {
+		etchash_executor_t executor = g_pool_executor;
+		pool_unlock();
+		return executor.submit(executor.context, fn, arg);
+	}
+	struct pool* pool = pool_get();
+	if (!pool) {
+		pool_unlock();
+		return false;
+	}
+	// keeps a concurrent reconfiguration from stopping the pool before the task is counted
+	etchash_atomic_add(&pool->submitters, 1);
+	pool_unlock();
+	struct pool_task* task = (struct pool_task*)malloc(sizeof(*task));
+	if (task) {
+		task->fn = fn;
+		task->arg = arg;
+		pool_push(pool_pick(pool, kind), task);
+		etchash_atomic_add(&pool->pending, 1);
+		etchash_mutex_lock(&pool->mutex);
+		etchash_cond_signal(&pool->wake);
+		etchash_mutex_unlock(&pool->mutex);
+	}
+	etchash_atomic_add(&pool->submitters, -1);
+	return task != NULL;
+}
+
+bool etchash_pool_pin_thread(etchash_work_kind_t kind)
+{
+	pool_lock();
+	etchash_pool_options_t options = g_pool_options;
+	pool_unlock();
+	unsigned cpus[POOL_MAX_CPUS];
+	bool paired;
+	unsigned const count = pool_placement(&options, cpus, &paired);
+	if (!paired) {
+		return false;
+	}
+	unsigned kind_cpus[POOL_MAX_CPUS];
+	unsigned num_kind_cpus = 0;
+	for (unsigned i = 0; i < count; ++i) {
+		if (kind == ETCHASH_WORK_ANY || (i % 2 == 1) == (kind == ETCHASH_WORK_COMPUTE)) {
+			kind_cpus[num_kind_cpus++] = cpus[i];
+		}
+	}
+	return etchash_thread_set_affinity(kind_cpus, num_kind_cpus);
+}
+
+unsigned etchash_pool_concurrency(void)
+{
+	unsigned concurrency;
+	pool_lock();
+	if (g_pool_has_executor) {
+		concurrency = g_pool_executor.concurrency ? g_pool_executor.concurrency : etchash_cpu_count();
+	} else if (g_pool) {
+		concurrency = g_pool->num_workers;
+	} else {
+		concurrency = g_pool_options.threads ? g_pool_options.threads : etchash_cpu_count();
+	}
+	pool_unlock();
+	return concurrency;
+}
+
+// shared by the calling thread and its helpers, the last one to leave frees it
+struct pool_batch {
+	etchash_mutex_t mutex;
+	etchash_cond_t done;
+	uint64_t count;
+	uint64_t grain;
+	uint64_t next;
+	uint64_t claimed;
+	uint64_t finished;
+	bool cancelled;
+	unsigned refs;
+	etchash_range_fn body;
+	void* arg;
+};
+
+static void batch_release(struct pool_batch* batch)
+{
+	etchash_mutex_lock(&batch->mutex);
+	bool last = --batch->refs == 0;
+	etchash_mutex_unlock(&batch->mutex);
+	if (last) {
+		etchash_cond_destroy(&batch->done);
+		etchash_mutex_destroy(&batch->mutex);
+		free(batch);
+	}
+}
+
+static void batch_run(struct pool_batch* batch)
+{
+	etchash_mutex_lock(&batch->mutex);
+	while (!batch->cancelled && batch->next < batch->count) {
+		uint64_t begin = batch->next;
+		uint64_t end = batch->count - begin < batch->grain ? batch->count : begin + batch->grain;
+		batch->next = end;
+		batch->claimed++;
+		etchash_mutex_unlock(&batch->mutex);
+		bool ok = batch->body(batch->arg, begin, end);
+		etchash_mutex_lock(&batch->mutex);
+		if (!ok) {
+			batch->cancelled = true;
+		}
+		if (++batch->finished == batch->claimed) {
+			etchash_cond_broadcast(&batch->done);
+		}
+	}
+	etchash_mutex_unlock(&batch->mutex);
+}
+
+static void batch_helper(void* arg)
+{
+	struct pool_batch* batch = (struct pool_batch*)arg;
+	batch_run(batch);
+	batch_release(batch);
+}
+
+bool etchash_parallel_for(uint64_t count, uint64_t grain, etchash_range_fn body, void* arg)
+{
+	return etchash_parallel_for_kind(ETCHASH_WORK_ANY, count, grain, body, arg);
+}
+
+bool etchash_parallel_for_kind(
+	etchash_work_kind_t kind,
+	uint64_t count,
+	uint64_t grain,
+	etchash_range_fn body,
+	void* arg
+)
+{
+	if (!grain) {
+		grain = 1;
+	}
+	uint64_t chunks = count / grain + (count % grain != 0);
+	unsigned concurrency = etchash_pool_concurrency();
+	if (chunks <= 1 || concurrency <= 1) {
+		for (uint64_t begin = 0; begin < count; begin += grain) {
+			if (!body(arg, begin, count - begin < grain ? count : begin + grain)) {
+				return false;
+			}
+		}
+		return true;
+	}
+	struct pool_batch* batch = (struct pool_batch*)calloc(1, sizeof(*batch));
+	if (!batch) {
+		return false;
+	}
+	etchash_mutex_init(&batch->mutex);
+	etchash_cond_init(&batch->done);
+	batch->count = count;
+	batch->grain = grain;
+	batch->body = body;
+	batch->arg = arg;
+	batch->refs = 1;
+	uint64_t helpers = chunks - 1 < concurrency - 1 ? chunks - 1 : concurrency - 1;
+	for (uint64_t i = 0; i < helpers; ++i) {
+		etchash_mutex_lock(&batch->mutex);
+		batch->refs++;
+		etchash_mutex_unlock(&batch->mutex);
+		if (!etchash_pool_submit_kind(kind, batch_helper, batch)) {
+			batch_release(batch);
+			break;
+		}
+	}
+	batch_run(batch);
+	// helpers that did not start yet find no chunks left, only wait for the running ones
+	etchash_mutex_lock(&batch->mutex);
+	while (batch->finished != batch->claimed) {
+		etchash_cond_wait(&batch->done, &batch->mutex);
+	}
+	bool ok = !batch->cancelled;
+	etchash_mutex_unlock(&batch->mutex);
+	batch_release(batch);
+	return ok;
+}
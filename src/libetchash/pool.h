@@ -0,0 +1,158 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file pool.h
+ * @date 2026
+ *
+ * The threads the library does its parallel work on: parallel DAG builds,
+ * Merkle tree builds and the search scheduler.
+ *
+ * By default that is one library wide work-stealing pool. Each worker runs its
+ * own queue in submission order and steals the newest tasks of the others when
+ * it runs dry. Embedders with their own scheduler (Go, Python, a C++ runtime)
+ * can inject an executor instead, so that etchash does not oversubscribe the
+ * cores next to it.
+ *
+ * Threads that block for long or run at idle priority keep their own thread:
+ * the background generator, the DAG watchdog and the peer server would hold
+ * a worker indefinitely or change its priority.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*etchash_task_fn)(void* arg);
+
+/// What bounds a task, for pairing tasks on the hyperthreads of a core
+typedef enum etchash_work_kind {
+	ETCHASH_WORK_ANY = 0,
+	ETCHASH_WORK_MEMORY,         ///< DRAM latency: full mode hashing
+	ETCHASH_WORK_COMPUTE,        ///< Keccak: light mode hashing, cache, DAG and Merkle tree generation
+} etchash_work_kind_t;
+
+/// A thread provider of the embedder
+typedef struct etchash_executor {
+	/**
+	 * Run fn(arg) on some thread soon, never inline in the calling thread
+	 *
+	 * @return      false if the task cannot be run
+	 */
+	bool (*submit)(void* context, etchash_task_fn fn, void* arg);
+	void* context;
+	unsigned concurrency;        ///< Tasks run at once, 0 for the CPU count
+} etchash_executor_t;
+
+/// Settings of the internal pool. Zero initialize for the defaults.
+typedef struct etchash_pool_options {
+	unsigned threads;            ///< Worker threads, 0 for one per CPU (of the NUMA node if given)
+	unsigned const* cpus;        ///< Pin worker i to cpus[i % num_cpus], NULL to not pin
+	unsigned num_cpus;
+	bool numa;                   ///< Pin all workers to the CPUs of @a numa_node (Linux only)
+	unsigned numa_node;
+	/**
+	 * Pin worker pairs to the two hyperthreads of a core, one running memory
+	 * bound and the other compute bound tasks, instead of letting two tasks of
+	 * the same kind compete for one core. Workers run the other kind when
+	 * theirs has none. Ignored without SMT. The default thread count is then
+	 * two per core, of the NUMA node or CPU list if given.
+	 */
+	bool smt_pairing;
+} etchash_pool_options_t;
+
+/**
+ * Restart the internal pool with new settings, after its queued tasks ran
+ *
+ * Call it while the library is idle.
+ *
+ * @return      false if no worker could be started
+ */
+bool etchash_pool_configure(etchash_pool_options_t const* options);
+
+/**
+ * Run the library's tasks on an executor of the embedder
+ *
+ * Call it while the library is idle.
+ *
+ * @param executor  The executor, copied, or NULL to go back to the internal pool
+ */
+void etchash_pool_set_executor(etchash_executor_t const* executor);
+
+/**
+ * Stop the internal pool's threads after its queued tasks ran. It is started
+ * again by the next task.
+ */
+void etchash_pool_shutdown(void);
+
+/**
+ * Run a task on the executor or the internal pool, which is started on first use
+ *
+ * @return      false if the task cannot be run
+ */
+bool etchash_pool_submit(etchash_task_fn fn, void* arg);
+
+/**
+ * Like @ref etchash_pool_submit() for a task of a known kind
+ */
+bool etchash_pool_submit_kind(etchash_work_kind_t kind, etchash_task_fn fn, void* arg);
+
+/**
+ * Pin the calling thread to the hyperthreads that run tasks of @a kind, for
+ * the library's dedicated threads and the embedder's own, such as verifier
+ * threads (@a ETCHASH_WORK_COMPUTE)
+ *
+ * @return      false if the pool does not pair hyperthreads
+ */
+bool etchash_pool_pin_thread(etchash_work_kind_t kind);
+
+/**
+ * @return      The number of tasks run at once
+ */
+unsigned etchash_pool_concurrency(void);
+
+/**
+ * Process a range of items
+ *
+ * @return      false to skip the chunks not started yet
+ */
+typedef bool (*etchash_range_fn)(void* arg, uint64_t begin, uint64_t end);
+
+/**
+ * Split [0, count) in chunks of @a grain items and process them on the pool,
+ * with the calling thread taking part. Returns once every chunk started has
+ * been processed, so it also works with a busy pool.
+ *
+ * @return      false if a chunk returned false
+ */
+bool etchash_parallel_for(uint64_t count, uint64_t grain, etchash_range_fn body, void* arg);
+
+/**
+ * Like @ref etchash_parallel_for() for chunks of a known kind
+ */
+bool etchash_parallel_for_kind(
+	etchash_work_kind_t kind,
+	uint64_t count,
+	uint64_t grain,
+	etchash_range_fn body,
+	void* arg
+);
+
+#ifdef __cplusplus
+}
+#endif
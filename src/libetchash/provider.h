@@ -0,0 +1,80 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file provider.h
+ * @date 2026
+ *
+ * Hashimoto over a dataset supplied by the embedder.
+ *
+ * A provider hands out DAG items (64 byte nodes) in batches: every DAG access
+ * asks for the MIX_NODES items of one page at once, so a provider can overlap
+ * their I/O or computation. Partial, on-disk, out-of-core or remote datasets
+ * plug in this way; the built-in full and light providers serve as a fallback
+ * for what a provider lacks.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "etchash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Size in bytes of a DAG item
+#define ETCHASH_ITEM_BYTES 64
+
+/**
+ * Fetch DAG items
+ *
+ * @param user      The provider's user pointer
+ * @param items     Indices of the DAG items
+ * @param count     Number of items
+ * @param[out] out  count * ETCHASH_ITEM_BYTES bytes for the items, in order
+ * @return          false if the items are not available, failing the hash
+ */
+typedef bool (*etchash_fetch_t)(void* user, uint32_t const* items, unsigned count, void* out);
+
+typedef struct etchash_provider {
+	etchash_fetch_t fetch;
+	void* user;
+	uint64_t full_size;       ///< Size of the dataset in bytes
+} etchash_provider_t;
+
+/**
+ * Calculate the hashimoto result with the DAG items of a provider
+ *
+ * @return          The result, with success false if a fetch failed
+ */
+etchash_return_value_t etchash_compute_with_provider(
+	etchash_provider_t const* provider,
+	etchash_h256_t const header_hash,
+	uint64_t nonce
+);
+
+/**
+ * A provider reading the DAG of a full handler
+ */
+void etchash_provider_from_full(etchash_provider_t* provider, etchash_full_t full);
+
+/**
+ * A provider calculating the DAG items from the cache
+ */
+void etchash_provider_from_light(etchash_provider_t* provider, etchash_light_t light, uint64_t full_size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,453 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file search.c
+ * @date 2026
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "search.h"
+#include "internal.h"
+#include "pool.h"
+#include "thread.h"
+#include "boundary.h"
+#include "io.h"
+
+// nonces a task takes from a job at once, the job's generation is checked before every hash
+#define SEARCH_CHUNK 64
+
+#if defined(_MSC_VER)
+#define SEARCH_THREAD_LOCAL __declspec(thread)
+#else
+#define SEARCH_THREAD_LOCAL __thread
+#endif
+
+// a scheduler created DAG, shared by the jobs of its epoch
+typedef struct search_epoch {
+	etchash_h256_t seed;
+	uint64_t full_size;
+	etchash_light_t light;
+	etchash_full_t full;
+	unsigned refs;
+	struct search_epoch* next;
+} search_epoch_t;
+
+typedef struct search_slot {
+	bool active;
+	uint32_t job_id;
+	int32_t volatile generation;
+	etchash_full_t full;
+	search_epoch_t* epoch;        // NULL for a DAG passed in by the caller
+	etchash_h256_t header_hash;
+	etchash_h256_t boundary;
+	uint64_t next_nonce;
+	uint32_t weight;
+	uint32_t priority;
+	double pass;                  // hashes handed out divided by weight
+	unsigned inflight;            // tasks hashing the current work
+	uint64_t hashes;
+	uint64_t solutions;
+	uint64_t started_ms;
+} search_slot_t;
+
+struct etchash_search {
+	etchash_mutex_t mutex;
+	etchash_cond_t idle;          // signalled when a task is done with a chunk or exits
+	char dirname[256];
+	etchash_search_found_t found;
+	void* user;
+	bool stop;
+	unsigned num_tasks;           // tasks kept on the pool while there is work
+	unsigned tasks;               // tasks queued or running
+	search_slot_t slots[ETCHASH_SEARCH_MAX_JOBS];
+	search_epoch_t* epochs;
+};
+
+// the slot whose solution the calling task is reporting, see search_retire()
+static SEARCH_THREAD_LOCAL search_slot_t* t_found_slot;
+
+// the active job of the highest priority which got the least hashes for its weight
+static search_slot_t* search_pick(struct etchash_search* s)
+{
+	search_slot_t* best = NULL;
+	for (unsigned i = 0; i < ETCHASH_SEARCH_MAX_JOBS; ++i) {
+		search_slot_t* slot = &s->slots[i];
+		if (!slot->active) {
+			continue;
+		}
+		if (!best || slot->priority > best->priority ||
+			(slot->priority == best->priority && slot->pass < best->pass)) {
+			best = slot;
+		}
+	}
+	return best;
+}
+
+// a task exits, waking etchash_search_delete() with the last one
+static void search_task_exit(struct etchash_search* s)
+{
+	etchash_mutex_lock(&s->mutex);
+	if (--s->tasks == 0) {
+		etchash_cond_broadcast(&s->idle);
+	}
+	etchash_mutex_unlock(&s->mutex);
+}
+
+// hashes one chunk of the most deserving job and submits itself again for the
+// next, so that other pool work interleaves with the search
+static void search_task(void* arg)
+{
+	struct etchash_search* s = (struct etchash_search*)arg;
+	etchash_mutex_lock(&s->mutex);
+	search_slot_t* slot = s->stop ? NULL : search_pick(s);
+	if (!slot) {
+		etchash_mutex_unlock(&s->mutex);
+		search_task_exit(s);
+		return;
+	}
+	int32_t const generation = slot->generation;
+	etchash_full_t const full = slot->full;
+	etchash_h256_t const header_hash = slot->header_hash;
+	etchash_h256_t const boundary = slot->boundary;
+	uint32_t const job_id = slot->job_id;
+	uint64_t const start = slot->next_nonce;
+	slot->next_nonce += SEARCH_CHUNK;
+	slot->pass += (double)SEARCH_CHUNK / slot->weight;
+	slot->inflight++;
+	etchash_mutex_unlock(&s->mutex);
+
+	uint64_t hashes = 0;
+	uint64_t solutions = 0;
+	for (uint64_t nonce = start; nonce < start + SEARCH_CHUNK; ++nonce) {
+		if (etchash_atomic_load(&slot->generation) != generation) {
+			break;
+		}
+		etchash_return_value_t ret = etchash_full_compute(full, header_hash, nonce);
+		hashes++;
+		if (ret.success && etchash_boundary_check(&ret.result, &boundary)) {
+			etchash_search_solution_t solution;
+			solution.job_id = job_id;
+			solution.generation = (uint32_t)generation;
+			solution.nonce = nonce;
+			solution.mix_hash = ret.mix_hash;
+			solution.result = ret.result;
+			solutions++;
+			t_found_slot = slot;
+			s->found(&solution, s->user);
+			t_found_slot = NULL;
+		}
+	}
+
+	etchash_mutex_lock(&s->mutex);
+	if (slot->generation == generation) {
+		slot->hashes += hashes;
+		slot->solutions += solutions;
+	}
+	if (--slot->inflight == 0) {
+		etchash_cond_broadcast(&s->idle);
+	}
+	bool const again = !s->stop;
+	etchash_mutex_unlock(&s->mutex);
+	if (!again || !etchash_pool_submit_kind(ETCHASH_WORK_MEMORY, search_task, s)) {
+		search_task_exit(s);
+	}
+}
+
+// tops the tasks up to num_tasks. Called with the mutex held, returns with it
+// released as an executor may run the tasks before submit returns
+static void search_spawn(struct etchash_search* s)
+{
+	unsigned const missing = s->num_tasks - s->tasks;
+	s->tasks = s->num_tasks;
+	etchash_mutex_unlock(&s->mutex);
+	for (unsigned i = 0; i < missing; ++i) {
+		if (!etchash_pool_submit_kind(ETCHASH_WORK_MEMORY, search_task, s)) {
+			ETCHASH_CRITICAL("Could not submit a search task to the pool");
+			search_task_exit(s);
+		}
+	}
+}
+
+// drops a reference to an epoch, freeing it with the last one. Called with the mutex held
+static void search_epoch_release(struct etchash_search* s, search_epoch_t* epoch)
+{
+	if (--epoch->refs) {
+		return;
+	}
+	search_epoch_t** p = &s->epochs;
+	while (*p != epoch) {
+		p = &(*p)->next;
+	}
+	*p = epoch->next;
+	etchash_full_delete(epoch->full);
+	etchash_light_delete(epoch->light);
+	free(epoch);
+}
+
+static search_epoch_t* search_epoch_find(struct etchash_search* s, etchash_h256_t const* seed, uint64_t full_size)
+{
+	for (search_epoch_t* epoch = s->epochs; epoch; epoch = epoch->next) {
+		if (epoch->full_size == full_size && memcmp(&epoch->seed, seed, sizeof(*seed)) == 0) {
+			return epoch;
+		}
+	}
+	return NULL;
+}
+
+// returns a referenced epoch, creating its DAG without holding the mutex. Called with the mutex held
+static search_epoch_t* search_epoch_acquire(
+	struct etchash_search* s,
+	uint64_t cache_size,
+	etchash_h256_t const* seed,
+	uint64_t full_size
+)
+{
+	search_epoch_t* epoch = search_epoch_find(s, seed, full_size);
+	if (epoch) {
+		epoch->refs++;
+		return epoch;
+	}
+	etchash_mutex_unlock(&s->mutex);
+	epoch = calloc(sizeof(*epoch), 1);
+	if (epoch) {
+		epoch->seed = *seed;
+		epoch->full_size = full_size;
+		epoch->light = etchash_light_new_internal(cache_size, seed);
+		if (epoch->light) {
+			epoch->full = etchash_full_new_internal_ex(s->dirname, *seed, full_size, epoch->light, NULL, NULL, NULL);
+		}
+		if (!epoch->full) {
+			if (epoch->light) {
+				etchash_light_delete(epoch->light);
+			}
+			free(epoch);
+			epoch = NULL;
+		}
+	}
+	etchash_mutex_lock(&s->mutex);
+	if (!epoch) {
+		return NULL;
+	}
+	// another caller may have created the same DAG meanwhile
+	search_epoch_t* existing = search_epoch_find(s, seed, full_size);
+	if (existing) {
+		etchash_full_delete(epoch->full);
+		etchash_light_delete(epoch->light);
+		free(epoch);
+		existing->refs++;
+		return existing;
+	}
+	epoch->refs = 1;
+	epoch->next = s->epochs;
+	s->epochs = epoch;
+	return epoch;
+}
+
+static search_slot_t* search_find_slot(struct etchash_search* s, uint32_t job_id)
+{
+	for (unsigned i = 0; i < ETCHASH_SEARCH_MAX_JOBS; ++i) {
+		if (s->slots[i].active && s->slots[i].job_id == job_id) {
+			return &s->slots[i];
+		}
+	}
+	return NULL;
+}
+
+// stops the tasks working on a slot's work and waits for them. Called with the mutex held
+static void search_retire(struct etchash_search* s, search_slot_t* slot)
+{
+	etchash_atomic_add(&slot->generation, 1);
+	// a task may replace or remove its own job from the found callback, it
+	// stops at its next generation check
+	unsigned const own = t_found_slot == slot ? 1 : 0;
+	while (slot->inflight > own) {
+		etchash_cond_wait(&s->idle, &s->mutex);
+	}
+	if (slot->epoch) {
+		search_epoch_release(s, slot->epoch);
+		slot->epoch = NULL;
+	}
+}
+
+static bool search_set_work(
+	struct etchash_search* s,
+	uint32_t job_id,
+	etchash_search_work_t const* work,
+	uint64_t cache_size,
+	etchash_h256_t const* seed,
+	uint64_t full_size
+)
+{
+	etchash_mutex_lock(&s->mutex);
+	search_epoch_t* epoch = NULL;
+	if (!work->full) {
+		epoch = search_epoch_acquire(s, cache_size, seed, full_size);
+		if (!epoch) {
+			etchash_mutex_unlock(&s->mutex);
+			return false;
+		}
+	}
+	search_slot_t* slot = search_find_slot(s, job_id);
+	if (slot) {
+		search_retire(s, slot);
+	} else {
+		for (unsigned i = 0; i < ETCHASH_SEARCH_MAX_JOBS && !slot; ++i) {
+			// a removed job's slot is busy until the task reporting from it is done
+			if (!s->slots[i].active && !s->slots[i].inflight) {
+				slot = &s->slots[i];
+			}
+		}
+		if (!slot) {
+			if (epoch) {
+				search_epoch_release(s, epoch);
+			}
+			etchash_mutex_unlock(&s->mutex);
+			return false;
+		}
+		slot->job_id = job_id;
+		slot->generation = 0;
+	}
+	// start even with the jobs it competes with, so that it does not get a burst of hashes
+	double pass = 0;
+	bool first = true;
+	for (unsigned i = 0; i < ETCHASH_SEARCH_MAX_JOBS; ++i) {
+		search_slot_t* other = &s->slots[i];
+		if (other != slot && other->active && other->priority == work->priority && (first || other->pass < pass)) {
+			pass = other->pass;
+			first = false;
+		}
+	}
+	slot->active = true;
+	slot->full = epoch ? epoch->full : work->full;
+	slot->epoch = epoch;
+	slot->header_hash = work->header_hash;
+	slot->boundary = work->boundary;
+	slot->next_nonce = work->start_nonce;
+	slot->weight = work->weight ? work->weight : 1;
+	slot->priority = work->priority;
+	slot->pass = pass;
+	slot->hashes = 0;
+	slot->solutions = 0;
+	slot->started_ms = etchash_time_ms();
+	search_spawn(s);
+	return true;
+}
+
+bool etchash_search_set_work(etchash_search_t search, uint32_t job_id, etchash_search_work_t const* work)
+{
+	if (work->full) {
+		// the seed costs a Keccak hash per epoch, only a scheduler created DAG needs it
+		return search_set_work(search, job_id, work, 0, NULL, 0);
+	}
+	etchash_h256_t seed = etchash_get_seedhash(work->block_number);
+	uint64_t cache_size = etchash_get_cachesize(work->block_number);
+	uint64_t full_size = etchash_get_datasize(work->block_number);
+	return search_set_work(search, job_id, work, cache_size, &seed, full_size);
+}
+
+bool etchash_search_set_work_internal(
+	etchash_search_t search,
+	uint32_t job_id,
+	etchash_search_work_t const* work,
+	uint64_t cache_size,
+	etchash_h256_t const* seed,
+	uint64_t full_size
+)
+{
+	return search_set_work(search, job_id, work, cache_size, seed, full_size);
+}
+
+void etchash_search_remove(etchash_search_t search, uint32_t job_id)
+{
+	etchash_mutex_lock(&search->mutex);
+	search_slot_t* slot = search_find_slot(search, job_id);
+	if (slot) {
+		slot->active = false;
+		search_retire(search, slot);
+	}
+	etchash_mutex_unlock(&search->mutex);
+}
+
+bool etchash_search_job_stats(etchash_search_t search, uint32_t job_id, etchash_search_stats_t* stats)
+{
+	etchash_mutex_lock(&search->mutex);
+	search_slot_t* slot = search_find_slot(search, job_id);
+	if (slot) {
+		uint64_t elapsed = etchash_time_ms() - slot->started_ms;
+		stats->generation = (uint32_t)slot->generation;
+		stats->hashes = slot->hashes;
+		stats->solutions = slot->solutions;
+		stats->hashrate = elapsed ? slot->hashes * 1000.0 / elapsed : 0;
+	}
+	etchash_mutex_unlock(&search->mutex);
+	return slot != NULL;
+}
+
+etchash_search_t etchash_search_new(
+	unsigned threads,
+	char const* dirname,
+	etchash_search_found_t found,
+	void* user
+)
+{
+	struct etchash_search* s = calloc(sizeof(*s), 1);
+	if (!s) {
+		return NULL;
+	}
+	if (dirname) {
+		if (!etchash_strncat(s->dirname, sizeof(s->dirname), dirname, strlen(dirname))) {
+			goto fail_free;
+		}
+	} else if (!etchash_get_default_dirname(s->dirname, sizeof(s->dirname))) {
+		goto fail_free;
+	}
+	s->found = found;
+	s->user = user;
+	s->num_tasks = threads ? threads : etchash_pool_concurrency();
+	etchash_mutex_init(&s->mutex);
+	etchash_cond_init(&s->idle);
+	return s;
+
+fail_free:
+	free(s);
+	return NULL;
+}
+
+void etchash_search_delete(etchash_search_t search)
+{
+	// a found callback runs on one of the tasks this waits for
+	assert(!(t_found_slot >= search->slots && t_found_slot < search->slots + ETCHASH_SEARCH_MAX_JOBS));
+	etchash_mutex_lock(&search->mutex);
+	search->stop = true;
+	for (unsigned i = 0; i < ETCHASH_SEARCH_MAX_JOBS; ++i) {
+		// stops tasks in the middle of a chunk
+		etchash_atomic_add(&search->slots[i].generation, 1);
+	}
+	while (search->tasks) {
+		etchash_cond_wait(&search->idle, &search->mutex);
+	}
+	etchash_mutex_unlock(&search->mutex);
+	for (unsigned i = 0; i < ETCHASH_SEARCH_MAX_JOBS; ++i) {
+		if (search->slots[i].active && search->slots[i].epoch) {
+			search_epoch_release(search, search->slots[i].epoch);
+		}
+	}
+	etchash_cond_destroy(&search->idle);
+	etchash_mutex_destroy(&search->mutex);
+	free(search);
+}
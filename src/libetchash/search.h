@@ -0,0 +1,135 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file search.h
+ * @date 2026
+ *
+ * Search tasks on the library pool (see pool.h) working on several jobs at
+ * once, each with its own header, boundary and DAG epoch.
+ *
+ * Jobs of the highest priority present get all the tasks; jobs of equal
+ * priority share them in proportion to their weights. Replacing or removing a
+ * job stops every task working on its old work after at most one hash, and
+ * the call returns only once no task uses the old work anymore. Jobs for the
+ * same epoch share one DAG.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "etchash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ETCHASH_SEARCH_MAX_JOBS 32
+
+/// A work package for @ref etchash_search_set_work()
+typedef struct etchash_search_work {
+	uint64_t block_number;        ///< Selects the DAG when @a full is NULL
+	etchash_full_t full;          ///< DAG to use, NULL to use the scheduler's DAG of the block's epoch
+	etchash_h256_t header_hash;
+	etchash_h256_t boundary;      ///< 2^256 / difficulty, big endian
+	uint64_t start_nonce;
+	uint32_t weight;              ///< Share among jobs of equal priority, 0 counts as 1
+	uint32_t priority;            ///< Jobs of lower priority wait while a higher one exists
+} etchash_search_work_t;
+
+typedef struct etchash_search_solution {
+	uint32_t job_id;
+	uint32_t generation;          ///< Generation of the job's work, see @ref etchash_search_stats_t
+	uint64_t nonce;
+	etchash_h256_t mix_hash;
+	etchash_h256_t result;
+} etchash_search_solution_t;
+
+typedef struct etchash_search_stats {
+	uint32_t generation;          ///< Incremented by every @ref etchash_search_set_work() of the job
+	uint64_t hashes;              ///< Hashes computed for the current work
+	uint64_t solutions;           ///< Solutions found for the current work
+	double hashrate;              ///< Hashes per second since the current work was set
+} etchash_search_stats_t;
+
+/**
+ * Called from the search tasks for every solution, concurrently
+ *
+ * The callback may replace or remove the solution's job, or any other, with
+ * @ref etchash_search_set_work() and @ref etchash_search_remove(). It must not
+ * delete the scheduler, whose tasks it runs on.
+ */
+typedef void (*etchash_search_found_t)(etchash_search_solution_t const* solution, void* user);
+
+typedef struct etchash_search* etchash_search_t;
+
+/**
+ * Create a scheduler, its tasks are submitted to the pool once work is set
+ *
+ * @param threads   Number of search tasks run at once, 0 for the pool's concurrency
+ * @param dirname   Directory of the DAGs the scheduler creates, NULL for the default
+ * @param found     Called for every solution
+ * @param user      Handed to @a found
+ * @return          The scheduler or NULL in failure
+ */
+etchash_search_t etchash_search_new(
+	unsigned threads,
+	char const* dirname,
+	etchash_search_found_t found,
+	void* user
+);
+
+/**
+ * Wait for the search tasks to stop and free the scheduler and the DAGs it created
+ */
+void etchash_search_delete(etchash_search_t search);
+
+/**
+ * Add a job or replace its work
+ *
+ * Creating the DAG of a new epoch takes long, create DAGs ahead of time or
+ * pass them in @a work.
+ *
+ * @param job_id    Caller chosen id of the job
+ * @param work      The work, copied
+ * @return          false if there is no free job slot or the DAG could not be created
+ */
+bool etchash_search_set_work(etchash_search_t search, uint32_t job_id, etchash_search_work_t const* work);
+
+/**
+ * Like @ref etchash_search_set_work() with explicit epoch parameters for a
+ * scheduler created DAG, mostly for tests with small data
+ */
+bool etchash_search_set_work_internal(
+	etchash_search_t search,
+	uint32_t job_id,
+	etchash_search_work_t const* work,
+	uint64_t cache_size,
+	etchash_h256_t const* seed,
+	uint64_t full_size
+);
+
+/**
+ * Remove a job. Its DAG, if passed in, may be freed after this returns.
+ */
+void etchash_search_remove(etchash_search_t search, uint32_t job_id);
+
+/**
+ * @return          false if there is no such job
+ */
+bool etchash_search_job_stats(etchash_search_t search, uint32_t job_id, etchash_search_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,617 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file shard.c
+ * @date 2026
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "shard.h"
+#include "internal.h"
+#include "fnv.h"
+#include "endian.h"
+#include "thread.h"
+#include "topology.h"
+#include "io.h"
+
+#ifdef WITH_CRYPTOPP
+#include "sha3_cryptopp.h"
+#else
+#include "sha3.h"
+#endif // WITH_CRYPTOPP
+
+#define SHARD_MAX_CPUS 1024
+#define SHARD_DEFAULT_IN_FLIGHT 32
+#define SHARD_UNSEEDED UINT32_MAX
+// polls of an empty inbox before a worker sleeps
+#define SHARD_SPINS 256
+#define SHARD_PAGE_BYTES (sizeof(uint32_t) * MIX_WORDS)
+// word w of a mix spanning MIX_NODES nodes
+#define SHARD_MIX_WORD(mix, w) ((mix)[(w) / NODE_WORDS].words[(w) % NODE_WORDS])
+
+// a hash in flight: the state of etchash_hash() of internal.c between two accesses
+struct shard_job {
+	node s_mix[MIX_NODES + 1];   // the seed, then the mix
+	uint32_t slot;               // of its nonce and result in the batch
+	uint32_t access;             // the next one, SHARD_UNSEEDED before the seed is hashed
+	uint32_t index;              // page of the next access
+};
+
+struct shard_cell {
+	int32_t volatile sequence;
+	uint32_t job;
+};
+
+// bounded lock-free queue of job ids for any number of producers and
+// consumers: a cell is free to push at position p when its sequence is p and
+// holds a job to pop when it is p + 1. Positions wrap around as unsigned.
+struct shard_queue {
+	struct shard_cell* cells;
+	uint32_t mask;
+	char pad0[64];
+	int32_t volatile head;       // next push
+	char pad1[64];
+	int32_t volatile tail;       // next pop
+	char pad2[64];
+};
+
+struct shard_node;
+
+struct shard_worker {
+	struct etchash_shard* shard;
+	struct shard_node* node;
+	unsigned index;              // within its node
+	etchash_thread_t thread;
+	// written by the worker only, during a batch, and read between batches under batch_lock
+	uint64_t hashes;
+	uint64_t forwards;
+	uint64_t accesses;
+};
+
+struct shard_node {
+	unsigned id;                 // of the NUMA node, its index in emulation
+	node* data;                  // the pages [first_page, first_page + num_pages)
+	uint32_t first_page;
+	uint32_t num_pages;
+	unsigned* cpus;
+	unsigned num_cpus;
+	struct shard_queue inbox;
+	// idle workers wait for the inbox
+	etchash_mutex_t mutex;
+	etchash_cond_t wake;
+	int32_t volatile sleepers;
+	struct shard_worker* workers;
+	unsigned num_workers;
+};
+
+struct etchash_shard {
+	uint32_t num_pages;
+	etchash_divisor_t page_divisor; // num_pages, for the modulus of the page accesses
+	uint32_t pages_per_node;     // of every node but the last
+	struct shard_node* nodes;
+	unsigned num_nodes;
+	bool emulate;
+	etchash_budget_entry_t budget; // the shards of every node
+	struct shard_job* jobs;
+	uint32_t num_jobs;
+	int32_t volatile stop;
+	// the source of the pages while the workers fill their node
+	etchash_light_t light;
+	node const* source;
+	int32_t volatile filling;
+	// the batch of etchash_shard_compute(), one at a time
+	etchash_mutex_t batch_lock;
+	etchash_h256_t header_hash;
+	uint64_t const* nonces;
+	etchash_return_value_t* ret;
+	uint32_t count;
+	int32_t volatile next;       // next nonce to start
+	int32_t volatile done;       // hashes finished
+	// waits for the fill and the end of a batch
+	etchash_mutex_t mutex;
+	etchash_cond_t finished;
+};
+
+static bool shard_queue_init(struct shard_queue* queue, uint32_t capacity)
+{
+	uint32_t size = 1;
+	while (size < capacity) {
+		size <<= 1;
+	}
+	queue->cells = (struct shard_cell*)malloc(sizeof(struct shard_cell) * size);
+	if (!queue->cells) {
+		return false;
+	}
+	for (uint32_t i = 0; i != size; ++i) {
+		queue->cells[i].sequence = (int32_t)i;
+	}
+	queue->mask = size - 1;
+	queue->head = 0;
+	queue->tail = 0;
+	return true;
+}
+
+static bool shard_queue_push(struct shard_queue* queue, uint32_t job)
+{
+	uint32_t pos = (uint32_t)etchash_atomic_load(&queue->head);
+	for (;;) {
+		struct shard_cell* const cell = &queue->cells[pos & queue->mask];
+		int32_t const diff = (int32_t)((uint32_t)etchash_atomic_load(&cell->sequence) - pos);
+		if (diff == 0) {
+			if (etchash_atomic_cas(&queue->head, (int32_t)pos, (int32_t)(pos + 1))) {
+				cell->job = job;
+				etchash_atomic_store(&cell->sequence, (int32_t)(pos + 1));
+				return true;
+			}
+		} else if (diff < 0) {
+			return false;
+		}
+		pos = (uint32_t)etchash_atomic_load(&queue->head);
+	}
+}
+
+static bool shard_queue_pop(struct shard_queue* queue, uint32_t* job)
+{
+	uint32_t pos = (uint32_t)etchash_atomic_load(&queue->tail);
+	for (;;) {
+		struct shard_cell* const cell = &queue->cells[pos & queue->mask];
+		int32_t const diff = (int32_t)((uint32_t)etchash_atomic_load(&cell->sequence) - (pos + 1));
+		if (diff == 0) {
+			if (etchash_atomic_cas(&queue->tail, (int32_t)pos, (int32_t)(pos + 1))) {
+				*job = cell->job;
+				etchash_atomic_store(&cell->sequence, (int32_t)(pos + queue->mask + 1));
+				return true;
+			}
+		} else if (diff < 0) {
+			return false;
+		}
+		pos = (uint32_t)etchash_atomic_load(&queue->tail);
+	}
+}
+
+static bool shard_queue_ready(struct shard_queue* queue)
+{
+	uint32_t const pos = (uint32_t)etchash_atomic_load(&queue->tail);
+	return etchash_atomic_load(&queue->cells[pos & queue->mask].sequence) == (int32_t)(pos + 1);
+}
+
+static void shard_send(struct shard_node* target, uint32_t job)
+{
+	// the inbox of every node can hold all the jobs, it is only full while a
+	// consumer preempted between taking a cell and freeing it holds the cell
+	// one lap ahead
+	while (!shard_queue_push(&target->inbox, job)) {
+		etchash_sleep_ms(1);
+	}
+	// a sleeper counts itself before it checks the inbox, so it sees the job or is signaled
+	if (etchash_atomic_load(&target->sleepers)) {
+		etchash_mutex_lock(&target->mutex);
+		etchash_cond_signal(&target->wake);
+		etchash_mutex_unlock(&target->mutex);
+	}
+}
+
+static bool shard_next(struct shard_worker* worker, uint32_t* job)
+{
+	struct shard_node* const numa = worker->node;
+	unsigned spins = 0;
+	for (;;) {
+		if (shard_queue_pop(&numa->inbox, job)) {
+			return true;
+		}
+		if (etchash_atomic_load(&worker->shard->stop)) {
+			return false;
+		}
+		if (++spins < SHARD_SPINS) {
+			continue;
+		}
+		etchash_mutex_lock(&numa->mutex);
+		etchash_atomic_add(&numa->sleepers, 1);
+		if (!shard_queue_ready(&numa->inbox) && !etchash_atomic_load(&worker->shard->stop)) {
+			etchash_cond_timedwait(&numa->wake, &numa->mutex, 100);
+		}
+		etchash_atomic_add(&numa->sleepers, -1);
+		etchash_mutex_unlock(&numa->mutex);
+		spins = 0;
+	}
+}
+
+static uint32_t shard_index(struct etchash_shard const* shard, struct shard_job const* job)
+{
+	node const* const mix = job->s_mix + 1;
+	uint32_t const x = fnv_hash(job->s_mix[0].words[0] ^ job->access, SHARD_MIX_WORD(mix, job->access % MIX_WORDS));
+	return etchash_fastmod(x, shard->page_divisor);
+}
+
+static void shard_seed(struct etchash_shard const* shard, struct shard_job* job)
+{
+	node* const s_mix = job->s_mix;
+	memcpy(s_mix[0].bytes, &shard->header_hash, 32);
+	fix_endian64(s_mix[0].double_words[4], shard->nonces[job->slot]);
+	SHA3_512(s_mix[0].bytes, s_mix[0].bytes, 40);
+	fix_endian_arr32(s_mix[0].words, 16);
+	node* const mix = s_mix + 1;
+	for (uint32_t w = 0; w != MIX_WORDS; ++w) {
+		SHARD_MIX_WORD(mix, w) = s_mix[0].words[w % NODE_WORDS];
+	}
+	job->access = 0;
+	job->index = shard_index(shard, job);
+}
+
+static void shard_finish(struct etchash_shard const* shard, struct shard_job* job)
+{
+	node* const mix = job->s_mix + 1;
+	for (uint32_t w = 0; w != MIX_WORDS; w += 4) {
+		uint32_t reduction = SHARD_MIX_WORD(mix, w + 0);
+		reduction = reduction * FNV_PRIME ^ SHARD_MIX_WORD(mix, w + 1);
+		reduction = reduction * FNV_PRIME ^ SHARD_MIX_WORD(mix, w + 2);
+		reduction = reduction * FNV_PRIME ^ SHARD_MIX_WORD(mix, w + 3);
+		SHARD_MIX_WORD(mix, w / 4) = reduction;
+	}
+	fix_endian_arr32(mix->words, MIX_WORDS / 4);
+	etchash_return_value_t* const ret = &shard->ret[job->slot];
+	memcpy(&ret->mix_hash, mix->bytes, 32);
+	SHA3_256(&ret->result, job->s_mix[0].bytes, 64 + 32);
+	ret->success = true;
+}
+
+// run a job until it leaves the node, taking the next nonce of the batch when its hash is done
+static void shard_run(struct shard_worker* worker, uint32_t id)
+{
+	struct etchash_shard* const shard = worker->shard;
+	struct shard_node* const numa = worker->node;
+	struct shard_job* const job = &shard->jobs[id];
+	for (;;) {
+		if (job->access == SHARD_UNSEEDED) {
+			shard_seed(shard, job);
+		}
+		node* const mix = job->s_mix + 1;
+		while (job->access != ETCHASH_ACCESSES) {
+			uint32_t const page = job->index - numa->first_page;
+			if (page >= numa->num_pages) {
+				worker->forwards++;
+				shard_send(&shard->nodes[job->index / shard->pages_per_node], id);
+				return;
+			}
+			node const* const dag_nodes = numa->data + (size_t)page * MIX_NODES;
+			for (unsigned n = 0; n != MIX_NODES; ++n) {
+				for (unsigned w = 0; w != NODE_WORDS; ++w) {
+					mix[n].words[w] = fnv_hash(mix[n].words[w], dag_nodes[n].words[w]);
+				}
+			}
+			worker->accesses++;
+			if (++job->access != ETCHASH_ACCESSES) {
+				job->index = shard_index(shard, job);
+			}
+		}
+		shard_finish(shard, job);
+		worker->hashes++;
+		// the batch may be replaced once done reaches count, read it before
+		uint32_t const count = shard->count;
+		uint32_t const next = (uint32_t)(etchash_atomic_add(&shard->next, 1) - 1);
+		if (next < count) {
+			job->slot = next;
+			job->access = SHARD_UNSEEDED;
+			etchash_atomic_add(&shard->done, 1);
+			continue;
+		}
+		if (etchash_atomic_add(&shard->done, 1) == (int32_t)count) {
+			etchash_mutex_lock(&shard->mutex);
+			etchash_cond_broadcast(&shard->finished);
+			etchash_mutex_unlock(&shard->mutex);
+		}
+		return;
+	}
+}
+
+// write this worker's part of the node's pages, on the node when pinned
+static void shard_fill(struct shard_worker* worker)
+{
+	struct etchash_shard const* const shard = worker->shard;
+	struct shard_node* const numa = worker->node;
+	uint32_t const begin = (uint32_t)((uint64_t)numa->num_pages * worker->index / numa->num_workers);
+	uint32_t const end = (uint32_t)((uint64_t)numa->num_pages * (worker->index + 1) / numa->num_workers);
+	if (shard->source) {
+		memcpy(
+			numa->data + (size_t)begin * MIX_NODES,
+			shard->source + ((size_t)numa->first_page + begin) * MIX_NODES,
+			(size_t)(end - begin) * SHARD_PAGE_BYTES
+		);
+		return;
+	}
+	for (uint32_t i = begin * MIX_NODES; i != end * MIX_NODES; ++i) {
+		etchash_calculate_dag_item(&numa->data[i], numa->first_page * MIX_NODES + i, shard->light);
+	}
+}
+
+static void shard_worker_run(void* arg)
+{
+	struct shard_worker* const worker = (struct shard_worker*)arg;
+	struct etchash_shard* const shard = worker->shard;
+	if (!shard->emulate && worker->node->num_cpus) {
+		etchash_thread_set_affinity(worker->node->cpus, worker->node->num_cpus);
+	}
+	shard_fill(worker);
+	if (etchash_atomic_add(&shard->filling, -1) == 0) {
+		etchash_mutex_lock(&shard->mutex);
+		etchash_cond_broadcast(&shard->finished);
+		etchash_mutex_unlock(&shard->mutex);
+	}
+	uint32_t job;
+	while (shard_next(worker, &job)) {
+		shard_run(worker, job);
+	}
+}
+
+static void shard_stop(struct etchash_shard* shard)
+{
+	etchash_atomic_store(&shard->stop, 1);
+	for (unsigned i = 0; i != shard->num_nodes; ++i) {
+		struct shard_node* const numa = &shard->nodes[i];
+		etchash_mutex_lock(&numa->mutex);
+		etchash_cond_broadcast(&numa->wake);
+		etchash_mutex_unlock(&numa->mutex);
+	}
+}
+
+static void shard_free(struct etchash_shard* shard, unsigned started)
+{
+	for (unsigned i = 0; i != shard->num_nodes; ++i) {
+		struct shard_node* const numa = &shard->nodes[i];
+		for (unsigned w = 0; w != numa->num_workers && started; ++w, --started) {
+			etchash_thread_join(numa->workers[w].thread);
+		}
+	}
+	for (unsigned i = 0; i != shard->num_nodes; ++i) {
+		struct shard_node* const numa = &shard->nodes[i];
+		free(numa->data);
+		free(numa->cpus);
+		free(numa->inbox.cells);
+		free(numa->workers);
+		etchash_cond_destroy(&numa->wake);
+		etchash_mutex_destroy(&numa->mutex);
+	}
+	free(shard->nodes);
+	free(shard->jobs);
+	if (shard->budget) {
+		etchash_budget_release(shard->budget);
+	}
+	etchash_cond_destroy(&shard->finished);
+	etchash_mutex_destroy(&shard->mutex);
+	etchash_mutex_destroy(&shard->batch_lock);
+	free(shard);
+}
+
+static etchash_shard_t shard_new(
+	uint64_t full_size,
+	uint64_t epoch,
+	etchash_light_t light,
+	node const* source,
+	etchash_shard_options_t const* options
+)
+{
+	etchash_shard_options_t const defaults = {0};
+	if (!options) {
+		options = &defaults;
+	}
+	uint64_t const num_pages = full_size / SHARD_PAGE_BYTES;
+	if (full_size % MIX_WORDS != 0 || num_pages == 0 || num_pages > UINT32_MAX) {
+		return NULL;
+	}
+
+	unsigned ids[ETCHASH_SHARD_MAX_NODES];
+	unsigned num_nodes;
+	if (options->emulate) {
+		num_nodes = options->nodes ? options->nodes : 2;
+		num_nodes = num_nodes < ETCHASH_SHARD_MAX_NODES ? num_nodes : ETCHASH_SHARD_MAX_NODES;
+		for (unsigned i = 0; i != num_nodes; ++i) {
+			ids[i] = i;
+		}
+	} else {
+		num_nodes = etchash_topology_numa_nodes(ids, ETCHASH_SHARD_MAX_NODES);
+		if (!num_nodes) {
+			ids[0] = 0;
+			num_nodes = 1;
+		}
+		if (options->nodes && options->nodes < num_nodes) {
+			num_nodes = options->nodes;
+		}
+	}
+	// every node gets at least one page
+	uint32_t const pages_per_node = (uint32_t)((num_pages + num_nodes - 1) / num_nodes);
+	num_nodes = (unsigned)((num_pages + pages_per_node - 1) / pages_per_node);
+
+	struct etchash_shard* shard = (struct etchash_shard*)calloc(1, sizeof(*shard));
+	if (!shard) {
+		return NULL;
+	}
+	shard->num_pages = (uint32_t)num_pages;
+	shard->page_divisor = etchash_divisor_make(shard->num_pages);
+	shard->pages_per_node = pages_per_node;
+	shard->emulate = options->emulate;
+	shard->light = light;
+	shard->source = source;
+	etchash_mutex_init(&shard->batch_lock);
+	etchash_mutex_init(&shard->mutex);
+	etchash_cond_init(&shard->finished);
+	shard->nodes = (struct shard_node*)calloc(num_nodes, sizeof(struct shard_node));
+	if (!shard->nodes) {
+		shard_free(shard, 0);
+		return NULL;
+	}
+	shard->num_nodes = num_nodes;
+	shard->budget = etchash_budget_acquire(ETCHASH_BUDGET_DAG, num_pages * SHARD_PAGE_BYTES, epoch, false);
+	if (!shard->budget) {
+		ETCHASH_CRITICAL("Sharded DAG of %llu bytes does not fit the memory budget.", (unsigned long long)full_size);
+		shard_free(shard, 0);
+		return NULL;
+	}
+
+	unsigned num_workers = 0;
+	for (unsigned i = 0; i != num_nodes; ++i) {
+		struct shard_node* const numa = &shard->nodes[i];
+		etchash_mutex_init(&numa->mutex);
+		etchash_cond_init(&numa->wake);
+		numa->id = ids[i];
+		numa->first_page = pages_per_node * i;
+		numa->num_pages = i + 1 == num_nodes ? shard->num_pages - numa->first_page : pages_per_node;
+		if (!options->emulate) {
+			numa->cpus = (unsigned*)malloc(sizeof(unsigned) * SHARD_MAX_CPUS);
+			numa->num_cpus = numa->cpus ? etchash_topology_numa_cpus(numa->id, numa->cpus, SHARD_MAX_CPUS) : 0;
+		}
+		numa->num_workers = options->threads_per_node;
+		if (!numa->num_workers) {
+			numa->num_workers = numa->num_cpus ? numa->num_cpus : etchash_cpu_count() / num_nodes;
+			numa->num_workers = numa->num_workers ? numa->num_workers : 1;
+		}
+		num_workers += numa->num_workers;
+		// not touched before the workers fill it
+		numa->data = (node*)malloc((size_t)numa->num_pages * SHARD_PAGE_BYTES);
+		numa->workers = (struct shard_worker*)calloc(numa->num_workers, sizeof(struct shard_worker));
+		if (!numa->data || !numa->workers) {
+			shard_free(shard, 0);
+			return NULL;
+		}
+	}
+
+	shard->num_jobs = num_workers * (options->in_flight ? options->in_flight : SHARD_DEFAULT_IN_FLIGHT);
+	shard->jobs = (struct shard_job*)malloc(sizeof(struct shard_job) * shard->num_jobs);
+	if (!shard->jobs) {
+		shard_free(shard, 0);
+		return NULL;
+	}
+	for (unsigned i = 0; i != num_nodes; ++i) {
+		if (!shard_queue_init(&shard->nodes[i].inbox, shard->num_jobs * 2)) {
+			shard_free(shard, 0);
+			return NULL;
+		}
+	}
+
+	shard->filling = (int32_t)num_workers;
+	unsigned started = 0;
+	for (unsigned i = 0; i != num_nodes; ++i) {
+		struct shard_node* const numa = &shard->nodes[i];
+		for (unsigned w = 0; w != numa->num_workers; ++w) {
+			struct shard_worker* const worker = &numa->workers[w];
+			worker->shard = shard;
+			worker->node = numa;
+			worker->index = w;
+			if (!etchash_thread_create(&worker->thread, shard_worker_run, worker)) {
+				ETCHASH_CRITICAL("Could not start a worker of the sharded DAG");
+				// the started ones finish their part before they see the stop
+				shard_stop(shard);
+				shard_free(shard, started);
+				return NULL;
+			}
+			started++;
+		}
+	}
+	etchash_mutex_lock(&shard->mutex);
+	while (etchash_atomic_load(&shard->filling) != 0) {
+		etchash_cond_wait(&shard->finished, &shard->mutex);
+	}
+	etchash_mutex_unlock(&shard->mutex);
+	shard->light = NULL;
+	shard->source = NULL;
+	return shard;
+}
+
+etchash_shard_t etchash_shard_new(
+	etchash_light_t light,
+	uint64_t full_size,
+	etchash_shard_options_t const* options
+)
+{
+	if (!light) {
+		return NULL;
+	}
+	return shard_new(full_size, get_epoch_number(light->block_number), light, NULL, options);
+}
+
+etchash_shard_t etchash_shard_new_from_full(etchash_full_t full, etchash_shard_options_t const* options)
+{
+	if (!full) {
+		return NULL;
+	}
+	// the epoch only ranks eviction victims, and shards are never evicted
+	return shard_new(full->file_size, 0, NULL, full->data, options);
+}
+
+void etchash_shard_delete(etchash_shard_t shard)
+{
+	unsigned workers = 0;
+	for (unsigned i = 0; i != shard->num_nodes; ++i) {
+		workers += shard->nodes[i].num_workers;
+	}
+	shard_stop(shard);
+	shard_free(shard, workers);
+}
+
+bool etchash_shard_compute(
+	etchash_shard_t shard,
+	etchash_h256_t const header_hash,
+	uint64_t const* nonces,
+	uint32_t count,
+	etchash_return_value_t* ret
+)
+{
+	if (count > INT32_MAX / 2) {
+		return false;
+	}
+	if (!count) {
+		return true;
+	}
+	etchash_mutex_lock(&shard->batch_lock);
+	shard->header_hash = header_hash;
+	shard->nonces = nonces;
+	shard->ret = ret;
+	shard->count = count;
+	uint32_t const started = count < shard->num_jobs ? count : shard->num_jobs;
+	etchash_atomic_store(&shard->next, (int32_t)started);
+	etchash_atomic_store(&shard->done, 0);
+	// unseeded jobs go round the nodes, the seed hash is Keccak bound and runs anywhere
+	for (uint32_t i = 0; i != started; ++i) {
+		shard->jobs[i].slot = i;
+		shard->jobs[i].access = SHARD_UNSEEDED;
+		shard_send(&shard->nodes[i % shard->num_nodes], i);
+	}
+	etchash_mutex_lock(&shard->mutex);
+	while (etchash_atomic_load(&shard->done) != (int32_t)count) {
+		etchash_cond_wait(&shard->finished, &shard->mutex);
+	}
+	etchash_mutex_unlock(&shard->mutex);
+	etchash_mutex_unlock(&shard->batch_lock);
+	return true;
+}
+
+void etchash_shard_stats(etchash_shard_t shard, etchash_shard_stats_t* stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	// every count of a batch was written before its last hash was done
+	etchash_mutex_lock(&shard->batch_lock);
+	stats->nodes = shard->num_nodes;
+	for (unsigned i = 0; i != shard->num_nodes; ++i) {
+		struct shard_node const* const numa = &shard->nodes[i];
+		stats->shard_bytes[i] = (uint64_t)numa->num_pages * SHARD_PAGE_BYTES;
+		for (unsigned w = 0; w != numa->num_workers; ++w) {
+			stats->hashes += numa->workers[w].hashes;
+			stats->forwards += numa->workers[w].forwards;
+			stats->accesses[i] += numa->workers[w].accesses;
+		}
+	}
+	etchash_mutex_unlock(&shard->batch_lock);
+}
@@ -0,0 +1,118 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file shard.h
+ * @date 2026
+ *
+ * A full mode engine that shards the DAG over NUMA nodes instead of
+ * replicating or interleaving it.
+ *
+ * Every node holds a contiguous range of the DAG pages, written by the node's
+ * own workers so that first touch places them in its memory. A hash in flight
+ * runs on the workers of the node owning its next page and moves, through a
+ * lock-free queue, to the workers of another node when a page falls outside
+ * the shard. Every DAG read is local at the cost of about one move per access
+ * with two nodes, which is cheap next to a remote DRAM read as a hash is only
+ * 64 + 128 bytes of state.
+ *
+ * In emulation mode the shards are neither bound nor pinned, any number of
+ * them can be tested on a single node host.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "etchash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ETCHASH_SHARD_MAX_NODES 64
+
+typedef struct etchash_shard_options {
+	/**
+	 * Shards, 0 for every online NUMA node (2 in emulation). Not emulated,
+	 * the first @a nodes online nodes; a host without NUMA gets one shard.
+	 */
+	unsigned nodes;
+	unsigned threads_per_node;   ///< 0 for the CPUs of the node, in emulation for an even share of the CPUs
+	unsigned in_flight;          ///< Hashes in flight per worker, 0 for 32
+	bool emulate;                ///< Do not pin workers to the CPUs of their node
+} etchash_shard_options_t;
+
+typedef struct etchash_shard_stats {
+	unsigned nodes;
+	uint64_t hashes;
+	uint64_t forwards;                                   ///< Moves of a hash to another node
+	uint64_t accesses[ETCHASH_SHARD_MAX_NODES];          ///< DAG page reads per node, all local
+	uint64_t shard_bytes[ETCHASH_SHARD_MAX_NODES];
+} etchash_shard_stats_t;
+
+typedef struct etchash_shard* etchash_shard_t;
+
+/**
+ * Create an engine and generate the shards of a DAG on their nodes
+ *
+ * @param light     Cache of the epoch, only used until this returns
+ * @param full_size The size of the DAG in bytes
+ * @param options   NULL for the defaults
+ * @return          The engine or NULL in failure, also when the shards do not
+ *                  fit the memory budget (see budget.h), where they count as a DAG
+ */
+etchash_shard_t etchash_shard_new(
+	etchash_light_t light,
+	uint64_t full_size,
+	etchash_shard_options_t const* options
+);
+
+/**
+ * Create an engine with the shards copied from a DAG, for instance one
+ * loaded from disk, which may be deleted after this returns
+ */
+etchash_shard_t etchash_shard_new_from_full(etchash_full_t full, etchash_shard_options_t const* options);
+
+/**
+ * Stop the workers and free the shards
+ */
+void etchash_shard_delete(etchash_shard_t shard);
+
+/**
+ * Hash @a count nonces, bit exact with @ref etchash_full_compute() for each
+ *
+ * Returns when every hash is done. Calls from several threads run one after
+ * another.
+ *
+ * @param nonces     @a count nonces, below 2^31 of them
+ * @param[out] ret   @a count results, in the order of @a nonces
+ * @return           false for an invalid count
+ */
+bool etchash_shard_compute(
+	etchash_shard_t shard,
+	etchash_h256_t const header_hash,
+	uint64_t const* nonces,
+	uint32_t count,
+	etchash_return_value_t* ret
+);
+
+/**
+ * Get the totals since creation, waiting for a running batch of
+ * @ref etchash_shard_compute() to finish
+ */
+void etchash_shard_stats(etchash_shard_t shard, etchash_shard_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
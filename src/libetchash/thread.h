@@ -0,0 +1,240 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file thread.h
+ * @date 2026
+ *
+ * Minimal cross-platform threading primitives used by the parts of etchash
+ * that do work on more than one core.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "compiler.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+typedef HANDLE etchash_thread_t;
+typedef CRITICAL_SECTION etchash_mutex_t;
+typedef CONDITION_VARIABLE etchash_cond_t;
+typedef SRWLOCK etchash_rwlock_t;
+#define ETCHASH_RWLOCK_INITIALIZER SRWLOCK_INIT
+#else
+#include <pthread.h>
+typedef pthread_t etchash_thread_t;
+typedef pthread_mutex_t etchash_mutex_t;
+typedef pthread_cond_t etchash_cond_t;
+typedef pthread_rwlock_t etchash_rwlock_t;
+#define ETCHASH_RWLOCK_INITIALIZER PTHREAD_RWLOCK_INITIALIZER
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*etchash_thread_fn)(void* arg);
+
+/**
+ * Start a new thread
+ *
+ * @param[out] thread    The handle of the started thread
+ * @param[in] fn         The function to run in the thread
+ * @param[in] arg        The argument handed to @a fn
+ * @return               true if the thread was started
+ */
+bool etchash_thread_create(etchash_thread_t* thread, etchash_thread_fn fn, void* arg);
+/**
+ * Wait for a thread started with @ref etchash_thread_create() to finish
+ */
+void etchash_thread_join(etchash_thread_t thread);
+
+void etchash_mutex_init(etchash_mutex_t* mutex);
+void etchash_mutex_destroy(etchash_mutex_t* mutex);
+void etchash_mutex_lock(etchash_mutex_t* mutex);
+void etchash_mutex_unlock(etchash_mutex_t* mutex);
+
+void etchash_cond_init(etchash_cond_t* cond);
+void etchash_cond_destroy(etchash_cond_t* cond);
+void etchash_cond_wait(etchash_cond_t* cond, etchash_mutex_t* mutex);
+/**
+ * Wait on a condition for at most @a timeout_ms milliseconds
+ *
+ * @return               false if the wait timed out
+ */
+bool etchash_cond_timedwait(etchash_cond_t* cond, etchash_mutex_t* mutex, uint32_t timeout_ms);
+void etchash_cond_signal(etchash_cond_t* cond);
+void etchash_cond_broadcast(etchash_cond_t* cond);
+
+/**
+ * Reader/writer locks, only created statically with ETCHASH_RWLOCK_INITIALIZER
+ * so they need neither initialization nor destruction
+ */
+void etchash_rwlock_read_lock(etchash_rwlock_t* lock);
+void etchash_rwlock_read_unlock(etchash_rwlock_t* lock);
+void etchash_rwlock_write_lock(etchash_rwlock_t* lock);
+void etchash_rwlock_write_unlock(etchash_rwlock_t* lock);
+
+/**
+ * Get the number of logical CPUs available to the process
+ *
+ * @return               The number of CPUs, at least 1
+ */
+unsigned etchash_cpu_count(void);
+
+/**
+ * Suspend the calling thread for @a ms milliseconds
+ */
+void etchash_sleep_ms(uint32_t ms);
+
+/**
+ * Move the calling thread to or from the lowest scheduling priority
+ *
+ * Going back to normal priority may need privileges the process lacks.
+ *
+ * @param background     true for idle priority, false for normal priority
+ * @return               true if the priority was changed
+ */
+bool etchash_thread_set_background(bool background);
+
+/**
+ * Pin the calling thread to a set of CPUs
+ *
+ * Not supported outside Linux and Windows, and on Windows for the first 64 CPUs only.
+ *
+ * @param cpus           Indices of the CPUs
+ * @param count          Number of CPUs
+ * @return               true if the affinity was changed
+ */
+bool etchash_thread_set_affinity(unsigned const* cpus, unsigned count);
+
+/**
+ * Atomically add @a delta to @a value
+ *
+ * @return               The new value
+ */
+static inline int32_t etchash_atomic_add(int32_t volatile* value, int32_t delta)
+{
+#if defined(_WIN32)
+	return (int32_t)InterlockedExchangeAdd((LONG volatile*)value, delta) + delta;
+#else
+	return __atomic_add_fetch(value, delta, __ATOMIC_SEQ_CST);
+#endif
+}
+
+/**
+ * Atomically add @a delta to a 64 bit @a value
+ *
+ * @return               The new value
+ */
+static inline uint64_t etchash_atomic_add_u64(uint64_t volatile* value, uint64_t delta)
+{
+#if defined(_WIN32)
+	return (uint64_t)InterlockedExchangeAdd64((LONG64 volatile*)value, (LONG64)delta) + delta;
+#else
+	return __atomic_add_fetch(value, delta, __ATOMIC_SEQ_CST);
+#endif
+}
+
+static inline int32_t etchash_atomic_load(int32_t volatile* value)
+{
+#if defined(_WIN32)
+	return (int32_t)InterlockedCompareExchange((LONG volatile*)value, 0, 0);
+#else
+	return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+static inline uint64_t etchash_atomic_load_u64(uint64_t volatile* value)
+{
+#if defined(_WIN32)
+	return (uint64_t)InterlockedCompareExchange64((LONG64 volatile*)value, 0, 0);
+#else
+	return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+static inline void etchash_atomic_store_u64(uint64_t volatile* value, uint64_t desired)
+{
+#if defined(_WIN32)
+	InterlockedExchange64((LONG64 volatile*)value, (LONG64)desired);
+#else
+	__atomic_store_n(value, desired, __ATOMIC_SEQ_CST);
+#endif
+}
+
+static inline void etchash_atomic_store(int32_t volatile* value, int32_t desired)
+{
+#if defined(_WIN32)
+	InterlockedExchange((LONG volatile*)value, desired);
+#else
+	__atomic_store_n(value, desired, __ATOMIC_SEQ_CST);
+#endif
+}
+
+/**
+ * Atomically replace @a value by @a desired if it is @a expected
+ *
+ * @return               true if it was replaced
+ */
+static inline bool etchash_atomic_cas(int32_t volatile* value, int32_t expected, int32_t desired)
+{
+#if defined(_WIN32)
+	return InterlockedCompareExchange((LONG volatile*)value, desired, expected) == expected;
+#else
+	return __atomic_compare_exchange_n(value, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+#endif
+}
+
+/**
+ * Take a spin lock, yielding while another thread holds it
+ *
+ * A spin lock is a zero initialized int32_t, so unlike a mutex it needs no
+ * initialization on any platform and suits static locks of state that changes
+ * rarely.
+ */
+static inline void etchash_spin_lock(int32_t volatile* lock)
+{
+	while (!etchash_atomic_cas(lock, 0, 1)) {
+		etchash_sleep_ms(0);
+	}
+}
+
+static inline void etchash_spin_unlock(int32_t volatile* lock)
+{
+	etchash_atomic_store(lock, 0);
+}
+
+static inline void* etchash_atomic_exchange_ptr(void* volatile* value, void* desired)
+{
+#if defined(_WIN32)
+	return InterlockedExchangePointer((PVOID volatile*)value, desired);
+#else
+	return __atomic_exchange_n(value, desired, __ATOMIC_SEQ_CST);
+#endif
+}
+
+static inline void* etchash_atomic_load_ptr(void* volatile* value)
+{
+#if defined(_WIN32)
+	return InterlockedCompareExchangePointer((PVOID volatile*)value, NULL, NULL);
+#else
+	return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,196 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file thread_posix.c
+ * @date 2026
+ */
+
+#include "thread.h"
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+#if defined(__linux__) && !defined(SCHED_IDLE)
+// only exposed with _GNU_SOURCE
+#define SCHED_IDLE 5
+#endif
+
+struct etchash_thread_start {
+	etchash_thread_fn fn;
+	void* arg;
+};
+
+static void* etchash_thread_trampoline(void* arg)
+{
+	struct etchash_thread_start start = *(struct etchash_thread_start*)arg;
+	free(arg);
+	start.fn(start.arg);
+	return NULL;
+}
+
+bool etchash_thread_create(etchash_thread_t* thread, etchash_thread_fn fn, void* arg)
+{
+	struct etchash_thread_start* start = malloc(sizeof(*start));
+	if (!start) {
+		return false;
+	}
+	start->fn = fn;
+	start->arg = arg;
+	if (pthread_create(thread, NULL, etchash_thread_trampoline, start) != 0) {
+		free(start);
+		return false;
+	}
+	return true;
+}
+
+void etchash_thread_join(etchash_thread_t thread)
+{
+	pthread_join(thread, NULL);
+}
+
+void etchash_mutex_init(etchash_mutex_t* mutex)
+{
+	pthread_mutex_init(mutex, NULL);
+}
+
+void etchash_mutex_destroy(etchash_mutex_t* mutex)
+{
+	pthread_mutex_destroy(mutex);
+}
+
+void etchash_mutex_lock(etchash_mutex_t* mutex)
+{
+	pthread_mutex_lock(mutex);
+}
+
+void etchash_mutex_unlock(etchash_mutex_t* mutex)
+{
+	pthread_mutex_unlock(mutex);
+}
+
+void etchash_rwlock_read_lock(etchash_rwlock_t* lock)
+{
+	pthread_rwlock_rdlock(lock);
+}
+
+void etchash_rwlock_read_unlock(etchash_rwlock_t* lock)
+{
+	pthread_rwlock_unlock(lock);
+}
+
+void etchash_rwlock_write_lock(etchash_rwlock_t* lock)
+{
+	pthread_rwlock_wrlock(lock);
+}
+
+void etchash_rwlock_write_unlock(etchash_rwlock_t* lock)
+{
+	pthread_rwlock_unlock(lock);
+}
+
+void etchash_cond_init(etchash_cond_t* cond)
+{
+	pthread_cond_init(cond, NULL);
+}
+
+void etchash_cond_destroy(etchash_cond_t* cond)
+{
+	pthread_cond_destroy(cond);
+}
+
+void etchash_cond_wait(etchash_cond_t* cond, etchash_mutex_t* mutex)
+{
+	pthread_cond_wait(cond, mutex);
+}
+
+bool etchash_cond_timedwait(etchash_cond_t* cond, etchash_mutex_t* mutex, uint32_t timeout_ms)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += timeout_ms / 1000;
+	ts.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+	if (ts.tv_nsec >= 1000000000L) {
+		ts.tv_sec += 1;
+		ts.tv_nsec -= 1000000000L;
+	}
+	return pthread_cond_timedwait(cond, mutex, &ts) != ETIMEDOUT;
+}
+
+void etchash_cond_signal(etchash_cond_t* cond)
+{
+	pthread_cond_signal(cond);
+}
+
+void etchash_cond_broadcast(etchash_cond_t* cond)
+{
+	pthread_cond_broadcast(cond);
+}
+
+unsigned etchash_cpu_count(void)
+{
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (unsigned)n : 1;
+}
+
+void etchash_sleep_ms(uint32_t ms)
+{
+	struct timespec ts;
+	ts.tv_sec = ms / 1000;
+	ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+	while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+	}
+}
+
+bool etchash_thread_set_background(bool background)
+{
+	struct sched_param param;
+	param.sched_priority = 0;
+#if defined(SCHED_IDLE)
+	int policy = background ? SCHED_IDLE : SCHED_OTHER;
+#else
+	int policy = SCHED_OTHER;
+	if (background) {
+		param.sched_priority = sched_get_priority_min(SCHED_OTHER);
+	}
+#endif
+	return pthread_setschedparam(pthread_self(), policy, &param) == 0;
+}
+
+bool etchash_thread_set_affinity(unsigned const* cpus, unsigned count)
+{
+#if defined(__linux__) && defined(SYS_sched_setaffinity)
+	// the raw call, cpu_set_t needs _GNU_SOURCE which the unity builds cannot set
+	unsigned long mask[1024 / (8 * sizeof(unsigned long))] = {0};
+	unsigned const bits = 8 * sizeof(unsigned long);
+	bool any = false;
+	for (unsigned i = 0; i != count; ++i) {
+		if (cpus[i] < 1024) {
+			mask[cpus[i] / bits] |= 1UL << (cpus[i] % bits);
+			any = true;
+		}
+	}
+	return any && syscall(SYS_sched_setaffinity, 0, sizeof(mask), mask) == 0;
+#else
+	(void)cpus;
+	(void)count;
+	return false;
+#endif
+}
@@ -0,0 +1,157 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file thread_win32.c
+ * @date 2026
+ */
+
+#include "thread.h"
+#include <stdlib.h>
+
+struct etchash_thread_start {
+	etchash_thread_fn fn;
+	void* arg;
+};
+
+static DWORD WINAPI etchash_thread_trampoline(LPVOID arg)
+{
+	struct etchash_thread_start start = *(struct etchash_thread_start*)arg;
+	free(arg);
+	start.fn(start.arg);
+	return 0;
+}
+
+bool etchash_thread_create(etchash_thread_t* thread, etchash_thread_fn fn, void* arg)
+{
+	struct etchash_thread_start* start = malloc(sizeof(*start));
+	if (!start) {
+		return false;
+	}
+	start->fn = fn;
+	start->arg = arg;
+	*thread = CreateThread(NULL, 0, etchash_thread_trampoline, start, 0, NULL);
+	if (*thread == NULL) {
+		free(start);
+		return false;
+	}
+	return true;
+}
+
+void etchash_thread_join(etchash_thread_t thread)
+{
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+}
+
+void etchash_mutex_init(etchash_mutex_t* mutex)
+{
+	InitializeCriticalSection(mutex);
+}
+
+void etchash_mutex_destroy(etchash_mutex_t* mutex)
+{
+	DeleteCriticalSection(mutex);
+}
+
+void etchash_mutex_lock(etchash_mutex_t* mutex)
+{
+	EnterCriticalSection(mutex);
+}
+
+void etchash_mutex_unlock(etchash_mutex_t* mutex)
+{
+	LeaveCriticalSection(mutex);
+}
+
+void etchash_rwlock_read_lock(etchash_rwlock_t* lock)
+{
+	AcquireSRWLockShared(lock);
+}
+
+void etchash_rwlock_read_unlock(etchash_rwlock_t* lock)
+{
+	ReleaseSRWLockShared(lock);
+}
+
+void etchash_rwlock_write_lock(etchash_rwlock_t* lock)
+{
+	AcquireSRWLockExclusive(lock);
+}
+
+void etchash_rwlock_write_unlock(etchash_rwlock_t* lock)
+{
+	ReleaseSRWLockExclusive(lock);
+}
+
+void etchash_cond_init(etchash_cond_t* cond)
+{
+	InitializeConditionVariable(cond);
+}
+
+void etchash_cond_destroy(etchash_cond_t* cond)
+{
+	// condition variables need no cleanup on windows
+	(void)cond;
+}
+
+void etchash_cond_wait(etchash_cond_t* cond, etchash_mutex_t* mutex)
+{
+	SleepConditionVariableCS(cond, mutex, INFINITE);
+}
+
+bool etchash_cond_timedwait(etchash_cond_t* cond, etchash_mutex_t* mutex, uint32_t timeout_ms)
+{
+	return SleepConditionVariableCS(cond, mutex, timeout_ms) != 0;
+}
+
+void etchash_cond_signal(etchash_cond_t* cond)
+{
+	WakeConditionVariable(cond);
+}
+
+void etchash_cond_broadcast(etchash_cond_t* cond)
+{
+	WakeAllConditionVariable(cond);
+}
+
+unsigned etchash_cpu_count(void)
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors > 0 ? (unsigned)info.dwNumberOfProcessors : 1;
+}
+
+void etchash_sleep_ms(uint32_t ms)
+{
+	Sleep(ms);
+}
+
+bool etchash_thread_set_background(bool background)
+{
+	int priority = background ? THREAD_PRIORITY_IDLE : THREAD_PRIORITY_NORMAL;
+	return SetThreadPriority(GetCurrentThread(), priority) != 0;
+}
+
+bool etchash_thread_set_affinity(unsigned const* cpus, unsigned count)
+{
+	DWORD_PTR mask = 0;
+	for (unsigned i = 0; i != count; ++i) {
+		if (cpus[i] < 8 * sizeof(DWORD_PTR)) {
+			mask |= (DWORD_PTR)1 << cpus[i];
+		}
+	}
+	return mask && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+}
@@ -0,0 +1,141 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file topology.c
+ * @date 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "topology.h"
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+unsigned etchash_cpulist_parse(char const* list, unsigned* cpus, unsigned max)
+{
+	unsigned count = 0;
+	char const* p = list;
+	while (*p && *p != '\n') {
+		char* end;
+		unsigned long first = strtoul(p, &end, 10);
+		unsigned long last = first;
+		if (end == p) {
+			break;
+		}
+		p = end;
+		if (*p == '-') {
+			last = strtoul(p + 1, &end, 10);
+			p = end;
+		}
+		for (unsigned long cpu = first; cpu <= last && count < max; ++cpu) {
+			cpus[count++] = (unsigned)cpu;
+		}
+		if (*p == ',') {
+			++p;
+		}
+	}
+	return count;
+}
+
+#if defined(__linux__)
+static unsigned topology_read_cpulist(char const* path, unsigned* cpus, unsigned max)
+{
+	char list[4096];
+	FILE* f = fopen(path, "r");
+	if (!f) {
+		return 0;
+	}
+	size_t n = fread(list, 1, sizeof(list) - 1, f);
+	fclose(f);
+	list[n] = '\0';
+	return etchash_cpulist_parse(list, cpus, max);
+}
+#endif
+
+unsigned etchash_topology_numa_nodes(unsigned* nodes, unsigned max)
+{
+#if defined(__linux__)
+	return topology_read_cpulist("/sys/devices/system/node/online", nodes, max);
+#else
+	(void)nodes;
+	(void)max;
+	return 0;
+#endif
+}
+
+unsigned etchash_topology_numa_cpus(unsigned node, unsigned* cpus, unsigned max)
+{
+#if defined(__linux__)
+	char path[96];
+	snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", node);
+	return topology_read_cpulist(path, cpus, max);
+#else
+	(void)node;
+	(void)cpus;
+	(void)max;
+	return 0;
+#endif
+}
+
+unsigned etchash_topology_smt_pairs(unsigned* first, unsigned* second, unsigned max)
+{
+	unsigned count = 0;
+#if defined(__linux__)
+	unsigned online[1024];
+	unsigned siblings[64];
+	unsigned const num_online = topology_read_cpulist("/sys/devices/system/cpu/online", online, 1024);
+	for (unsigned i = 0; i < num_online && count < max; ++i) {
+		char path[96];
+		snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/thread_siblings_list", online[i]);
+		unsigned const n = topology_read_cpulist(path, siblings, 64);
+		// every core once, from its first hyperthread
+		if (n >= 2 && siblings[0] == online[i]) {
+			first[count] = siblings[0];
+			second[count] = siblings[1];
+			count++;
+		}
+	}
+#elif defined(_WIN32)
+	DWORD size = 0;
+	GetLogicalProcessorInformation(NULL, &size);
+	SYSTEM_LOGICAL_PROCESSOR_INFORMATION* info = (SYSTEM_LOGICAL_PROCESSOR_INFORMATION*)malloc(size);
+	if (!info || !GetLogicalProcessorInformation(info, &size)) {
+		free(info);
+		return 0;
+	}
+	for (DWORD i = 0; i < size / sizeof(*info) && count < max; ++i) {
+		if (info[i].Relationship != RelationProcessorCore) {
+			continue;
+		}
+		unsigned found = 0;
+		for (unsigned bit = 0; bit < sizeof(ULONG_PTR) * 8 && found < 2; ++bit) {
+			if (info[i].ProcessorMask & ((ULONG_PTR)1 << bit)) {
+				(found++ ? second : first)[count] = bit;
+			}
+		}
+		if (found == 2) {
+			count++;
+		}
+	}
+	free(info);
+#else
+	(void)first;
+	(void)second;
+	(void)max;
+#endif
+	return count;
+}
@@ -0,0 +1,63 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file topology.h
+ * @date 2026
+ *
+ * The CPU layout of the host, as far as the library places its threads.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Parse a Linux cpulist such as "0-3,8-11"
+ *
+ * @return      The number of CPUs written to @a cpus
+ */
+unsigned etchash_cpulist_parse(char const* list, unsigned* cpus, unsigned max);
+
+/**
+ * Get the online NUMA nodes (Linux only)
+ *
+ * @return      The number of nodes written to @a nodes, 0 if unknown
+ */
+unsigned etchash_topology_numa_nodes(unsigned* nodes, unsigned max);
+
+/**
+ * Get the CPUs of a NUMA node (Linux only)
+ *
+ * @return      The number of CPUs written to @a cpus, 0 if unknown
+ */
+unsigned etchash_topology_numa_cpus(unsigned node, unsigned* cpus, unsigned max);
+
+/**
+ * Get the two hyperthreads of every core with simultaneous multithreading.
+ * Cores with more than two keep their first two.
+ *
+ * @param[out] first    The first hyperthread of core i
+ * @param[out] second   Its sibling
+ * @return              The number of cores written, 0 without SMT or if unknown
+ */
+unsigned etchash_topology_smt_pairs(unsigned* first, unsigned* second, unsigned max);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,306 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file trace.c
+ * @date 2026
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "trace.h"
+#include "internal.h"
+#include "thread.h"
+#include "io.h"
+
+struct etchash_trace {
+	etchash_mutex_t mutex;
+	etchash_trace_record_t* ring;
+	uint64_t capacity;
+	uint64_t count;  // records appended so far
+	FILE* file;
+};
+
+typedef struct trace_file_header {
+	uint64_t magic;
+	uint32_t version;
+	uint32_t record_size;
+	uint64_t full_size;
+} trace_file_header_t;
+
+etchash_trace_t etchash_trace_new(uint64_t capacity)
+{
+	if (capacity == 0) {
+		return NULL;
+	}
+	struct etchash_trace* trace = calloc(sizeof(*trace), 1);
+	if (!trace) {
+		return NULL;
+	}
+	trace->ring = malloc((size_t)(capacity * sizeof(etchash_trace_record_t)));
+	if (!trace->ring) {
+		free(trace);
+		return NULL;
+	}
+	trace->capacity = capacity;
+	etchash_mutex_init(&trace->mutex);
+	return trace;
+}
+
+etchash_trace_t etchash_trace_open(char const* path, uint64_t full_size)
+{
+	struct etchash_trace* trace = calloc(sizeof(*trace), 1);
+	if (!trace) {
+		return NULL;
+	}
+	trace->file = etchash_fopen(path, "wb");
+	if (!trace->file) {
+		ETCHASH_CRITICAL("Could not create trace file: \"%s\"", path);
+		free(trace);
+		return NULL;
+	}
+	trace_file_header_t header;
+	memset(&header, 0, sizeof(header));
+	header.magic = ETCHASH_TRACE_MAGIC_NUM;
+	header.version = ETCHASH_TRACE_VERSION;
+	header.record_size = sizeof(etchash_trace_record_t);
+	header.full_size = full_size;
+	if (fwrite(&header, sizeof(header), 1, trace->file) != 1) {
+		ETCHASH_CRITICAL("Could not write trace file header: \"%s\"", path);
+		fclose(trace->file);
+		free(trace);
+		return NULL;
+	}
+	etchash_mutex_init(&trace->mutex);
+	return trace;
+}
+
+void etchash_trace_delete(etchash_trace_t trace)
+{
+	if (trace->file) {
+		fclose(trace->file);
+	}
+	etchash_mutex_destroy(&trace->mutex);
+	free(trace->ring);
+	free(trace);
+}
+
+void etchash_trace_append(
+	etchash_trace_t trace,
+	uint64_t nonce,
+	uint32_t flags,
+	uint32_t const pages[ETCHASH_ACCESSES]
+)
+{
+	etchash_trace_record_t record;
+	record.nonce = nonce;
+	record.flags = flags;
+	memcpy(record.pages, pages, sizeof(record.pages));
+	etchash_mutex_lock(&trace->mutex);
+	if (trace->file) {
+		if (fwrite(&record, sizeof(record), 1, trace->file) == 1) {
+			trace->count++;
+		}
+	} else {
+		trace->ring[trace->count % trace->capacity] = record;
+		trace->count++;
+	}
+	etchash_mutex_unlock(&trace->mutex);
+}
+
+uint64_t etchash_trace_count(etchash_trace_t trace)
+{
+	etchash_mutex_lock(&trace->mutex);
+	uint64_t count = trace->count;
+	if (!trace->file && count > trace->capacity) {
+		count = trace->capacity;
+	}
+	etchash_mutex_unlock(&trace->mutex);
+	return count;
+}
+
+uint64_t etchash_trace_records(etchash_trace_t trace, etchash_trace_record_t* records, uint64_t max)
+{
+	uint64_t copied = 0;
+	etchash_mutex_lock(&trace->mutex);
+	if (trace->ring) {
+		uint64_t const held = trace->count < trace->capacity ? trace->count : trace->capacity;
+		uint64_t const first = trace->count - held;
+		for (; copied != held && copied != max; ++copied) {
+			records[copied] = trace->ring[(first + copied) % trace->capacity];
+		}
+	}
+	etchash_mutex_unlock(&trace->mutex);
+	return copied;
+}
+
+bool etchash_trace_load(
+	char const* path,
+	etchash_trace_record_t** records,
+	uint64_t* count,
+	uint64_t* full_size
+)
+{
+	FILE* f = etchash_fopen(path, "rb");
+	if (!f) {
+		return false;
+	}
+	bool ret = false;
+	size_t size;
+	trace_file_header_t header;
+	if (!etchash_file_size(f, &size) ||
+		fread(&header, sizeof(header), 1, f) != 1 ||
+		header.magic != ETCHASH_TRACE_MAGIC_NUM ||
+		header.version != ETCHASH_TRACE_VERSION ||
+		header.record_size != sizeof(etchash_trace_record_t)) {
+		goto close_file;
+	}
+	*count = (size - sizeof(header)) / sizeof(etchash_trace_record_t);
+	*full_size = header.full_size;
+	*records = malloc((size_t)(*count ? *count : 1) * sizeof(etchash_trace_record_t));
+	if (!*records) {
+		goto close_file;
+	}
+	if (fread(*records, sizeof(etchash_trace_record_t), (size_t)*count, f) != *count) {
+		free(*records);
+		*records = NULL;
+		goto close_file;
+	}
+	ret = true;
+
+close_file:
+	fclose(f);
+	return ret;
+}
+
+// open addressing map from page index to the position of its last access
+typedef struct trace_reuse_map {
+	uint64_t* keys;  // page index + 1, 0 marks an empty slot
+	uint64_t* last;
+	uint64_t mask;
+} trace_reuse_map_t;
+
+static uint64_t* trace_reuse_slot(trace_reuse_map_t* map, uint64_t page, bool* found)
+{
+	uint64_t i = (page * 0x9E3779B97F4A7C15ULL) >> 20;
+	for (;; ++i) {
+		i &= map->mask;
+		if (map->keys[i] == page + 1) {
+			*found = true;
+			return &map->last[i];
+		}
+		if (map->keys[i] == 0) {
+			map->keys[i] = page + 1;
+			*found = false;
+			return &map->last[i];
+		}
+	}
+}
+
+static bool trace_bit_set(uint8_t* bitmap, uint64_t bit)
+{
+	bool const was_set = (bitmap[bit >> 3] >> (bit & 7)) & 1;
+	bitmap[bit >> 3] |= (uint8_t)(1U << (bit & 7));
+	return was_set;
+}
+
+bool etchash_trace_analyse(
+	etchash_trace_record_t const* records,
+	uint64_t count,
+	etchash_trace_layout_t const* layout,
+	etchash_trace_stats_t* stats
+)
+{
+	uint64_t const full_size = layout->full_size;
+	uint32_t const numa_nodes = layout->numa_nodes ? layout->numa_nodes : 1;
+	uint64_t const interleave = layout->interleave_bytes ? layout->interleave_bytes : 4096;
+	if (full_size < ETCHASH_MIX_BYTES || numa_nodes > ETCHASH_TRACE_MAX_NUMA_NODES) {
+		return false;
+	}
+	memset(stats, 0, sizeof(*stats));
+	uint64_t const accesses = count * ETCHASH_ACCESSES;
+	uint64_t const num_pages = full_size / ETCHASH_MIX_BYTES;
+	uint64_t const num_4k = (full_size + 4095) >> 12;
+	uint64_t const num_2m = (full_size + (1 << 21) - 1) >> 21;
+
+	trace_reuse_map_t map;
+	uint64_t slots = 16;
+	while (slots < 2 * accesses && slots < 2 * num_pages) {
+		slots <<= 1;
+	}
+	map.mask = slots - 1;
+	map.keys = calloc((size_t)slots, sizeof(uint64_t));
+	map.last = malloc((size_t)slots * sizeof(uint64_t));
+	uint8_t* seen_4k = calloc((size_t)(num_4k + 7) / 8, 1);
+	uint8_t* seen_2m = calloc((size_t)(num_2m + 7) / 8, 1);
+	bool const ok = map.keys && map.last && seen_4k && seen_2m;
+	if (!ok) {
+		goto free_mem;
+	}
+
+	double reuse_sum = 0;
+	uint64_t reuses = 0;
+	uint64_t position = 0;
+	for (uint64_t r = 0; r != count; ++r) {
+		for (unsigned i = 0; i != ETCHASH_ACCESSES; ++i, ++position) {
+			uint64_t const page = records[r].pages[i] % num_pages;
+			uint64_t const offset = page * ETCHASH_MIX_BYTES;
+			bool found;
+			uint64_t* last = trace_reuse_slot(&map, page, &found);
+			if (found) {
+				uint64_t const distance = position - *last;
+				unsigned bucket = 0;
+				while (bucket < 63 && (distance >> (bucket + 1)) != 0) {
+					bucket++;
+				}
+				stats->reuse_histogram[bucket]++;
+				reuse_sum += (double)distance;
+				reuses++;
+			} else {
+				stats->cold_accesses++;
+				stats->distinct_pages++;
+			}
+			*last = position;
+			if (!trace_bit_set(seen_4k, offset >> 12)) {
+				stats->distinct_4k++;
+			}
+			if (!trace_bit_set(seen_2m, offset >> 21)) {
+				stats->distinct_2m++;
+			}
+			stats->numa_accesses[(offset / interleave) % numa_nodes]++;
+		}
+	}
+	stats->hashes = count;
+	stats->accesses = accesses;
+	stats->mean_reuse_distance = reuses ? reuse_sum / (double)reuses : 0;
+	stats->hugepage_coverage = (double)stats->distinct_2m / (double)num_2m;
+
+free_mem:
+	free(map.keys);
+	free(map.last);
+	free(seen_4k);
+	free(seen_2m);
+	return ok;
+}
+
+void etchash_light_set_trace(etchash_light_t light, etchash_trace_t trace)
+{
+	light->trace = trace;
+}
+
+void etchash_full_set_trace(etchash_full_t full, etchash_trace_t trace)
+{
+	full->trace = trace;
+}
@@ -0,0 +1,165 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file trace.h
+ * @date 2026
+ *
+ * Opt-in recording of the DAG pages accessed by each hash.
+ *
+ * A trace is attached to a light or full handler with
+ * @ref etchash_light_set_trace() or @ref etchash_full_set_trace(). While
+ * attached, every compute call on the handler appends one record holding the
+ * ETCHASH_ACCESSES page indices in the order hashimoto read them. In light mode
+ * page i stands for the two DAG items 2i and 2i + 1 that were computed from the
+ * cache. Handlers without a trace only pay for a single NULL check per hash.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "etchash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ETCHASH_TRACE_MAGIC_NUM 0x3143525448435445  // "ETCHTRC1"
+#define ETCHASH_TRACE_VERSION 1
+#define ETCHASH_TRACE_MAX_NUMA_NODES 64
+
+/// Record flags
+#define ETCHASH_TRACE_LIGHT 1U  ///< DAG items were calculated from the cache
+
+struct etchash_trace;
+typedef struct etchash_trace* etchash_trace_t;
+
+/// The DAG pages accessed by a single hash
+typedef struct etchash_trace_record {
+	uint64_t nonce;
+	uint32_t flags;
+	uint32_t pages[ETCHASH_ACCESSES];
+} etchash_trace_record_t;
+
+/// The layout the analysis assumes for the DAG in memory
+typedef struct etchash_trace_layout {
+	uint64_t full_size;         ///< Size of the DAG in bytes
+	uint32_t numa_nodes;        ///< Nodes the DAG is interleaved across, 0 or 1 for none
+	uint64_t interleave_bytes;  ///< Interleave granularity, 0 for 4096
+} etchash_trace_layout_t;
+
+/// Result of @ref etchash_trace_analyse()
+typedef struct etchash_trace_stats {
+	uint64_t hashes;
+	uint64_t accesses;
+	uint64_t distinct_pages;      ///< Distinct ETCHASH_MIX_BYTES pages touched
+	uint64_t distinct_4k;         ///< Distinct 4 KiB pages touched, i.e. TLB entries with small pages
+	uint64_t distinct_2m;         ///< Distinct 2 MiB pages touched, i.e. TLB entries with hugepages
+	double hugepage_coverage;     ///< Fraction of the DAG covered by the touched 2 MiB pages
+	uint64_t cold_accesses;       ///< Accesses to a page for the first time
+	double mean_reuse_distance;   ///< Mean number of accesses between two accesses to a page
+	/// reuse_histogram[i] counts reuses with a distance in [2^i, 2^(i+1))
+	uint64_t reuse_histogram[64];
+	uint64_t numa_accesses[ETCHASH_TRACE_MAX_NUMA_NODES];  ///< Accesses per NUMA node
+} etchash_trace_stats_t;
+
+/**
+ * Create a trace keeping the last @a capacity records in memory
+ *
+ * @param capacity    Number of records in the ring buffer, older ones are overwritten
+ * @return            The trace or NULL for ERRNOMEM
+ */
+etchash_trace_t etchash_trace_new(uint64_t capacity);
+
+/**
+ * Create a trace appending every record to a file
+ *
+ * @param path        The file to create
+ * @param full_size   The DAG size stored in the file header for the analysis
+ * @return            The trace or NULL if the file could not be created
+ */
+etchash_trace_t etchash_trace_open(char const* path, uint64_t full_size);
+
+/**
+ * Flush and free a trace. Detach it from all handlers first.
+ */
+void etchash_trace_delete(etchash_trace_t trace);
+
+/**
+ * Append a record. Safe to call from several threads at once.
+ */
+void etchash_trace_append(
+	etchash_trace_t trace,
+	uint64_t nonce,
+	uint32_t flags,
+	uint32_t const pages[ETCHASH_ACCESSES]
+);
+
+/**
+ * Number of records held in a ring buffer trace, or written to a file trace
+ */
+uint64_t etchash_trace_count(etchash_trace_t trace);
+
+/**
+ * Copy the records of a ring buffer trace, oldest first
+ *
+ * @param[out] records   Receives at most @a max records
+ * @return               The number of records copied
+ */
+uint64_t etchash_trace_records(etchash_trace_t trace, etchash_trace_record_t* records, uint64_t max);
+
+/**
+ * Read the records of a trace file
+ *
+ * @param path             The trace file
+ * @param[out] records     Receives a malloc()ed array of records, free() it
+ * @param[out] count       Receives the number of records
+ * @param[out] full_size   Receives the DAG size from the file header
+ * @return                 false if the file is missing or not a trace
+ */
+bool etchash_trace_load(
+	char const* path,
+	etchash_trace_record_t** records,
+	uint64_t* count,
+	uint64_t* full_size
+);
+
+/**
+ * Analyse recorded accesses
+ *
+ * @param records    The records to analyse
+ * @param count      Number of records
+ * @param layout     The assumed memory layout of the DAG
+ * @param[out] stats Receives the results
+ * @return           false for ERRNOMEM or an invalid layout
+ */
+bool etchash_trace_analyse(
+	etchash_trace_record_t const* records,
+	uint64_t count,
+	etchash_trace_layout_t const* layout,
+	etchash_trace_stats_t* stats
+);
+
+/**
+ * Attach a trace to a light handler, or detach it with NULL
+ */
+void etchash_light_set_trace(etchash_light_t light, etchash_trace_t trace);
+/**
+ * Attach a trace to a full handler, or detach it with NULL
+ */
+void etchash_full_set_trace(etchash_full_t full, etchash_trace_t trace);
+
+#ifdef __cplusplus
+}
+#endif
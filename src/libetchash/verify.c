@@ -0,0 +1,382 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file verify.c
+ * @date 2026
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "verify.h"
+#include "internal.h"
+#include "background.h"
+#include "thread.h"
+
+// caches kept for epochs that have none of their own, the least recently used goes first
+#define VERIFY_BUILT_CACHES 4
+// epochs whose seed etchash_verify() remembers, the seed costs a Keccak hash per epoch since genesis
+#define VERIFY_EPOCHS 16
+
+typedef struct verify_entry {
+	void const* handle;
+	bool full;
+	etchash_h256_t seed;
+	uint64_t size;                   // DAG or cache bytes, with the seed identifies the epoch
+	int32_t volatile users;
+	uint64_t volatile last_use;      // of a cache, the light counter of the stats at its last use
+	struct verify_entry* next;
+} verify_entry_t;
+
+typedef struct verify_built {
+	etchash_h256_t seed;
+	uint64_t cache_size;
+	etchash_light_t light;           // NULL while a thread builds it
+	bool used;
+} verify_built_t;
+
+typedef struct verify_epoch {
+	uint64_t key;                    // 0 for none, see verify_epoch_key()
+	etchash_h256_t seed;
+	uint64_t cache_size;
+	uint64_t full_size;
+} verify_epoch_t;
+
+// a verification of the epoch being built, or of an explicit one
+typedef struct verify_job {
+	uint64_t block_number;
+	verify_epoch_t epoch;
+	bool computed;                   // past the quick check
+} verify_job_t;
+
+// lookups share the lock, only handles coming and going and new epochs take it alone
+static etchash_rwlock_t g_verify_lock = ETCHASH_RWLOCK_INITIALIZER;
+static verify_entry_t* g_verify_entries;
+static verify_epoch_t g_verify_epochs[VERIFY_EPOCHS];
+// counted atomically, outside of the lock
+static etchash_verify_stats_t g_verify_stats;
+// only taken when an epoch has no cache or DAG, see etchash_spin_lock()
+static int32_t volatile g_verify_built_lock;
+static verify_built_t g_verify_built[VERIFY_BUILT_CACHES];
+
+static void verify_add(void const* handle, bool full, etchash_h256_t const* seed, uint64_t size)
+{
+	verify_entry_t* entry = (verify_entry_t*)calloc(1, sizeof(*entry));
+	if (!entry) {
+		// the handle still works, verifications just do not find it
+		return;
+	}
+	entry->handle = handle;
+	entry->full = full;
+	entry->seed = *seed;
+	entry->size = size;
+	etchash_rwlock_write_lock(&g_verify_lock);
+	entry->next = g_verify_entries;
+	g_verify_entries = entry;
+	etchash_rwlock_write_unlock(&g_verify_lock);
+}
+
+void etchash_verify_add_light(etchash_light_t light, etchash_h256_t const* seed)
+{
+	verify_add(light, false, seed, light->cache_size);
+}
+
+void etchash_verify_add_full(etchash_full_t full, etchash_h256_t const* seed)
+{
+	verify_add(full, true, seed, full->file_size);
+}
+
+void etchash_verify_remove(void const* handle)
+{
+	etchash_rwlock_write_lock(&g_verify_lock);
+	verify_entry_t** p = &g_verify_entries;
+	while (*p && (*p)->handle != handle) {
+		p = &(*p)->next;
+	}
+	verify_entry_t* entry = *p;
+	if (entry) {
+		*p = entry->next;
+	}
+	etchash_rwlock_write_unlock(&g_verify_lock);
+	if (!entry) {
+		return;
+	}
+	// unlinked, no verification can start using it anymore
+	while (etchash_atomic_load(&entry->users)) {
+		etchash_sleep_ms(0);
+	}
+	free(entry);
+}
+
+// the entry of an epoch's DAG, or else its cache, with a user added
+static verify_entry_t* verify_find(etchash_h256_t const* seed, uint64_t cache_size, uint64_t full_size)
+{
+	verify_entry_t* found = NULL;
+	etchash_rwlock_read_lock(&g_verify_lock);
+	for (verify_entry_t* entry = g_verify_entries; entry; entry = entry->next) {
+		if (memcmp(&entry->seed, seed, sizeof(*seed)) != 0) {
+			continue;
+		}
+		if (entry->full && entry->size == full_size) {
+			found = entry;
+			break;
+		}
+		if (!entry->full && entry->size == cache_size) {
+			found = entry;
+		}
+	}
+	if (found) {
+		etchash_atomic_add(&found->users, 1);
+	}
+	etchash_rwlock_read_unlock(&g_verify_lock);
+	return found;
+}
+
+static uint64_t verify_last_use(etchash_light_t light)
+{
+	uint64_t ret = 0;
+	etchash_rwlock_read_lock(&g_verify_lock);
+	for (verify_entry_t* entry = g_verify_entries; entry; entry = entry->next) {
+		if (entry->handle == light) {
+			ret = etchash_atomic_load_u64(&entry->last_use);
+			break;
+		}
+	}
+	etchash_rwlock_read_unlock(&g_verify_lock);
+	return ret;
+}
+
+// a free slot, else the one of the least recently used cache. Called with the built lock held
+static verify_built_t* verify_built_victim(void)
+{
+	verify_built_t* victim = NULL;
+	uint64_t victim_use = 0;
+	for (unsigned i = 0; i != VERIFY_BUILT_CACHES; ++i) {
+		verify_built_t* const built = &g_verify_built[i];
+		if (!built->used) {
+			return built;
+		}
+		if (!built->light) {
+			continue;
+		}
+		uint64_t const last_use = verify_last_use(built->light);
+		if (!victim || last_use < victim_use) {
+			victim = built;
+			victim_use = last_use;
+		}
+	}
+	return victim;
+}
+
+// build the cache of an epoch that has neither a DAG nor a cache, once for all threads asking for it
+static verify_entry_t* verify_build(etchash_h256_t const* seed, uint64_t cache_size, uint64_t full_size)
+{
+	for (;;) {
+		etchash_spin_lock(&g_verify_built_lock);
+		verify_built_t* slot = NULL;
+		for (unsigned i = 0; i != VERIFY_BUILT_CACHES && !slot; ++i) {
+			verify_built_t* const built = &g_verify_built[i];
+			if (built->used && built->cache_size == cache_size && memcmp(&built->seed, seed, sizeof(*seed)) == 0) {
+				slot = built;
+			}
+		}
+		if (slot) {
+			// built or being built by another thread, the cache registers itself
+			etchash_light_t const light = slot->light;
+			etchash_spin_unlock(&g_verify_built_lock);
+			verify_entry_t* entry = verify_find(seed, cache_size, full_size);
+			if (entry) {
+				return entry;
+			}
+			if (light) {
+				// unless evicted meanwhile, the cache could not be registered
+				etchash_spin_lock(&g_verify_built_lock);
+				bool const kept = slot->light == light;
+				etchash_spin_unlock(&g_verify_built_lock);
+				if (kept) {
+					return NULL;
+				}
+			} else {
+				etchash_sleep_ms(1);
+			}
+			continue;
+		}
+		slot = verify_built_victim();
+		if (!slot) {
+			// every slot is being built, one of them may be for this epoch soon
+			etchash_spin_unlock(&g_verify_built_lock);
+			etchash_sleep_ms(1);
+			verify_entry_t* entry = verify_find(seed, cache_size, full_size);
+			if (entry) {
+				return entry;
+			}
+			continue;
+		}
+		etchash_light_t const old = slot->light;
+		slot->seed = *seed;
+		slot->cache_size = cache_size;
+		slot->light = NULL;
+		slot->used = true;
+		etchash_spin_unlock(&g_verify_built_lock);
+		if (old) {
+			// waits for the verifications still using it
+			etchash_light_delete(old);
+		}
+
+		etchash_light_t const light = etchash_light_new_internal(cache_size, seed);
+		etchash_spin_lock(&g_verify_built_lock);
+		slot->light = light;
+		slot->used = light != NULL;
+		etchash_spin_unlock(&g_verify_built_lock);
+		if (!light) {
+			return NULL;
+		}
+		etchash_atomic_add_u64(&g_verify_stats.caches_built, 1);
+		return verify_find(seed, cache_size, full_size);
+	}
+}
+
+// the hash of a proof past the quick check, with the cheapest data of its epoch
+static etchash_return_value_t verify_compute(void* user, etchash_h256_t const* header_hash, uint64_t nonce)
+{
+	verify_job_t* const job = (verify_job_t*)user;
+	verify_epoch_t const* const epoch = &job->epoch;
+	job->computed = true;
+	etchash_return_value_t ret;
+	verify_entry_t* entry = verify_find(&epoch->seed, epoch->cache_size, epoch->full_size);
+	if (!entry) {
+		entry = verify_build(&epoch->seed, epoch->cache_size, epoch->full_size);
+	}
+	if (!entry) {
+		memset(&ret, 0, sizeof(ret));
+		ret.success = false;
+		return ret;
+	}
+
+	if (entry->full) {
+		ret = etchash_full_compute((etchash_full_t)entry->handle, *header_hash, nonce);
+		etchash_atomic_add_u64(&g_verify_stats.full, 1);
+	} else {
+		etchash_foreground_begin();
+		ret = etchash_light_compute_internal((etchash_light_t)entry->handle, epoch->full_size, *header_hash, nonce);
+		etchash_foreground_end();
+		etchash_atomic_store_u64(&entry->last_use, etchash_atomic_add_u64(&g_verify_stats.light, 1));
+	}
+	etchash_atomic_add(&entry->users, -1);
+	return ret;
+}
+
+static bool verify_job(
+	verify_job_t* job,
+	etchash_proof_compute_t compute,
+	etchash_h256_t const* header_hash,
+	uint64_t nonce,
+	etchash_h256_t const* mix_hash,
+	etchash_h256_t const* boundary
+)
+{
+	job->computed = false;
+	bool const ret = etchash_verify_proof(header_hash, nonce, mix_hash, boundary, compute, job);
+	if (!job->computed) {
+		etchash_atomic_add_u64(&g_verify_stats.rejected, 1);
+	}
+	return ret;
+}
+
+bool etchash_verify_internal(
+	etchash_h256_t const* seed,
+	uint64_t cache_size,
+	uint64_t full_size,
+	etchash_h256_t const* header_hash,
+	uint64_t nonce,
+	etchash_h256_t const* mix_hash,
+	etchash_h256_t const* boundary
+)
+{
+	verify_job_t job;
+	job.block_number = 0;
+	job.epoch.key = 0;
+	job.epoch.seed = *seed;
+	job.epoch.cache_size = cache_size;
+	job.epoch.full_size = full_size;
+	return verify_job(&job, verify_compute, header_hash, nonce, mix_hash, boundary);
+}
+
+// the seed depends on the epoch length as well as the epoch number
+static uint64_t verify_epoch_key(uint64_t block_number)
+{
+	return (get_epoch_number(block_number) << 1 | (block_number >= ETCHASH_ACTIVATION_BLOCK)) + 1;
+}
+
+static etchash_return_value_t verify_block_compute(void* user, etchash_h256_t const* header_hash, uint64_t nonce)
+{
+	verify_job_t* const job = (verify_job_t*)user;
+	uint64_t const key = verify_epoch_key(job->block_number);
+	verify_epoch_t* const slot = &g_verify_epochs[key % VERIFY_EPOCHS];
+	etchash_rwlock_read_lock(&g_verify_lock);
+	job->epoch = *slot;
+	etchash_rwlock_read_unlock(&g_verify_lock);
+	if (job->epoch.key != key) {
+		job->epoch.key = key;
+		job->epoch.seed = etchash_get_seedhash(job->block_number);
+		job->epoch.cache_size = etchash_get_cachesize(job->block_number);
+		job->epoch.full_size = etchash_get_datasize(job->block_number);
+		etchash_rwlock_write_lock(&g_verify_lock);
+		*slot = job->epoch;
+		etchash_rwlock_write_unlock(&g_verify_lock);
+	}
+	return verify_compute(job, header_hash, nonce);
+}
+
+bool etchash_verify(
+	uint64_t block_number,
+	etchash_h256_t const* header_hash,
+	uint64_t nonce,
+	etchash_h256_t const* mix_hash,
+	etchash_h256_t const* boundary
+)
+{
+	// the epoch is only looked up for proofs past the quick check
+	verify_job_t job;
+	job.block_number = block_number;
+	return verify_job(&job, verify_block_compute, header_hash, nonce, mix_hash, boundary);
+}
+
+void etchash_verify_stats(etchash_verify_stats_t* stats)
+{
+	stats->full = etchash_atomic_load_u64(&g_verify_stats.full);
+	stats->light = etchash_atomic_load_u64(&g_verify_stats.light);
+	stats->caches_built = etchash_atomic_load_u64(&g_verify_stats.caches_built);
+	stats->rejected = etchash_atomic_load_u64(&g_verify_stats.rejected);
+}
+
+void etchash_verify_release(void)
+{
+	etchash_light_t built[VERIFY_BUILT_CACHES];
+	unsigned count = 0;
+	etchash_spin_lock(&g_verify_built_lock);
+	for (unsigned i = 0; i != VERIFY_BUILT_CACHES; ++i) {
+		// the ones being built stay with their builder
+		if (g_verify_built[i].light) {
+			built[count++] = g_verify_built[i].light;
+			g_verify_built[i].light = NULL;
+			g_verify_built[i].used = false;
+		}
+	}
+	etchash_spin_unlock(&g_verify_built_lock);
+	for (unsigned i = 0; i != count; ++i) {
+		etchash_light_delete(built[i]);
+	}
+}
@@ -0,0 +1,109 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file verify.h
+ * @date 2026
+ *
+ * Proof of work verification routed to the cheapest data at hand.
+ *
+ * Every cache and DAG registers itself here for as long as it lives. A
+ * verification uses a DAG of its epoch when one is resident, which reads 128
+ * items instead of deriving each from the cache, then a cache of its epoch,
+ * and only builds a cache if neither exists. Threads verifying the same such
+ * epoch wait for a single build. The caches of the last few epochs built this
+ * way are kept, the least recently used making room for a new one, until
+ * @ref etchash_verify_release().
+ *
+ * Proofs that miss their boundary are rejected before any of this, and
+ * @ref etchash_verify() only looks the epoch's seed up for the others.
+ *
+ * Deleting a DAG or cache waits for the verifications using it, so handles
+ * can be replaced at any time.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "etchash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// How verifications were served, library wide
+typedef struct etchash_verify_stats {
+	uint64_t full;                   ///< Computed with a resident DAG
+	uint64_t light;                  ///< Computed with a resident cache
+	uint64_t caches_built;           ///< Caches built because the epoch had none
+	uint64_t rejected;               ///< Failed the difficulty pre-check, nothing computed
+} etchash_verify_stats_t;
+
+/**
+ * Verify a proof of work
+ *
+ * @param block_number  Block number of the header, selects the epoch
+ * @param header_hash   Hash of the header without nonce and mix
+ * @param nonce         Claimed nonce
+ * @param mix_hash      Claimed mix digest
+ * @param boundary      2^256 / difficulty, big endian
+ * @return              true if the mix is right and the result is within the boundary
+ */
+bool etchash_verify(
+	uint64_t block_number,
+	etchash_h256_t const* header_hash,
+	uint64_t nonce,
+	etchash_h256_t const* mix_hash,
+	etchash_h256_t const* boundary
+);
+
+/**
+ * Like @ref etchash_verify() with explicit epoch parameters, mostly for tests
+ * with small data
+ */
+bool etchash_verify_internal(
+	etchash_h256_t const* seed,
+	uint64_t cache_size,
+	uint64_t full_size,
+	etchash_h256_t const* header_hash,
+	uint64_t nonce,
+	etchash_h256_t const* mix_hash,
+	etchash_h256_t const* boundary
+);
+
+void etchash_verify_stats(etchash_verify_stats_t* stats);
+
+/**
+ * Free the caches built by verifications, except those still being built
+ */
+void etchash_verify_release(void);
+
+/**
+ * Make a cache available to verifications of its epoch
+ */
+void etchash_verify_add_light(etchash_light_t light, etchash_h256_t const* seed);
+
+/**
+ * Make a DAG available to verifications of its epoch
+ */
+void etchash_verify_add_full(etchash_full_t full, etchash_h256_t const* seed);
+
+/**
+ * Withdraw a cache or DAG, waiting for the verifications using it
+ */
+void etchash_verify_remove(void const* handle);
+
+#ifdef __cplusplus
+}
+#endif
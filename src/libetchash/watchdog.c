@@ -0,0 +1,225 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file watchdog.c
+ * @date 2026
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "watchdog.h"
+#include "internal.h"
+#include "thread.h"
+#include "pool.h"
+#include "io.h"
+
+#ifdef WITH_CRYPTOPP
+#include "sha3_cryptopp.h"
+#else
+#include "sha3.h"
+#endif // WITH_CRYPTOPP
+
+struct etchash_watchdog {
+	etchash_full_t full;
+	etchash_light_t light;
+	etchash_watchdog_options_t options;
+	uint64_t items;
+	uint64_t cursor;              // next item to check
+	uint64_t sweep_checked;       // items checked in the current sweep
+	uint64_t random;
+	etchash_h256_t cache_digest;  // of the cache when the watchdog started
+	bool cache_corrupt;           // the cache stopped matching cache_digest, nothing is repaired anymore
+	etchash_mutex_t mutex;
+	etchash_cond_t wake;
+	bool stop;
+	etchash_thread_t thread;
+	etchash_watchdog_stats_t stats;
+};
+
+static uint64_t watchdog_random(struct etchash_watchdog* w)
+{
+	w->random ^= w->random << 13;
+	w->random ^= w->random >> 7;
+	w->random ^= w->random << 17;
+	return w->random;
+}
+
+// a repair rewrites items from the cache, so the cache itself has to be right first
+static bool watchdog_cache_intact(struct etchash_watchdog* w)
+{
+	if (w->cache_corrupt) {
+		return false;
+	}
+	etchash_h256_t digest = {{0}};
+	SHA3_256(&digest, (uint8_t const*)w->light->cache, w->light->cache_size);
+	if (memcmp(&digest, &w->cache_digest, sizeof(digest)) == 0) {
+		return true;
+	}
+	w->cache_corrupt = true;
+	etchash_mutex_lock(&w->mutex);
+	w->stats.cache_corruptions++;
+	w->stats.last_corruption_ms = etchash_time_ms();
+	etchash_mutex_unlock(&w->mutex);
+	return false;
+}
+
+// re-derives an item, rewriting it if it differs. Returns false if it was corrupt
+static bool watchdog_check_item(struct etchash_watchdog* w, uint32_t index)
+{
+	node expected;
+	etchash_calculate_dag_item(&expected, index, w->light);
+	node* const item = &w->full->data[index];
+	if (memcmp(item, &expected, sizeof(node)) == 0) {
+		return true;
+	}
+	if (!watchdog_cache_intact(w)) {
+		return false;
+	}
+	// hashes reading the item meanwhile were already wrong, a torn read changes nothing
+	memcpy(item, &expected, sizeof(node));
+	bool const repaired = memcmp(item, &expected, sizeof(node)) == 0;
+	etchash_mutex_lock(&w->mutex);
+	w->stats.corrupt_items++;
+	w->stats.repaired_items += repaired;
+	w->stats.last_corruption_ms = etchash_time_ms();
+	etchash_mutex_unlock(&w->mutex);
+	return false;
+}
+
+static void watchdog_cross_check(struct etchash_watchdog* w)
+{
+	etchash_h256_t header_hash;
+	for (unsigned i = 0; i != 4; ++i) {
+		uint64_t const r = watchdog_random(w);
+		memcpy(&header_hash.b[8 * i], &r, 8);
+	}
+	uint64_t const nonce = watchdog_random(w);
+	uint32_t pages[ETCHASH_ACCESSES];
+	etchash_return_value_t const full = etchash_full_compute_indices(w->full, header_hash, nonce, pages);
+	etchash_return_value_t const light = etchash_light_compute_internal(w->light, w->full->file_size, header_hash, nonce);
+	bool const failed = memcmp(&full.result, &light.result, sizeof(full.result)) != 0;
+	etchash_mutex_lock(&w->mutex);
+	w->stats.cross_checks++;
+	w->stats.cross_check_failures += failed;
+	etchash_mutex_unlock(&w->mutex);
+	if (failed && watchdog_cache_intact(w)) {
+		// the corruption is in one of the pages the hash read, repair them now
+		for (unsigned i = 0; i != ETCHASH_ACCESSES; ++i) {
+			for (unsigned n = 0; n != MIX_NODES; ++n) {
+				watchdog_check_item(w, pages[i] * MIX_NODES + n);
+			}
+		}
+	}
+}
+
+static void watchdog_run(void* arg)
+{
+	struct etchash_watchdog* w = (struct etchash_watchdog*)arg;
+	if (!w->options.normal_priority) {
+		etchash_thread_set_background(true);
+	}
+	etchash_pool_pin_thread(ETCHASH_WORK_COMPUTE);
+	uint64_t next_cross_check = etchash_time_ms() + w->options.cross_check_interval_ms;
+	etchash_mutex_lock(&w->mutex);
+	while (!w->stop) {
+		etchash_mutex_unlock(&w->mutex);
+		uint64_t checked = 0;
+		for (; checked != w->options.items_per_batch && !w->cache_corrupt; ++checked) {
+			watchdog_check_item(w, (uint32_t)w->cursor);
+			w->cursor = (w->cursor + 1) % w->items;
+		}
+		if (!w->cache_corrupt && etchash_time_ms() >= next_cross_check) {
+			watchdog_cross_check(w);
+			next_cross_check = etchash_time_ms() + w->options.cross_check_interval_ms;
+		}
+		etchash_mutex_lock(&w->mutex);
+		w->stats.items_checked += checked;
+		w->sweep_checked += checked;
+		while (w->sweep_checked >= w->items) {
+			w->sweep_checked -= w->items;
+			w->stats.sweeps++;
+		}
+		if (!w->stop) {
+			etchash_cond_timedwait(&w->wake, &w->mutex, w->options.batch_interval_ms);
+		}
+	}
+	etchash_mutex_unlock(&w->mutex);
+}
+
+etchash_watchdog_t etchash_watchdog_new(
+	etchash_full_t full,
+	etchash_light_t light,
+	etchash_watchdog_options_t const* options
+)
+{
+	struct etchash_watchdog* w = calloc(sizeof(*w), 1);
+	if (!w) {
+		return NULL;
+	}
+	w->full = full;
+	w->light = light;
+	if (options) {
+		w->options = *options;
+	}
+	if (!w->options.items_per_batch) {
+		w->options.items_per_batch = 4096;
+	}
+	if (!w->options.batch_interval_ms) {
+		w->options.batch_interval_ms = 100;
+	}
+	if (!w->options.cross_check_interval_ms) {
+		w->options.cross_check_interval_ms = 10000;
+	}
+	w->items = full->file_size / sizeof(node);
+	if (!w->items) {
+		goto fail_free;
+	}
+	// start at a random item so that restarted watchdogs do not favour the DAG's front
+	w->random = etchash_time_ms() * 0x9E3779B97F4A7C15ULL | 1;
+	w->cursor = watchdog_random(w) % w->items;
+	SHA3_256(&w->cache_digest, (uint8_t const*)light->cache, light->cache_size);
+	etchash_mutex_init(&w->mutex);
+	etchash_cond_init(&w->wake);
+	if (!etchash_thread_create(&w->thread, watchdog_run, w)) {
+		etchash_cond_destroy(&w->wake);
+		etchash_mutex_destroy(&w->mutex);
+		goto fail_free;
+	}
+	return w;
+
+fail_free:
+	free(w);
+	return NULL;
+}
+
+void etchash_watchdog_stats(etchash_watchdog_t watchdog, etchash_watchdog_stats_t* stats)
+{
+	etchash_mutex_lock(&watchdog->mutex);
+	*stats = watchdog->stats;
+	etchash_mutex_unlock(&watchdog->mutex);
+}
+
+void etchash_watchdog_delete(etchash_watchdog_t watchdog)
+{
+	etchash_mutex_lock(&watchdog->mutex);
+	watchdog->stop = true;
+	etchash_cond_signal(&watchdog->wake);
+	etchash_mutex_unlock(&watchdog->mutex);
+	etchash_thread_join(watchdog->thread);
+	etchash_cond_destroy(&watchdog->wake);
+	etchash_mutex_destroy(&watchdog->mutex);
+	free(watchdog);
+}
@@ -0,0 +1,83 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file watchdog.h
+ * @date 2026
+ *
+ * Detection and repair of corrupted DAG items in long lived full handlers.
+ *
+ * Memory without ECC flips bits now and then. In a DAG that stays mapped for
+ * days a flipped bit makes every hash touching its page wrong, turning valid
+ * solutions into rejects. The watchdog thread re-derives the DAG items from
+ * the cache in a rotating window at idle priority, rewrites items that differ
+ * and periodically compares a full mode hash with the light mode one. The
+ * cache is checked against its digest from the start before any rewrite, a
+ * corrupted cache is reported and nothing is repaired from it.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "etchash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Settings for @ref etchash_watchdog_new(). Zero initialize for the defaults.
+typedef struct etchash_watchdog_options {
+	uint32_t items_per_batch;        ///< DAG items checked per batch, 0 for 4096
+	uint32_t batch_interval_ms;      ///< Pause between batches, 0 for 100
+	uint32_t cross_check_interval_ms;///< Time between full/light hash comparisons, 0 for 10 seconds
+	bool normal_priority;            ///< Run at normal instead of idle priority
+} etchash_watchdog_options_t;
+
+typedef struct etchash_watchdog_stats {
+	uint64_t items_checked;
+	uint64_t sweeps;                 ///< Complete passes over the DAG
+	uint64_t corrupt_items;          ///< Items found to differ from their derivation
+	uint64_t repaired_items;         ///< Corrupt items rewritten and verified
+	uint64_t cross_checks;
+	uint64_t cross_check_failures;   ///< Full mode hashes that differed from light mode
+	uint64_t cache_corruptions;      ///< Times the cache no longer matched its digest, repairs stop then
+	uint64_t last_corruption_ms;     ///< etchash_time_ms() of the last corruption, 0 for none
+} etchash_watchdog_stats_t;
+
+typedef struct etchash_watchdog* etchash_watchdog_t;
+
+/**
+ * Start watching a DAG
+ *
+ * @param full      The DAG to watch and repair, must outlive the watchdog
+ * @param light     The cache the DAG was made from, must outlive the watchdog
+ * @param options   Settings, may be NULL for the defaults
+ * @return          The watchdog or NULL if it could not be started
+ */
+etchash_watchdog_t etchash_watchdog_new(
+	etchash_full_t full,
+	etchash_light_t light,
+	etchash_watchdog_options_t const* options
+);
+
+void etchash_watchdog_stats(etchash_watchdog_t watchdog, etchash_watchdog_stats_t* stats);
+
+/**
+ * Stop the watchdog thread and free the watchdog
+ */
+void etchash_watchdog_delete(etchash_watchdog_t watchdog);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,10 +1,13 @@
+#define PY_SSIZE_T_CLEAN
 #include <Python.h>
 #include <alloca.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include "../libetchash/etchash.h"
 #include "../libetchash/internal.h"
+#include "../libetchash/boundary.h"
 
 #if PY_MAJOR_VERSION >= 3
 #define PY_STRING_FORMAT "y#"
@@ -19,14 +22,15 @@
 static PyObject *
 mkcache_bytes(PyObject *self, PyObject *args) {
     unsigned long block_number;
-    unsigned long cache_size;
 
     if (!PyArg_ParseTuple(args, "k", &block_number))
         return 0;
 
     etchash_light_t L = etchash_light_new(block_number);
-    PyObject * val = Py_BuildValue(PY_STRING_FORMAT, L->cache, L->cache_size);
-    free(L->cache);
+    if (!L)
+        return PyErr_NoMemory();
+    PyObject * val = Py_BuildValue(PY_STRING_FORMAT, L->cache, (Py_ssize_t) L->cache_size);
+    etchash_light_delete(L);
     return val;
 }
 
@@ -73,28 +77,105 @@ hashimoto_light(PyObject *self, PyObject *args) {
     char *header;
     unsigned long block_number;
     unsigned long long nonce;
-    int cache_size, header_size;
+    Py_ssize_t cache_size, header_size;
     if (!PyArg_ParseTuple(args, "k" PY_STRING_FORMAT PY_STRING_FORMAT "K", &block_number, &cache_bytes, &cache_size, &header, &header_size, &nonce))
         return 0;
     if (header_size != 32) {
         char error_message[1024];
-        sprintf(error_message, "Seed must be 32 bytes long (was %i)", header_size);
+        sprintf(error_message, "Seed must be 32 bytes long (was %zd)", header_size);
         PyErr_SetString(PyExc_ValueError, error_message);
         return 0;
     }
-    struct etchash_light *s;
-    s = calloc(sizeof(*s), 1);
-    s->cache = cache_bytes;
-    s->cache_size = cache_size;
-    s->block_number = block_number;
-    struct etchash_h256 *h;
-    h = calloc(sizeof(*h), 1);
-    for (int i = 0; i < 32; i++) h->b[i] = header[i];
-    struct etchash_return_value out = etchash_light_compute(s, *h, nonce);
+    // the cache bytes are borrowed from the Python object, nothing is copied
+    struct etchash_light s;
+    memset(&s, 0, sizeof(s));
+    s.cache = cache_bytes;
+    s.cache_size = cache_size;
+    s.block_number = block_number;
+    etchash_h256_t h;
+    memcpy(&h, header, 32);
+    struct etchash_return_value out = etchash_light_compute(&s, h, nonce);
     return Py_BuildValue("{" PY_CONST_STRING_FORMAT ":" PY_STRING_FORMAT "," PY_CONST_STRING_FORMAT ":" PY_STRING_FORMAT "}",
-                         "mix digest", &out.mix_hash, 32,
-                         "result", &out.result, 32);
+                         "mix digest", &out.mix_hash, (Py_ssize_t) 32,
+                         "result", &out.result, (Py_ssize_t) 32);
+}
+// Splits a difficulty of up to 128 bits into two words, only difficulties
+// beyond 64 bits take a temporary int
+static int
+difficulty_words(PyObject *difficulty, uint64_t *high, uint64_t *low) {
+    *high = 0;
+    *low = PyLong_AsUnsignedLongLong(difficulty);
+    if (!PyErr_Occurred())
+        return 1;
+    if (!PyErr_ExceptionMatches(PyExc_OverflowError))
+        return 0;
+    PyErr_Clear();
+    PyObject *shift = PyLong_FromLong(64);
+    PyObject *upper = shift ? PyNumber_Rshift(difficulty, shift) : 0;
+    Py_XDECREF(shift);
+    if (!upper)
+        return 0;
+    *high = PyLong_AsUnsignedLongLong(upper);
+    Py_DECREF(upper);
+    if (PyErr_Occurred()) {
+        PyErr_SetString(PyExc_OverflowError, "Difficulty must be a non-negative integer below 2^128");
+        return 0;
+    }
+    *low = PyLong_AsUnsignedLongLongMask(difficulty);
+    return 1;
+}
+
+// difficulty_to_boundary(difficulty)
+static PyObject *
+difficulty_to_boundary(PyObject *self, PyObject *args) {
+    PyObject *difficulty;
+    uint64_t high, low;
+    if (!PyArg_ParseTuple(args, "O", &difficulty))
+        return 0;
+    if (!difficulty_words(difficulty, &high, &low))
+        return 0;
+    etchash_h256_t boundary = etchash_difficulty128_to_boundary(high, low);
+    return Py_BuildValue(PY_STRING_FORMAT, &boundary, (Py_ssize_t) 32);
+}
+
+// light_verify(block_number, cache, header, nonce, mix_digest, difficulty)
+static PyObject *
+light_verify(PyObject *self, PyObject *args) {
+    char *cache_bytes;
+    char *header;
+    char *mix_digest;
+    PyObject *difficulty;
+    unsigned long block_number;
+    unsigned long long nonce;
+    uint64_t high, low;
+    Py_ssize_t cache_size, header_size, mix_size;
+    if (!PyArg_ParseTuple(args, "k" PY_STRING_FORMAT PY_STRING_FORMAT "K" PY_STRING_FORMAT "O", &block_number,
+                          &cache_bytes, &cache_size, &header, &header_size, &nonce, &mix_digest, &mix_size, &difficulty))
+        return 0;
+    if (header_size != 32 || mix_size != 32) {
+        char error_message[1024];
+        sprintf(error_message, "Header and mix digest must be 32 bytes long (were %zd and %zd)", header_size, mix_size);
+        PyErr_SetString(PyExc_ValueError, error_message);
+        return 0;
+    }
+    if (!difficulty_words(difficulty, &high, &low))
+        return 0;
+    if (!high && !low)
+        Py_RETURN_FALSE;
+    // the cache bytes are borrowed from the Python object, nothing is copied
+    struct etchash_light s;
+    memset(&s, 0, sizeof(s));
+    s.cache = cache_bytes;
+    s.cache_size = cache_size;
+    s.block_number = block_number;
+    etchash_h256_t h, mix;
+    memcpy(&h, header, 32);
+    memcpy(&mix, mix_digest, 32);
+    etchash_h256_t boundary = etchash_difficulty128_to_boundary(high, low);
+    bool ok = etchash_light_verify_internal(&s, etchash_get_datasize(block_number), h, nonce, mix, boundary);
+    return PyBool_FromLong(ok);
 }
+
 /*
 // hashimoto_full(dataset, header, nonce)
 static PyObject *
@@ -196,7 +277,7 @@ get_seedhash(PyObject *self, PyObject *args) {
         return 0;
     }
     etchash_h256_t seedhash = etchash_get_seedhash(block_number);
-    return Py_BuildValue(PY_STRING_FORMAT, (char *) &seedhash, 32);
+    return Py_BuildValue(PY_STRING_FORMAT, (char *) &seedhash, (Py_ssize_t) 32);
 }
 
 static PyMethodDef PyetchashMethods[] =
@@ -213,6 +294,12 @@ static PyMethodDef PyetchashMethods[] =
                 {"hashimoto_light", hashimoto_light, METH_VARARGS,
                         "hashimoto_light(block_number, cache_bytes, header, nonce)\n\n"
                                 "Runs the hashimoto hashing function just using cache bytes. Takes an int (full_size), byte array (cache_bytes), another byte array (header), and an int (nonce). Returns an object containing the mix digest, and hash result."},
+                {"difficulty_to_boundary", difficulty_to_boundary, METH_VARARGS,
+                        "difficulty_to_boundary(difficulty)\n\n"
+                                "Returns 2^256 / difficulty as 32 big endian bytes, the bound of a valid result. Takes an int below 2^128."},
+                {"light_verify", light_verify, METH_VARARGS,
+                        "light_verify(block_number, cache_bytes, header, nonce, mix_digest, difficulty)\n\n"
+                                "Checks a proof of work using cache bytes. Returns True if the mix digest is right and the result meets the difficulty (an int), rejecting most invalid proofs before hashing."},
                 /*{"hashimoto_full", hashimoto_full, METH_VARARGS,
                         "hashimoto_full(dataset_bytes, header, nonce)\n\n"
                                 "Runs the hashimoto hashing function using the dataset bytes. Useful for testing. Returns an object containing the mix digest (byte array), and hash result (another byte array)."},
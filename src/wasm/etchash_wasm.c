@@ -0,0 +1,101 @@
+/*
+  This file is part of etchash.
+
+  etchash is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  etchash is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with etchash.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file etchash_wasm.c
+ * @date 2026
+ *
+ * The exports of the WebAssembly module behind js/etchash_wasm.js. Handles
+ * are pointers into the module's linear memory, as are the buffers: headers,
+ * seeds and hashes are 32 bytes, nonces 8 bytes in the byte order of the
+ * seed hash input, as etchash.js takes them.
+ */
+
+#include <string.h>
+#include <libetchash/etchash.h>
+#include <libetchash/internal.h>
+#include <libetchash/endian.h>
+
+#ifdef WITH_CRYPTOPP
+#include <libetchash/sha3_cryptopp.h>
+#else
+#include <libetchash/sha3.h>
+#endif // WITH_CRYPTOPP
+
+#if defined(__EMSCRIPTEN__)
+#include <emscripten.h>
+#else
+#define EMSCRIPTEN_KEEPALIVE
+#endif
+
+EMSCRIPTEN_KEEPALIVE etchash_light_t etchash_wasm_light_new(uint32_t cache_size, uint8_t const* seed)
+{
+	etchash_h256_t seed_hash;
+	memcpy(&seed_hash, seed, 32);
+	return etchash_light_new_internal(cache_size, &seed_hash);
+}
+
+EMSCRIPTEN_KEEPALIVE void etchash_wasm_light_delete(etchash_light_t light)
+{
+	etchash_light_delete(light);
+}
+
+EMSCRIPTEN_KEEPALIVE void etchash_wasm_cache_digest(etchash_light_t light, uint8_t* digest)
+{
+	etchash_h256_t hash;
+	SHA3_256(&hash, (uint8_t const*)light->cache, (size_t)light->cache_size);
+	memcpy(digest, &hash, 32);
+}
+
+/**
+ * Hash @a count nonces in light mode
+ *
+ * The DAG size is split in two words as it exceeds the 32 bit integers that
+ * cross the JavaScript boundary without BigInt.
+ *
+ * @param mix_hashes    Receives 32 bytes per nonce, may be NULL
+ * @param results       Receives 32 bytes per nonce
+ * @return              0 for an invalid DAG size
+ */
+EMSCRIPTEN_KEEPALIVE int etchash_wasm_hash(
+	etchash_light_t light,
+	uint32_t full_size_low,
+	uint32_t full_size_high,
+	uint8_t const* header,
+	uint8_t const* nonces,
+	uint32_t count,
+	uint8_t* mix_hashes,
+	uint8_t* results
+)
+{
+	uint64_t const full_size = (uint64_t)full_size_high << 32 | full_size_low;
+	etchash_h256_t header_hash;
+	memcpy(&header_hash, header, 32);
+	for (uint32_t i = 0; i != count; ++i) {
+		// the bytes are the little endian encoding etchash_hash() writes
+		uint64_t nonce;
+		memcpy(&nonce, nonces + (size_t)i * 8, 8);
+		fix_endian64_same(nonce);
+		etchash_return_value_t const ret = etchash_light_compute_internal(light, full_size, header_hash, nonce);
+		if (!ret.success) {
+			return 0;
+		}
+		if (mix_hashes) {
+			memcpy(mix_hashes + (size_t)i * 32, &ret.mix_hash, 32);
+		}
+		memcpy(results + (size_t)i * 32, &ret.result, 32);
+	}
+	return 1;
+}
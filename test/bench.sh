@@ -0,0 +1,50 @@
+#!/bin/bash
+
+# Runs the benchmarks of every binding that can be built here and prints a
+# combined report of their per-hash cost against the raw C numbers.
+#
+# usage: test/bench.sh [scale]
+
+# Strict mode
+set -e
+
+SCALE=${1:-1}
+
+SOURCE="${BASH_SOURCE[0]}"
+while [ -h "$SOURCE" ]; do
+  DIR="$( cd -P "$( dirname "$SOURCE" )" && pwd )"
+  SOURCE="$(readlink "$SOURCE")"
+  [[ $SOURCE != /* ]] && SOURCE="$DIR/$SOURCE"
+done
+TEST_DIR="$( cd -P "$( dirname "$SOURCE" )" && pwd )"
+RESULTS="$(mktemp -d)"
+trap 'rm -rf $RESULTS' EXIT
+
+echo -e "\n################# Benchmarking C ##################"
+mkdir -p $TEST_DIR/build
+cd $TEST_DIR/build
+cmake ../.. > /dev/null
+make Benchmark_Bindings > /dev/null
+./src/benchmark/Benchmark_Bindings $SCALE | tee $RESULTS/c.tsv
+
+if [ -x "$(which go)" ] ; then
+	echo -e "\n################# Benchmarking Go ##################"
+	cd $TEST_DIR/..
+	go test -run NONE -bench . -benchtime $((SCALE * 2))s | tee $RESULTS/go.txt
+fi
+
+if [ -x "$(which python3)" ] ; then
+	echo -e "\n################# Benchmarking Python ##################"
+	cd $TEST_DIR/..
+	python3 setup.py build_ext -b $RESULTS/pyetchash -t $RESULTS/pyetchash > /dev/null 2>&1
+	PYTHONPATH=$RESULTS/pyetchash python3 $TEST_DIR/python/bench_pyetchash.py $SCALE | tee $RESULTS/python.tsv
+fi
+
+if [ -x "$(which node)" ] ; then
+	echo -e "\n################# Benchmarking JS ##################"
+	cd $TEST_DIR/../js
+	node bench.js $SCALE | tee $RESULTS/js.tsv
+fi
+
+echo -e "\n################# Report ##################"
+python3 $TEST_DIR/bench_report.py $RESULTS/*.tsv $(ls $RESULTS/go.txt 2> /dev/null)
@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+# Combines the outputs of the benchmarks run by test/bench.sh into a single
+# table of per-hash costs and their overhead over the raw C numbers.
+#
+# usage: bench_report.py <result file>...
+#
+# Result files hold either tab separated lines
+#     binding  operation  granularity  hashes  ns/hash
+# or the output of `go test -bench`.
+import re
+import sys
+
+GO_LINE = re.compile(r"^Benchmark(\w+?)(Single|Batch)(?:-\d+)?\s+(\d+)\s+([\d.]+) ns/op(?:\s+([\d.]+) ns/hash)?")
+
+
+def snake(name):
+    return re.sub(r"(?<!^)(?=[A-Z])", "_", name).lower()
+
+
+def parse(path):
+    rows = []
+    with open(path) as f:
+        for line in f:
+            match = GO_LINE.match(line)
+            if match:
+                op, granularity, hashes, ns_op, ns_hash = match.groups()
+                rows.append(("go", snake(op), granularity.lower(), int(hashes), float(ns_hash or ns_op)))
+                continue
+            fields = line.rstrip("\n").split("\t")
+            if len(fields) == 5:
+                try:
+                    rows.append((fields[0], fields[1], fields[2], int(fields[3]), float(fields[4])))
+                except ValueError:
+                    pass
+    return rows
+
+
+def human(ns):
+    for unit, scale in (("s", 1e9), ("ms", 1e6), ("us", 1e3)):
+        if ns >= scale:
+            return "%.2f %s" % (ns / scale, unit)
+    return "%.1f ns" % ns
+
+
+def main(paths):
+    rows = []
+    for path in paths:
+        rows.extend(parse(path))
+    baseline = dict((op, ns) for binding, op, _, _, ns in rows if binding == "c")
+
+    print("%-16s %-8s %-7s %12s %12s %12s %9s" % (
+        "operation", "binding", "mode", "per hash", "C per hash", "overhead", "overhead"))
+    for binding, op, granularity, hashes, ns in sorted(rows, key=lambda r: (r[1], r[0] != "c", r[0], r[2])):
+        if binding == "c":
+            print("%-16s %-8s %-7s %12s" % (op, binding, "", human(ns)))
+            continue
+        if op not in baseline:
+            print("%-16s %-8s %-7s %12s %12s" % (op, binding, granularity, human(ns), "n/a"))
+            continue
+        c = baseline[op]
+        print("%-16s %-8s %-7s %12s %12s %12s %8.1f%%" % (
+            op, binding, granularity, human(ns), human(c), human(ns - c) if ns >= c else "-" + human(c - ns),
+            100.0 * (ns - c) / c))
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        sys.stderr.write("usage: %s <result file>...\n" % sys.argv[0])
+        sys.exit(1)
+    main(sys.argv[1:])
@@ -3,6 +3,23 @@
 #include <libetchash/etchash.h>
 #include <libetchash/internal.h>
 #include <libetchash/io.h>
+#include <libetchash/merkle.h>
+#include <libetchash/trace.h>
+#include <libetchash/auto.h>
+#include <libetchash/background.h>
+#include <libetchash/peer.h>
+#include <libetchash/search.h>
+#include <libetchash/budget.h>
+#include <libetchash/lanes.h>
+#include <libetchash/provider.h>
+#include <libetchash/watchdog.h>
+#include <libetchash/pool.h>
+#include <libetchash/verify.h>
+#include <libetchash/thread.h>
+#include <libetchash/topology.h>
+#include <libetchash/shard.h>
+#include <libetchash/boundary.h>
+#include <libetchash/epoch.h>
 
 #ifdef WITH_CRYPTOPP
 
@@ -15,6 +32,10 @@
 #ifdef _WIN32
 #include <windows.h>
 #include <Shlobj.h>
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
 #endif
 
 #define BOOST_TEST_MODULE Daggerhashimoto
@@ -23,6 +44,13 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <set>
+#include <algorithm>
+#include <memory>
 #include <boost/filesystem.hpp>
 #include <boost/test/unit_test.hpp>
 
@@ -494,6 +522,1669 @@ BOOST_AUTO_TEST_CASE(etchash_full_new_when_dag_exists_with_wrong_size) {
 	fs::remove_all("./test_etchash_directory/");
 }
 
+BOOST_AUTO_TEST_CASE(test_etchash_dag_v2_header) {
+	uint64_t full_size;
+	uint64_t cache_size;
+	etchash_h256_t seed;
+	memcpy(&seed, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+
+	cache_size = 1024;
+	full_size = 1024 * 32;
+
+	etchash_light_t light = etchash_light_new_internal(cache_size, &seed);
+	etchash_full_t full = etchash_full_new_internal(
+		"./test_etchash_directory/",
+		seed,
+		full_size,
+		light,
+		NULL
+	);
+	BOOST_ASSERT(full);
+	// the DAG data must start on a page boundary
+	BOOST_REQUIRE_EQUAL(full->header_size, (uint64_t)ETCHASH_DAG_HEADER_SIZE);
+	BOOST_REQUIRE_EQUAL((uintptr_t)etchash_full_dag(full) % ETCHASH_DAG_HEADER_SIZE, 0U);
+
+	etchash_dag_header_t const* header = (etchash_dag_header_t const*)
+		((char const*)etchash_full_dag(full) - ETCHASH_DAG_HEADER_SIZE);
+	BOOST_REQUIRE_EQUAL(header->magic, (uint64_t)ETCHASH_DAG_MAGIC_NUM);
+	BOOST_REQUIRE_EQUAL(header->version, (uint32_t)ETCHASH_DAG_FORMAT_VERSION);
+	BOOST_REQUIRE_EQUAL(header->revision, (uint32_t)ETCHASH_REVISION);
+	BOOST_REQUIRE_EQUAL(header->full_size, full_size);
+	BOOST_REQUIRE(memcmp(&header->seed_hash, &seed, 32) == 0);
+
+	etchash_full_delete(full);
+	etchash_light_delete(light);
+	fs::remove_all("./test_etchash_directory/");
+}
+
+BOOST_AUTO_TEST_CASE(test_etchash_dag_legacy_file_is_read) {
+	uint64_t full_size;
+	uint64_t cache_size;
+	etchash_h256_t seed;
+	etchash_h256_t hash;
+	memcpy(&seed, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+	memcpy(&hash, "~~~X~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+
+	cache_size = 1024;
+	full_size = 1024 * 32;
+
+	// write a DAG file in the legacy layout: magic number followed by the data
+	etchash_light_t light = etchash_light_new_internal(cache_size, &seed);
+	std::vector<uint8_t> data(full_size);
+	BOOST_REQUIRE(etchash_compute_full_data(data.data(), full_size, light, NULL));
+	char mutable_name[DAG_MUTABLE_NAME_MAX_SIZE];
+	etchash_io_mutable_name(ETCHASH_REVISION, &seed, mutable_name);
+	BOOST_REQUIRE(etchash_mkdir("./test_etchash_directory/"));
+	char* filename = etchash_io_create_filename("./test_etchash_directory/", mutable_name, strlen(mutable_name));
+	FILE* f = etchash_fopen(filename, "wb");
+	BOOST_REQUIRE(f);
+	uint64_t const magic_num = ETCHASH_DAG_MAGIC_NUM;
+	BOOST_REQUIRE_EQUAL(fwrite(&magic_num, ETCHASH_DAG_MAGIC_NUM_SIZE, 1, f), 1U);
+	BOOST_REQUIRE_EQUAL(fwrite(data.data(), data.size(), 1, f), 1U);
+	fclose(f);
+	free(filename);
+
+	BOOST_REQUIRE_EQUAL(
+		ETCHASH_IO_MEMO_MATCH,
+		etchash_io_prepare("./test_etchash_directory/", seed, &f, full_size, false)
+	);
+	fclose(f);
+
+	etchash_full_t full = etchash_full_new_internal(
+		"./test_etchash_directory/",
+		seed,
+		full_size,
+		light,
+		NULL
+	);
+	BOOST_ASSERT(full);
+	BOOST_REQUIRE_EQUAL(full->header_size, (uint64_t)ETCHASH_DAG_MAGIC_NUM_SIZE);
+	BOOST_REQUIRE(memcmp(etchash_full_dag(full), data.data(), full_size) == 0);
+	etchash_return_value_t full_out = etchash_full_compute(full, hash, 0x7c7c597c);
+	etchash_return_value_t light_out = etchash_light_compute_internal(light, full_size, hash, 0x7c7c597c);
+	BOOST_REQUIRE(full_out.success);
+	BOOST_REQUIRE_EQUAL(blockhashToHexString(&full_out.result), blockhashToHexString(&light_out.result));
+
+	etchash_full_delete(full);
+	etchash_light_delete(light);
+	fs::remove_all("./test_etchash_directory/");
+}
+
+BOOST_AUTO_TEST_CASE(test_etchash_merkle_access_proof) {
+	uint64_t full_size;
+	uint64_t cache_size;
+	etchash_h256_t seed;
+	etchash_h256_t hash;
+	memcpy(&seed, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+	memcpy(&hash, "~~~X~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+
+	cache_size = 1024;
+	full_size = 1024 * 32;
+
+	etchash_light_t light = etchash_light_new_internal(cache_size, &seed);
+	etchash_full_t full = etchash_full_new_internal(
+		"./test_etchash_directory/",
+		seed,
+		full_size,
+		light,
+		NULL
+	);
+	BOOST_ASSERT(full);
+
+	// the root must not depend on the number of threads building the tree
+	etchash_merkle_tree_t single = etchash_merkle_tree_build(full, false);
+	etchash_merkle_tree_t tree = etchash_merkle_tree_new(full, "./test_etchash_directory/", &seed, true);
+	BOOST_ASSERT(single && tree);
+	etchash_h256_t root = etchash_merkle_tree_root(tree);
+	etchash_h256_t single_root = etchash_merkle_tree_root(single);
+	BOOST_REQUIRE_EQUAL(blockhashToHexString(&root), blockhashToHexString(&single_root));
+
+	// the second time around the tree comes from the on-disk cache
+	etchash_merkle_tree_t cached = etchash_merkle_tree_load("./test_etchash_directory/", &seed, full_size);
+	BOOST_ASSERT(cached);
+	etchash_h256_t cached_root = etchash_merkle_tree_root(cached);
+	BOOST_REQUIRE_EQUAL(blockhashToHexString(&root), blockhashToHexString(&cached_root));
+	BOOST_REQUIRE(!etchash_merkle_tree_load("./test_etchash_directory/", &seed, full_size * 2));
+
+	std::unique_ptr<etchash_access_proof_t> proof(new etchash_access_proof_t);
+	etchash_return_value_t proof_out = etchash_full_compute_with_proof(full, cached, hash, 0x7c7c597c, proof.get());
+	etchash_return_value_t full_out = etchash_full_compute(full, hash, 0x7c7c597c);
+	BOOST_REQUIRE(proof_out.success);
+	BOOST_REQUIRE_EQUAL(blockhashToHexString(&proof_out.result), blockhashToHexString(&full_out.result));
+	BOOST_REQUIRE_EQUAL(proof->depth, 8U);
+	for (unsigned i = 0; i < ETCHASH_ACCESSES; ++i) {
+		BOOST_REQUIRE(proof->indices[i] < full_size / ETCHASH_MIX_BYTES);
+		BOOST_REQUIRE(memcmp(proof->pages[i], (uint8_t const*)full->data + proof->indices[i] * ETCHASH_MIX_BYTES, ETCHASH_MIX_BYTES) == 0);
+		BOOST_REQUIRE(etchash_merkle_verify(&root, proof->pages[i], proof->indices[i], proof->branches[i], proof->depth));
+	}
+	// a tampered page or a wrong index must not verify
+	proof->pages[0][0] ^= 1;
+	BOOST_REQUIRE(!etchash_merkle_verify(&root, proof->pages[0], proof->indices[0], proof->branches[0], proof->depth));
+	proof->pages[0][0] ^= 1;
+	BOOST_REQUIRE(!etchash_merkle_verify(&root, proof->pages[0], proof->indices[0] ^ 1, proof->branches[0], proof->depth));
+
+	etchash_merkle_tree_delete(cached);
+	etchash_merkle_tree_delete(tree);
+	etchash_merkle_tree_delete(single);
+	etchash_full_delete(full);
+	etchash_light_delete(light);
+	fs::remove_all("./test_etchash_directory/");
+}
+
+BOOST_AUTO_TEST_CASE(test_etchash_access_trace) {
+	uint64_t full_size;
+	uint64_t cache_size;
+	etchash_h256_t seed;
+	etchash_h256_t hash;
+	memcpy(&seed, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+	memcpy(&hash, "~~~X~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+
+	cache_size = 1024;
+	full_size = 1024 * 32;
+
+	etchash_light_t light = etchash_light_new_internal(cache_size, &seed);
+	etchash_full_t full = etchash_full_new_internal(
+		"./test_etchash_directory/",
+		seed,
+		full_size,
+		light,
+		NULL
+	);
+	BOOST_ASSERT(full);
+
+	// the ring buffer keeps the last records only
+	etchash_trace_t ring = etchash_trace_new(4);
+	etchash_full_set_trace(full, ring);
+	etchash_light_set_trace(light, ring);
+	for (uint64_t nonce = 0; nonce < 5; ++nonce) {
+		etchash_full_compute(full, hash, nonce);
+	}
+	etchash_light_compute_internal(light, full_size, hash, 5);
+	etchash_full_set_trace(full, NULL);
+	etchash_light_set_trace(light, NULL);
+	etchash_full_compute(full, hash, 6);
+	BOOST_REQUIRE_EQUAL(etchash_trace_count(ring), 4U);
+	etchash_trace_record_t records[4];
+	BOOST_REQUIRE_EQUAL(etchash_trace_records(ring, records, 4), 4U);
+	for (unsigned r = 0; r < 4; ++r) {
+		BOOST_REQUIRE_EQUAL(records[r].nonce, r + 2);
+		uint32_t indices[ETCHASH_ACCESSES];
+		etchash_full_compute_indices(full, hash, records[r].nonce, indices);
+		BOOST_REQUIRE(memcmp(indices, records[r].pages, sizeof(indices)) == 0);
+	}
+	BOOST_REQUIRE_EQUAL(records[3].flags, ETCHASH_TRACE_LIGHT);
+	BOOST_REQUIRE_EQUAL(records[2].flags, 0U);
+	etchash_trace_delete(ring);
+
+	// file traces can be read back and analysed
+	etchash_trace_t file = etchash_trace_open("./test_etchash_trace", full_size);
+	BOOST_ASSERT(file);
+	etchash_full_set_trace(full, file);
+	for (uint64_t nonce = 0; nonce < 100; ++nonce) {
+		etchash_full_compute(full, hash, nonce);
+	}
+	etchash_full_set_trace(full, NULL);
+	etchash_trace_delete(file);
+
+	etchash_trace_record_t* loaded;
+	uint64_t count;
+	etchash_trace_layout_t layout = {};
+	BOOST_REQUIRE(etchash_trace_load("./test_etchash_trace", &loaded, &count, &layout.full_size));
+	BOOST_REQUIRE_EQUAL(count, 100U);
+	BOOST_REQUIRE_EQUAL(layout.full_size, full_size);
+	layout.numa_nodes = 2;
+	etchash_trace_stats_t stats;
+	BOOST_REQUIRE(etchash_trace_analyse(loaded, count, &layout, &stats));
+	free(loaded);
+	BOOST_REQUIRE_EQUAL(stats.accesses, 100U * ETCHASH_ACCESSES);
+	// 100 hashes touch nearly all of the 256 pages of the tiny DAG
+	BOOST_REQUIRE(stats.distinct_pages <= full_size / ETCHASH_MIX_BYTES);
+	BOOST_REQUIRE(stats.distinct_pages > 200);
+	BOOST_REQUIRE_EQUAL(stats.cold_accesses, stats.distinct_pages);
+	BOOST_REQUIRE_EQUAL(stats.distinct_4k, 8U);
+	BOOST_REQUIRE_EQUAL(stats.distinct_2m, 1U);
+	BOOST_REQUIRE_EQUAL(stats.numa_accesses[0] + stats.numa_accesses[1], stats.accesses);
+	uint64_t reuses = 0;
+	for (unsigned i = 0; i < 64; ++i) {
+		reuses += stats.reuse_histogram[i];
+	}
+	BOOST_REQUIRE_EQUAL(reuses + stats.cold_accesses, stats.accesses);
+
+	fs::remove("./test_etchash_trace");
+	etchash_full_delete(full);
+	etchash_light_delete(light);
+	fs::remove_all("./test_etchash_directory/");
+}
+
+BOOST_AUTO_TEST_CASE(test_etchash_auto_select) {
+	// a recorded host: 2 GiB cgroup limit with 512 MiB used, 1.5 cpus out of 8
+	fs::create_directories("./test_etchash_host/proc");
+	fs::create_directories("./test_etchash_host/sys/fs/cgroup");
+	fs::create_directories("./test_etchash_host/sys/devices/system/cpu");
+	fs::create_directories("./test_etchash_host/sys/devices/system/node");
+	std::ofstream("./test_etchash_host/proc/meminfo") <<
+		"MemTotal:       16777216 kB\n"
+		"MemAvailable:    8388608 kB\n"
+		"HugePages_Free:       16\n"
+		"Hugepagesize:       2048 kB\n";
+	std::ofstream("./test_etchash_host/sys/fs/cgroup/memory.max") << "2147483648\n";
+	std::ofstream("./test_etchash_host/sys/fs/cgroup/memory.current") << "536870912\n";
+	std::ofstream("./test_etchash_host/sys/fs/cgroup/cpu.max") << "150000 100000\n";
+	std::ofstream("./test_etchash_host/sys/devices/system/cpu/online") << "0-7\n";
+	std::ofstream("./test_etchash_host/sys/devices/system/node/online") << "0-1\n";
+
+	etchash_host_info_t host;
+	etchash_host_probe("./test_etchash_host", ".", &host);
+	fs::remove_all("./test_etchash_host");
+	BOOST_REQUIRE_EQUAL(host.memory_limit, 2048ULL << 20);
+	BOOST_REQUIRE_EQUAL(host.memory_available, 1536ULL << 20);
+	BOOST_REQUIRE_EQUAL(host.cpus, 8U);
+	BOOST_REQUIRE_CLOSE(host.cpu_quota, 1.5, 0.001);
+	BOOST_REQUIRE_EQUAL(host.numa_nodes, 2U);
+	BOOST_REQUIRE_EQUAL(host.hugepages_free, 32ULL << 20);
+	BOOST_REQUIRE(host.disk_free != ETCHASH_UNKNOWN_SIZE);
+
+	// 1 GiB fits in 1.5 GiB with the default 256 MiB headroom, quota rounds up
+	etchash_auto_choice_t choice;
+	host.disk_free = ETCHASH_UNKNOWN_SIZE;
+	etchash_auto_select(&host, NULL, 1024ULL << 20, 16ULL << 20, false, &choice);
+	BOOST_REQUIRE_EQUAL(choice.mode, ETCHASH_MODE_FULL);
+	BOOST_REQUIRE_EQUAL(choice.threads, 2U);
+	BOOST_REQUIRE(strstr(choice.reason, "full mode") != NULL);
+
+	// 1.5 GiB doesn't
+	etchash_auto_select(&host, NULL, 1536ULL << 20, 16ULL << 20, false, &choice);
+	BOOST_REQUIRE_EQUAL(choice.mode, ETCHASH_MODE_LIGHT);
+	BOOST_REQUIRE(strstr(choice.reason, "memory") != NULL);
+
+	// neither does a DAG file larger than the free disk space, unless it's there
+	host.disk_free = 512ULL << 20;
+	etchash_auto_select(&host, NULL, 1024ULL << 20, 16ULL << 20, false, &choice);
+	BOOST_REQUIRE_EQUAL(choice.mode, ETCHASH_MODE_LIGHT);
+	BOOST_REQUIRE(strstr(choice.reason, "disk") != NULL);
+	etchash_auto_select(&host, NULL, 1024ULL << 20, 16ULL << 20, true, &choice);
+	BOOST_REQUIRE_EQUAL(choice.mode, ETCHASH_MODE_FULL);
+
+	etchash_auto_policy_t policy = {};
+	policy.light_only = true;
+	policy.max_threads = 1;
+	etchash_auto_select(&host, &policy, 1024ULL << 20, 16ULL << 20, true, &choice);
+	BOOST_REQUIRE_EQUAL(choice.mode, ETCHASH_MODE_LIGHT);
+	BOOST_REQUIRE_EQUAL(choice.threads, 1U);
+
+	// the handler agrees with the plain light client
+	etchash_auto_t handler = etchash_auto_new(0, &policy);
+	BOOST_ASSERT(handler);
+	BOOST_REQUIRE(!handler->full);
+	etchash_auto_get_choice(handler, &choice);
+	BOOST_REQUIRE_EQUAL(choice.mode, ETCHASH_MODE_LIGHT);
+	etchash_h256_t hash;
+	memcpy(&hash, "~~~X~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+	etchash_return_value_t a = etchash_auto_compute(handler, hash, 42);
+	etchash_return_value_t b = etchash_light_compute(handler->light, hash, 42);
+	BOOST_REQUIRE(a.success && b.success);
+	BOOST_REQUIRE(memcmp(&a.result, &b.result, 32) == 0);
+	etchash_auto_delete(handler);
+}
+
+BOOST_AUTO_TEST_CASE(test_etchash_background_generation) {
+	uint64_t full_size;
+	uint64_t cache_size;
+	etchash_h256_t seed;
+	etchash_h256_t hash;
+	memcpy(&seed, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+	memcpy(&hash, "~~~X~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+
+	cache_size = 1024;
+	full_size = 1024 * 32;
+
+	etchash_background_options_t options = {};
+	options.dirname = "./test_etchash_directory/";
+	options.deadline_block = 1000;
+	options.escalate_blocks = 10;
+
+	// the generator waits for foreground work
+	etchash_foreground_begin();
+	etchash_background_t bg = etchash_background_new_internal(cache_size, &seed, full_size, &options);
+	BOOST_ASSERT(bg);
+	BOOST_REQUIRE(!etchash_background_wait(bg, 100));
+	etchash_background_status_t status;
+	etchash_background_status(bg, &status);
+	BOOST_REQUIRE(status.paused);
+	BOOST_REQUIRE(!status.escalated);
+	BOOST_REQUIRE(status.state == ETCHASH_BACKGROUND_CACHE);
+
+	// until the deadline gets close
+	etchash_background_set_head(bg, 995);
+	BOOST_REQUIRE(etchash_background_wait(bg, 10000));
+	etchash_foreground_end();
+	etchash_background_status(bg, &status);
+	BOOST_REQUIRE(status.state == ETCHASH_BACKGROUND_DONE);
+	BOOST_REQUIRE(status.escalated);
+	BOOST_REQUIRE(status.paused_ms > 0);
+
+	etchash_light_t light;
+	etchash_full_t full;
+	BOOST_REQUIRE(etchash_background_take(bg, &light, &full));
+	BOOST_REQUIRE(!etchash_background_take(bg, &light, &full));
+	etchash_background_delete(bg);
+	etchash_return_value_t a = etchash_full_compute(full, hash, 5);
+	etchash_return_value_t b = etchash_light_compute_internal(light, full_size, hash, 5);
+	BOOST_REQUIRE(a.success && b.success);
+	BOOST_REQUIRE(memcmp(&a.result, &b.result, 32) == 0);
+	etchash_full_delete(full);
+	etchash_light_delete(light);
+
+	// deleting a paused generator cancels it
+	etchash_foreground_begin();
+	bg = etchash_background_new_internal(cache_size, &seed, full_size * 2, &options);
+	BOOST_ASSERT(bg);
+	BOOST_REQUIRE(!etchash_background_wait(bg, 20));
+	etchash_background_delete(bg);
+	etchash_foreground_end();
+	fs::remove_all("./test_etchash_directory/");
+
+	// the light of a block hashes with the DAG size of its epoch. A sparse legacy
+	// DAG file stands in for the real one, which would take minutes to generate.
+	uint64_t const block = 30000;
+	uint64_t const block_full_size = etchash_get_datasize(block);
+	etchash_h256_t const block_seed = etchash_get_seedhash(block);
+	char mutable_name[DAG_MUTABLE_NAME_MAX_SIZE];
+	etchash_io_mutable_name(ETCHASH_REVISION, &block_seed, mutable_name);
+	fs::create_directories("./test_etchash_background_directory/");
+	std::string const dag_name = std::string("./test_etchash_background_directory/") + mutable_name;
+	FILE* f = fopen(dag_name.c_str(), "wb");
+	BOOST_ASSERT(f);
+	uint64_t const magic = ETCHASH_DAG_MAGIC_NUM;
+	BOOST_REQUIRE_EQUAL(fwrite(&magic, sizeof(magic), 1, f), 1u);
+	BOOST_REQUIRE_EQUAL(fseek(f, (long)(block_full_size + sizeof(magic) - 1), SEEK_SET), 0);
+	BOOST_REQUIRE(fputc(0, f) != EOF);
+	fclose(f);
+	etchash_background_options_t block_options = {};
+	block_options.dirname = "./test_etchash_background_directory/";
+	bg = etchash_background_new(block, &block_options);
+	BOOST_ASSERT(bg);
+	BOOST_REQUIRE(etchash_background_wait(bg, 60000));
+	BOOST_REQUIRE(etchash_background_take(bg, &light, &full));
+	etchash_background_delete(bg);
+	BOOST_REQUIRE_EQUAL(light->block_number, block);
+	a = etchash_light_compute(light, hash, 5);
+	b = etchash_light_compute_internal(light, block_full_size, hash, 5);
+	BOOST_REQUIRE(a.success && b.success);
+	BOOST_REQUIRE(memcmp(&a.result, &b.result, 32) == 0);
+	etchash_full_delete(full);
+	etchash_light_delete(light);
+	fs::remove_all("./test_etchash_background_directory/");
+}
+
+#ifndef _WIN32
+static unsigned g_peer_progress_calls = 0;
+static int peer_progress(etchash_progress_t const* progress, void* user)
+{
+	(void)user;
+	g_peer_progress_calls++;
+	BOOST_CHECK(progress->nodes_done <= progress->total_nodes);
+	return 0;
+}
+
+BOOST_AUTO_TEST_CASE(test_etchash_peer_dag_transfer) {
+	uint64_t full_size;
+	uint64_t cache_size;
+	etchash_h256_t seed;
+	memcpy(&seed, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+
+	cache_size = 1024;
+	full_size = 1024 * 32;
+
+	etchash_light_t light = etchash_light_new_internal(cache_size, &seed);
+	etchash_full_t served = etchash_full_new_internal(
+		"./test_etchash_directory/",
+		seed,
+		full_size,
+		light,
+		NULL
+	);
+	BOOST_ASSERT(served);
+	etchash_peer_server_t server = etchash_peer_server_new("unix:./test_etchash_peer.sock", "./test_etchash_directory/");
+	BOOST_ASSERT(server);
+
+	// the first peer doesn't exist, the second has the DAG
+	char const* peers[] = {"unix:./test_etchash_no_peer.sock", "unix:./test_etchash_peer.sock"};
+	etchash_full_options_t options = {};
+	options.progress_interval = 1;
+	options.peers = peers;
+	options.num_peers = 2;
+	g_peer_progress_calls = 0;
+	etchash_full_t fetched = etchash_full_new_internal_ex(
+		"./test_etchash_peer_directory/",
+		seed,
+		full_size,
+		light,
+		peer_progress,
+		NULL,
+		&options
+	);
+	BOOST_ASSERT(fetched);
+	// a single report instead of one per node
+	BOOST_REQUIRE_EQUAL(g_peer_progress_calls, 1U);
+	BOOST_REQUIRE(memcmp(etchash_full_dag(fetched), etchash_full_dag(served), full_size) == 0);
+	etchash_full_delete(fetched);
+
+	// the fetched DAG file is complete and reused as is
+	fetched = etchash_full_new_internal("./test_etchash_peer_directory/", seed, full_size, light, NULL);
+	BOOST_ASSERT(fetched);
+	BOOST_REQUIRE(memcmp(etchash_full_dag(fetched), etchash_full_dag(served), full_size) == 0);
+	etchash_full_delete(fetched);
+	fs::remove_all("./test_etchash_peer_directory/");
+
+	// corrupted data fails the sampled checks
+	std::vector<uint8_t> data(full_size);
+	memcpy(data.data(), etchash_full_dag(served), full_size);
+	BOOST_REQUIRE(etchash_peer_verify(data.data(), full_size, light, 0));
+	data[full_size - 1] ^= 1;
+	BOOST_REQUIRE(!etchash_peer_verify(data.data(), full_size, light, 0));
+
+	// a peer without the wanted DAG makes the client generate it
+	etchash_h256_t other_seed;
+	memcpy(&other_seed, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~X", 32);
+	etchash_light_t other_light = etchash_light_new_internal(cache_size, &other_seed);
+	options.num_peers = 2;
+	g_peer_progress_calls = 0;
+	fetched = etchash_full_new_internal_ex(
+		"./test_etchash_peer_directory/",
+		other_seed,
+		full_size,
+		other_light,
+		peer_progress,
+		NULL,
+		&options
+	);
+	BOOST_ASSERT(fetched);
+	BOOST_REQUIRE(g_peer_progress_calls > 1);
+	etchash_h256_t hash;
+	memcpy(&hash, "~~~X~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+	etchash_return_value_t a = etchash_full_compute(fetched, hash, 5);
+	etchash_return_value_t b = etchash_light_compute_internal(other_light, full_size, hash, 5);
+	BOOST_REQUIRE(memcmp(&a.result, &b.result, 32) == 0);
+	etchash_full_delete(fetched);
+	etchash_light_delete(other_light);
+
+	// a client that never sends its request does not hold up the others
+	int idle = socket(AF_UNIX, SOCK_STREAM, 0);
+	BOOST_REQUIRE(idle >= 0);
+	struct sockaddr_un idle_addr = {};
+	idle_addr.sun_family = AF_UNIX;
+	strcpy(idle_addr.sun_path, "./test_etchash_peer.sock");
+	BOOST_REQUIRE(connect(idle, (struct sockaddr*)&idle_addr, sizeof(idle_addr)) == 0);
+	std::vector<uint8_t> first(full_size);
+	std::vector<uint8_t> second(full_size);
+	bool first_ok = false;
+	bool second_ok = false;
+	auto const fetch_start = std::chrono::steady_clock::now();
+	std::thread first_fetch([&] {
+		first_ok = etchash_peer_fetch("unix:./test_etchash_peer.sock", &seed, full_size, light, first.data(), 0);
+	});
+	std::thread second_fetch([&] {
+		second_ok = etchash_peer_fetch("unix:./test_etchash_peer.sock", &seed, full_size, light, second.data(), 0);
+	});
+	first_fetch.join();
+	second_fetch.join();
+	BOOST_REQUIRE(std::chrono::steady_clock::now() - fetch_start < std::chrono::seconds(10));
+	BOOST_REQUIRE(first_ok);
+	BOOST_REQUIRE(second_ok);
+	BOOST_REQUIRE(memcmp(first.data(), etchash_full_dag(served), full_size) == 0);
+	BOOST_REQUIRE(memcmp(second.data(), etchash_full_dag(served), full_size) == 0);
+
+	// the server stops without waiting for the idle client to time out
+	auto const delete_start = std::chrono::steady_clock::now();
+	etchash_peer_server_delete(server);
+	BOOST_REQUIRE(std::chrono::steady_clock::now() - delete_start < std::chrono::seconds(10));
+	close(idle);
+	BOOST_REQUIRE(!fs::exists("./test_etchash_peer.sock"));
+	etchash_full_delete(served);
+	etchash_light_delete(light);
+	fs::remove_all("./test_etchash_peer_directory/");
+	fs::remove_all("./test_etchash_directory/");
+}
+#endif
+
+struct search_context {
+	std::mutex mutex;
+	std::vector<etchash_search_solution_t> solutions;
+	uint32_t current[8] = {};
+	unsigned stale = 0;
+};
+
+static void search_found(etchash_search_solution_t const* solution, void* user)
+{
+	search_context* ctx = (search_context*)user;
+	std::lock_guard<std::mutex> lock(ctx->mutex);
+	if (solution->generation < ctx->current[solution->job_id]) {
+		ctx->stale++;
+	}
+	ctx->solutions.push_back(*solution);
+}
+
+struct search_replace_context {
+	etchash_search_t search;
+	etchash_search_work_t work;
+	std::atomic<unsigned> replaced{0};
+	std::atomic<bool> removed{false};
+};
+
+// reacts to a solution by replacing its own job, then removes it
+static void search_found_replace(etchash_search_solution_t const* solution, void* user)
+{
+	search_replace_context* ctx = (search_replace_context*)user;
+	etchash_search_work_t work = ctx->work;
+	work.start_nonce = solution->nonce + 1;
+	if (solution->generation < 3) {
+		BOOST_CHECK(etchash_search_set_work(ctx->search, solution->job_id, &work));
+		ctx->replaced++;
+	} else {
+		etchash_search_remove(ctx->search, solution->job_id);
+		ctx->removed = true;
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_etchash_search_scheduler) {
+	uint64_t full_size;
+	uint64_t cache_size;
+	etchash_h256_t seed;
+	etchash_h256_t other_seed;
+	memcpy(&seed, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+	// DAG files are named after the first 8 bytes of the seed
+	memcpy(&other_seed, "X~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+
+	cache_size = 1024;
+	full_size = 1024 * 32;
+
+	etchash_light_t light = etchash_light_new_internal(cache_size, &seed);
+	etchash_full_t full = etchash_full_new_internal("./test_etchash_search_directory/", seed, full_size, light, NULL);
+	BOOST_ASSERT(full);
+	search_context ctx;
+	etchash_search_t search = etchash_search_new(2, "./test_etchash_search_directory/", search_found, &ctx);
+	BOOST_ASSERT(search);
+
+	// about one hash in 16 is a solution
+	etchash_search_work_t work = {};
+	work.full = full;
+	memset(&work.boundary, 0xff, 32);
+	work.boundary.b[0] = 0x10;
+	memcpy(&work.header_hash, "~~~A~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+	work.weight = 3;
+	BOOST_REQUIRE(etchash_search_set_work(search, 1, &work));
+	memcpy(&work.header_hash, "~~~B~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+	work.weight = 1;
+	work.start_nonce = 1ULL << 40;
+	BOOST_REQUIRE(etchash_search_set_work(search, 2, &work));
+	etchash_sleep_ms(300);
+
+	// hashes are shared by weight
+	etchash_search_stats_t a, b;
+	BOOST_REQUIRE(etchash_search_job_stats(search, 1, &a));
+	BOOST_REQUIRE(etchash_search_job_stats(search, 2, &b));
+	BOOST_REQUIRE(b.hashes > 0);
+	double ratio = (double)a.hashes / b.hashes;
+	BOOST_REQUIRE(ratio > 2.5 && ratio < 3.5);
+	BOOST_REQUIRE(a.hashrate > 0);
+
+	// no solution of the replaced work arrives after the call returns
+	memcpy(&work.header_hash, "~~~C~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+	work.weight = 3;
+	work.start_nonce = 0;
+	BOOST_REQUIRE(etchash_search_set_work(search, 1, &work));
+	{
+		std::lock_guard<std::mutex> lock(ctx.mutex);
+		ctx.current[1] = 1;
+	}
+	etchash_sleep_ms(50);
+	BOOST_REQUIRE(etchash_search_job_stats(search, 1, &a));
+	BOOST_REQUIRE_EQUAL(a.generation, 1U);
+
+	// a job of higher priority takes all threads until it is removed
+	memcpy(&work.header_hash, "~~~D~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+	work.weight = 1;
+	work.priority = 1;
+	BOOST_REQUIRE(etchash_search_set_work(search, 3, &work));
+	etchash_sleep_ms(50);
+	etchash_search_stats_t before, after;
+	BOOST_REQUIRE(etchash_search_job_stats(search, 1, &before));
+	etchash_sleep_ms(100);
+	BOOST_REQUIRE(etchash_search_job_stats(search, 1, &after));
+	BOOST_REQUIRE_EQUAL(before.hashes, after.hashes);
+	etchash_search_remove(search, 3);
+	BOOST_REQUIRE(!etchash_search_job_stats(search, 3, &after));
+	etchash_sleep_ms(100);
+	BOOST_REQUIRE(etchash_search_job_stats(search, 1, &after));
+	BOOST_REQUIRE(after.hashes > before.hashes);
+
+	// jobs of the same epoch share a scheduler created DAG
+	work.full = NULL;
+	work.priority = 2;
+	memcpy(&work.header_hash, "~~~E~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+	BOOST_REQUIRE(etchash_search_set_work_internal(search, 4, &work, cache_size, &other_seed, full_size));
+	memcpy(&work.header_hash, "~~~F~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+	BOOST_REQUIRE(etchash_search_set_work_internal(search, 5, &work, cache_size, &other_seed, full_size));
+	etchash_sleep_ms(100);
+	etchash_search_remove(search, 4);
+	etchash_search_remove(search, 5);
+	etchash_search_remove(search, 1);
+	etchash_search_remove(search, 2);
+	etchash_search_delete(search);
+
+	// the found callback replaces and removes its own job
+	search_replace_context replace;
+	replace.search = etchash_search_new(2, "./test_etchash_search_directory/", search_found_replace, &replace);
+	BOOST_ASSERT(replace.search);
+	replace.work = {};
+	replace.work.full = full;
+	memset(&replace.work.boundary, 0xff, 32);
+	replace.work.boundary.b[0] = 0x10;
+	memcpy(&replace.work.header_hash, "~~~G~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+	BOOST_REQUIRE(etchash_search_set_work(replace.search, 7, &replace.work));
+	for (unsigned i = 0; i != 500 && !replace.removed; ++i) {
+		etchash_sleep_ms(10);
+	}
+	BOOST_REQUIRE(replace.removed);
+	BOOST_REQUIRE(replace.replaced >= 3u);
+	BOOST_REQUIRE(!etchash_search_job_stats(replace.search, 7, &a));
+	etchash_search_delete(replace.search);
+
+	// every solution verifies against the header of its work
+	BOOST_REQUIRE_EQUAL(ctx.stale, 0U);
+	etchash_light_t other_light = etchash_light_new_internal(cache_size, &other_seed);
+	char const* headers[] = {"", "~~~A", "~~~B", "~~~D", "~~~E", "~~~F"};
+	unsigned checked[6] = {};
+	for (etchash_search_solution_t const& solution: ctx.solutions) {
+		uint32_t job = solution.job_id;
+		etchash_h256_t header;
+		memcpy(&header, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+		memcpy(&header, job == 1 && solution.generation == 1 ? "~~~C" : headers[job], 4);
+		if (checked[job]++ > 20) {
+			continue;
+		}
+		etchash_return_value_t ret = etchash_light_compute_internal(
+			job >= 4 ? other_light : light, full_size, header, solution.nonce
+		);
+		BOOST_REQUIRE(memcmp(&ret.result, &solution.result, 32) == 0);
+		BOOST_REQUIRE(memcmp(&ret.mix_hash, &solution.mix_hash, 32) == 0);
+	}
+	BOOST_REQUIRE(checked[1] && checked[2] && checked[3] && checked[4] && checked[5]);
+
+	etchash_light_delete(other_light);
+	etchash_full_delete(full);
+	etchash_light_delete(light);
+	fs::remove_all("./test_etchash_search_directory/");
+}
+
+static void budget_evict(void* user)
+{
+	etchash_full_t* full = (etchash_full_t*)user;
+	etchash_full_delete(*full);
+	*full = NULL;
+}
+
+BOOST_AUTO_TEST_CASE(test_etchash_memory_budget) {
+	uint64_t full_size;
+	uint64_t cache_size;
+	etchash_h256_t seed;
+	etchash_h256_t other_seed;
+	memcpy(&seed, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+	memcpy(&other_seed, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~X", 32);
+	char const* dirname = "./test_etchash_budget_directory/";
+
+	cache_size = 1024;
+	full_size = 1024 * 32;
+
+	etchash_budget_set(0, ETCHASH_BUDGET_LRU);
+	etchash_budget_usage_t base;
+	etchash_budget_usage(&base);
+
+	etchash_light_t light = etchash_light_new_internal(cache_size, &seed);
+	etchash_light_t other_light = etchash_light_new_internal(cache_size, &other_seed);
+	other_light->block_number = ETCHASH_EPOCH_LENGTH * 5;
+	etchash_full_t full = etchash_full_new_internal(dirname, seed, full_size, light, NULL);
+	BOOST_ASSERT(full);
+	etchash_budget_usage_t usage;
+	etchash_budget_usage(&usage);
+	BOOST_REQUIRE_EQUAL(usage.category[ETCHASH_BUDGET_CACHE] - base.category[ETCHASH_BUDGET_CACHE], 2 * cache_size);
+	BOOST_REQUIRE_EQUAL(usage.category[ETCHASH_BUDGET_DAG] - base.category[ETCHASH_BUDGET_DAG], full_size);
+	BOOST_REQUIRE_EQUAL(usage.entries[ETCHASH_BUDGET_DAG] - base.entries[ETCHASH_BUDGET_DAG], 1U);
+
+	// room for a single DAG, the evictable one makes room for the next
+	uint64_t limit = usage.used + full_size / 2;
+	etchash_budget_set(limit, ETCHASH_BUDGET_LRU);
+	etchash_budget_set_evict(full->budget, budget_evict, &full);
+	BOOST_REQUIRE(etchash_budget_fits(ETCHASH_BUDGET_DAG, full_size));
+	etchash_full_t other = etchash_full_new_internal(dirname, other_seed, full_size, other_light, NULL);
+	BOOST_ASSERT(other);
+	BOOST_REQUIRE(!full);
+	etchash_budget_usage(&usage);
+	BOOST_REQUIRE(usage.used <= limit);
+	BOOST_REQUIRE_EQUAL(usage.evictions - base.evictions, 1U);
+
+	// nothing is evictable, so another DAG is refused
+	BOOST_REQUIRE(!etchash_budget_fits(ETCHASH_BUDGET_DAG, full_size));
+	BOOST_REQUIRE(!etchash_full_new_internal(dirname, seed, full_size, light, NULL));
+	etchash_budget_usage(&usage);
+	BOOST_REQUIRE_EQUAL(usage.refusals - base.refusals, 1U);
+
+	// caches are always admitted
+	etchash_light_t extra = etchash_light_new_internal(cache_size, &seed);
+	BOOST_ASSERT(extra);
+	etchash_light_delete(extra);
+
+	// the current and the next epoch are kept
+	etchash_budget_set(limit, ETCHASH_BUDGET_KEEP_CURRENT);
+	etchash_budget_set_evict(other->budget, budget_evict, &other);
+	etchash_budget_set_head(ETCHASH_EPOCH_LENGTH * 4);
+	BOOST_REQUIRE(!etchash_full_new_internal(dirname, seed, full_size, light, NULL));
+	BOOST_REQUIRE(other);
+	etchash_budget_set_head(0);
+	full = etchash_full_new_internal(dirname, seed, full_size, light, NULL);
+	BOOST_ASSERT(full);
+	BOOST_REQUIRE(!other);
+
+	// the handle touched last is kept, even without an allocation in between
+	etchash_budget_set(0, ETCHASH_BUDGET_LRU);
+	other = etchash_full_new_internal(dirname, other_seed, full_size, other_light, NULL);
+	BOOST_ASSERT(other);
+	etchash_budget_set_evict(full->budget, budget_evict, &full);
+	etchash_budget_set_evict(other->budget, budget_evict, &other);
+	etchash_budget_touch(full->budget);
+	etchash_budget_touch(other->budget);
+	etchash_budget_usage(&usage);
+	etchash_budget_set(usage.used + full_size / 2, ETCHASH_BUDGET_LRU);
+	etchash_full_t third = etchash_full_new_internal(dirname, seed, full_size, light, NULL);
+	BOOST_ASSERT(third);
+	BOOST_REQUIRE(!full);
+	BOOST_REQUIRE(other);
+	full = third;
+
+	etchash_budget_set(0, ETCHASH_BUDGET_LRU);
+	etchash_full_delete(other);
+	etchash_full_delete(full);
+	etchash_light_delete(other_light);
+	etchash_light_delete(light);
+	etchash_budget_usage(&usage);
+	BOOST_REQUIRE_EQUAL(usage.used, base.used);
+	fs::remove_all(dirname);
+}
+
+BOOST_AUTO_TEST_CASE(test_etchash_full_compute_lanes) {
+	uint64_t full_size;
+	uint64_t cache_size;
+	etchash_h256_t seed;
+	etchash_h256_t hash;
+	memcpy(&seed, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+	memcpy(&hash, "~~~X~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+
+	// a page count that is no power of two exercises the lane wise modulo
+	cache_size = 1024;
+	full_size = 128 * 5003;
+
+	etchash_light_t light = etchash_light_new_internal(cache_size, &seed);
+	etchash_full_t full = etchash_full_new_internal("./test_etchash_lanes_directory/", seed, full_size, light, NULL);
+	BOOST_ASSERT(full);
+	BOOST_TEST_MESSAGE("lanes implementation: " << etchash_lanes_impl());
+
+	etchash_lanes_impl_t const impls[] = {ETCHASH_LANES_SCALAR, ETCHASH_LANES_AVX512};
+	for (etchash_lanes_impl_t impl: impls) {
+		for (uint64_t batch = 0; batch != 64; ++batch) {
+			uint64_t nonces[ETCHASH_LANES];
+			for (unsigned l = 0; l != ETCHASH_LANES; ++l) {
+				// unordered and far apart nonces
+				nonces[l] = (batch * ETCHASH_LANES + l) * 0x9E3779B97F4A7C15ULL;
+			}
+			etchash_return_value_t ret[ETCHASH_LANES];
+			etchash_full_compute_lanes_ex(full, hash, nonces, ret, impl);
+			for (unsigned l = 0; l != ETCHASH_LANES; ++l) {
+				etchash_return_value_t expected = etchash_full_compute(full, hash, nonces[l]);
+				BOOST_REQUIRE(ret[l].success);
+				BOOST_REQUIRE(memcmp(&ret[l].result, &expected.result, 32) == 0);
+				BOOST_REQUIRE(memcmp(&ret[l].mix_hash, &expected.mix_hash, 32) == 0);
+			}
+		}
+	}
+
+	etchash_full_delete(full);
+	etchash_light_delete(light);
+	fs::remove_all("./test_etchash_lanes_directory/");
+}
+
+// the first half of the DAG in memory, the rest calculated from the cache
+struct partial_dataset {
+	std::vector<uint8_t> head;
+	etchash_provider_t light;
+	unsigned fetches;
+	bool fail;
+};
+
+static bool partial_fetch(void* user, uint32_t const* items, unsigned count, void* out)
+{
+	partial_dataset* partial = (partial_dataset*)user;
+	partial->fetches++;
+	for (unsigned i = 0; i != count; ++i) {
+		uint8_t* item = (uint8_t*)out + i * ETCHASH_ITEM_BYTES;
+		if ((uint64_t)items[i] * ETCHASH_ITEM_BYTES < partial->head.size()) {
+			memcpy(item, &partial->head[items[i] * ETCHASH_ITEM_BYTES], ETCHASH_ITEM_BYTES);
+		} else if (partial->fail || !partial->light.fetch(partial->light.user, &items[i], 1, item)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+BOOST_AUTO_TEST_CASE(test_etchash_dataset_provider) {
+	uint64_t full_size;
+	uint64_t cache_size;
+	etchash_h256_t seed;
+	etchash_h256_t hash;
+	memcpy(&seed, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+	memcpy(&hash, "~~~X~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+
+	cache_size = 1024;
+	full_size = 1024 * 32;
+
+	etchash_light_t light = etchash_light_new_internal(cache_size, &seed);
+	etchash_full_t full = etchash_full_new_internal("./test_etchash_directory/", seed, full_size, light, NULL);
+	BOOST_ASSERT(full);
+
+	partial_dataset partial;
+	partial.head.assign((uint8_t const*)etchash_full_dag(full), (uint8_t const*)etchash_full_dag(full) + full_size / 2);
+	etchash_provider_from_light(&partial.light, light, full_size);
+	partial.fetches = 0;
+	partial.fail = false;
+	etchash_provider_t provider = {partial_fetch, &partial, full_size};
+	etchash_provider_t from_full;
+	etchash_provider_from_full(&from_full, full);
+
+	for (uint64_t nonce = 0; nonce != 32; ++nonce) {
+		etchash_return_value_t expected = etchash_full_compute(full, hash, nonce);
+		etchash_return_value_t a = etchash_compute_with_provider(&provider, hash, nonce);
+		etchash_return_value_t b = etchash_compute_with_provider(&from_full, hash, nonce);
+		BOOST_REQUIRE(a.success && b.success);
+		BOOST_REQUIRE(memcmp(&a.result, &expected.result, 32) == 0);
+		BOOST_REQUIRE(memcmp(&a.mix_hash, &expected.mix_hash, 32) == 0);
+		BOOST_REQUIRE(memcmp(&b.result, &expected.result, 32) == 0);
+	}
+	// one batch per DAG access
+	BOOST_REQUIRE_EQUAL(partial.fetches, 32U * ETCHASH_ACCESSES);
+
+	// missing items fail the hash
+	partial.fail = true;
+	BOOST_REQUIRE(!etchash_compute_with_provider(&provider, hash, 0).success);
+
+	etchash_full_delete(full);
+	etchash_light_delete(light);
+	fs::remove_all("./test_etchash_directory/");
+}
+
+BOOST_AUTO_TEST_CASE(test_etchash_watchdog_repairs_dag) {
+	uint64_t full_size;
+	uint64_t cache_size;
+	etchash_h256_t seed;
+	memcpy(&seed, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+
+	cache_size = 1024;
+	full_size = 1024 * 32;
+
+	etchash_light_t light = etchash_light_new_internal(cache_size, &seed);
+	etchash_full_t full = etchash_full_new_internal("./test_etchash_directory/", seed, full_size, light, NULL);
+	BOOST_ASSERT(full);
+	uint8_t* dag = (uint8_t*)etchash_full_dag(full);
+	std::vector<uint8_t> good(dag, dag + full_size);
+
+	// a flipped bit in every item, so the first cross check fails
+	uint64_t const items = full_size / 64;
+	for (uint64_t i = 0; i != items; ++i) {
+		dag[i * 64 + i % 64] ^= 0x10;
+	}
+	etchash_watchdog_options_t options = {};
+	options.items_per_batch = 1;
+	options.batch_interval_ms = 1;
+	options.cross_check_interval_ms = 1;
+	etchash_watchdog_t watchdog = etchash_watchdog_new(full, light, &options);
+	BOOST_ASSERT(watchdog);
+	etchash_watchdog_stats_t stats;
+	for (unsigned i = 0; i != 1000; ++i) {
+		etchash_watchdog_stats(watchdog, &stats);
+		if (stats.sweeps) {
+			break;
+		}
+		etchash_sleep_ms(10);
+	}
+	etchash_watchdog_delete(watchdog);
+
+	BOOST_REQUIRE(stats.sweeps >= 1);
+	BOOST_REQUIRE(stats.items_checked >= items);
+	BOOST_REQUIRE_EQUAL(stats.corrupt_items, items);
+	BOOST_REQUIRE_EQUAL(stats.repaired_items, items);
+	BOOST_REQUIRE(stats.cross_checks >= 1);
+	BOOST_REQUIRE(stats.cross_check_failures >= 1);
+	BOOST_REQUIRE(stats.last_corruption_ms > 0);
+	BOOST_REQUIRE(memcmp(dag, good.data(), full_size) == 0);
+
+	etchash_full_delete(full);
+	etchash_light_delete(light);
+	fs::remove_all("./test_etchash_directory/");
+}
+
+BOOST_AUTO_TEST_CASE(test_etchash_watchdog_keeps_dag_on_corrupt_cache) {
+	uint64_t full_size;
+	uint64_t cache_size;
+	etchash_h256_t seed;
+	memcpy(&seed, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+
+	cache_size = 1024;
+	full_size = 1024 * 32;
+
+	etchash_light_t light = etchash_light_new_internal(cache_size, &seed);
+	etchash_full_t full = etchash_full_new_internal("./test_etchash_directory/", seed, full_size, light, NULL);
+	BOOST_ASSERT(full);
+	uint8_t* dag = (uint8_t*)etchash_full_dag(full);
+
+	etchash_watchdog_options_t options = {};
+	options.items_per_batch = 64;
+	options.batch_interval_ms = 1;
+	options.cross_check_interval_ms = 1;
+	etchash_watchdog_t watchdog = etchash_watchdog_new(full, light, &options);
+	BOOST_ASSERT(watchdog);
+	// the cache goes bad after the watchdog took its digest, no item may be rewritten from it
+	((uint8_t*)light->cache)[0] ^= 0x01;
+	dag[0] ^= 0x10;
+	std::vector<uint8_t> flipped(dag, dag + full_size);
+	etchash_watchdog_stats_t stats;
+	for (unsigned i = 0; i != 1000; ++i) {
+		etchash_watchdog_stats(watchdog, &stats);
+		if (stats.cache_corruptions) {
+			break;
+		}
+		etchash_sleep_ms(10);
+	}
+	etchash_sleep_ms(50);
+	etchash_watchdog_stats(watchdog, &stats);
+	etchash_watchdog_delete(watchdog);
+
+	BOOST_REQUIRE_EQUAL(stats.cache_corruptions, 1);
+	BOOST_REQUIRE_EQUAL(stats.repaired_items, 0);
+	BOOST_REQUIRE(memcmp(dag, flipped.data(), full_size) == 0);
+
+	etchash_full_delete(full);
+	etchash_light_delete(light);
+	fs::remove_all("./test_etchash_directory/");
+}
+
+struct pool_sum_ctx {
+	std::vector<std::atomic<int>> hits;
+	std::atomic<uint64_t> sum;
+	explicit pool_sum_ctx(size_t n) : hits(n), sum(0) {}
+};
+
+static bool pool_sum_range(void* arg, uint64_t begin, uint64_t end)
+{
+	pool_sum_ctx* ctx = (pool_sum_ctx*)arg;
+	for (uint64_t i = begin; i != end; ++i) {
+		ctx->hits[i]++;
+		ctx->sum += i;
+	}
+	return true;
+}
+
+static bool pool_cancel_range(void* arg, uint64_t begin, uint64_t)
+{
+	(void)arg;
+	return begin < 50;
+}
+
+static std::atomic<unsigned> g_executor_tasks(0);
+
+static bool pool_thread_executor(void*, etchash_task_fn fn, void* arg)
+{
+	g_executor_tasks++;
+	std::thread(fn, arg).detach();
+	return true;
+}
+
+static void pool_count_task(void* arg)
+{
+	(*(std::atomic<unsigned>*)arg)++;
+}
+
+static int pool_progress(etchash_progress_t const* progress, void* user)
+{
+	uint64_t* last = (uint64_t*)user;
+	BOOST_REQUIRE(progress->nodes_done >= *last);
+	*last = progress->nodes_done;
+	return 0;
+}
+
+BOOST_AUTO_TEST_CASE(test_etchash_thread_pool) {
+	etchash_pool_options_t options = {};
+	options.threads = 4;
+	BOOST_REQUIRE(etchash_pool_configure(&options));
+	BOOST_REQUIRE_EQUAL(etchash_pool_concurrency(), 4u);
+
+	// every item exactly once, with the calling thread taking part
+	pool_sum_ctx ctx(10007);
+	BOOST_REQUIRE(etchash_parallel_for(10007, 13, pool_sum_range, &ctx));
+	for (size_t i = 0; i != ctx.hits.size(); ++i) {
+		BOOST_REQUIRE_EQUAL(ctx.hits[i].load(), 1);
+	}
+	BOOST_REQUIRE_EQUAL(ctx.sum.load(), (uint64_t)10007 * 10006 / 2);
+	BOOST_REQUIRE(!etchash_parallel_for(1000, 1, pool_cancel_range, NULL));
+
+	// the parallel DAG build matches the serial one
+	uint64_t full_size = 1024 * 32;
+	etchash_h256_t seed;
+	memcpy(&seed, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+	etchash_light_t light = etchash_light_new_internal(1024, &seed);
+	etchash_full_t serial = etchash_full_new_internal("./test_etchash_directory/", seed, full_size, light, NULL);
+	BOOST_ASSERT(serial);
+	etchash_full_options_t full_options = {};
+	full_options.parallel = true;
+	full_options.progress_interval = 7;
+	uint64_t last = 0;
+	etchash_full_t parallel = etchash_full_new_internal_ex(
+		"./test_etchash_pool_directory/", seed, full_size, light, pool_progress, &last, &full_options
+	);
+	BOOST_ASSERT(parallel);
+	BOOST_REQUIRE_EQUAL(last, full_size / 64);
+	BOOST_REQUIRE(memcmp(etchash_full_dag(serial), etchash_full_dag(parallel), full_size) == 0);
+
+	// an injected executor runs the library's tasks instead of the pool
+	etchash_executor_t executor = {};
+	executor.submit = pool_thread_executor;
+	executor.concurrency = 3;
+	etchash_pool_set_executor(&executor);
+	BOOST_REQUIRE_EQUAL(etchash_pool_concurrency(), 3u);
+	pool_sum_ctx injected(1000);
+	BOOST_REQUIRE(etchash_parallel_for(1000, 10, pool_sum_range, &injected));
+	BOOST_REQUIRE_EQUAL(injected.sum.load(), (uint64_t)1000 * 999 / 2);
+	BOOST_REQUIRE(g_executor_tasks.load() >= 1);
+	etchash_merkle_tree_t tree = etchash_merkle_tree_build(parallel, true);
+	etchash_merkle_tree_t single = etchash_merkle_tree_build(parallel, false);
+	BOOST_ASSERT(tree && single);
+	BOOST_REQUIRE(memcmp(etchash_merkle_tree_root(tree).b, etchash_merkle_tree_root(single).b, 32) == 0);
+	etchash_merkle_tree_delete(single);
+	etchash_merkle_tree_delete(tree);
+	etchash_pool_set_executor(NULL);
+
+	// tasks submitted while the pool is replaced or shut down all run
+	std::atomic<unsigned> submitted(0);
+	std::atomic<unsigned> ran(0);
+	std::atomic<bool> submitting(true);
+	std::vector<std::thread> submitters;
+	for (unsigned i = 0; i != 3; ++i) {
+		submitters.emplace_back([&] {
+			while (submitting) {
+				if (etchash_pool_submit(pool_count_task, &ran)) {
+					submitted++;
+				}
+			}
+		});
+	}
+	for (unsigned i = 0; i != 20; ++i) {
+		options.threads = 1 + i % 3;
+		BOOST_REQUIRE(etchash_pool_configure(&options));
+		if (i % 5 == 4) {
+			etchash_pool_shutdown();
+		}
+	}
+	submitting = false;
+	for (std::thread& t: submitters) {
+		t.join();
+	}
+	etchash_pool_shutdown();
+	BOOST_REQUIRE(submitted.load() > 0);
+	BOOST_REQUIRE_EQUAL(ran.load(), submitted.load());
+
+	etchash_full_delete(parallel);
+	etchash_full_delete(serial);
+	etchash_light_delete(light);
+	etchash_pool_shutdown();
+	fs::remove_all("./test_etchash_directory/");
+	fs::remove_all("./test_etchash_pool_directory/");
+}
+
+BOOST_AUTO_TEST_CASE(test_etchash_verify_routing) {
+	uint64_t full_size = 1024 * 32;
+	uint64_t cache_size = 1024;
+	etchash_h256_t seed;
+	etchash_h256_t header;
+	memcpy(&seed, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+	memcpy(&header, "~~~X~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+	etchash_h256_t easy;
+	etchash_h256_t impossible;
+	memset(&easy, 0xff, 32);
+	memset(&impossible, 0, 32);
+	uint64_t const nonce = 0x7c7c597c;
+
+	etchash_light_t reference = etchash_light_new_internal(cache_size, &seed);
+	etchash_return_value_t expected = etchash_light_compute_internal(reference, full_size, header, nonce);
+	etchash_light_delete(reference);
+	etchash_h256_t bad_mix = expected.mix_hash;
+	bad_mix.b[0] ^= 1;
+
+	// no cache or DAG of the epoch, one is built and kept
+	etchash_verify_stats_t before;
+	etchash_verify_stats_t after;
+	etchash_verify_stats(&before);
+	BOOST_REQUIRE(etchash_verify_internal(&seed, cache_size, full_size, &header, nonce, &expected.mix_hash, &easy));
+	BOOST_REQUIRE(!etchash_verify_internal(&seed, cache_size, full_size, &header, nonce, &bad_mix, &easy));
+	BOOST_REQUIRE(!etchash_verify_internal(&seed, cache_size, full_size, &header, nonce, &expected.mix_hash, &impossible));
+	etchash_verify_stats(&after);
+	BOOST_REQUIRE_EQUAL(after.caches_built - before.caches_built, 1u);
+	BOOST_REQUIRE_EQUAL(after.light - before.light, 2u);
+	BOOST_REQUIRE_EQUAL(after.rejected - before.rejected, 1u);
+	etchash_verify_release();
+
+	// threads verifying an epoch without a cache wait for a single build
+	etchash_verify_stats(&before);
+	std::vector<std::thread> threads;
+	std::atomic<unsigned> wrong(0);
+	for (unsigned i = 0; i != 4; ++i) {
+		threads.emplace_back([&] {
+			if (!etchash_verify_internal(&seed, cache_size, full_size, &header, nonce, &expected.mix_hash, &easy)) {
+				wrong++;
+			}
+		});
+	}
+	for (std::thread& t: threads) {
+		t.join();
+	}
+	etchash_verify_stats(&after);
+	BOOST_REQUIRE_EQUAL(wrong.load(), 0u);
+	BOOST_REQUIRE_EQUAL(after.caches_built - before.caches_built, 1u);
+
+	// alternating epochs keep their built caches
+	etchash_h256_t other_seed;
+	memcpy(&other_seed, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~X", 32);
+	etchash_light_t other = etchash_light_new_internal(cache_size, &other_seed);
+	etchash_return_value_t other_expected = etchash_light_compute_internal(other, full_size, header, nonce);
+	etchash_light_delete(other);
+	etchash_verify_stats(&before);
+	for (unsigned i = 0; i != 3; ++i) {
+		BOOST_REQUIRE(etchash_verify_internal(&seed, cache_size, full_size, &header, nonce, &expected.mix_hash, &easy));
+		BOOST_REQUIRE(etchash_verify_internal(&other_seed, cache_size, full_size, &header, nonce, &other_expected.mix_hash, &easy));
+	}
+	etchash_verify_stats(&after);
+	BOOST_REQUIRE_EQUAL(after.caches_built - before.caches_built, 1u);
+	BOOST_REQUIRE_EQUAL(after.light - before.light, 6u);
+	etchash_verify_release();
+
+	// a block's epoch is not even looked up for a proof that misses the boundary
+	etchash_verify_stats(&before);
+	BOOST_REQUIRE(!etchash_verify(ETCHASH_ACTIVATION_BLOCK, &header, nonce, &expected.mix_hash, &impossible));
+	etchash_verify_stats(&after);
+	BOOST_REQUIRE_EQUAL(after.rejected - before.rejected, 1u);
+	BOOST_REQUIRE_EQUAL(after.caches_built, before.caches_built);
+
+	// a resident DAG takes over
+	etchash_light_t light = etchash_light_new_internal(cache_size, &seed);
+	etchash_full_t full = etchash_full_new_internal("./test_etchash_directory/", seed, full_size, light, NULL);
+	BOOST_ASSERT(full);
+	etchash_verify_stats(&before);
+	BOOST_REQUIRE(etchash_verify_internal(&seed, cache_size, full_size, &header, nonce, &expected.mix_hash, &easy));
+	BOOST_REQUIRE(!etchash_verify_internal(&seed, cache_size, full_size, &header, nonce, &bad_mix, &easy));
+	etchash_verify_stats(&after);
+	BOOST_REQUIRE_EQUAL(after.full - before.full, 2u);
+	BOOST_REQUIRE_EQUAL(after.caches_built, before.caches_built);
+
+	// verifications stay right while the DAG is replaced under them
+	std::atomic<bool> done(false);
+	std::atomic<unsigned> failures(0);
+	std::thread verifier([&] {
+		while (!done) {
+			if (!etchash_verify_internal(&seed, cache_size, full_size, &header, nonce, &expected.mix_hash, &easy)) {
+				failures++;
+			}
+		}
+	});
+	for (unsigned i = 0; i != 5; ++i) {
+		etchash_full_delete(full);
+		full = etchash_full_new_internal("./test_etchash_directory/", seed, full_size, light, NULL);
+		BOOST_ASSERT(full);
+	}
+	done = true;
+	verifier.join();
+	BOOST_REQUIRE_EQUAL(failures.load(), 0u);
+
+	etchash_full_delete(full);
+	etchash_light_delete(light);
+	etchash_verify_release();
+	fs::remove_all("./test_etchash_directory/");
+}
+
+BOOST_AUTO_TEST_CASE(test_etchash_striped_dag) {
+	// 7 full chunks and a partial one over 3 stripes
+	uint64_t const full_size = 4096 * 7 + 1024;
+	etchash_h256_t seed;
+	etchash_h256_t hash;
+	memcpy(&seed, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+	memcpy(&hash, "~~~X~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+	etchash_light_t light = etchash_light_new_internal(1024, &seed);
+	etchash_full_t single = etchash_full_new_internal("./test_etchash_directory/", seed, full_size, light, NULL);
+	BOOST_ASSERT(single);
+
+	char const* dirs[] = {
+		"./test_etchash_stripe_0/",
+		"./test_etchash_stripe_1/",
+		"./test_etchash_stripe_2/"
+	};
+	etchash_full_options_t options = {};
+	options.dag_dirs = dirs;
+	options.num_dag_dirs = 3;
+	options.stripe_size = 4096;
+	for (unsigned pass = 0; pass != 2; ++pass) {
+		// generated the first time, mapped from the stripe files the second
+		etchash_full_t striped = etchash_full_new_internal_ex(NULL, seed, full_size, light, NULL, NULL, &options);
+		BOOST_ASSERT(striped);
+		BOOST_REQUIRE_EQUAL(etchash_full_dag_size(striped), full_size);
+		BOOST_REQUIRE(memcmp(etchash_full_dag(striped), etchash_full_dag(single), full_size) == 0);
+		etchash_return_value_t expected = etchash_full_compute(single, hash, 5);
+		etchash_return_value_t ret = etchash_full_compute(striped, hash, 5);
+		BOOST_REQUIRE(memcmp(&ret.mix_hash, &expected.mix_hash, 32) == 0);
+		etchash_full_delete(striped);
+	}
+	// chunks 0, 3, 6 / 1, 4, 7 (the partial one) / 2, 5
+	uint64_t const stripe_bytes[] = { 3 * 4096, 2 * 4096 + 1024, 2 * 4096 };
+	for (unsigned i = 0; i != 3; ++i) {
+		fs::directory_iterator it(dirs[i]);
+		BOOST_REQUIRE(it != fs::directory_iterator());
+		BOOST_REQUIRE_EQUAL(fs::file_size(it->path()), stripe_bytes[i] + ETCHASH_DAG_HEADER_SIZE);
+	}
+
+	etchash_full_delete(single);
+	etchash_light_delete(light);
+	fs::remove_all("./test_etchash_directory/");
+	for (char const* dir: dirs) {
+		fs::remove_all(dir);
+	}
+}
+
+static void pool_kind_task(void* arg)
+{
+	((std::atomic<int>*)arg)->fetch_add(1);
+}
+
+BOOST_AUTO_TEST_CASE(test_etchash_smt_pairing) {
+	unsigned cpus[16];
+	BOOST_REQUIRE_EQUAL(etchash_cpulist_parse("0-3,8,10-11\n", cpus, 16), 7u);
+	BOOST_REQUIRE_EQUAL(cpus[4], 8u);
+	BOOST_REQUIRE_EQUAL(cpus[6], 11u);
+	BOOST_REQUIRE_EQUAL(etchash_cpulist_parse("0-3,8", cpus, 2), 2u);
+
+	// every hyperthread belongs to one core only
+	static unsigned first[1024];
+	static unsigned second[1024];
+	unsigned const cores = etchash_topology_smt_pairs(first, second, 1024);
+	std::set<unsigned> seen;
+	for (unsigned c = 0; c != cores; ++c) {
+		BOOST_REQUIRE(first[c] != second[c]);
+		BOOST_REQUIRE(seen.insert(first[c]).second);
+		BOOST_REQUIRE(seen.insert(second[c]).second);
+	}
+
+	// work of either kind still runs on a paired pool, hyperthreads or not
+	etchash_pool_options_t options = {};
+	options.threads = 4;
+	options.smt_pairing = true;
+	BOOST_REQUIRE(etchash_pool_configure(&options));
+	BOOST_REQUIRE_EQUAL(etchash_pool_concurrency(), 4u);
+	for (etchash_work_kind_t kind: {ETCHASH_WORK_MEMORY, ETCHASH_WORK_COMPUTE, ETCHASH_WORK_ANY}) {
+		pool_sum_ctx ctx(5003);
+		BOOST_REQUIRE(etchash_parallel_for_kind(kind, 5003, 7, pool_sum_range, &ctx));
+		BOOST_REQUIRE_EQUAL(ctx.sum.load(), (uint64_t)5003 * 5002 / 2);
+	}
+	std::atomic<int> ran(0);
+	for (int i = 0; i != 16; ++i) {
+		BOOST_REQUIRE(etchash_pool_submit_kind(i % 2 ? ETCHASH_WORK_COMPUTE : ETCHASH_WORK_MEMORY, pool_kind_task, &ran));
+	}
+	for (int i = 0; i != 1000 && ran.load() != 16; ++i) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+	BOOST_REQUIRE_EQUAL(ran.load(), 16);
+	if (!cores) {
+		BOOST_REQUIRE(!etchash_pool_pin_thread(ETCHASH_WORK_COMPUTE));
+	}
+	etchash_pool_shutdown();
+}
+
+BOOST_AUTO_TEST_CASE(test_etchash_shard_emulated) {
+	uint64_t full_size = 1024 * 32;
+	etchash_h256_t seed;
+	etchash_h256_t hash;
+	memcpy(&seed, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+	memcpy(&hash, "~~~X~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+	etchash_light_t light = etchash_light_new_internal(1024, &seed);
+	etchash_full_t full = etchash_full_new_internal("./test_etchash_directory/", seed, full_size, light, NULL);
+	BOOST_ASSERT(full);
+
+	uint32_t const count = 200;
+	std::vector<uint64_t> nonces(count);
+	for (uint32_t i = 0; i != count; ++i) {
+		nonces[i] = 0x7c7c597cULL * i;
+	}
+	for (unsigned nodes: {1u, 2u, 3u}) {
+		// fewer jobs than nonces, so jobs are reused within a batch
+		etchash_shard_options_t options = {};
+		options.nodes = nodes;
+		options.threads_per_node = 2;
+		options.in_flight = 4;
+		options.emulate = true;
+		etchash_shard_t shard = nodes == 2 ?
+			etchash_shard_new_from_full(full, &options) :
+			etchash_shard_new(light, full_size, &options);
+		BOOST_ASSERT(shard);
+		std::vector<etchash_return_value_t> ret(count);
+		for (int batch = 0; batch != 2; ++batch) {
+			BOOST_REQUIRE(etchash_shard_compute(shard, hash, nonces.data(), count, ret.data()));
+			for (uint32_t i = 0; i != count; ++i) {
+				etchash_return_value_t const expected = etchash_full_compute(full, hash, nonces[i]);
+				BOOST_REQUIRE(ret[i].success);
+				BOOST_REQUIRE(memcmp(&ret[i].result, &expected.result, 32) == 0);
+				BOOST_REQUIRE(memcmp(&ret[i].mix_hash, &expected.mix_hash, 32) == 0);
+			}
+		}
+		BOOST_REQUIRE(etchash_shard_compute(shard, hash, NULL, 0, NULL));
+
+		etchash_shard_stats_t stats;
+		etchash_shard_stats(shard, &stats);
+		BOOST_REQUIRE_EQUAL(stats.nodes, nodes);
+		BOOST_REQUIRE_EQUAL(stats.hashes, 2u * count);
+		uint64_t accesses = 0;
+		uint64_t bytes = 0;
+		for (unsigned i = 0; i != stats.nodes; ++i) {
+			accesses += stats.accesses[i];
+			bytes += stats.shard_bytes[i];
+			BOOST_REQUIRE(stats.accesses[i] > 0);
+		}
+		BOOST_REQUIRE_EQUAL(accesses, 2ull * count * ETCHASH_ACCESSES);
+		BOOST_REQUIRE_EQUAL(bytes, full_size);
+		// a single shard never forwards, more of them nearly every access
+		if (nodes == 1) {
+			BOOST_REQUIRE_EQUAL(stats.forwards, 0u);
+		} else {
+			BOOST_REQUIRE(stats.forwards > count);
+		}
+		etchash_shard_delete(shard);
+	}
+
+	// the shards are accounted as a DAG
+	etchash_budget_usage_t usage;
+	etchash_budget_usage(&usage);
+	uint64_t const dags = usage.category[ETCHASH_BUDGET_DAG];
+	etchash_shard_options_t options = {};
+	options.nodes = 2;
+	options.threads_per_node = 1;
+	options.emulate = true;
+	etchash_shard_t shard = etchash_shard_new(light, full_size, &options);
+	BOOST_ASSERT(shard);
+	etchash_budget_usage(&usage);
+	BOOST_REQUIRE_EQUAL(usage.category[ETCHASH_BUDGET_DAG], dags + full_size);
+	etchash_shard_delete(shard);
+	etchash_budget_usage(&usage);
+	BOOST_REQUIRE_EQUAL(usage.category[ETCHASH_BUDGET_DAG], dags);
+	etchash_budget_set(usage.used + full_size / 2, ETCHASH_BUDGET_LRU);
+	BOOST_REQUIRE(!etchash_shard_new(light, full_size, &options));
+	etchash_budget_set(0, ETCHASH_BUDGET_LRU);
+
+	etchash_full_delete(full);
+	etchash_light_delete(light);
+	fs::remove_all("./test_etchash_directory/");
+}
+
+BOOST_AUTO_TEST_CASE(test_etchash_boundary) {
+	struct {
+		uint64_t high;
+		uint64_t low;
+		char const* boundary;
+	} const cases[] = {
+		{0, 0, "0000000000000000000000000000000000000000000000000000000000000000"},
+		{0, 1, "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff"},
+		{0, 2, "8000000000000000000000000000000000000000000000000000000000000000"},
+		{0, 3, "5555555555555555555555555555555555555555555555555555555555555555"},
+		{0, 1000000007, "000000044b82f98895147f23df9f377d4795fb1436c44a6bd07fdba1cb5f66e2"},
+		{1, 0, "0000000000000001000000000000000000000000000000000000000000000000"},
+		{1, 12345, "0000000000000000ffffffffffffcfc70000000009156cb0fffffe49f5d99c97"},
+		{0x8000000000000000ULL, 3, "00000000000000000000000000000001fffffffffffffffffffffffffffffff4"},
+		{~0ULL, ~0ULL, "0000000000000000000000000000000100000000000000000000000000000001"},
+		{0xdeadbeefcafebabeULL, 0x0123456789abcdefULL, "00000000000000000000000000000001264eb564b347462c1b4de06397062353"},
+	};
+	for (auto const& c: cases) {
+		etchash_h256_t boundary = etchash_difficulty128_to_boundary(c.high, c.low);
+		BOOST_REQUIRE_EQUAL(blockhashToHexString(&boundary), c.boundary);
+		if (!c.high) {
+			etchash_h256_t narrow = etchash_difficulty_to_boundary(c.low);
+			BOOST_REQUIRE(memcmp(&narrow, &boundary, 32) == 0);
+		}
+	}
+
+	// the word compare agrees with the byte compare, around and at the boundary
+	etchash_h256_t boundary = etchash_difficulty_to_boundary(1000000007);
+	for (unsigned i = 0; i != 32; ++i) {
+		for (int delta: {-1, 0, 1}) {
+			etchash_h256_t hash = boundary;
+			hash.b[i] = (uint8_t)(hash.b[i] + delta);
+			BOOST_REQUIRE_EQUAL(etchash_boundary_check(&hash, &boundary), etchash_check_difficulty(&hash, &boundary));
+		}
+	}
+
+	uint64_t full_size = 1024 * 32;
+	etchash_h256_t seed;
+	etchash_h256_t hash;
+	memcpy(&seed, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+	memcpy(&hash, "~~~X~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+	etchash_light_t light = etchash_light_new_internal(1024, &seed);
+	etchash_return_value_t const ret = etchash_light_compute_internal(light, full_size, hash, 5);
+	BOOST_REQUIRE(ret.success);
+	etchash_h256_t const easy = etchash_difficulty_to_boundary(1);
+	etchash_h256_t wrong = ret.mix_hash;
+	wrong.b[0] ^= 1;
+	BOOST_REQUIRE(etchash_light_verify_internal(light, full_size, hash, 5, ret.mix_hash, easy));
+	BOOST_REQUIRE(etchash_light_verify_internal(light, full_size, hash, 5, ret.mix_hash, ret.result));
+	BOOST_REQUIRE(!etchash_light_verify_internal(light, full_size, hash, 5, wrong, easy));
+	BOOST_REQUIRE(!etchash_light_verify_internal(light, full_size, hash, 6, ret.mix_hash, easy));
+	// a boundary just below the result
+	etchash_h256_t below = ret.result;
+	int i = 31;
+	while (below.b[i] == 0) {
+		below.b[i--] = 0xff;
+	}
+	below.b[i]--;
+	BOOST_REQUIRE(!etchash_light_verify_internal(light, full_size, hash, 5, ret.mix_hash, below));
+	BOOST_REQUIRE(!etchash_light_verify(light, hash, 5, ret.mix_hash, 0));
+	etchash_light_delete(light);
+}
+
+struct chunk_hook_ctx {
+	std::mutex mutex;
+	std::vector<uint8_t> copy;
+	std::vector<std::pair<uint64_t, uint64_t>> ranges;
+	std::set<void const*> data;
+	etchash_merkle_tree_t tree;
+	bool cancel;
+};
+
+static int chunk_hook_record(etchash_chunk_t const* chunk, void* user)
+{
+	chunk_hook_ctx* ctx = (chunk_hook_ctx*)user;
+	if (ctx->cancel) {
+		return 1;
+	}
+	{
+		std::lock_guard<std::mutex> lock(ctx->mutex);
+		BOOST_REQUIRE_EQUAL(chunk->size, (chunk->end_node - chunk->first_node) * 64);
+		memcpy(&ctx->copy[chunk->first_node * 64], chunk->data, chunk->size);
+		ctx->ranges.push_back(std::make_pair(chunk->first_node, chunk->end_node));
+		ctx->data.insert((uint8_t const*)chunk->data - chunk->first_node * 64);
+	}
+	return etchash_merkle_chunk_hook(chunk, ctx->tree);
+}
+
+BOOST_AUTO_TEST_CASE(test_etchash_chunk_hook) {
+	// 4000 nodes, chunks of 300 nodes are rounded up to 512 so the last one is short
+	uint64_t full_size = 64 * 4000;
+	etchash_h256_t seed;
+	memcpy(&seed, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~H", 32);
+	etchash_light_t light = etchash_light_new_internal(1024, &seed);
+	for (bool parallel: {false, true}) {
+		chunk_hook_ctx ctx;
+		ctx.copy.resize(full_size);
+		ctx.tree = etchash_merkle_tree_begin(full_size);
+		ctx.cancel = false;
+		etchash_full_options_t options = {};
+		options.parallel = parallel;
+		options.chunk_hook = chunk_hook_record;
+		options.chunk_user = &ctx;
+		options.chunk_nodes = 300;
+		etchash_full_t full = etchash_full_new_internal_ex(
+			"./test_etchash_chunk_directory/", seed, full_size, light, NULL, NULL, &options
+		);
+		BOOST_ASSERT(full);
+
+		// every node in exactly one chunk, each of them complete when it was hooked
+		std::sort(ctx.ranges.begin(), ctx.ranges.end());
+		BOOST_REQUIRE_EQUAL(ctx.ranges.size(), 8u);
+		for (size_t i = 0; i != ctx.ranges.size(); ++i) {
+			BOOST_REQUIRE_EQUAL(ctx.ranges[i].first, i * 512);
+			BOOST_REQUIRE_EQUAL(ctx.ranges[i].second, std::min<uint64_t>((i + 1) * 512, 4000));
+		}
+		BOOST_REQUIRE_EQUAL(ctx.data.size(), 1u);
+		BOOST_REQUIRE(*ctx.data.begin() == etchash_full_dag(full));
+		BOOST_REQUIRE(memcmp(ctx.copy.data(), etchash_full_dag(full), full_size) == 0);
+
+		// the tree built along the way is the one built from the finished DAG
+		BOOST_REQUIRE(etchash_merkle_tree_finish(ctx.tree, NULL));
+		etchash_merkle_tree_t built = etchash_merkle_tree_build(full, false);
+		BOOST_REQUIRE(memcmp(etchash_merkle_tree_root(ctx.tree).b, etchash_merkle_tree_root(built).b, 32) == 0);
+		etchash_merkle_tree_delete(ctx.tree);
+		etchash_full_delete(full);
+
+		// loaded from disk, no chunk is hooked and the tree hashes the mapped DAG
+		chunk_hook_ctx loaded;
+		loaded.copy.resize(full_size);
+		loaded.tree = etchash_merkle_tree_begin(full_size);
+		loaded.cancel = false;
+		options.chunk_user = &loaded;
+		full = etchash_full_new_internal_ex(
+			"./test_etchash_chunk_directory/", seed, full_size, light, NULL, NULL, &options
+		);
+		BOOST_ASSERT(full);
+		BOOST_REQUIRE(loaded.ranges.empty());
+		BOOST_REQUIRE(!etchash_merkle_tree_finish(loaded.tree, NULL));
+		BOOST_REQUIRE(etchash_merkle_tree_finish(loaded.tree, full));
+		BOOST_REQUIRE(memcmp(etchash_merkle_tree_root(loaded.tree).b, etchash_merkle_tree_root(built).b, 32) == 0);
+		etchash_merkle_tree_delete(loaded.tree);
+		etchash_merkle_tree_delete(built);
+		etchash_full_delete(full);
+		fs::remove_all("./test_etchash_chunk_directory/");
+	}
+
+	// a hook cancels the generation
+	chunk_hook_ctx ctx;
+	ctx.copy.resize(full_size);
+	ctx.tree = NULL;
+	ctx.cancel = true;
+	etchash_full_options_t options = {};
+	options.chunk_hook = chunk_hook_record;
+	options.chunk_user = &ctx;
+	BOOST_REQUIRE(!etchash_full_new_internal_ex(
+		"./test_etchash_chunk_directory/", seed, full_size, light, NULL, NULL, &options
+	));
+	fs::remove_all("./test_etchash_chunk_directory/");
+	etchash_light_delete(light);
+}
+
+BOOST_AUTO_TEST_CASE(test_etchash_epoch_context) {
+	// the reciprocal modulus is exact
+	uint32_t const divisors[] = {1, 2, 3, 7, 16, 256, 8388593, 0x7fffffff, 0x80000001, 0xffffffff};
+	for (uint32_t d: divisors) {
+		etchash_divisor_t const divisor = etchash_divisor_make(d);
+		uint32_t x = 0x9e3779b9;
+		for (int i = 0; i != 10000; ++i) {
+			x = x * 1664525 + 1013904223;
+			BOOST_REQUIRE_EQUAL(etchash_fastmod(x, divisor), x % d);
+		}
+		for (uint32_t edge: {0u, 1u, d - 1, d, 0xfffffffeu, 0xffffffffu}) {
+			BOOST_REQUIRE_EQUAL(etchash_fastmod(edge, divisor), edge % d);
+		}
+	}
+
+	uint64_t full_size = 1024 * 32;
+	etchash_h256_t seed;
+	etchash_h256_t hash;
+	memcpy(&seed, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~E", 32);
+	memcpy(&hash, "~~~X~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+	etchash_full_options_t options = {};
+	options.dirname = "./test_etchash_epoch_directory/";
+	etchash_epoch_context_t const* light = etchash_epoch_context_new_internal(
+		11700005, &seed, 1024, full_size, false, NULL, NULL, NULL
+	);
+	etchash_epoch_context_t const* full = etchash_epoch_context_new_internal(
+		5, &seed, 1024, full_size, true, NULL, NULL, &options
+	);
+	BOOST_ASSERT(light && full);
+	BOOST_REQUIRE_EQUAL(light->epoch_number, 195u);
+	BOOST_REQUIRE_EQUAL(light->epoch_length, 60000u);
+	BOOST_REQUIRE_EQUAL(light->first_block, 11700000u);
+	BOOST_REQUIRE_EQUAL(full->epoch_number, 0u);
+	BOOST_REQUIRE_EQUAL(full->epoch_length, 30000u);
+	BOOST_REQUIRE_EQUAL(full->full_nodes, 512u);
+	BOOST_REQUIRE_EQUAL(full->cache_nodes.divisor, 16u);
+	BOOST_REQUIRE_EQUAL(full->full_pages.divisor, 256u);
+	BOOST_REQUIRE(!light->full && full->full);
+
+	// both modes agree with the block number based entry points
+	uint32_t const count = 37;
+	std::vector<uint64_t> nonces(count);
+	std::vector<etchash_return_value_t> batch(count);
+	for (uint32_t i = 0; i != count; ++i) {
+		nonces[i] = 0x7c7c597cULL * i;
+	}
+	etchash_epoch_compute_batch(full, hash, nonces.data(), count, batch.data());
+	for (uint32_t i = 0; i != count; ++i) {
+		etchash_return_value_t const expected = etchash_full_compute(full->full, hash, nonces[i]);
+		etchash_return_value_t const from_light = etchash_epoch_compute(light, hash, nonces[i]);
+		etchash_return_value_t const legacy = etchash_light_compute_internal(light->light, full_size, hash, nonces[i]);
+		BOOST_REQUIRE(batch[i].success && from_light.success);
+		BOOST_REQUIRE(memcmp(&batch[i], &expected, 64) == 0);
+		BOOST_REQUIRE(memcmp(&from_light, &expected, 64) == 0);
+		BOOST_REQUIRE(memcmp(&legacy, &expected, 64) == 0);
+	}
+
+	etchash_h256_t const easy = etchash_difficulty_to_boundary(1);
+	etchash_h256_t wrong = batch[3].mix_hash;
+	wrong.b[5] ^= 1;
+	BOOST_REQUIRE(etchash_epoch_verify(light, hash, nonces[3], batch[3].mix_hash, batch[3].result));
+	BOOST_REQUIRE(etchash_epoch_verify(full, hash, nonces[3], batch[3].mix_hash, easy));
+	BOOST_REQUIRE(!etchash_epoch_verify(full, hash, nonces[3], wrong, easy));
+	BOOST_REQUIRE(!etchash_epoch_verify(full, hash, nonces[3], batch[3].mix_hash, etchash_difficulty_to_boundary(~0ULL)));
+
+	// the last reference frees the context
+	BOOST_REQUIRE(etchash_epoch_context_acquire(full) == full);
+	etchash_epoch_context_release(full);
+	BOOST_REQUIRE_EQUAL(full->refs, 1);
+	etchash_epoch_context_release(full);
+	etchash_epoch_context_release(light);
+	fs::remove_all("./test_etchash_epoch_directory/");
+
+	// the real epoch facts
+	etchash_epoch_context_t const* epoch = etchash_epoch_context_new(30001);
+	BOOST_ASSERT(epoch);
+	etchash_h256_t const seedhash = etchash_get_seedhash(30001);
+	BOOST_REQUIRE(memcmp(&epoch->seedhash, &seedhash, 32) == 0);
+	BOOST_REQUIRE_EQUAL(epoch->cache_size, etchash_get_cachesize(30001));
+	BOOST_REQUIRE_EQUAL(epoch->full_size, etchash_get_datasize(30001));
+	BOOST_REQUIRE_EQUAL(epoch->first_block, 30000u);
+	etchash_return_value_t const ret = etchash_epoch_compute(epoch, hash, 5);
+	etchash_return_value_t const expected = etchash_light_compute(epoch->light, hash, 5);
+	BOOST_REQUIRE(memcmp(&ret, &expected, 64) == 0);
+	etchash_epoch_context_release(epoch);
+}
+
 static bool g_executed = false;
 static unsigned g_prev_progress = 0;
 static int test_full_callback(unsigned _progress)
@@ -569,6 +2260,74 @@ BOOST_AUTO_TEST_CASE(failing_full_client_callback) {
 	fs::remove_all("./test_etchash_directory/");
 }
 
+struct progress_job {
+	uint64_t reports;
+	uint64_t last_done;
+	uint64_t total;
+	uint64_t cancel_at;
+};
+
+static int test_progress_callback(etchash_progress_t const* _progress, void* _user)
+{
+	progress_job* job = (progress_job*)_user;
+	BOOST_CHECK(_progress->nodes_done >= job->last_done);
+	job->reports++;
+	job->last_done = _progress->nodes_done;
+	job->total = _progress->total_nodes;
+	return job->cancel_at && _progress->nodes_done >= job->cancel_at ? 1 : 0;
+}
+
+BOOST_AUTO_TEST_CASE(full_client_progress_callback_with_user_data) {
+	uint64_t full_size;
+	uint64_t cache_size;
+	etchash_h256_t seed;
+	memcpy(&seed, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~", 32);
+
+	cache_size = 1024;
+	full_size = 1024 * 32;
+
+	progress_job cache_job = {};
+	etchash_light_t light = etchash_light_new_internal_ex(cache_size, &seed, test_progress_callback, &cache_job);
+	BOOST_ASSERT(light);
+	BOOST_REQUIRE_EQUAL(cache_job.total, (cache_size / 64) * (1 + ETCHASH_CACHE_ROUNDS));
+	BOOST_REQUIRE_EQUAL(cache_job.last_done, cache_job.total);
+
+	// two jobs reporting through the same callback, one of which gets cancelled
+	progress_job job = {};
+	progress_job cancelled_job = {};
+	cancelled_job.cancel_at = 100;
+	etchash_full_options_t options = {};
+	options.progress_interval = 16;
+	etchash_full_t cancelled = etchash_full_new_internal_ex(
+		"./test_etchash_directory/",
+		seed,
+		full_size,
+		light,
+		test_progress_callback,
+		&cancelled_job,
+		&options
+	);
+	BOOST_REQUIRE(!cancelled);
+	BOOST_REQUIRE(cancelled_job.last_done < full_size / 64);
+	etchash_full_t full = etchash_full_new_internal_ex(
+		"./test_etchash_directory/",
+		seed,
+		full_size,
+		light,
+		test_progress_callback,
+		&job,
+		&options
+	);
+	BOOST_ASSERT(full);
+	BOOST_REQUIRE_EQUAL(job.total, full_size / 64);
+	BOOST_REQUIRE_EQUAL(job.last_done, job.total);
+	BOOST_REQUIRE_EQUAL(job.reports, full_size / 64 / 16 + 1);
+
+	etchash_full_delete(full);
+	etchash_light_delete(light);
+	fs::remove_all("./test_etchash_directory/");
+}
+
 BOOST_AUTO_TEST_CASE(test_incomplete_dag_file) {
 	uint64_t full_size;
 	uint64_t cache_size;
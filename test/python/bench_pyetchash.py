@@ -0,0 +1,36 @@
+# Python numbers for the cross-binding benchmark report, see test/bench.sh.
+# Prints one tab separated line per measurement:
+#
+#     binding  operation  granularity  hashes  ns/hash
+#
+# mkcache_bytes copies the whole cache into a bytes object, its cost on top of
+# the C cache generation shows up as the cache_generate overhead.
+import sys
+import time
+import pyetchash
+
+scale = int(sys.argv[1]) if len(sys.argv) > 1 else 1
+header = b"~~~X" + b"~" * 28
+
+
+def report(op, granularity, hashes, seconds):
+    print("python\t%s\t%s\t%d\t%.1f" % (op, granularity, hashes, seconds * 1e9 / hashes))
+    sys.stdout.flush()
+
+
+start = time.perf_counter()
+cache = pyetchash.mkcache_bytes(0)
+report("cache_generate", "single", 1, time.perf_counter() - start)
+
+calls = 50 * scale
+start = time.perf_counter()
+for nonce in range(calls):
+    pyetchash.hashimoto_light(0, cache, header, nonce)
+report("light_verify", "single", calls, time.perf_counter() - start)
+
+# the same calls without the attribute lookups, leaving the argument parsing
+# and result dict building of the extension
+light = pyetchash.hashimoto_light
+start = time.perf_counter()
+results = [light(0, cache, header, nonce) for nonce in range(calls)]
+report("light_verify", "batch", calls, time.perf_counter() - start)
@@ -65,6 +65,28 @@ def int_to_bytes(i):
     b.reverse()
     return "".join(b)
 
+def test_difficulty_to_boundary():
+    for difficulty in [1, 2, 3, 132416, 2**64, 2**64 + 12345, 2**128 - 1]:
+        expected = min(2**256 // difficulty, 2**256 - 1)
+        boundary = pyetchash.difficulty_to_boundary(difficulty)
+        assert len(boundary) == 32
+        assert int.from_bytes(boundary, "big") == expected
+    assert pyetchash.difficulty_to_boundary(0) == bytes(32)
+
+def test_light_verify():
+    cache = pyetchash.mkcache_bytes(0)
+    header = b"~~~~~X~~~~~~~~~~~~~~~~~~~~~~~~~~"
+    light_result = pyetchash.hashimoto_light(0, cache, header, 5)
+    mix = light_result[b"mix digest"]
+    result = int.from_bytes(light_result[b"result"], "big")
+    # the hardest difficulty the result still meets, and the next one
+    difficulty = 2**256 // result
+    assert pyetchash.light_verify(0, cache, header, 5, mix, difficulty)
+    assert not pyetchash.light_verify(0, cache, header, 5, mix, difficulty + 1)
+    assert not pyetchash.light_verify(0, cache, header, 6, mix, 1)
+    assert not pyetchash.light_verify(0, cache, header, 5, bytes(32), 1)
+    assert not pyetchash.light_verify(0, cache, header, 5, mix, 0)
+
 def test_mining_basic():
     easy_difficulty = int_to_bytes(2**256 - 1)
     assert easy_difficulty.encode('hex') == 'f' * 64
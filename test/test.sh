@@ -19,6 +19,12 @@ if [ -x "$(which nodejs)" ] ; then
 fi
 if [ -x "$(which node)" ] ; then 
 	node test.js
+	# a configured WebAssembly build must have produced the module, see src/wasm
+	if [ -f "$TEST_DIR/../build_wasm/CMakeCache.txt" ] ; then
+		ETCHASH_WASM_REQUIRED=1 node test_wasm.js
+	else
+		node test_wasm.js
+	fi
 fi
 
 echo -e "\n################# Testing C ##################"